@@ -1,26 +1,153 @@
 #pragma once
 
 #include <unordered_map>
+#include <unordered_set>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <resource/texture.h>
 #include <resource/material.h>
 #include <resource/mesh.h>
 #include <resource/scene.h>
 #include <gfx/vk.h>
+#include <gfx/shader_cache.h>
 #include <common/scene.h>
+#include <utility/file_watcher.h>
+
+namespace ast
+{
+struct Image;
+struct Material;
+struct Mesh;
+} // namespace ast
 
 namespace helios
 {
+struct MemoryStatistics
+{
+    vk::MemoryBudget device;
+    VkDeviceSize     budget               = 0; // Limit enforced by the residency manager
+    VkDeviceSize     texture_bytes        = 0;
+    VkDeviceSize     mesh_bytes           = 0;
+    uint32_t         num_textures         = 0;
+    uint32_t         num_evicted_textures = 0;
+    uint32_t         num_meshes           = 0;
+};
+
+struct SceneLoadAsset;
+
+// Progress of a scene opened through ResourceManager::load_scene_async(). The scene graph exists from the start, a worker thread reads
+// the asset files in the background and ResourceManager::update_scene_loads() uploads them a few at a time every frame. Meshes show
+// up as soon as their BLAS is built, with their materials at first missing the textures that are still on their way. Dropping the
+// handle cancels the load.
+class SceneLoad
+{
+public:
+    using Ptr = std::shared_ptr<SceneLoad>;
+
+    friend class ResourceManager;
+
+public:
+    ~SceneLoad();
+
+    inline Scene::Ptr scene() { return m_scene; }
+    inline uint32_t   num_assets() { return m_num_assets; }
+    inline uint32_t   num_loaded_assets() { return m_num_loaded_assets; }
+    inline uint32_t   num_meshes() { return m_num_meshes; }
+    inline uint32_t   num_loaded_meshes() { return m_num_loaded_meshes; }
+    inline float      progress() { return m_num_assets == 0 ? 1.0f : float(m_num_loaded_assets) / float(m_num_assets); }
+    inline bool       is_complete() { return m_is_complete; }
+
+private:
+    // A material created before all of its textures were loaded, completed once they are.
+    struct PendingMaterial
+    {
+        Material::Ptr                  material;
+        std::string                    full_path;
+        std::shared_ptr<ast::Material> ast_material;
+    };
+
+    // A mesh whose alpha tested triangles were sorted before the textures of its materials arrived, sorted again once they have.
+    struct DeferredMesh
+    {
+        Mesh::Ptr                  mesh;
+        std::string                full_path;
+        std::shared_ptr<ast::Mesh> ast_mesh;
+    };
+
+    SceneLoad();
+
+    void                            start();
+    void                            read_assets();
+    bool                            push(std::shared_ptr<SceneLoadAsset> asset);
+    std::shared_ptr<SceneLoadAsset> pop();
+    bool                            is_read();
+
+private:
+    // Written before the worker starts and only read by it afterwards
+    std::vector<std::string>        m_mesh_paths;
+    std::vector<std::string>        m_material_paths;
+    std::vector<std::string>        m_texture_cube_paths;
+    std::unordered_set<std::string> m_cached_paths; // Materials and textures that were already loaded when the load started
+
+    // Shared with the worker
+    std::thread                                 m_thread;
+    std::mutex                                  m_mutex;
+    std::condition_variable                     m_condition;
+    std::deque<std::shared_ptr<SceneLoadAsset>> m_assets;
+    bool                                        m_is_read = false;
+    std::atomic<bool>                           m_is_cancelled;
+    std::atomic<uint32_t>                       m_num_assets;
+
+    // Only touched on the main thread
+    Scene::Ptr                                                   m_scene;
+    uint32_t                                                     m_num_meshes        = 0;
+    uint32_t                                                     m_num_loaded_assets = 0;
+    uint32_t                                                     m_num_loaded_meshes = 0;
+    bool                                                         m_is_complete       = false;
+    std::unordered_map<std::string, std::vector<MeshNode::Ptr>> m_mesh_nodes;     // Mesh path to the nodes waiting for it
+    std::unordered_map<std::string, std::vector<MeshNode::Ptr>> m_override_nodes; // Material path to the nodes overridden by it
+    std::unordered_map<std::string, std::vector<IBLNode::Ptr>>  m_ibl_nodes;      // Cubemap path to the nodes waiting for it
+    std::vector<PendingMaterial>                                 m_pending_materials;
+    std::vector<DeferredMesh>                                    m_deferred_meshes;
+    std::vector<Texture2D::Ptr>                                  m_textures; // Keeps loaded textures cached until their materials are complete
+    std::unordered_set<std::string>                              m_failed_textures;
+};
+
 class ResourceManager
 {
+private:
+    // A texture whose resident mips are about to change. The new image is uploaded first and swapped in once the GPU is idle.
+    struct ResidencyChange
+    {
+        Texture2D::Ptr     texture;
+        vk::Image::Ptr     image;
+        vk::ImageView::Ptr image_view;
+        uint32_t           resident_mip;
+    };
+
 private:
     std::weak_ptr<vk::Backend>                        m_backend;
+    ShaderCache::Ptr                                  m_shader_cache; // Compiles the shaders of the sky model every scene owns
     std::unordered_map<std::string, Texture2D::Ptr>   m_textures_2d;
     std::unordered_map<std::string, TextureCube::Ptr> m_textures_cube;
     std::unordered_map<std::string, Material::Ptr>    m_materials;
     std::unordered_map<std::string, Mesh::Ptr>        m_meshes;
+    LinearAllocator                                   m_scratch_allocator; // Staging of loaded data before it is handed to the uploader
+    VkDeviceSize                                      m_memory_budget      = 0; // Zero follows the budget reported by the driver
+    uint64_t                                          m_residency_frame    = 0;
+    uint64_t                                          m_next_enforce_frame = 0;
+    bool                                              m_over_budget        = false;
+    std::vector<Texture2D::Ptr>                       m_textures_to_restore;
+    FileWatcher                                       m_file_watcher;
+    std::vector<std::string>                          m_changed_files;
+    std::vector<std::weak_ptr<SceneLoad>>             m_scene_loads;
+    SceneLoad::Ptr                                    m_loading_scene; // Set while the graph of a scene loaded in the background is created
 
 public:
-    ResourceManager(vk::Backend::Ptr backend);
+    ResourceManager(vk::Backend::Ptr backend, ShaderCache::Ptr shader_cache);
     ~ResourceManager();
 
     Texture2D::Ptr   load_texture_2d(const std::string& path, bool srgb = false);
@@ -29,7 +156,44 @@ public:
     Mesh::Ptr        load_mesh(const std::string& path);
     Scene::Ptr       load_scene(const std::string& path);
 
+    // Creates the scene graph right away and loads the meshes, materials and textures it references in the background. Returns
+    // nullptr if the scene file could not be read.
+    SceneLoad::Ptr load_scene_async(const std::string& path);
+
+    // Uploads the assets of the scenes being loaded that are ready, for at most a few milliseconds, and attaches them to their
+    // nodes. Call once per frame before the scene is updated.
+    void update_scene_loads();
+
+    // Marks everything the render state references as used, reloads evicted textures that are used again and, while the device
+    // is over budget, frees cached resources that nothing references and evicts cold textures down to their smallest mips, least
+    // recently used first. Call once per frame after the scene has been updated.
+    void             update_residency(RenderState& render_state);
+    void             set_memory_budget(VkDeviceSize bytes);
+    MemoryStatistics memory_statistics();
+
+    // Reloads the cached textures, materials and meshes whose files changed on disk. The handles stay the same, the GPU resources
+    // behind them are swapped and the scenes using a reloaded mesh rebuild their hierarchy. Call once per frame before the scene
+    // is updated.
+    void reload_changed_resources();
+
+    inline VkDeviceSize memory_budget() { return m_memory_budget; }
+
 private:
+    void                      touch(Mesh* mesh, Material* material_override);
+    void                      touch(Material* material);
+    VkDeviceSize              budget_limit(const vk::MemoryBudget& device);
+    VkDeviceSize              release_unreferenced(VkDeviceSize bytes);
+    VkDeviceSize              evict_cold_textures(VkDeviceSize bytes);
+    void                      restore_textures();
+    bool                      upload_resident_mips(Texture2D::Ptr texture, uint32_t resident_mip, vk::BatchUploader& uploader, ResidencyChange& change, bool update_alpha_coverage = false);
+    void                      apply_residency_changes(const std::vector<ResidencyChange>& changes);
+    void                      update_scene_load(SceneLoad::Ptr load);
+    Material::Ptr             create_material(const std::string& full_path, vk::BatchUploader& uploader);
+    Material::Ptr             create_material(const std::string& full_path, const ast::Material& ast_material, vk::BatchUploader& uploader, bool cached_textures_only = false);
+    Mesh::Ptr                 create_mesh(const std::string& full_path, vk::BatchUploader& uploader);
+    Mesh::Ptr                 create_mesh(const std::string& full_path, const ast::Mesh& ast_mesh, vk::BatchUploader& uploader);
+    Texture2D::Ptr            cache_texture_2d(const std::string& path, const std::string& full_path, const ast::Image& ast_image, bool srgb, AlphaCoverage::Ptr alpha_coverage, vk::BatchUploader& uploader);
+    TextureCube::Ptr          cache_texture_cube(const std::string& path, const std::string& full_path, const ast::Image& ast_image, bool srgb, vk::BatchUploader& uploader);
     Texture2D::Ptr            load_texture_2d_internal(const std::string& path, bool srgb, vk::BatchUploader& uploader);
     TextureCube::Ptr          load_texture_cube_internal(const std::string& path, bool srgb, vk::BatchUploader& uploader);
     Material::Ptr             load_material_internal(const std::string& path, vk::BatchUploader& uploader);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <gfx/path_integrator.h>
+#include <string>
+#include <vector>
+
+namespace helios
+{
+#define CHECKPOINT_MAGIC 0x504b4348 // "HCKP"
+#define CHECKPOINT_VERSION 2
+
+struct CheckpointHeader
+{
+    uint32_t magic   = CHECKPOINT_MAGIC;
+    uint32_t version = CHECKPOINT_VERSION;
+    uint32_t width;
+    uint32_t height;
+    uint32_t num_accumulated_samples;
+    uint32_t tile_idx;
+    uint32_t sample_idx;
+    uint32_t reserved = 0;
+    uint64_t fingerprint;
+    uint32_t tiled;
+    uint32_t split_mode = JOB_SPLIT_NONE;
+    uint32_t job_index  = 0;
+    uint32_t job_count  = 1;
+    uint32_t job_samples;
+    uint32_t sample_offset;
+};
+
+namespace checkpoint
+{
+// Hashes everything that has to match for an accumulation to be continued: scene, camera, lights, instances, materials and their
+// textures, environment map or sky, integrator settings and resolution.
+extern uint64_t fingerprint(RenderState& render_state, PathIntegrator::Ptr path_integrator, uint32_t width, uint32_t height);
+
+// Writes the RGB channels of an RGBA32F accumulation buffer. The file is written under a temporary name and renamed once complete
+// so that a process killed mid-write never leaves a truncated checkpoint behind.
+extern bool write(const std::string& path, const CheckpointHeader& header, const float* rgba);
+
+// Reads a checkpoint back into an RGBA32F buffer.
+extern bool read(const std::string& path, CheckpointHeader& header, std::vector<float>& rgba);
+
+// Number of samples accumulated into each pixel of a checkpoint. Only differs between pixels for tiled and split renders.
+extern std::vector<uint32_t> sample_counts(const CheckpointHeader& header);
+} // namespace checkpoint
+} // namespace helios
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <gfx/vk.h>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+namespace helios
+{
+#define IMAGE_READBACK_RING_SIZE 4
+
+// Invoked on the readback worker thread once the GPU copy has completed. The data pointer is only valid for the duration of the call.
+using ImageReadbackCallback = std::function<void(const void* data, size_t size, uint32_t width, uint32_t height)>;
+
+class ImageReadback
+{
+public:
+    using Ptr = std::shared_ptr<ImageReadback>;
+
+public:
+    ImageReadback(vk::Backend::Ptr backend);
+    ~ImageReadback();
+
+    // Records a copy of the first mip/layer of 'image' into a free slot of the ring. The image is returned to 'layout' afterwards.
+    // Returns false without recording anything if every slot is still in use.
+    bool request(vk::CommandBuffer::Ptr cmd_buf, vk::Image::Ptr image, VkImageLayout layout, uint32_t bytes_per_pixel, ImageReadbackCallback callback);
+
+    // Hands every copy whose frame has finished executing over to the worker thread. Call once per frame before recording.
+    void update();
+
+    // Blocks until every outstanding copy and callback has completed.
+    void flush();
+
+    bool has_free_slot();
+
+private:
+    enum SlotState
+    {
+        SLOT_STATE_FREE,
+        SLOT_STATE_COPY_PENDING,
+        SLOT_STATE_PROCESSING
+    };
+
+    struct Slot
+    {
+        vk::Buffer::Ptr       buffer;
+        SlotState             state = SLOT_STATE_FREE;
+        uint32_t              frame_idx;
+        uint64_t              frame_number;
+        uint32_t              width;
+        uint32_t              height;
+        size_t                size;
+        ImageReadbackCallback callback;
+    };
+
+    void worker();
+
+private:
+    std::weak_ptr<vk::Backend> m_backend;
+    Slot                       m_slots[IMAGE_READBACK_RING_SIZE];
+    uint64_t                   m_frame_number = 0;
+    std::deque<uint32_t>       m_ready_slots;
+    std::mutex                 m_mutex;
+    std::condition_variable    m_ready_cv;
+    std::condition_variable    m_free_cv;
+    std::thread                m_thread;
+    bool                       m_quit = false;
+};
+} // namespace helios
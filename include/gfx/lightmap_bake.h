@@ -0,0 +1,76 @@
+#pragma once
+
+#include <gfx/vk.h>
+#include <resource/scene.h>
+#include <glm.hpp>
+#include <string>
+#include <vector>
+
+namespace helios
+{
+struct LightmapBakeSettings
+{
+    uint32_t width                 = 512;
+    uint32_t height                = 512;
+    uint32_t samples_per_launch    = 4;      // Paths traced by every texel in one launch
+    uint32_t min_samples           = 256;    // Paths per texel before a texel may be considered converged
+    uint32_t max_samples           = 16384;  // Paths per texel after which the bake stops, converged or not
+    float    convergence_threshold = 0.01f;  // Standard error of the mean irradiance, relative to the mean
+    float    normal_offset         = 0.001f; // Texels are lifted off their surface by this distance to avoid self intersection
+    uint32_t dilation_iterations   = 4;      // Rings of texels around every chart that are filled in before the atlas is written
+};
+
+// Irradiance of a mesh node baked into an atlas over its lightmap UVs (tex_coord.zw), through PathIntegrator::render_lightmap().
+// The triangles are rasterized into a G-buffer of world space positions and normals on the CPU when the bake is created, with
+// conservative coverage so that texels only partially covered by a chart are baked as well. Every launch traces a few more
+// hemispherical paths per texel with next event estimation, and a texel stops tracing once the standard error of its mean is small
+// enough. The atlas is written as an HDR image with V increasing downwards, and holds irradiance, i.e. it has to be multiplied by
+// albedo / PI when shading.
+class LightmapBake
+{
+public:
+    using Ptr = std::shared_ptr<LightmapBake>;
+
+    friend class PathIntegrator;
+
+public:
+    LightmapBake(vk::Backend::Ptr backend, vk::DescriptorSetLayout::Ptr lightmap_ds_layout, MeshNode::Ptr node, const LightmapBakeSettings& settings);
+    ~LightmapBake();
+
+    void restart();
+
+    // Waits for the GPU, dilates the charts and writes the atlas. Returns false if the file could not be written.
+    bool save(const std::string& path);
+
+    inline uint32_t                    width() { return m_settings.width; }
+    inline uint32_t                    height() { return m_settings.height; }
+    inline uint32_t                    num_texels() { return m_num_texels; }
+    inline uint32_t                    num_converged_texels() { return m_num_converged_texels; }
+    inline uint32_t                    num_samples() { return m_num_launches * m_settings.samples_per_launch; }
+    inline bool                        is_complete() { return m_num_converged_texels == m_num_texels || num_samples() >= m_settings.max_samples; }
+    inline const LightmapBakeSettings& settings() { return m_settings; }
+
+private:
+    void rasterize(MeshNode::Ptr node, std::vector<glm::vec4>& texels);
+    void begin_launch(vk::CommandBuffer::Ptr cmd_buf, uint32_t frame_idx);
+    void end_launch(vk::CommandBuffer::Ptr cmd_buf, uint32_t frame_idx);
+    void resolve_converged_texels(uint32_t frame_idx);
+
+private:
+    std::weak_ptr<vk::Backend> m_backend;
+    LightmapBakeSettings       m_settings;
+    uint32_t                   m_num_texels           = 0; // Texels covered by at least one triangle
+    uint32_t                   m_num_launches         = 0;
+    uint32_t                   m_num_converged_texels = 0;
+    uint32_t                   m_bake_id              = 0;
+    bool                       m_needs_clear          = true;
+    std::vector<bool>          m_coverage;
+    vk::Buffer::Ptr            m_gbuffer;
+    vk::Buffer::Ptr            m_texel_buffer;
+    vk::Buffer::Ptr            m_state_buffer;
+    vk::Buffer::Ptr            m_state_readback[vk::Backend::kMaxFramesInFlight];
+    bool                       m_state_pending[vk::Backend::kMaxFramesInFlight];
+    uint32_t                   m_state_bake_id[vk::Backend::kMaxFramesInFlight];
+    vk::DescriptorSet::Ptr     m_lightmap_ds;
+};
+} // namespace helios
@@ -1,33 +1,108 @@
 #pragma once
 
 #include <gfx/vk.h>
+#include <gfx/shader_cache.h>
+#include <gfx/view_set.h>
+#include <gfx/probe_bake.h>
+#include <gfx/lightmap_bake.h>
 #include <resource/scene.h>
+#include <utility/sampler.h>
 #include <vector>
 
 namespace helios
 {
+// How a single image is divided between several processes that render it independently.
+enum JobSplitMode
+{
+    JOB_SPLIT_NONE,
+    JOB_SPLIT_TILES,
+    JOB_SPLIT_SAMPLES
+};
+
+// Keep in sync with src/engine/shader/ray_statistics.glsl
+#define RAY_STATISTICS_BOUNCE_BINS 16
+
+enum RayCounter
+{
+    RAY_COUNTER_PRIMARY,
+    RAY_COUNTER_SHADOW,
+    RAY_COUNTER_INDIRECT,
+    RAY_COUNTER_ANY_HIT,
+    RAY_COUNTER_RUSSIAN_ROULETTE,
+    RAY_COUNTER_BOUNCE_HISTOGRAM,
+    RAY_COUNTER_COUNT = RAY_COUNTER_BOUNCE_HISTOGRAM + RAY_STATISTICS_BOUNCE_BINS
+};
+
+// Counters gathered by the path tracing shaders over one or more launches, along with the GPU time those launches took.
+struct RayStatistics
+{
+    uint64_t counters[RAY_COUNTER_COUNT] = {};
+    uint32_t num_launches                = 0;
+    double   gpu_time                    = 0.0; // milliseconds
+
+    inline uint64_t total_rays() const { return counters[RAY_COUNTER_PRIMARY] + counters[RAY_COUNTER_SHADOW] + counters[RAY_COUNTER_INDIRECT]; }
+    inline double   mrays_per_second(uint64_t rays) const { return gpu_time > 0.0 ? double(rays) / (gpu_time * 1000.0) : 0.0; }
+    inline double   mrays_per_second(RayCounter counter) const { return mrays_per_second(counters[counter]); }
+
+    inline void add(const RayStatistics& other)
+    {
+        for (uint32_t i = 0; i < RAY_COUNTER_COUNT; i++)
+            counters[i] += other.counters[i];
+
+        num_launches += other.num_launches;
+        gpu_time += other.gpu_time;
+    }
+};
+
+// Selects the integrator compiled into the closest hit shader.
+enum IntegratorMode
+{
+    INTEGRATOR_PATH_TRACE,
+    INTEGRATOR_DIRECT_LIGHTING
+};
+
 class PathIntegrator
 {
 public:
     using Ptr = std::shared_ptr<PathIntegrator>;
 
 public:
-    PathIntegrator(vk::Backend::Ptr backend);
+    PathIntegrator(vk::Backend::Ptr backend, ShaderCache::Ptr shader_cache);
     ~PathIntegrator();
 
-    inline uint32_t max_ray_bounces() { return m_max_ray_bounces; }
-    inline uint32_t max_samples() { return m_max_samples; }
-    inline uint32_t num_accumulated_samples() { return m_max_samples * m_tile_idx + m_num_accumulated_samples; }
-    inline uint32_t num_target_samples() { return m_max_samples * m_tile_coords.size(); }
-    inline uint32_t tile_idx() { return m_tile_idx; }
-    inline bool     is_tiled() { return m_tiled; }
-    inline float    shadow_ray_bias() { return m_shadow_ray_bias; }
-    inline void     restart_bake()
+    inline uint32_t       max_ray_bounces() { return m_max_ray_bounces; }
+    inline uint32_t       max_samples() { return m_max_samples; }
+    inline uint32_t       num_accumulated_samples() { return job_samples() * m_tile_idx + m_num_accumulated_samples; }
+    inline uint32_t       num_target_samples() { return job_samples() * m_tile_coords.size(); }
+    inline bool           is_complete() { return m_tile_idx >= m_tile_coords.size() || job_samples() == 0; }
+    inline uint32_t       tile_idx() { return m_tile_idx; }
+    inline uint32_t       num_tile_samples() { return m_num_accumulated_samples; }
+    inline glm::uvec2     tile_coord(uint32_t idx) { return m_tile_coords[idx]; }
+    inline bool           is_tiled() { return m_tiled; }
+    inline float          shadow_ray_bias() { return m_shadow_ray_bias; }
+    inline SamplerType    sampler_type() { return m_sampler_type; }
+    inline IntegratorMode integrator_mode() { return m_integrator_mode; }
+    inline bool           visualize_nans() { return m_visualize_nans; }
+    inline JobSplitMode   job_split_mode() { return m_split_mode; }
+    inline uint32_t       job_index() { return m_job_index; }
+    inline uint32_t       job_count() { return m_job_count; }
+    inline bool           ray_statistics_enabled() { return m_ray_statistics_enabled; }
+    inline bool           light_groups_enabled() { return m_light_groups_enabled; }
+    inline void           restart_bake()
     {
         m_num_accumulated_samples = 0;
+        m_num_light_group_samples = 0;
         m_tile_idx                = 0;
+        m_bake_ray_statistics     = RayStatistics();
+        m_bake_id++;
+    }
+    // Checkpoints do not hold the light group layers, so those start over from the restored sample.
+    inline void restore_progress(const uint32_t& num_tile_samples, const uint32_t& tile_idx)
+    {
+        m_num_accumulated_samples = num_tile_samples;
+        m_num_light_group_samples = 0;
+        m_tile_idx                = tile_idx;
     }
-    inline void set_max_ray_bounces(const uint32_t& n) { m_max_ray_bounces = n; }
     inline void set_max_samples(const uint32_t& n) { m_max_samples = n; }
     inline void set_shadow_ray_bias(const float& bias) { m_shadow_ray_bias = bias; }
 
@@ -36,28 +111,136 @@ public:
     void on_window_resize();
     void set_tiled(bool tiled);
 
+    // Traces every view of the set in a single launch and accumulates one more sample into each of its layers. Tiling and job
+    // splitting do not apply, light groups are not written and the launch is not included in the ray statistics.
+    void         render_views(RenderState& render_state, ViewSet::Ptr view_set);
+    ViewSet::Ptr create_view_set(uint32_t width, uint32_t height, const std::vector<View>& views);
+
+    // Traces another batch of rays for every probe of the bake that has not converged yet, reusing the hit and miss stages of the
+    // path tracer. Like render_views(), the launch is not included in the ray statistics.
+    void           render_probes(RenderState& render_state, ProbeBake::Ptr probe_bake);
+    ProbeBake::Ptr create_probe_bake(ProbeVolumeNode::Ptr node, const ProbeBakeSettings& settings);
+
+    // Traces another batch of paths for every texel of the lightmap that has not converged yet. Like render_probes(), the hit and
+    // miss stages are shared with the path tracer and the launch is not included in the ray statistics.
+    void              render_lightmap(RenderState& render_state, LightmapBake::Ptr lightmap_bake);
+    LightmapBake::Ptr create_lightmap_bake(MeshNode::Ptr node, const LightmapBakeSettings& settings);
+
+    // These are compiled into the shaders as defines or specialization constants. Changing them rebuilds the affected pipeline
+    // libraries before the next launch.
+    void set_max_ray_bounces(const uint32_t& n);
+    void set_sampler_type(const SamplerType& type);
+    void set_integrator_mode(const IntegratorMode& mode);
+    void set_visualize_nans(const bool& visualize);
+    void set_job(JobSplitMode mode, uint32_t job_index, uint32_t job_count);
+
+    // Compiles the ray counters into the shaders. Counters are read back a few frames after each launch, without stalling.
+    void set_ray_statistics_enabled(const bool& enabled);
+
+    // Accumulates the radiance of every light group into its own layer of the image bound through
+    // RenderState::light_group_descriptor_set(), in addition to the regular output. Restarts the bake.
+    void set_light_groups_enabled(const bool& enabled);
+
+    // Counters of the most recently resolved launch, and the sum over every resolved launch of the current bake.
+    inline const RayStatistics& ray_statistics() { return m_last_ray_statistics; }
+    inline const RayStatistics& bake_ray_statistics() { return m_bake_ray_statistics; }
+
+    // Waits for the GPU and resolves every launch that has not been read back yet, e.g. before reporting the totals of a bake.
+    void flush_ray_statistics();
+
+    // First sample index and number of samples per pixel rendered by the current job.
+    uint32_t sample_offset();
+    uint32_t job_samples();
+
+    // Tiles rendered by one job, in the order they are rendered. Shared with tools that need to know which pixels a job covered.
+    static std::vector<glm::uvec2> generate_tile_coords(uint32_t width, uint32_t height, bool tiled, JobSplitMode mode, uint32_t job_index, uint32_t job_count);
+    static glm::uvec2              tile_size(uint32_t width, uint32_t height, bool tiled);
+
 private:
-    void launch_rays(RenderState& render_state, vk::RayTracingPipeline::Ptr pipeline, vk::PipelineLayout::Ptr pipeline_layout, vk::ShaderBindingTable::Ptr sbt, const uint32_t& x, const uint32_t& y, const uint32_t& z, const glm::mat4& view, const glm::mat4& projection, const glm::ivec2& tile_coord, const glm::ivec2& pixel_coord);
-    void create_pipeline();
-    void create_ray_debug_pipeline();
-    void compute_tile_coords();
+    void                        launch_rays(RenderState& render_state, vk::RayTracingPipeline::Ptr pipeline, vk::PipelineLayout::Ptr pipeline_layout, vk::ShaderBindingTable::Ptr sbt, const uint32_t& x, const uint32_t& y, const uint32_t& z, const glm::mat4& view, const glm::mat4& projection, const glm::ivec2& tile_coord, const glm::ivec2& pixel_coord);
+    void                        trace_rays(vk::CommandBuffer::Ptr cmd_buf, vk::RayTracingPipeline::Ptr pipeline, vk::ShaderBindingTable::Ptr sbt, const uint32_t& x, const uint32_t& y, const uint32_t& z);
+    void                        create_pipeline();
+    void                        create_ray_gen_library();
+    void                        create_multi_view_ray_gen_library();
+    void                        create_probe_bake_ray_gen_library();
+    void                        create_lightmap_bake_ray_gen_library();
+    vk::RayTracingPipeline::Ptr build_ray_gen_library(const std::string& shader, const std::vector<std::string>& defines);
+    void                        create_hit_library();
+    void                        link_pipeline();
+    void                        link_multi_view_pipeline();
+    void                        link_probe_bake_pipeline();
+    void                        link_lightmap_bake_pipeline();
+    vk::RayTracingPipeline::Ptr build_pipeline(vk::RayTracingPipeline::Ptr ray_gen_library, const std::string& ray_gen_shader, const std::vector<std::string>& ray_gen_library_defines);
+    void                        create_ray_debug_pipeline();
+    void                        create_ray_statistics_resources();
+    void                        begin_ray_statistics(vk::CommandBuffer::Ptr cmd_buf);
+    void                        end_ray_statistics(vk::CommandBuffer::Ptr cmd_buf);
+    void                        resolve_ray_statistics(uint32_t frame_idx);
+    void                        update_pipelines();
+    void                        set_specialization_constants(vk::ShaderBindingTable::Desc& sbt_desc);
+    std::vector<std::string>    ray_gen_defines();
+    std::vector<std::string>    multi_view_ray_gen_defines();
+    std::vector<std::string>    bake_ray_gen_defines();
+    std::vector<std::string>    hit_defines();
+    std::vector<std::string>    any_hit_defines();
+    std::vector<std::string>    miss_defines();
+    void                        add_ray_statistics_defines(std::vector<std::string>& defines);
+    void                        compute_tile_coords();
 
 private:
-    bool                        m_tiled                   = false;
-    uint32_t                    m_max_ray_bounces         = 7;
-    uint32_t                    m_max_samples             = 5000;
-    uint32_t                    m_num_accumulated_samples = 0;
-    uint32_t                    m_tile_idx                = 0;
-    float                       m_shadow_ray_bias         = 0.0f;
-    glm::uvec2                  m_tile_size;
-    std::vector<glm::uvec2>     m_tile_coords;
-    std::weak_ptr<vk::Backend>  m_backend;
-    vk::DescriptorSet::Ptr      m_path_trace_ds[2];
-    vk::RayTracingPipeline::Ptr m_path_trace_pipeline;
-    vk::PipelineLayout::Ptr     m_path_trace_pipeline_layout;
-    vk::ShaderBindingTable::Ptr m_path_trace_sbt;
-    vk::RayTracingPipeline::Ptr m_ray_debug_pipeline;
-    vk::PipelineLayout::Ptr     m_ray_debug_pipeline_layout;
-    vk::ShaderBindingTable::Ptr m_ray_debug_sbt;
+    bool                         m_tiled                   = false;
+    uint32_t                     m_max_ray_bounces         = 7;
+    uint32_t                     m_max_samples             = 5000;
+    uint32_t                     m_num_accumulated_samples = 0;
+    uint32_t                     m_num_light_group_samples = 0; // Samples of the current tile in the light group layers
+    uint32_t                     m_tile_idx                = 0;
+    float                        m_shadow_ray_bias         = 0.0f;
+    SamplerType                  m_sampler_type            = SAMPLER_SOBOL;
+    IntegratorMode               m_integrator_mode         = INTEGRATOR_PATH_TRACE;
+    bool                         m_visualize_nans          = false;
+    bool                         m_ray_gen_dirty           = false;
+    bool                         m_hit_dirty               = false;
+    JobSplitMode                 m_split_mode              = JOB_SPLIT_NONE;
+    uint32_t                     m_job_index               = 0;
+    uint32_t                     m_job_count               = 1;
+    uint32_t                     m_bake_id                 = 0;
+    bool                         m_ray_statistics_enabled  = false;
+    bool                         m_light_groups_enabled    = false;
+    bool                         m_subgroup_ray_statistics = false;
+    float                        m_timestamp_period        = 1.0f;
+    glm::uvec2                   m_tile_size;
+    std::vector<glm::uvec2>      m_tile_coords;
+    std::weak_ptr<vk::Backend>   m_backend;
+    ShaderCache::Ptr             m_shader_cache;
+    vk::DescriptorSet::Ptr       m_path_trace_ds[2];
+    vk::RayTracingPipeline::Ptr  m_path_trace_pipeline;
+    vk::RayTracingPipeline::Ptr  m_path_trace_ray_gen_library;
+    vk::RayTracingPipeline::Ptr  m_path_trace_hit_library;
+    vk::PipelineLayout::Ptr      m_path_trace_pipeline_layout;
+    vk::ShaderBindingTable::Ptr  m_path_trace_sbt;
+    vk::RayTracingPipeline::Ptr  m_multi_view_pipeline;
+    vk::RayTracingPipeline::Ptr  m_multi_view_ray_gen_library;
+    vk::ShaderBindingTable::Ptr  m_multi_view_sbt;
+    vk::DescriptorSetLayout::Ptr m_view_ds_layout;
+    vk::RayTracingPipeline::Ptr  m_probe_bake_pipeline;
+    vk::RayTracingPipeline::Ptr  m_probe_bake_ray_gen_library;
+    vk::ShaderBindingTable::Ptr  m_probe_bake_sbt;
+    vk::DescriptorSetLayout::Ptr m_probe_ds_layout;
+    vk::RayTracingPipeline::Ptr  m_lightmap_bake_pipeline;
+    vk::RayTracingPipeline::Ptr  m_lightmap_bake_ray_gen_library;
+    vk::ShaderBindingTable::Ptr  m_lightmap_bake_sbt;
+    vk::DescriptorSetLayout::Ptr m_lightmap_ds_layout;
+    vk::RayTracingPipeline::Ptr  m_ray_debug_pipeline;
+    vk::PipelineLayout::Ptr      m_ray_debug_pipeline_layout;
+    vk::ShaderBindingTable::Ptr  m_ray_debug_sbt;
+    vk::DescriptorSetLayout::Ptr m_ray_statistics_ds_layout;
+    vk::DescriptorSet::Ptr       m_ray_statistics_ds;
+    vk::Buffer::Ptr              m_ray_statistics_buffer;
+    vk::Buffer::Ptr              m_ray_statistics_readback[vk::Backend::kMaxFramesInFlight];
+    vk::QueryPool::Ptr           m_ray_statistics_query_pool;
+    bool                         m_ray_statistics_pending[vk::Backend::kMaxFramesInFlight];
+    uint32_t                     m_ray_statistics_bake_id[vk::Backend::kMaxFramesInFlight];
+    RayStatistics                m_last_ray_statistics;
+    RayStatistics                m_bake_ray_statistics;
 };
 } // namespace helios
\ No newline at end of file
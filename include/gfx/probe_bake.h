@@ -0,0 +1,91 @@
+#pragma once
+
+#include <gfx/vk.h>
+#include <resource/scene.h>
+#include <glm.hpp>
+#include <string>
+#include <vector>
+
+namespace helios
+{
+// Keep in sync with src/engine/shader/common.glsl
+#define PROBE_BAKE_LANES 16
+#define PROBE_BAKE_MAX_SH_COEFFICIENTS 9
+
+#define PROBE_VOLUME_MAGIC 0x42525048 // "HPRB"
+#define PROBE_VOLUME_VERSION 1
+
+// Followed by num_coefficients RGB float triplets per probe, with x varying fastest and z slowest. The coefficients are irradiance,
+// already convolved with the clamped cosine lobe, in the real SH basis ordered Y00, Y1-1, Y10, Y11, Y2-2, Y2-1, Y20, Y21, Y22.
+struct ProbeVolumeHeader
+{
+    uint32_t  magic   = PROBE_VOLUME_MAGIC;
+    uint32_t  version = PROBE_VOLUME_VERSION;
+    uint32_t  sh_bands;
+    uint32_t  num_coefficients;
+    uint32_t  resolution[3];
+    uint32_t  num_samples; // Rays traced by each probe that did not converge
+    glm::mat4 transform;   // Maps the unit cube [-0.5, 0.5] to the volume in world space
+};
+
+struct ProbeBakeSettings
+{
+    uint32_t rays_per_lane         = 64;    // Rays traced by every lane of a probe in one launch
+    uint32_t min_samples           = 1024;  // Rays per probe before a probe may be considered converged
+    uint32_t max_samples           = 65536; // Rays per probe after which the bake stops, converged or not
+    float    convergence_threshold = 0.01f; // Standard error of the mean irradiance, relative to the mean
+};
+
+// SH irradiance of a grid of probes, baked through PathIntegrator::render_probes() without rendering any cubemaps. Every probe is
+// traced by PROBE_BAKE_LANES invocations which project the radiance of their rays onto SH and keep a running mean. A probe stops
+// tracing once the spread between its lanes says that the mean is accurate enough. The probe positions are taken from the node when
+// the bake is created.
+class ProbeBake
+{
+public:
+    using Ptr = std::shared_ptr<ProbeBake>;
+
+    friend class PathIntegrator;
+
+public:
+    ProbeBake(vk::Backend::Ptr backend, vk::DescriptorSetLayout::Ptr probe_ds_layout, ProbeVolumeNode::Ptr node, const ProbeBakeSettings& settings);
+    ~ProbeBake();
+
+    void restart();
+
+    // Waits for the GPU, resolves the irradiance of every probe and writes the volume. Returns false if the file could not be written.
+    bool save(const std::string& path);
+
+    inline glm::uvec3               resolution() { return m_resolution; }
+    inline uint32_t                 sh_bands() { return m_sh_bands; }
+    inline uint32_t                 num_probes() { return m_resolution.x * m_resolution.y * m_resolution.z; }
+    inline uint32_t                 num_converged_probes() { return m_num_converged_probes; }
+    inline uint32_t                 num_samples() { return m_num_launches * PROBE_BAKE_LANES * m_settings.rays_per_lane; }
+    inline bool                     is_complete() { return m_num_converged_probes == num_probes() || num_samples() >= m_settings.max_samples; }
+    inline const ProbeBakeSettings& settings() { return m_settings; }
+
+private:
+    void begin_launch(vk::CommandBuffer::Ptr cmd_buf, uint32_t frame_idx);
+    void end_launch(vk::CommandBuffer::Ptr cmd_buf, uint32_t frame_idx);
+    void resolve_converged_probes(uint32_t frame_idx);
+
+private:
+    std::weak_ptr<vk::Backend> m_backend;
+    ProbeBakeSettings          m_settings;
+    glm::uvec3                 m_resolution;
+    uint32_t                   m_sh_bands;
+    glm::mat4                  m_transform;
+    uint32_t                   m_num_launches         = 0;
+    uint32_t                   m_num_converged_probes = 0;
+    uint32_t                   m_bake_id              = 0;
+    bool                       m_ping_pong            = false;
+    bool                       m_needs_clear          = true;
+    vk::Buffer::Ptr            m_probe_buffer;
+    vk::Buffer::Ptr            m_lane_buffers[2];
+    vk::Buffer::Ptr            m_state_buffer;
+    vk::Buffer::Ptr            m_state_readback[vk::Backend::kMaxFramesInFlight];
+    bool                       m_state_pending[vk::Backend::kMaxFramesInFlight];
+    uint32_t                   m_state_bake_id[vk::Backend::kMaxFramesInFlight];
+    vk::DescriptorSet::Ptr     m_probe_ds[2];
+};
+} // namespace helios
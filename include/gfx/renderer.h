@@ -2,6 +2,8 @@
 
 #include <resource/scene.h>
 #include <gfx/path_integrator.h>
+#include <gfx/image_readback.h>
+#include <gfx/checkpoint.h>
 #include <gfx/hosek_wilkie_sky_model.h>
 
 namespace helios
@@ -10,6 +12,10 @@ namespace helios
 
 class ResourceManager;
 
+// Invoked on the readback worker thread with the RGBA32F accumulation buffer once it holds 'num_samples' samples per pixel. If every
+// readback slot was busy when a requested count was reached, the capture is taken on a later frame and 'num_samples' is higher.
+using AccumulationCallback = std::function<void(const float* rgba, uint32_t width, uint32_t height, uint32_t num_samples)>;
+
 struct RayDebugView
 {
     glm::ivec2 pixel_coord;
@@ -39,12 +45,12 @@ class Renderer
 private:
     std::vector<RayDebugView>         m_ray_debug_views;
     std::weak_ptr<vk::Backend>        m_backend;
+    ShaderCache::Ptr                  m_shader_cache;
     PathIntegrator::Ptr               m_path_integrator;
     vk::Image::Ptr                    m_output_images[2];
     vk::ImageView::Ptr                m_output_image_views[2];
     vk::Image::Ptr                    m_tone_map_image;
     vk::ImageView::Ptr                m_tone_map_image_view;
-    vk::Image::Ptr                    m_save_to_disk_image;
     vk::DescriptorSet::Ptr            m_output_storage_image_ds[2];
     vk::DescriptorSet::Ptr            m_input_combined_sampler_ds[2];
     vk::DescriptorSet::Ptr            m_tone_map_ds;
@@ -64,17 +70,56 @@ private:
     vk::PipelineLayout::Ptr           m_debug_visualization_pipeline_layout;
     vk::RenderPass::Ptr               m_swapchain_renderpass;
     std::vector<vk::Framebuffer::Ptr> m_swapchain_framebuffers;
+    vk::Image::Ptr                    m_light_group_image;
+    vk::ImageView::Ptr                m_light_group_image_view;
+    vk::Image::Ptr                    m_light_group_composite_image;
+    vk::ImageView::Ptr                m_light_group_composite_image_view;
+    vk::DescriptorSet::Ptr            m_light_group_storage_image_ds;
+    vk::DescriptorSet::Ptr            m_light_group_combined_sampler_ds;
+    vk::DescriptorSet::Ptr            m_light_group_composite_ds;
+    vk::RenderPass::Ptr               m_light_group_composite_render_pass;
+    vk::Framebuffer::Ptr              m_light_group_composite_framebuffer;
+    vk::GraphicsPipeline::Ptr         m_light_group_composite_pipeline;
+    vk::PipelineLayout::Ptr           m_light_group_composite_pipeline_layout;
     vk::Buffer::Ptr                   m_ray_debug_vbo;
     vk::Buffer::Ptr                   m_ray_debug_draw_cmd;
+    ImageReadback::Ptr                m_image_readback;
     bool                              m_output_ping_pong       = false;
     bool                              m_ray_debug_view_added   = false;
     bool                              m_output_image_recreated = true;
     bool                              m_save_image_to_disk     = false;
-    bool                              m_copy_started           = false;
     std::string                       m_image_save_path        = "";
+    uint32_t                          m_snapshot_interval      = 0;
+    uint32_t                          m_last_snapshot_sample   = 0;
+    std::string                       m_snapshot_path          = "";
+    bool                              m_save_checkpoint        = false;
+    std::string                       m_checkpoint_save_path   = "";
+    uint32_t                          m_checkpoint_interval    = 0;
+    uint32_t                          m_last_checkpoint_sample = 0;
+    std::string                       m_checkpoint_path        = "";
+    bool                              m_resume_pending         = false;
+    CheckpointHeader                  m_resume_header;
+    std::vector<float>                m_resume_data;
+    std::string                       m_job_output_path        = "";
+    bool                              m_job_output_requested   = false;
+    std::vector<uint32_t>             m_capture_samples;
+    uint32_t                          m_capture_idx            = 0;
+    AccumulationCallback              m_capture_callback;
     ToneMapOperator                   m_tone_map_operator      = TONE_MAP_OPERATOR_ACES;
     float                             m_exposure               = 1.0f;
     OutputBuffer                      m_current_output_buffer  = OUTPUT_BUFFER_FINAL;
+    bool                              m_light_groups_enabled   = false;
+    bool                              m_light_group_recreated  = false;
+    bool                              m_light_groups_resumed   = false; // The light group layers miss the samples restored from a checkpoint
+    float                             m_light_group_scales[MAX_LIGHT_GROUPS];
+    glm::vec3                         m_light_group_tints[MAX_LIGHT_GROUPS];
+    ProbeBake::Ptr                    m_probe_bake;
+    std::string                       m_probe_bake_path        = "";
+    LightmapBake::Ptr                 m_lightmap_bake;
+    std::string                       m_lightmap_bake_path     = "";
+    ViewSet::Ptr                      m_cubemap;
+    uint32_t                          m_cubemap_samples        = 0;
+    std::string                       m_cubemap_path           = "";
 
 public:
     Renderer(vk::Backend::Ptr backend);
@@ -84,10 +129,31 @@ public:
     inline void                set_exposure(const float& exposure) { m_exposure = exposure; }
     inline void                set_current_output_buffer(OutputBuffer buffer) { m_current_output_buffer = buffer; }
     inline PathIntegrator::Ptr path_integrator() { return m_path_integrator; }
+    inline ShaderCache::Ptr    shader_cache() { return m_shader_cache; }
     inline ToneMapOperator     tone_map_operator() { return m_tone_map_operator; }
     inline OutputBuffer        current_output_buffer() { return m_current_output_buffer; }
     inline float               exposure() { return m_exposure; }
     inline vk::RenderPass::Ptr swapchain_renderpass() { return m_swapchain_renderpass; }
+    inline ImageReadback::Ptr  image_readback() { return m_image_readback; }
+    inline uint32_t            progress_snapshot_interval() { return m_snapshot_interval; }
+    inline bool                light_groups_enabled() { return m_light_groups_enabled; }
+    inline float               light_group_scale(uint32_t group) { return m_light_group_scales[group]; }
+    inline glm::vec3           light_group_tint(uint32_t group) { return m_light_group_tints[group]; }
+    inline ProbeBake::Ptr      probe_bake() { return m_probe_bake; }
+    inline LightmapBake::Ptr   lightmap_bake() { return m_lightmap_bake; }
+    inline ViewSet::Ptr        cubemap() { return m_cubemap; }
+
+    // The light groups are weighted by scale * tint and summed before tone mapping. Changing the weights does not restart accumulation.
+    inline void set_light_group_scale(uint32_t group, float scale)
+    {
+        if (group < MAX_LIGHT_GROUPS)
+            m_light_group_scales[group] = scale;
+    }
+    inline void set_light_group_tint(uint32_t group, const glm::vec3& tint)
+    {
+        if (group < MAX_LIGHT_GROUPS)
+            m_light_group_tints[group] = tint;
+    }
 
     void                             render(RenderState& render_state);
     void                             on_window_resize();
@@ -95,15 +161,46 @@ public:
     const std::vector<RayDebugView>& ray_debug_views();
     void                             clear_ray_debug_views();
     void                             save_image_to_disk(const std::string& path);
+    void                             set_progress_snapshots(uint32_t sample_interval, const std::string& path);
+    void                             save_checkpoint(const std::string& path);
+    void                             set_checkpoint_interval(uint32_t sample_interval, const std::string& path);
+    bool                             resume_from_checkpoint(const std::string& path);
+    void                             set_job_output(const std::string& path);
+    void                             set_accumulation_captures(const std::vector<uint32_t>& sample_counts, AccumulationCallback callback);
+    bool                             is_job_output_requested() { return m_job_output_requested; }
+    bool                             is_accumulation_capture_pending() { return m_capture_idx < m_capture_samples.size(); }
+
+    // Accumulates every light group separately so that it can be rescaled after rendering. Restarts the bake.
+    void set_light_groups_enabled(bool enabled);
+
+    // Bakes the probes of the volume alongside the regular rendering and writes them to 'path' once every probe has converged or the
+    // sample limit is reached. Replaces any bake that is still running.
+    void bake_probes(ProbeVolumeNode::Ptr node, const ProbeBakeSettings& settings, const std::string& path);
+
+    // Bakes the irradiance of the mesh over its lightmap UVs and writes the atlas to 'path' as an HDR image once every texel has
+    // converged or the sample limit is reached. Replaces any lightmap bake that is still running.
+    void bake_lightmap(MeshNode::Ptr node, const LightmapBakeSettings& settings, const std::string& path);
+
+    // Path traces the six faces of a cubemap around 'position' in one launch per frame alongside the regular rendering, and writes them
+    // to '<path>_px.hdr' through '<path>_nz.hdr' once 'num_samples' have been accumulated. Replaces any cubemap that is still rendering.
+    void render_cubemap(const glm::vec3& position, uint32_t size, uint32_t num_samples, const std::string& path);
 
 private:
     void tone_map(vk::CommandBuffer::Ptr cmd_buf, vk::DescriptorSet::Ptr read_image);
     void copy(vk::CommandBuffer::Ptr cmd_buf);
+    void composite_light_groups(vk::CommandBuffer::Ptr cmd_buf);
     void render_ray_debug_views(RenderState& render_state);
     void render_debug_visualization(RenderState& render_state);
     void render_depth_prepass(RenderState& render_state);
-    void copy_and_save_tone_mapped_image(vk::CommandBuffer::Ptr cmd_buf);
+    bool save_tone_mapped_image(vk::CommandBuffer::Ptr cmd_buf, const std::string& path);
+    bool write_checkpoint(RenderState& render_state, uint32_t image_idx, const std::string& path);
+    void capture_accumulation(RenderState& render_state, uint32_t image_idx);
+    void upload_checkpoint(RenderState& render_state);
+    void copy_completed_tile(RenderState& render_state, uint32_t tile_idx);
     void create_output_images();
+    void create_light_group_images();
+    void create_light_group_composite_render_pass();
+    void create_light_group_composite_pipeline();
     void create_tone_map_render_pass();
     void create_tone_map_framebuffer();
     void create_depth_prepass_render_pass();
@@ -119,5 +216,6 @@ private:
     void create_static_descriptor_sets();
     void create_dynamic_descriptor_sets();
     void update_dynamic_descriptor_sets();
+    void update_light_group_descriptor_sets();
 };
 } // namespace helios
\ No newline at end of file
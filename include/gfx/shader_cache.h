@@ -0,0 +1,33 @@
+#pragma once
+
+#include <gfx/vk.h>
+#include <unordered_map>
+#include <mutex>
+
+namespace helios
+{
+// Compiles GLSL shader permutations at runtime. Every permutation is identified by a hash of its source (including everything it
+// #includes), its stage and its set of defines. Compiled SPIR-V is kept on disk so a permutation is only ever compiled once per
+// source revision, and in memory so repeated requests during a session return the same module.
+class ShaderCache
+{
+public:
+    using Ptr = std::shared_ptr<ShaderCache>;
+
+public:
+    ShaderCache(vk::Backend::Ptr backend);
+    ~ShaderCache();
+
+    // Path is relative to the shader source directory, e.g. "path_trace.rgen". Each define is either "NAME" or "NAME VALUE".
+    vk::ShaderModule::Ptr load(const std::string& path, const std::vector<std::string>& defines = std::vector<std::string>());
+
+private:
+    bool gather_sources(const std::string& path, std::string& sources, std::vector<std::string>& visited);
+    bool compile(const std::string& path, const std::vector<std::string>& defines, std::vector<uint32_t>& spirv);
+
+private:
+    std::weak_ptr<vk::Backend>                          m_backend;
+    std::unordered_map<uint64_t, vk::ShaderModule::Ptr> m_modules;
+    std::mutex                                          m_mutex;
+};
+} // namespace helios
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <gfx/vk.h>
+#include <glm.hpp>
+#include <vector>
+#include <string>
+
+namespace helios
+{
+// Keep in sync with src/engine/shader/common.glsl
+#define MAX_VIEWS_PER_LAUNCH 256
+
+// Keep in sync with src/engine/shader/common.glsl
+enum ViewProjection
+{
+    VIEW_PROJECTION_PERSPECTIVE,
+    VIEW_PROJECTION_EQUIRECTANGULAR,
+    VIEW_PROJECTION_CUBEMAP_FACE
+};
+
+struct View
+{
+    ViewProjection projection_type = VIEW_PROJECTION_PERSPECTIVE;
+    glm::vec3      position        = glm::vec3(0.0f);
+    glm::mat4      view            = glm::mat4(1.0f); // Perspective views only
+    glm::mat4      projection      = glm::mat4(1.0f); // Perspective views only
+    float          focal_length    = 1.0f;
+    float          aperture_radius = 0.0f;
+    uint32_t       cubemap_face    = 0;
+};
+
+// A group of views that is path traced in a single launch through PathIntegrator::render_views(), sharing the TLAS and descriptor
+// state of the scene. Every view is accumulated into its own layer of the output, which stays in general layout between launches.
+class ViewSet
+{
+public:
+    using Ptr = std::shared_ptr<ViewSet>;
+
+    friend class PathIntegrator;
+
+public:
+    ViewSet(vk::Backend::Ptr backend, vk::DescriptorSetLayout::Ptr view_ds_layout, uint32_t width, uint32_t height, const std::vector<View>& views);
+    ~ViewSet();
+
+    // Changing the views restarts accumulation. The number of views can not change since it determines the number of output layers.
+    void set_views(const std::vector<View>& views);
+    void restart();
+
+    // Writes the accumulation of every view to its own Radiance HDR file. Waits for the device to go idle.
+    bool save(const std::vector<std::string>& paths);
+
+    inline uint32_t                 width() { return m_width; }
+    inline uint32_t                 height() { return m_height; }
+    inline uint32_t                 num_views() { return m_views.size(); }
+    inline uint32_t                 num_accumulated_samples() { return m_num_accumulated_samples; }
+    inline const std::vector<View>& views() { return m_views; }
+
+    // Accumulation written by the most recent launch.
+    inline vk::Image::Ptr     output_image() { return m_output_images[!m_ping_pong]; }
+    inline vk::ImageView::Ptr output_image_view() { return m_output_image_views[!m_ping_pong]; }
+
+    static View              perspective_view(const glm::mat4& view, const glm::mat4& projection, float focal_length = 1.0f, float aperture_radius = 0.0f);
+    static View              equirectangular_view(const glm::vec3& position);
+    static std::vector<View> stereo_views(const glm::mat4& view, const glm::mat4& projection, float eye_separation, float focal_length = 1.0f, float aperture_radius = 0.0f);
+
+    // Faces in the order +X, -X, +Y, -Y, +Z, -Z so that the output layers can be copied straight into a cubemap.
+    static std::vector<View> cubemap_views(const glm::vec3& position);
+
+private:
+    void begin_launch(vk::CommandBuffer::Ptr cmd_buf);
+    void end_launch(vk::CommandBuffer::Ptr cmd_buf);
+
+private:
+    std::weak_ptr<vk::Backend> m_backend;
+    uint32_t                   m_width;
+    uint32_t                   m_height;
+    std::vector<View>          m_views;
+    uint32_t                   m_num_accumulated_samples = 0;
+    bool                       m_ping_pong               = false;
+    bool                       m_images_recreated        = true;
+    bool                       m_views_dirty             = true;
+    vk::Image::Ptr             m_output_images[2];
+    vk::ImageView::Ptr         m_output_image_views[2];
+    vk::DescriptorSet::Ptr     m_output_storage_image_ds[2];
+    vk::Buffer::Ptr            m_view_buffer;
+    vk::DescriptorSet::Ptr     m_view_ds;
+};
+} // namespace helios
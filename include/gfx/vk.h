@@ -6,6 +6,7 @@
 #include <memory>
 #include <stack>
 #include <deque>
+#include <mutex>
 
 struct GLFWwindow;
 struct VmaAllocator_T;
@@ -60,10 +61,20 @@ struct QueueInfos
     bool transfer();
 };
 
+// Device local memory of the process, summed over every device local heap.
+struct MemoryBudget
+{
+    VkDeviceSize usage            = 0; // Bytes in use, as reported by the driver when VK_EXT_memory_budget is available
+    VkDeviceSize budget           = 0; // Bytes that can be used before allocations start to fail or spill into system memory
+    VkDeviceSize block_bytes      = 0; // Bytes of device memory allocated by VMA
+    VkDeviceSize allocation_bytes = 0; // Bytes of those blocks occupied by resources, the rest is free space or fragmentation
+};
+
 class Backend : public std::enable_shared_from_this<Backend>
 {
 public:
-    static const uint32_t kMaxFramesInFlight = 3;
+    static const uint32_t kMaxFramesInFlight   = 3;
+    static const uint32_t kInvalidBindlessSlot = 0xFFFFFFFF;
 
     using Ptr = std::shared_ptr<Backend>;
 
@@ -118,9 +129,20 @@ public:
     VmaAllocator_T*  allocator();
     size_t           min_dynamic_ubo_alignment();
     size_t           aligned_dynamic_ubo_size(size_t size);
+    size_t           min_storage_buffer_alignment();
+    size_t           aligned_storage_buffer_size(size_t size);
+    uint32_t         max_buffer_array_descriptor_count();
+    uint32_t         max_combined_sampler_array_descriptor_count();
+    uint32_t         register_bindless_texture(std::shared_ptr<ImageView> image_view);
+    void             update_bindless_texture(uint32_t slot, std::shared_ptr<ImageView> image_view);
+    void             release_bindless_texture(uint32_t slot);
+    MemoryBudget     memory_budget();
+
+    std::shared_ptr<DescriptorSet> bindless_texture_descriptor_set();
     VkFormat         find_supported_format(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
     void             process_deletion_queue();
     void             queue_object_deletion(std::shared_ptr<Object> object);
+    bool             save_pipeline_cache();
 
     inline VkPhysicalDeviceRayTracingPipelinePropertiesKHR    ray_tracing_pipeline_properties() { return m_ray_tracing_pipeline_properties; }
     inline VkPhysicalDeviceAccelerationStructurePropertiesKHR acceleration_structure_properties() { return m_acceleration_structure_properties; }
@@ -140,6 +162,7 @@ public:
     inline std::shared_ptr<Sampler>                           trilinear_sampler() { return m_trilinear_sampler; }
     inline std::shared_ptr<Sampler>                           nearest_sampler() { return m_nearest_sampler; }
     inline std::shared_ptr<ImageView>                         default_cubemap() { return m_default_cubemap_image_view; }
+    inline VkPipelineCache                                    pipeline_cache() { return m_vk_pipeline_cache; }
 
 private:
     Backend(GLFWwindow* window, bool enable_validation_layers, bool require_ray_tracing, std::vector<const char*> additional_device_extensions);
@@ -152,6 +175,8 @@ private:
     VkResult                 create_debug_utils_messenger(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger);
     void                     destroy_debug_utils_messenger(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator);
     bool                     create_surface(GLFWwindow* window);
+    void                     grow_bindless_textures(uint32_t capacity);
+    void                     write_bindless_texture(uint32_t slot, std::shared_ptr<ImageView> image_view);
     bool                     find_physical_device(std::vector<const char*> extensions);
     bool                     is_device_suitable(VkPhysicalDevice device, VkPhysicalDeviceType type, QueueInfos& infos, SwapChainSupportDetails& details, std::vector<const char*> extensions);
     bool                     find_queues(VkPhysicalDevice device, QueueInfos& infos);
@@ -168,6 +193,7 @@ private:
                                     const std::vector<VkPipelineStageFlags>&           wait_stages,
                                     const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores);
     void                     flush(VkQueue queue, const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs);
+    void                     create_pipeline_cache();
 
 private:
     GLFWwindow*                                              m_window                = nullptr;
@@ -182,6 +208,7 @@ private:
     VkSwapchainKHR                                           m_vk_swap_chain         = nullptr;
     VkDebugUtilsMessengerEXT                                 m_vk_debug_messenger    = nullptr;
     VmaAllocator_T*                                          m_vma_allocator         = nullptr;
+    VkPipelineCache                                          m_vk_pipeline_cache     = nullptr;
     SwapChainSupportDetails                                  m_swapchain_details;
     QueueInfos                                               m_selected_queues;
     VkFormat                                                 m_swap_chain_image_format;
@@ -189,6 +216,7 @@ private:
     VkExtent2D                                               m_swap_chain_extent;
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR          m_ray_tracing_pipeline_properties;
     VkPhysicalDeviceAccelerationStructurePropertiesKHR       m_acceleration_structure_properties;
+    VkPhysicalDeviceDescriptorIndexingProperties             m_descriptor_indexing_properties;
     std::shared_ptr<RenderPass>                              m_swap_chain_render_pass;
     std::vector<std::shared_ptr<Image>>                      m_swap_chain_images;
     std::vector<std::shared_ptr<ImageView>>                  m_swap_chain_image_views;
@@ -210,8 +238,16 @@ private:
     std::shared_ptr<Image>                                   m_swap_chain_depth      = nullptr;
     std::shared_ptr<ImageView>                               m_swap_chain_depth_view = nullptr;
     VkPhysicalDeviceProperties                               m_device_properties;
-    bool                                                     m_ray_tracing_enabled = false;
+    bool                                                     m_ray_tracing_enabled   = false;
+    bool                                                     m_memory_budget_enabled = false;
     std::deque<std::pair<std::shared_ptr<Object>, uint32_t>> m_deletion_queue;
+    std::shared_ptr<DescriptorPool>                          m_bindless_texture_descriptor_pool;
+    std::shared_ptr<DescriptorSet>                           m_bindless_texture_descriptor_set;
+    std::vector<VkDescriptorImageInfo>                       m_bindless_textures;
+    uint32_t                                                 m_bindless_texture_capacity = 0;
+    std::vector<uint32_t>                                    m_bindless_texture_free_slots;
+    std::deque<std::pair<uint32_t, uint32_t>>                m_bindless_texture_release_queue;
+    std::mutex                                               m_bindless_texture_mutex;
 };
 
 class Object
@@ -252,6 +288,7 @@ public:
     inline VkSampleCountFlags sample_count() { return m_sample_count; }
     inline VkImageTiling      tiling() { return m_tiling; }
     inline void*              mapped_ptr() { return m_mapped_ptr; }
+    inline VkDeviceSize       allocation_size() { return m_allocation_size; }
 
 private:
     Image(Backend::Ptr backend, VkImageType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, uint32_t array_size, VkFormat format, VmaMemoryUsage memory_usage, VkImageUsageFlags usage, VkSampleCountFlagBits sample_count, VkImageLayout initial_layout, size_t size, void* data, VkImageCreateFlags flags = 0, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL);
@@ -275,6 +312,7 @@ private:
     VmaAllocator_T*       m_vma_allocator    = nullptr;
     VmaAllocation_T*      m_vma_allocation   = nullptr;
     void*                 m_mapped_ptr       = nullptr;
+    VkDeviceSize          m_allocation_size  = 0;
 };
 
 class ImageView : public Object
@@ -348,6 +386,7 @@ public:
     void set_name(const std::string& name);
 
     void upload_data(void* data, size_t size, size_t offset);
+    void invalidate_mapped_data();
 
     inline const VkBuffer& handle() { return m_vk_buffer; }
     inline size_t          size() { return m_size; }
@@ -608,7 +647,7 @@ public:
         Desc& set_base_pipeline_index(const int32_t& index);
     };
 
-    static GraphicsPipeline::Ptr create_for_post_process(Backend::Ptr backend, std::string vs, std::string fs, std::shared_ptr<PipelineLayout> pipeline_layout, RenderPass::Ptr render_pass);
+    static GraphicsPipeline::Ptr create_for_post_process(Backend::Ptr backend, ShaderModule::Ptr vs, ShaderModule::Ptr fs, std::shared_ptr<PipelineLayout> pipeline_layout, RenderPass::Ptr render_pass);
     static GraphicsPipeline::Ptr create(Backend::Ptr backend, Desc desc);
 
     inline const VkPipeline& handle() { return m_vk_pipeline; }
@@ -677,6 +716,8 @@ public:
         std::vector<VkPipelineShaderStageCreateInfo> miss_stages;
         std::vector<HitGroupDesc>                    hit_groups;
         std::vector<std::string>                     entry_point_names;
+        std::vector<VkSpecializationMapEntry>        specialization_map_entries;
+        std::vector<uint8_t>                         specialization_data;
 
         Desc();
         Desc& add_ray_gen_group(ShaderModule::Ptr shader, const std::string& entry_point);
@@ -687,6 +728,8 @@ public:
                             ShaderModule::Ptr  intersection_shader      = nullptr,
                             const std::string& intersection_entry_point = "");
         Desc& add_miss_group(ShaderModule::Ptr shader, const std::string& entry_point);
+        // Applied to every stage in the table. Entries for constant IDs that a stage does not declare are ignored.
+        Desc& set_specialization_constants(const std::vector<VkSpecializationMapEntry>& entries, const void* data, size_t size);
     };
 
     static ShaderBindingTable::Ptr create(Backend::Ptr backend, Desc desc);
@@ -708,6 +751,9 @@ private:
     std::vector<std::string>                          m_entry_point_names;
     std::vector<VkPipelineShaderStageCreateInfo>      m_stages;
     std::vector<VkRayTracingShaderGroupCreateInfoKHR> m_groups;
+    std::vector<VkSpecializationMapEntry>             m_specialization_map_entries;
+    std::vector<uint8_t>                              m_specialization_data;
+    VkSpecializationInfo                              m_specialization_info;
 };
 
 class RayTracingPipeline : public Object
@@ -717,8 +763,10 @@ public:
 
     struct Desc
     {
-        VkRayTracingPipelineCreateInfoKHR create_info;
-        ShaderBindingTable::Ptr           sbt;
+        VkRayTracingPipelineCreateInfoKHR          create_info;
+        VkRayTracingPipelineInterfaceCreateInfoKHR interface_info;
+        ShaderBindingTable::Ptr                    sbt;
+        std::vector<RayTracingPipeline::Ptr>       libraries;
 
         Desc();
         Desc& set_shader_binding_table(ShaderBindingTable::Ptr table);
@@ -726,6 +774,12 @@ public:
         Desc& set_max_pipeline_ray_recursion_depth(uint32_t depth);
         Desc& set_base_pipeline(RayTracingPipeline::Ptr pipeline);
         Desc& set_base_pipeline_index(int32_t index);
+        // Pipeline libraries: stages compiled as a library are linked into a full pipeline later on. Both the libraries and the
+        // linked pipeline must agree on the interface. When libraries are added, the shader binding table only describes the
+        // layout of the linked groups, which have to be in the same order as the groups of the libraries.
+        Desc& set_library(bool library);
+        Desc& set_pipeline_interface(uint32_t max_ray_payload_size, uint32_t max_hit_attribute_size);
+        Desc& add_library(RayTracingPipeline::Ptr library);
     };
 
     static RayTracingPipeline::Ptr create(Backend::Ptr backend, Desc desc);
@@ -733,6 +787,7 @@ public:
     inline ShaderBindingTable::Ptr shader_binding_table() { return m_sbt; }
     inline Buffer::Ptr             shader_binding_table_buffer() { return m_vk_buffer; }
     inline const VkPipeline&       handle() { return m_vk_pipeline; }
+    inline bool                    is_library() { return m_library; }
 
     ~RayTracingPipeline();
 
@@ -742,9 +797,11 @@ private:
     RayTracingPipeline(Backend::Ptr backend, Desc desc);
 
 private:
-    VkPipeline              m_vk_pipeline;
-    vk::Buffer::Ptr         m_vk_buffer;
-    ShaderBindingTable::Ptr m_sbt;
+    VkPipeline                           m_vk_pipeline;
+    vk::Buffer::Ptr                      m_vk_buffer;
+    ShaderBindingTable::Ptr              m_sbt;
+    std::vector<RayTracingPipeline::Ptr> m_libraries;
+    bool                                 m_library = false;
 };
 
 class AccelerationStructure : public Object
@@ -842,9 +899,11 @@ public:
     {
         std::vector<VkDescriptorSetLayoutBinding> bindings;
         VkSampler                                 binding_samplers[32][8];
-        void*                                     pnext_ptr = nullptr;
+        void*                                     pnext_ptr    = nullptr;
+        VkDescriptorSetLayoutCreateFlags          create_flags = 0;
 
         Desc& set_next_ptr(void* pnext);
+        Desc& set_create_flags(VkDescriptorSetLayoutCreateFlags flags);
         Desc& add_binding(uint32_t binding, VkDescriptorType descriptor_type, uint32_t descriptor_count, VkShaderStageFlags stage_flags);
         Desc& add_binding(uint32_t binding, VkDescriptorType descriptor_type, uint32_t descriptor_count, VkShaderStageFlags stage_flags, Sampler::Ptr samplers[]);
     };
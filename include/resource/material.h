@@ -42,6 +42,8 @@ private:
     float                                   m_roughness_value = 0.0f;
     bool                                    m_alpha_test      = false;
     uint32_t                                m_id;
+    uint64_t                                m_version     = 0;
+    uint32_t                                m_light_group = 0;
     std::string                             m_path;
 
 public:
@@ -62,6 +64,11 @@ public:
     ~Material();
 
     bool                              is_emissive();
+    void                              set_albedo_value(const glm::vec4& value);
+    void                              set_emissive_value(const glm::vec4& value);
+    void                              set_metallic_value(float value);
+    void                              set_roughness_value(float value);
+    void                              set_light_group(uint32_t group);
     inline bool                       is_alpha_tested() { return m_alpha_test; }
     inline MaterialType               type() { return m_type; }
     inline std::shared_ptr<Texture2D> albedo_texture() { return m_albedo_texture_info.array_index == -1 ? nullptr : m_textures[m_albedo_texture_info.array_index]; }
@@ -80,6 +87,11 @@ public:
     inline float                      roughness_value() { return m_roughness_value; }
     inline uint32_t                   id() { return m_id; }
     inline std::string                path() { return m_path; }
+    inline uint64_t                   version() { return m_version; }
+    inline uint32_t                   light_group() { return m_light_group; }
+
+    // Version of the most recently edited material, scenes compare it against the last version they uploaded.
+    static uint64_t latest_version();
 
 private:
     Material(vk::Backend::Ptr                        backend,
@@ -96,5 +108,11 @@ private:
              float                                   roughness_value = 0.0f,
              bool                                    alpha_test      = false,
              const std::string&                      path            = "");
+
+    // Takes over the properties and textures of a material reloaded from the same file, keeping the handle, id and light group.
+    void replace(Material::Ptr other);
+
+    // Lets scenes pick up changes that do not go through the setters, e.g. a texture whose image was swapped.
+    void increment_version();
 };
 } // namespace helios
\ No newline at end of file
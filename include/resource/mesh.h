@@ -26,6 +26,19 @@ struct SubMesh
     uint32_t    base_index;
     glm::vec3   max_extents;
     glm::vec3   min_extents;
+    // The triangles of submeshes with an alpha tested material are sorted into those the alpha test never cuts out, those it has
+    // to run for and those it always cuts out, in that order. Only the first are marked opaque and the last are left out of the BLAS.
+    // Instances with a material override are traced against a second BLAS of the mesh which keeps every triangle of those submeshes.
+    uint32_t    opaque_triangle_count  = 0;
+    uint32_t    cut_out_triangle_count = 0;
+};
+
+// A geometry of the BLAS of a mesh, which gl_GeometryIndexEXT indexes. The first ones belong to the submeshes in order, followed by
+// the alpha tested triangles of submeshes that were split. The override BLAS only has the former, one for each whole submesh.
+struct MeshGeometry
+{
+    uint32_t submesh_idx;
+    uint32_t primitive_offset; // First triangle of the geometry in the index buffer
 };
 
 class Material;
@@ -39,13 +52,17 @@ public:
 
 private:
     vk::AccelerationStructure::Ptr         m_blas;
+    vk::AccelerationStructure::Ptr         m_override_blas; // Only built when alpha tested submeshes were sorted
     VkAccelerationStructureCreateInfoKHR   m_blas_info;
     vk::Buffer::Ptr                        m_vbo;
     vk::Buffer::Ptr                        m_ibo;
     std::vector<SubMesh>                   m_sub_meshes;
+    std::vector<MeshGeometry>              m_geometries;
     std::vector<std::shared_ptr<Material>> m_materials;
     uint32_t                               m_id;
     std::string                            m_path;
+    uint64_t                               m_last_used_frame = 0; // Residency frame of the ResourceManager in which the mesh was last rendered
+    uint64_t                               m_version         = 0;
 
 public:
     static Mesh::Ptr create(vk::Backend::Ptr                       backend,
@@ -66,11 +83,19 @@ public:
 
     inline const std::vector<std::shared_ptr<Material>>& materials() { return m_materials; }
     inline const std::vector<SubMesh>&                   sub_meshes() { return m_sub_meshes; }
+    inline const std::vector<MeshGeometry>&              geometries() { return m_geometries; }
     inline vk::AccelerationStructure::Ptr                acceleration_structure() { return m_blas; }
+    inline vk::AccelerationStructure::Ptr                override_acceleration_structure() { return m_override_blas ? m_override_blas : m_blas; }
+    inline bool                                          has_override_acceleration_structure() { return m_override_blas != nullptr; }
     inline vk::Buffer::Ptr                               vertex_buffer() { return m_vbo; }
     inline vk::Buffer::Ptr                               index_buffer() { return m_ibo; }
     inline uint32_t                                      id() { return m_id; }
     inline std::string                                   path() { return m_path; }
+    inline uint64_t                                      last_used_frame() { return m_last_used_frame; }
+    inline uint64_t                                      version() { return m_version; }
+
+    // Version of the most recently reloaded mesh, scenes compare it against the last version they built their hierarchy with.
+    static uint64_t latest_version();
 
 private:
     Mesh(vk::Backend::Ptr                       backend,
@@ -80,5 +105,9 @@ private:
          std::vector<std::shared_ptr<Material>> materials,
          vk::BatchUploader&                     uploader,
          const std::string&                     path = "");
+
+    // Takes over the geometry, acceleration structure and materials of a mesh reloaded from the same file. The old buffers are
+    // destroyed once the frames in flight are done with them.
+    void replace_geometry(Mesh::Ptr other);
 };
 } // namespace helios
\ No newline at end of file
@@ -5,16 +5,23 @@
 #include <glm.hpp>
 #include <gtc/quaternion.hpp>
 #include <utility/macros.h>
+#include <utility/linear_allocator.h>
 #include <memory>
 #include <vector>
 #include <unordered_map>
+#include <algorithm>
 
 namespace helios
 {
-#define MAX_SCENE_MESH_INSTANCE_COUNT 1024
-#define MAX_SCENE_LIGHT_COUNT 100000
-#define MAX_SCENE_MATERIAL_COUNT 4096
-#define MAX_SCENE_MATERIAL_TEXTURE_COUNT (MAX_SCENE_MATERIAL_COUNT * 4)
+#define MAX_SCENE_MESH_COUNT (1 << 16) // Upper bound of the VBO, IBO and submesh info arrays, further limited by the device
+#define MAX_SCENE_INSTANCE_COUNT (1 << 24) // Limited by the 24 bits of VkAccelerationStructureInstanceKHR::instanceCustomIndex
+#define MAX_SCENE_MATERIAL_TEXTURE_COUNT (1 << 18) // Upper bound of the bindless texture array, further limited by the device
+#define SCENE_INITIAL_MESH_CAPACITY 64
+#define SCENE_INITIAL_INSTANCE_CAPACITY 1024
+#define SCENE_INITIAL_LIGHT_CAPACITY 64
+#define SCENE_INITIAL_MATERIAL_CAPACITY 64
+#define MAX_LIGHT_GROUPS 4 // Keep in sync with common.glsl
+#define MAX_PROBE_VOLUME_RESOLUTION 64
 
 class Scene;
 class Mesh;
@@ -29,10 +36,20 @@ enum NodeType
     NODE_SPOT_LIGHT,
     NODE_POINT_LIGHT,
     NODE_IBL,
-    NODE_ROOT
+    NODE_PROBE_VOLUME,
+    NODE_ROOT,
+    NODE_INSTANCER
 };
 
-struct RenderState;
+class RenderState;
+
+enum SceneState
+{
+    SCENE_STATE_READY,
+    SCENE_STATE_PROPERTIES_UPDATED, // Only material or light properties changed, the affected GPU slots are patched in place
+    SCENE_STATE_TRANSFORMS_UPDATED,
+    SCENE_STATE_HIERARCHY_UPDATED
+};
 
 struct AccelerationStructureData
 {
@@ -55,6 +72,7 @@ protected:
     bool                               m_is_enabled         = true;
     bool                               m_is_transform_dirty = true;
     bool                               m_is_heirarchy_dirty = true;
+    bool                               m_is_property_dirty  = false;
     std::string                        m_name;
     Node*                              m_parent = nullptr;
     std::vector<std::shared_ptr<Node>> m_children;
@@ -84,6 +102,7 @@ protected:
     virtual void mid_frame_cleanup();
     void         update_children(RenderState& render_state);
     void         mark_transforms_as_dirty();
+    void         update_property_state(RenderState& render_state);
 };
 
 class TransformNode : public Node
@@ -126,6 +145,9 @@ public:
     void      move(const glm::vec3& displacement);
     void      rotate_euler_yxz(const glm::vec3& e);
     void      rotate_euler_xyz(const glm::vec3& e);
+
+protected:
+    virtual void transform_updated(RenderState& render_state);
 };
 
 class RootNode : public TransformNode
@@ -148,7 +170,6 @@ public:
 private:
     std::shared_ptr<Mesh>     m_mesh;
     std::shared_ptr<Material> m_material_override;
-    vk::Buffer::Ptr           m_material_indices_buffer;
 
 public:
     MeshNode(const std::string& name);
@@ -160,10 +181,44 @@ public:
     void                             set_material_override(std::shared_ptr<Material> material_override);
     inline std::shared_ptr<Mesh>     mesh() { return m_mesh; }
     inline std::shared_ptr<Material> material_override() { return m_material_override; }
-    inline vk::Buffer::Ptr           material_indices_buffer() { return m_material_indices_buffer; }
 
 private:
-    void create_instance_data_buffer();
+    void mid_frame_material_cleanup();
+
+protected:
+    void mid_frame_cleanup() override;
+};
+
+// Emits any number of instances of a single mesh without creating a node for each of them. Only a 3x4 transform relative to the
+// instancer is stored per instance, so scattering millions of copies of a mesh costs little more than the transforms themselves.
+class InstancerNode : public TransformNode
+{
+public:
+    using Ptr = std::shared_ptr<InstancerNode>;
+
+private:
+    std::shared_ptr<Mesh>     m_mesh;
+    std::shared_ptr<Material> m_material_override;
+    std::vector<glm::mat3x4>  m_instance_transforms;
+
+public:
+    InstancerNode(const std::string& name);
+    ~InstancerNode();
+
+    void update(RenderState& render_state) override;
+
+    void                                   set_mesh(std::shared_ptr<Mesh> mesh);
+    void                                   set_material_override(std::shared_ptr<Material> material_override);
+    void                                   set_instances(const std::vector<glm::mat4>& transforms);
+    void                                   add_instance(const glm::mat4& transform);
+    void                                   clear_instances();
+    glm::mat4                              instance_transform(uint32_t idx);
+    inline std::shared_ptr<Mesh>           mesh() { return m_mesh; }
+    inline std::shared_ptr<Material>       material_override() { return m_material_override; }
+    inline uint32_t                        instance_count() { return m_instance_transforms.size(); }
+    inline const std::vector<glm::mat3x4>& instance_transforms() { return m_instance_transforms; }
+
+private:
     void mid_frame_material_cleanup();
 
 protected:
@@ -176,9 +231,10 @@ public:
     using Ptr = std::shared_ptr<DirectionalLightNode>;
 
 private:
-    glm::vec3 m_color     = glm::vec4(1.0f);
-    float     m_intensity = 1.0f;
-    float     m_radius    = 0.1f;
+    glm::vec3 m_color       = glm::vec4(1.0f);
+    float     m_intensity   = 1.0f;
+    float     m_radius      = 0.1f;
+    uint32_t  m_light_group = 0;
 
 public:
     DirectionalLightNode(const std::string& name);
@@ -186,12 +242,17 @@ public:
 
     void update(RenderState& render_state) override;
 
-    inline void      set_color(const glm::vec3& color) { m_color = color; }
-    inline void      set_intensity(const float& intensity) { m_intensity = intensity; }
-    inline void      set_radius(const float& r) { m_radius = r; }
+    inline void      set_color(const glm::vec3& color) { m_color = color; m_is_property_dirty = true; }
+    inline void      set_intensity(const float& intensity) { m_intensity = intensity; m_is_property_dirty = true; }
+    inline void      set_radius(const float& r) { m_radius = r; m_is_property_dirty = true; }
+    inline void      set_light_group(uint32_t group) { m_light_group = std::min(group, uint32_t(MAX_LIGHT_GROUPS - 1)); m_is_property_dirty = true; }
     inline glm::vec3 color() { return m_color; }
     inline float     intensity() { return m_intensity; }
     inline float     radius() { return m_radius; }
+    inline uint32_t  light_group() { return m_light_group; }
+
+protected:
+    void transform_updated(RenderState& render_state) override;
 };
 
 class SpotLightNode : public TransformNode
@@ -204,6 +265,7 @@ public:
     float     m_outer_cone_angle = 50.0f;
     float     m_intensity        = 1.0f;
     float     m_radius           = 5.0f;
+    uint32_t  m_light_group      = 0;
 
 public:
     SpotLightNode(const std::string& name);
@@ -211,16 +273,21 @@ public:
 
     void update(RenderState& render_state) override;
 
-    inline void      set_color(const glm::vec3& color) { m_color = color; }
-    inline void      set_intensity(const float& intensity) { m_intensity = intensity; }
-    inline void      set_inner_cone_angle(const float& cone_angle) { m_inner_cone_angle = cone_angle; }
-    inline void      set_outer_cone_angle(const float& cone_angle) { m_outer_cone_angle = cone_angle; }
-    inline void      set_radius(const float& r) { m_radius = r; }
+    inline void      set_color(const glm::vec3& color) { m_color = color; m_is_property_dirty = true; }
+    inline void      set_intensity(const float& intensity) { m_intensity = intensity; m_is_property_dirty = true; }
+    inline void      set_inner_cone_angle(const float& cone_angle) { m_inner_cone_angle = cone_angle; m_is_property_dirty = true; }
+    inline void      set_outer_cone_angle(const float& cone_angle) { m_outer_cone_angle = cone_angle; m_is_property_dirty = true; }
+    inline void      set_radius(const float& r) { m_radius = r; m_is_property_dirty = true; }
+    inline void      set_light_group(uint32_t group) { m_light_group = std::min(group, uint32_t(MAX_LIGHT_GROUPS - 1)); m_is_property_dirty = true; }
     inline glm::vec3 color() { return m_color; }
     inline float     intensity() { return m_intensity; }
     inline float     radius() { return m_radius; }
+    inline uint32_t  light_group() { return m_light_group; }
     inline float     inner_cone_angle() { return m_inner_cone_angle; }
     inline float     outer_cone_angle() { return m_outer_cone_angle; }
+
+protected:
+    void transform_updated(RenderState& render_state) override;
 };
 
 class PointLightNode : public TransformNode
@@ -229,9 +296,10 @@ public:
     using Ptr = std::shared_ptr<PointLightNode>;
 
 private:
-    glm::vec3 m_color     = glm::vec4(1.0f);
-    float     m_intensity = 1.0f;
-    float     m_radius    = 5.0f;
+    glm::vec3 m_color       = glm::vec4(1.0f);
+    float     m_intensity   = 1.0f;
+    float     m_radius      = 5.0f;
+    uint32_t  m_light_group = 0;
 
 public:
     PointLightNode(const std::string& name);
@@ -239,12 +307,17 @@ public:
 
     void update(RenderState& render_state) override;
 
-    inline void      set_color(const glm::vec3& color) { m_color = color; }
-    inline void      set_intensity(const float& intensity) { m_intensity = intensity; }
-    inline void      set_radius(const float& r) { m_radius = r; }
+    inline void      set_color(const glm::vec3& color) { m_color = color; m_is_property_dirty = true; }
+    inline void      set_intensity(const float& intensity) { m_intensity = intensity; m_is_property_dirty = true; }
+    inline void      set_radius(const float& r) { m_radius = r; m_is_property_dirty = true; }
+    inline void      set_light_group(uint32_t group) { m_light_group = std::min(group, uint32_t(MAX_LIGHT_GROUPS - 1)); m_is_property_dirty = true; }
     inline glm::vec3 color() { return m_color; }
     inline float     intensity() { return m_intensity; }
     inline float     radius() { return m_radius; }
+    inline uint32_t  light_group() { return m_light_group; }
+
+protected:
+    void transform_updated(RenderState& render_state) override;
 };
 
 class CameraNode : public TransformNode
@@ -290,6 +363,7 @@ public:
 
 private:
     std::shared_ptr<TextureCube> m_image;
+    uint32_t                     m_light_group = 0;
 
 public:
     IBLNode(const std::string& name);
@@ -298,17 +372,40 @@ public:
     void update(RenderState& render_state) override;
 
     void                                set_image(std::shared_ptr<TextureCube> image);
+    inline void                         set_light_group(uint32_t group) { m_light_group = std::min(group, uint32_t(MAX_LIGHT_GROUPS - 1)); m_is_property_dirty = true; }
     inline std::shared_ptr<TextureCube> image() { return m_image; }
+    inline uint32_t                     light_group() { return m_light_group; }
 
 protected:
     void mid_frame_cleanup() override;
 };
 
-enum SceneState
+// Places a grid of irradiance probes inside the unit cube [-0.5, 0.5] of its global transform, one probe at the center of every
+// cell. The probes are baked through PathIntegrator::render_probes() and do not take part in rendering the scene.
+class ProbeVolumeNode : public TransformNode
 {
-    SCENE_STATE_READY,
-    SCENE_STATE_HIERARCHY_UPDATED,
-    SCENE_STATE_TRANSFORMS_UPDATED
+public:
+    using Ptr = std::shared_ptr<ProbeVolumeNode>;
+
+private:
+    glm::uvec3 m_resolution = glm::uvec3(4);
+    uint32_t   m_sh_bands   = 3;
+
+public:
+    ProbeVolumeNode(const std::string& name);
+    ~ProbeVolumeNode();
+
+    void update(RenderState& render_state) override;
+
+    glm::vec3         probe_position(uint32_t x, uint32_t y, uint32_t z);
+    void              set_resolution(const glm::uvec3& resolution);
+    void              set_sh_bands(uint32_t bands);
+    inline glm::uvec3 resolution() { return m_resolution; }
+    inline uint32_t   sh_bands() { return m_sh_bands; }
+    inline uint32_t   num_probes() { return m_resolution.x * m_resolution.y * m_resolution.z; }
+
+protected:
+    void transform_updated(RenderState& render_state) override;
 };
 
 class RenderState
@@ -317,6 +414,7 @@ public:
     friend class Node;
     friend class TransformNode;
     friend class MeshNode;
+    friend class InstancerNode;
     friend class DirectionalLightNode;
     friend class SpotLightNode;
     friend class PointLightNode;
@@ -327,6 +425,7 @@ public:
 
 private:
     std::vector<MeshNode*>             m_meshes;
+    std::vector<InstancerNode*>        m_instancers;
     std::vector<DirectionalLightNode*> m_directional_lights;
     std::vector<SpotLightNode*>        m_spot_lights;
     std::vector<PointLightNode*>       m_point_lights;
@@ -337,6 +436,7 @@ private:
     uint32_t                           m_viewport_width  = 0;
     uint32_t                           m_viewport_height = 0;
     uint32_t                           m_num_lights      = 0;
+    uint32_t                           m_num_instances   = 0;
     vk::DescriptorSet::Ptr             m_read_image_ds;
     vk::DescriptorSet::Ptr             m_write_image_ds;
     vk::DescriptorSet::Ptr             m_scene_ds;
@@ -345,8 +445,13 @@ private:
     vk::DescriptorSet::Ptr             m_material_indices_ds;
     vk::DescriptorSet::Ptr             m_texture_ds;
     vk::DescriptorSet::Ptr             m_ray_debug_ds;
+    vk::DescriptorSet::Ptr             m_light_group_ds;
     vk::CommandBuffer::Ptr             m_cmd_buffer;
 
+private:
+    // Scene states are ordered by how much of the GPU scene has to be rebuilt, the largest one requested during a frame wins.
+    inline void promote_scene_state(SceneState state) { m_scene_state = std::max(m_scene_state, state); }
+
 public:
     RenderState();
     ~RenderState();
@@ -354,7 +459,11 @@ public:
     void clear();
     void setup(uint32_t width, uint32_t height, vk::CommandBuffer::Ptr cmd_buffer);
 
+    // The environment light is the IBL if there is one, otherwise the sky of the first directional light.
+    uint32_t environment_light_group();
+
     inline const std::vector<MeshNode*>&             meshes() { return m_meshes; }
+    inline const std::vector<InstancerNode*>&        instancers() { return m_instancers; }
     inline const std::vector<DirectionalLightNode*>& directional_lights() { return m_directional_lights; }
     inline const std::vector<SpotLightNode*>&        spot_lights() { return m_spot_lights; }
     inline const std::vector<PointLightNode*>&       point_lights() { return m_point_lights; }
@@ -365,6 +474,7 @@ public:
     inline uint32_t                                  viewport_width() { return m_viewport_width; }
     inline uint32_t                                  viewport_height() { return m_viewport_height; }
     inline uint32_t                                  num_lights() { return m_num_lights; }
+    inline uint32_t                                  num_instances() { return m_num_instances; }
     inline vk::DescriptorSet::Ptr                    read_image_descriptor_set() { return m_read_image_ds; }
     inline vk::DescriptorSet::Ptr                    write_image_descriptor_set() { return m_write_image_ds; }
     inline vk::DescriptorSet::Ptr                    scene_descriptor_set() { return m_scene_ds; }
@@ -373,6 +483,7 @@ public:
     inline vk::DescriptorSet::Ptr                    material_indices_descriptor_set() { return m_material_indices_ds; }
     inline vk::DescriptorSet::Ptr                    texture_descriptor_set() { return m_texture_ds; }
     inline vk::DescriptorSet::Ptr                    ray_debug_descriptor_set() { return m_ray_debug_ds; }
+    inline vk::DescriptorSet::Ptr                    light_group_descriptor_set() { return m_light_group_ds; }
     inline vk::CommandBuffer::Ptr                    cmd_buffer() { return m_cmd_buffer; }
 };
 
@@ -425,7 +536,7 @@ private:
     };
 
 public:
-    static Scene::Ptr create(vk::Backend::Ptr backend, const std::string& name, Node::Ptr root = nullptr, const std::string& path = "");
+    static Scene::Ptr create(vk::Backend::Ptr backend, ShaderCache::Ptr shader_cache, const std::string& name, Node::Ptr root = nullptr, const std::string& path = "");
     ~Scene();
 
     void            update(RenderState& render_state);
@@ -442,24 +553,52 @@ public:
     inline HosekWilkieSkyModel*       sky_model() { return m_sky_model.get(); }
 
 private:
-    Scene(vk::Backend::Ptr backend, const std::string& name, Node::Ptr root = nullptr, const std::string& path = "");
+    Scene(vk::Backend::Ptr backend, ShaderCache::Ptr shader_cache, const std::string& name, Node::Ptr root = nullptr, const std::string& path = "");
     void create_gpu_resources(RenderState& render_state);
     void update_static_descriptors();
+    void ensure_instance_capacity(uint32_t num_instances);
+    void ensure_light_capacity(uint32_t num_lights);
+    void ensure_material_capacity(uint32_t num_materials);
+    void ensure_descriptor_capacity(uint32_t num_meshes);
+    bool update_gpu_properties(RenderState& render_state);
+
+private:
+    struct MaterialSlot
+    {
+        std::shared_ptr<Material> material;
+        uint32_t                  index;
+        bool                      is_emissive;
+    };
 
 private:
     AccelerationStructureData              m_tlas;
     Node::Ptr                              m_root;
     vk::DescriptorPool::Ptr                m_descriptor_pool;
+    vk::DescriptorPool::Ptr                m_array_descriptor_pool;
     vk::DescriptorSet::Ptr                 m_scene_descriptor_set;
     vk::DescriptorSet::Ptr                 m_vbo_descriptor_set;
     vk::DescriptorSet::Ptr                 m_ibo_descriptor_set;
     vk::DescriptorSet::Ptr                 m_material_indices_descriptor_set;
-    vk::DescriptorSet::Ptr                 m_textures_descriptor_set;
     vk::Buffer::Ptr                        m_light_data_buffer;
     vk::Buffer::Ptr                        m_material_data_buffer;
     vk::Buffer::Ptr                        m_instance_data_buffer;
-    std::unordered_map<uint32_t, uint32_t> m_global_material_indices;
-    std::unordered_map<uint32_t, uint32_t> m_global_mesh_indices;
+    vk::Buffer::Ptr                        m_submesh_info_buffer;
+    uint32_t                               m_instance_capacity = 0;
+    uint32_t                               m_light_capacity    = 0;
+    uint32_t                               m_material_capacity = 0;
+    uint32_t                               m_mesh_capacity     = 0;
+    ScratchHashMap<uint32_t, uint32_t>     m_global_material_indices;
+    std::vector<MaterialSlot>              m_material_slots;
+    std::vector<uint32_t>                  m_material_slot_users;
+    std::vector<uint32_t>                  m_dirty_material_slots;
+    uint64_t                               m_material_version     = 0;
+    uint64_t                               m_mesh_version         = 0;
+    uint64_t                               m_texture_cube_version = 0;
+    ScratchHashMap<uint32_t, uint32_t>     m_global_mesh_indices;
+    LinearAllocator                        m_frame_allocator; // Temporaries of a single update, reset at the start of the next one
+    ScratchHashSet<uint32_t>               m_processed_meshes;
+    ScratchHashSet<uint32_t>               m_processed_materials;
+    ScratchHashMap<uint64_t, uint32_t>     m_material_data_indices;
     size_t                                 m_camera_buffer_aligned_size;
     uint32_t                               m_num_area_lights = 0;
     std::unique_ptr<HosekWilkieSkyModel>   m_sky_model;
@@ -1,10 +1,65 @@
 #pragma once
 
 #include <gfx/vk.h>
+#include <glm.hpp>
 #include <memory>
+#include <vector>
 
 namespace helios
 {
+enum AlphaCoverageFlags
+{
+    ALPHA_COVERAGE_OPAQUE  = 1, // Every texel passes the alpha test
+    ALPHA_COVERAGE_CUT_OUT = 2  // Every texel fails the alpha test
+};
+
+// Conservative summary of the alpha channel of a texture against the alpha test of the any-hit shader, used when meshes are
+// imported to find the triangles that the alpha test never or always cuts out. The finest level is a power of two grid over UV
+// space of at most 512x512 cells, each of which covers the texels that bilinear filtering may read anywhere inside of it. Every
+// level above merges 2x2 cells of the one below.
+class AlphaCoverage
+{
+public:
+    using Ptr = std::shared_ptr<AlphaCoverage>;
+
+    // Must be kept in sync with the cutoff in path_trace_rahit.glsl.
+    static constexpr float kAlphaTestCutoff = 0.1f;
+
+public:
+    // Takes the alpha of every texel of the top mip, row by row.
+    static AlphaCoverage::Ptr create(uint32_t width, uint32_t height, const std::vector<uint8_t>& alpha);
+    // For textures without an alpha channel, which always pass the alpha test.
+    static AlphaCoverage::Ptr create_opaque();
+    ~AlphaCoverage();
+
+    // Returns the flags that hold for every texel the triangle may sample, or 0 if the alpha test has to be run.
+    uint8_t classify(const glm::vec2& uv0, const glm::vec2& uv1, const glm::vec2& uv2);
+
+private:
+    struct Level
+    {
+        uint32_t             width;
+        uint32_t             height;
+        std::vector<uint8_t> flags;
+    };
+
+    struct Triangle
+    {
+        glm::vec2 min_extents;
+        glm::vec2 max_extents;
+        glm::vec3 edges[3]; // Edge functions that are positive inside the triangle
+    };
+
+    AlphaCoverage(uint32_t width, uint32_t height, const std::vector<uint8_t>& alpha);
+    AlphaCoverage();
+
+    // Cell coordinates are not wrapped, so that neighbouring cells stay neighbours across the edges of the texture.
+    uint8_t classify_cell(uint32_t level, int32_t x, int32_t y, const Triangle& triangle);
+
+private:
+    std::vector<Level> m_levels; // Finest first
+};
+
 class Texture : public vk::Object
 {
 public:
@@ -17,6 +72,7 @@ protected:
     vk::ImageView::Ptr m_image_view;
     std::string        m_path;
     uint32_t           m_id;
+    uint64_t           m_last_used_frame = 0; // Residency frame of the ResourceManager in which the texture was last rendered
 
 public:
     Texture(vk::Backend::Ptr backend, vk::Image::Ptr image, vk::ImageView::Ptr image_view, const std::string& path);
@@ -26,6 +82,7 @@ public:
     inline vk::ImageView::Ptr image_view() { return m_image_view; }
     inline uint32_t           id() { return m_id; }
     inline std::string        path() { return m_path; }
+    inline uint64_t           last_used_frame() { return m_last_used_frame; }
 };
 
 class Texture2D : public Texture
@@ -39,8 +96,25 @@ public:
     static Texture2D::Ptr create(vk::Backend::Ptr backend, vk::Image::Ptr image, vk::ImageView::Ptr image_view, const std::string& path);
     ~Texture2D();
 
+    // Index of the texture in the bindless texture array, stable for the lifetime of the texture.
+    inline uint32_t bindless_index() { return m_bindless_index; }
+
+    // Mip of the source image that the resident image starts at. Cold textures are evicted down to their smallest mips by the
+    // ResourceManager, which swaps the image behind the bindless index and reloads the full chain once the texture is used again.
+    inline uint32_t resident_mip() { return m_resident_mip; }
+    inline bool     is_evicted() { return m_resident_mip > 0; }
+
+    // Null if the alpha channel could not be read, e.g. for block compression formats it does not decode.
+    inline AlphaCoverage::Ptr alpha_coverage() { return m_alpha_coverage; }
+
 private:
     Texture2D(vk::Backend::Ptr backend, vk::Image::Ptr image, vk::ImageView::Ptr image_view, const std::string& path);
+
+private:
+    uint32_t           m_bindless_index = vk::Backend::kInvalidBindlessSlot;
+    uint32_t           m_resident_mip   = 0;
+    bool               m_srgb           = false;
+    AlphaCoverage::Ptr m_alpha_coverage;
 };
 
 class TextureCube : public Texture
@@ -54,7 +128,20 @@ public:
     static TextureCube::Ptr create(vk::Backend::Ptr backend, vk::Image::Ptr image, vk::ImageView::Ptr image_view, const std::string& path);
     ~TextureCube();
 
+    inline uint64_t version() { return m_version; }
+
+    // Version of the most recently reloaded cubemap, scenes compare it against the last version they wrote their environment map with.
+    static uint64_t latest_version();
+
 private:
     TextureCube(vk::Backend::Ptr backend, vk::Image::Ptr image, vk::ImageView::Ptr image_view, const std::string& path);
+
+    // Takes over the image of a cubemap reloaded from the same file. The old image is destroyed once the frames in flight are done
+    // with it.
+    void replace_image(TextureCube::Ptr other);
+
+private:
+    bool     m_srgb    = false;
+    uint64_t m_version = 0;
 };
 } // namespace helios
\ No newline at end of file
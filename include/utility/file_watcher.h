@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace helios
+{
+// Reports watched files that were written since the last poll. On Linux the parent directories are watched through inotify, which
+// also catches files that tools replace by renaming a temporary file over them. A directory stays watched until the last file in it
+// is unwatched. Elsewhere the modification times are compared, at most a few times a second.
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    void watch(const std::string& path);
+    void unwatch(const std::string& path);
+
+    // Appends every watched file that changed since the last call, each of them once.
+    void poll(std::vector<std::string>& changed_files);
+
+private:
+    std::unordered_map<std::string, std::string> m_files; // Normalized path to the path the file was watched with
+#if defined(__linux__)
+    int                                  m_inotify_fd = -1;
+    std::unordered_map<int, std::string>      m_directories;  // Watch descriptor to directory
+    std::unordered_map<std::string, int>      m_watches;      // Directory to watch descriptor
+    std::unordered_map<std::string, uint32_t> m_watch_counts; // Directory to the number of watched files in it
+#else
+    std::unordered_map<std::string, std::filesystem::file_time_type> m_write_times;
+    std::chrono::steady_clock::time_point                            m_last_poll;
+#endif
+};
+} // namespace helios
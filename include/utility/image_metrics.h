@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace helios
+{
+namespace image_metrics
+{
+// Every image is a tightly packed RGBA32F buffer of linear radiance, alpha is ignored.
+
+// Root mean squared error over all color channels.
+extern double rmse(const float* test, const float* reference, uint32_t width, uint32_t height);
+
+// Mean squared error relative to the squared reference value, which keeps bright regions from dominating the result.
+extern double rel_mse(const float* test, const float* reference, uint32_t width, uint32_t height, float epsilon = 0.01f);
+
+// Mean perceptual error in [0, 1] following the color pipeline of FLIP (Andersson et al. 2020): both images are tone mapped, filtered
+// by the contrast sensitivity of the eye in an opponent color space and compared with the HyAB distance. The edge and point feature
+// terms of FLIP are not included.
+extern double flip(const float* test, const float* reference, uint32_t width, uint32_t height, float exposure = 1.0f, float pixels_per_degree = 67.0f);
+} // namespace image_metrics
+} // namespace helios
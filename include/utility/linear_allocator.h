@@ -0,0 +1,224 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+namespace helios
+{
+// Bump allocator for temporaries that live until the next reset(), e.g. everything built while the scene is updated. Memory is
+// handed out from blocks that are kept across resets, so once the largest frame has been seen it does not touch the heap again.
+// Nothing is freed individually and destructors are not run, which is left to the containers built on top of it.
+class LinearAllocator
+{
+public:
+    struct Marker
+    {
+        size_t block;
+        size_t offset;
+    };
+
+public:
+    LinearAllocator(size_t block_size = 1024 * 1024);
+    ~LinearAllocator();
+
+    LinearAllocator(const LinearAllocator&) = delete;
+    LinearAllocator& operator=(const LinearAllocator&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    inline T* allocate_array(size_t count) { return (T*)allocate(sizeof(T) * count, alignof(T)); }
+
+    // Releases everything allocated after the marker was taken.
+    inline Marker marker() { return { m_current_block, m_offset }; }
+    void          rewind(const Marker& marker);
+    inline void   reset() { rewind({ 0, 0 }); }
+
+    size_t capacity();
+
+private:
+    struct Block
+    {
+        uint8_t* data;
+        size_t   size;
+    };
+
+    std::vector<Block> m_blocks;
+    size_t             m_block_size;
+    size_t             m_current_block = 0;
+    size_t             m_offset        = 0;
+};
+
+// Lets standard containers draw from a LinearAllocator. deallocate() is a no-op, so containers should reserve what they need up
+// front instead of growing.
+template <typename T>
+class LinearStlAllocator
+{
+public:
+    using value_type = T;
+
+    template <typename U>
+    friend class LinearStlAllocator;
+
+public:
+    LinearStlAllocator(LinearAllocator& allocator) :
+        m_allocator(&allocator) {}
+
+    template <typename U>
+    LinearStlAllocator(const LinearStlAllocator<U>& other) :
+        m_allocator(other.m_allocator) {}
+
+    inline T*   allocate(size_t count) { return m_allocator->allocate_array<T>(count); }
+    inline void deallocate(T*, size_t) {}
+
+    template <typename U>
+    inline bool operator==(const LinearStlAllocator<U>& other) const { return m_allocator == other.m_allocator; }
+
+    template <typename U>
+    inline bool operator!=(const LinearStlAllocator<U>& other) const { return m_allocator != other.m_allocator; }
+
+private:
+    LinearAllocator* m_allocator;
+};
+
+template <typename T>
+using LinearVector = std::vector<T, LinearStlAllocator<T>>;
+
+// Open addressing hash map for integer keys that is rebuilt over and over, e.g. on every hierarchy update. reset() only bumps a
+// generation counter, so clearing it is O(1) and the slots are reused without returning to the heap. Lookups return pointers that
+// stay valid until the next insertion.
+template <typename K, typename V>
+class ScratchHashMap
+{
+public:
+    ScratchHashMap(size_t initial_capacity = 64)
+    {
+        size_t capacity = 16;
+
+        while (capacity < initial_capacity)
+            capacity *= 2;
+
+        m_slots.resize(capacity);
+    }
+
+    inline void reset()
+    {
+        m_size = 0;
+        m_generation++;
+
+        // Slots written 2^32 resets ago would look live again
+        if (m_generation == 0)
+        {
+            for (auto& slot : m_slots)
+                slot.generation = 0;
+
+            m_generation = 1;
+        }
+    }
+
+    inline V* find(const K& key)
+    {
+        Slot& slot = m_slots[probe(key)];
+        return slot.generation == m_generation ? &slot.value : nullptr;
+    }
+
+    inline bool contains(const K& key) { return find(key) != nullptr; }
+
+    // Returns false and leaves the value untouched if the key is already present.
+    inline bool insert(const K& key, const V& value)
+    {
+        if (find(key))
+            return false;
+
+        (*this)[key] = value;
+        return true;
+    }
+
+    // Inserts a value initialized entry if the key is missing, like std::unordered_map.
+    V& operator[](const K& key)
+    {
+        size_t idx = probe(key);
+
+        if (m_slots[idx].generation != m_generation)
+        {
+            // Keep the load factor at or below one half so that probe sequences stay short
+            if ((m_size + 1) * 2 > m_slots.size())
+            {
+                grow();
+                idx = probe(key);
+            }
+
+            m_slots[idx].key        = key;
+            m_slots[idx].value      = V();
+            m_slots[idx].generation = m_generation;
+            m_size++;
+        }
+
+        return m_slots[idx].value;
+    }
+
+    inline size_t size() { return m_size; }
+
+private:
+    struct Slot
+    {
+        K        key        = K();
+        V        value      = V();
+        uint32_t generation = 0;
+    };
+
+    static inline size_t hash(const K& key)
+    {
+        const uint64_t h = uint64_t(key) * 0x9E3779B97F4A7C15ull;
+        return size_t(h ^ (h >> 32));
+    }
+
+    // Index of the slot holding the key, or of the empty slot where it would be inserted.
+    inline size_t probe(const K& key)
+    {
+        const size_t mask = m_slots.size() - 1;
+
+        size_t idx = hash(key) & mask;
+
+        while (m_slots[idx].generation == m_generation && m_slots[idx].key != key)
+            idx = (idx + 1) & mask;
+
+        return idx;
+    }
+
+    void grow()
+    {
+        std::vector<Slot> slots(m_slots.size() * 2);
+        std::swap(slots, m_slots);
+
+        for (auto& slot : slots)
+        {
+            if (slot.generation == m_generation)
+                m_slots[probe(slot.key)] = slot;
+        }
+    }
+
+private:
+    std::vector<Slot> m_slots;
+    size_t            m_size       = 0;
+    uint32_t          m_generation = 1;
+};
+
+template <typename K>
+class ScratchHashSet
+{
+public:
+    ScratchHashSet(size_t initial_capacity = 64) :
+        m_map(initial_capacity) {}
+
+    // Returns false if the key was already present.
+    inline bool   insert(const K& key) { return m_map.insert(key, true); }
+    inline bool   contains(const K& key) { return m_map.contains(key); }
+    inline void   reset() { m_map.reset(); }
+    inline size_t size() { return m_map.size(); }
+
+private:
+    ScratchHashMap<K, bool> m_map;
+};
+} // namespace helios
@@ -2,11 +2,17 @@
 
 #include <string>
 
+// Messages below this level are compiled out. 0 = INFO, 1 = WARNING, 2 = ERROR, 3 = FATAL.
+#ifndef HELIOS_LOG_MIN_LEVEL
+#    define HELIOS_LOG_MIN_LEVEL 0
+#endif
+
 // Macros for quick access. File and line are added through the respective macros.
-#define HELIOS_LOG_INFO(x) helios::logger::log(x, std::string(__FILE__), __LINE__, helios::logger::LEVEL_INFO)
-#define HELIOS_LOG_WARNING(x) helios::logger::log(x, std::string(__FILE__), __LINE__, helios::logger::LEVEL_WARNING)
-#define HELIOS_LOG_ERROR(x) helios::logger::log(x, std::string(__FILE__), __LINE__, helios::logger::LEVEL_ERR)
-#define HELIOS_LOG_FATAL(x) helios::logger::log(x, std::string(__FILE__), __LINE__, helios::logger::LEVEL_FATAL)
+#define HELIOS_LOG(x, level) (((level) >= HELIOS_LOG_MIN_LEVEL) ? helios::logger::log(x, __FILE__, __LINE__, level) : (void)0)
+#define HELIOS_LOG_INFO(x) HELIOS_LOG(x, helios::logger::LEVEL_INFO)
+#define HELIOS_LOG_WARNING(x) HELIOS_LOG(x, helios::logger::LEVEL_WARNING)
+#define HELIOS_LOG_ERROR(x) HELIOS_LOG(x, helios::logger::LEVEL_ERR)
+#define HELIOS_LOG_FATAL(x) HELIOS_LOG(x, helios::logger::LEVEL_FATAL)
 
 namespace helios
 {
@@ -30,10 +36,15 @@ enum LogVerbosity
     VERBOSITY_ALL       = 0x0f
 };
 
-// Custom stream callback type. Use to implement your own logging stream such as through a network etc.
+// Custom stream callback type. Use to implement your own logging stream such as through a network etc. It is invoked from the
+// logger thread.
 typedef void (*CustomStreamCallback)(std::string, LogLevel);
 
+// Starts the logger thread. Messages are queued by the calling thread and formatted and written to the open streams in the background.
 extern void initialize();
+
+// Writes out everything that is still queued and stops the logger thread. Anything logged afterwards is written synchronously.
+extern void shutdown();
 extern void set_verbosity(int flags);
 
 // Open streams.
@@ -46,12 +57,14 @@ extern void close_file_stream();
 extern void close_console_stream();
 extern void close_custom_stream();
 
-// Debug mode. These will flush the stream immediately after each log.
+// Debug mode. Every log call blocks until its message has been written and the streams are flushed.
 extern void enable_debug_mode();
 extern void disable_debug_mode();
 
-// Main log method. File, line and level are required in addition to log message.
-extern void log(std::string text, std::string file, int line, LogLevel level);
+// Main log method. File, line and level are required in addition to log message. The file has to be a string literal, which __FILE__
+// is, since only the pointer is queued. Errors wake the logger thread immediately and fatal errors block until they are written.
+extern void log(const std::string& text, const char* file, int line, LogLevel level);
+extern void log(const char* text, const char* file, int line, LogLevel level);
 
 // Simplified API.
 extern void log_info(std::string text);
@@ -59,7 +72,7 @@ extern void log_error(std::string text);
 extern void log_warning(std::string text);
 extern void log_fatal(std::string text);
 
-// Explicitly flush all streams.
+// Blocks until every message queued so far has been written, then flushes all streams.
 extern void flush();
 } // namespace logger
 } // namespace helios
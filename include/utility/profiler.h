@@ -2,28 +2,83 @@
 
 #include <memory>
 #include <string>
+#include <atomic>
 #include <gfx/vk.h>
 
-#define HELIOS_SCOPED_SAMPLE(name) helios::profiler::ScopedProfile __FILE__##__LINE__(name)
+#define HELIOS_PROFILER_CONCAT_IMPL(a, b) a##b
+#define HELIOS_PROFILER_CONCAT(a, b) HELIOS_PROFILER_CONCAT_IMPL(a, b)
+
+// The name must outlive the profiler, so pass a string literal or a name returned by profiler::intern().
+#define HELIOS_SCOPED_SAMPLE(name) helios::profiler::ScopedProfile HELIOS_PROFILER_CONCAT(scoped_profile_, __LINE__)(name)
 
 namespace helios
 {
 namespace profiler
 {
+enum CaptureMode
+{
+    // Nothing is recorded, a scoped sample only costs a relaxed atomic load.
+    CAPTURE_OFF,
+    // Per-frame CPU and GPU timings are collected for ui(), nothing is kept after the frame has been displayed.
+    CAPTURE_LIVE,
+    // Like CAPTURE_LIVE, but the most recent events of every thread are also kept in fixed-size ring buffers for export.
+    CAPTURE_RING,
+    // Like CAPTURE_LIVE, but every event is kept until the capture is stopped.
+    CAPTURE_FULL
+};
+
+extern std::atomic<bool> g_sampling_enabled;
+
+inline bool is_sampling_enabled() { return g_sampling_enabled.load(std::memory_order_relaxed); }
+
+extern void begin_sample(const char* name);
+extern void end_sample(const char* name);
+
 struct ScopedProfile
 {
-    ScopedProfile(std::string name);
-    ~ScopedProfile();
+    inline ScopedProfile(const char* name) :
+        m_name(name), m_active(is_sampling_enabled())
+    {
+        if (m_active)
+            begin_sample(m_name);
+    }
 
-    std::string m_name;
+    inline ~ScopedProfile()
+    {
+        if (m_active)
+            end_sample(m_name);
+    }
+
+    const char* m_name;
+    bool        m_active;
 };
 
 extern void initialize(vk::Backend::Ptr backend);
 extern void shutdown();
-extern void begin_sample(std::string name);
-extern void end_sample(std::string name);
 extern void begin_frame(vk::CommandBuffer::Ptr cmd_buf);
 extern void end_frame();
 extern void ui();
-}; // namespace profiler
-} // namespace helios
\ No newline at end of file
+
+// Takes effect at the start of the next frame so that samples never straddle a mode change.
+extern void        set_capture_mode(CaptureMode mode);
+extern CaptureMode capture_mode();
+
+// Writes every captured CPU and GPU event in the Chrome trace event format, which can be opened in chrome://tracing or Perfetto.
+extern bool export_trace(const std::string& path);
+
+// Latest CPU and GPU times (in milliseconds) of a sample taken on the main thread during a frame. Results become available a few
+// frames after the sample was taken, once the GPU has finished the frame. Returns false if no such sample has been resolved yet.
+extern bool sample_time(const std::string& name, float& cpu_time, float& gpu_time);
+
+// Sets the current value of a named counter, e.g. a throughput that is measured once per frame. The latest value of every counter is
+// shown by ui() and captured values are exported as counter tracks. Call from the main thread, the name follows the same rules as
+// HELIOS_SCOPED_SAMPLE.
+extern void set_counter(const char* name, double value);
+
+// Returns a pointer to a copy of the name that stays valid until shutdown, for sample names that are built at runtime.
+extern const char* intern(const std::string& name);
+
+// Names the track of the calling thread in exported traces.
+extern void set_thread_name(const char* name);
+} // namespace profiler
+} // namespace helios
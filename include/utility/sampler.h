@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <glm.hpp>
+
+// CPU mirror of the sampler in src/engine/shader/random.glsl. Sobol samples are integer math and must match the shader bit for bit,
+// blue noise samples add a float offset whose rounding may differ by an ulp. helios_regress checks both against the GPU on startup.
+
+namespace helios
+{
+enum SamplerType
+{
+    SAMPLER_SOBOL,
+    SAMPLER_BLUE_NOISE
+};
+
+namespace sampler
+{
+// Sample dimensions used by the camera ray.
+const uint32_t kDimCameraJitter = 0;
+const uint32_t kDimAperture     = 2;
+const uint32_t kDimBounceStart  = 4;
+
+// Sample dimensions used at each bounce, relative to the start of that bounce.
+const uint32_t kDimLightSelection  = 0;
+const uint32_t kDimLightPrimitive  = 1;
+const uint32_t kDimLightPosition   = 2;
+const uint32_t kDimBsdfLobe        = 4;
+const uint32_t kDimBsdfDirection   = 5;
+const uint32_t kDimRussianRoulette = 7;
+const uint32_t kDimsPerBounce      = 8;
+
+struct State
+{
+    uint32_t    pixel;
+    uint32_t    pixel_seed;
+    uint32_t    sample_idx;
+    SamplerType type;
+};
+
+extern uint32_t  hash(uint32_t seed);
+extern uint32_t  hash_combine(uint32_t seed, uint32_t v);
+extern uint32_t  nested_uniform_scramble(uint32_t x, uint32_t seed);
+extern glm::vec2 sobol_owen_2d(uint32_t index, uint32_t seed);
+extern State     init(const glm::uvec2& pixel, uint32_t sample_idx, SamplerType type);
+extern uint32_t  bounce_dimension(uint32_t depth, uint32_t offset);
+extern glm::vec2 sample_2d(const State& state, uint32_t dimension);
+extern float     sample_1d(const State& state, uint32_t dimension);
+} // namespace sampler
+} // namespace helios
@@ -5,6 +5,7 @@
 #include <sstream>
 #include <cassert>
 #include <algorithm>
+#include <functional>
 #include <stdio.h>
 
 namespace helios
@@ -31,5 +32,12 @@ extern std::string current_working_directory();
 
 // Changes the current working directory.
 extern void change_current_working_directory(std::string path);
+
+// Writes a quoted JSON string, escaping quotes, backslashes and control characters.
+extern void write_json_string(FILE* f, const char* str);
+
+// Calls 'write' with a temporary path next to 'path' and moves the file into place once it succeeded, so that an interrupted write
+// never leaves a truncated file behind. Returns false if either step failed.
+extern bool write_file_atomic(const std::string& path, const std::function<bool(const std::string& temp_path)>& write);
 } // namespace utility
 } // namespace helios
@@ -0,0 +1,577 @@
+#include <core/application.h>
+#include <utility/profiler.h>
+#include <utility/logger.h>
+#include <utility/utility.h>
+#include <vk_mem_alloc.h>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <filesystem>
+#include <unordered_set>
+#include <stdio.h>
+#include <time.h>
+#if defined(_WIN32)
+#    include <Windows.h>
+#    include <psapi.h>
+#else
+#    include <sys/resource.h>
+#endif
+
+// Runs a set of scenes through a fixed sequence of phases and writes the timings as JSON, so that results can be compared between
+// builds to catch performance regressions.
+//
+// usage: helios_bench [options] <scene.json...>
+//
+// --runs <count>              : number of times every scene is run (default 5)
+// --spp <count>               : samples per pixel accumulated in every run (default 64)
+// --resolution <width> <height> : render resolution (default 1920 1080)
+// --bounces <count>           : maximum number of ray bounces
+// --output <path>             : results file (default bench.json)
+// --backend <gpu|cpu>         : only the GPU backend is implemented at the moment
+// --ray-stats                 : compile the ray counters into the shaders and report the throughput of every ray type
+//
+// Every run loads the scene with an empty ResourceManager (cold), renders until the requested sample count is reached and then loads
+// it again from the warm cache. Each metric is reported as the median, p95 and p99 over all runs of a scene.
+
+#define BENCH_SCHEMA_VERSION 1
+
+namespace helios
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+enum BenchMetric
+{
+    METRIC_LOAD_COLD,
+    METRIC_LOAD_WARM,
+    METRIC_BLAS_BUILD,
+    METRIC_TLAS_BUILD,
+    METRIC_TIME_TO_FIRST_FRAME,
+    METRIC_TIME_TO_SPP,
+    METRIC_PRIMARY_MRAYS,
+    METRIC_SHADOW_MRAYS,
+    METRIC_INDIRECT_MRAYS,
+    METRIC_TOTAL_MRAYS,
+    METRIC_COUNT
+};
+
+static const char* kMetricNames[] = {
+    "load_cold_ms",
+    "load_warm_ms",
+    "blas_build_ms",
+    "tlas_build_gpu_ms",
+    "time_to_first_frame_ms",
+    "time_to_spp_ms",
+    "primary_mrays_per_sec",
+    "shadow_mrays_per_sec",
+    "indirect_mrays_per_sec",
+    "total_mrays_per_sec"
+};
+
+enum BenchPhase
+{
+    PHASE_LOAD,
+    PHASE_FIRST_FRAME,
+    PHASE_ACCUMULATE,
+    PHASE_DRAIN,
+    PHASE_DONE
+};
+
+struct BenchConfig
+{
+    std::vector<std::string> scenes;
+    uint32_t                 runs        = 5;
+    uint32_t                 spp         = 64;
+    uint32_t                 width       = 1920;
+    uint32_t                 height      = 1080;
+    int32_t                  bounces     = -1;
+    std::string              output_path = "bench.json";
+    std::string              backend     = "gpu";
+    bool                     ray_stats   = false;
+};
+
+struct SceneResults
+{
+    std::string         path;
+    std::vector<double> metrics[METRIC_COUNT];
+    uint64_t            peak_device_memory = 0;
+    uint64_t            peak_host_memory   = 0;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Nearest-rank percentile of a sorted sample set.
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.size() == 0)
+        return 0.0;
+
+    size_t rank = (size_t)std::ceil(p * double(sorted.size()));
+
+    return sorted[std::min(std::max(rank, size_t(1)), sorted.size()) - 1];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint64_t peak_host_memory()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+
+    return 0;
+#else
+    rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+#    if defined(__APPLE__)
+    return uint64_t(usage.ru_maxrss);
+#    else
+    return uint64_t(usage.ru_maxrss) * 1024;
+#    endif
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+class Bench : public Application
+{
+public:
+    Bench(const BenchConfig& config) :
+        m_config(config)
+    {
+    }
+
+protected:
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool init(int argc, const char* argv[]) override
+    {
+        if (m_config.backend != "gpu")
+        {
+            HELIOS_LOG_ERROR("Backend '" + m_config.backend + "' is not available, only the GPU backend is implemented.");
+            return false;
+        }
+
+        if (m_config.scenes.size() == 0)
+        {
+            if (std::filesystem::exists("assets/scene/default.json"))
+                m_config.scenes.push_back("scene/default.json");
+            else
+            {
+                HELIOS_LOG_ERROR("No scenes to benchmark.");
+                return false;
+            }
+        }
+
+        if (m_config.bounces > 0)
+            m_renderer->path_integrator()->set_max_ray_bounces(m_config.bounces);
+
+        m_renderer->path_integrator()->set_max_samples(m_config.spp);
+        m_renderer->path_integrator()->set_ray_statistics_enabled(m_config.ray_stats);
+
+        m_results.resize(m_config.scenes.size());
+
+        for (uint32_t i = 0; i < m_config.scenes.size(); i++)
+            m_results[i].path = m_config.scenes[i];
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Loading and anything that waits on the GPU happens here rather than in update(), since this is called before the command buffer
+    // of the frame starts recording.
+    void gui() override
+    {
+        sample_memory();
+
+        switch (m_phase)
+        {
+            case PHASE_LOAD:
+            {
+                if (!load_cold())
+                {
+                    m_phase = PHASE_DONE;
+                    request_exit();
+                }
+                else
+                    m_phase = PHASE_FIRST_FRAME;
+
+                break;
+            }
+            case PHASE_FIRST_FRAME:
+            {
+                // The first frame was submitted at the end of the previous update.
+                m_vk_backend->wait_idle();
+
+                current_results().metrics[METRIC_TIME_TO_FIRST_FRAME].push_back(elapsed_ms(m_load_start));
+
+                m_phase = PHASE_ACCUMULATE;
+                break;
+            }
+            case PHASE_ACCUMULATE:
+            {
+                if (m_renderer->path_integrator()->is_complete())
+                {
+                    m_vk_backend->wait_idle();
+
+                    const double time_to_spp = elapsed_ms(m_render_start);
+                    const double rays        = double(m_width) * double(m_height) * double(m_config.spp);
+
+                    current_results().metrics[METRIC_TIME_TO_SPP].push_back(time_to_spp);
+                    current_results().metrics[METRIC_PRIMARY_MRAYS].push_back(rays / (time_to_spp * 1000.0));
+
+                    if (m_config.ray_stats)
+                    {
+                        // Counted in the shaders and divided by the GPU time of the launches alone.
+                        m_renderer->path_integrator()->flush_ray_statistics();
+
+                        const RayStatistics& statistics = m_renderer->path_integrator()->bake_ray_statistics();
+
+                        current_results().metrics[METRIC_SHADOW_MRAYS].push_back(statistics.mrays_per_second(RAY_COUNTER_SHADOW));
+                        current_results().metrics[METRIC_INDIRECT_MRAYS].push_back(statistics.mrays_per_second(RAY_COUNTER_INDIRECT));
+                        current_results().metrics[METRIC_TOTAL_MRAYS].push_back(statistics.mrays_per_second(statistics.total_rays()));
+                    }
+
+                    load_warm();
+                    build_blas();
+
+                    // Wait until the frame that built the TLAS has been resolved by the profiler.
+                    m_drain_frames = vk::Backend::kMaxFramesInFlight + 1;
+                    m_phase        = PHASE_DRAIN;
+                }
+
+                break;
+            }
+            case PHASE_DRAIN:
+            {
+                if (--m_drain_frames == 0)
+                {
+                    float cpu_time = 0.0f;
+                    float gpu_time = 0.0f;
+
+                    if (profiler::sample_time("TLAS Build", cpu_time, gpu_time))
+                        current_results().metrics[METRIC_TLAS_BUILD].push_back(gpu_time);
+
+                    next_run();
+                }
+
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void update(vk::CommandBuffer::Ptr cmd_buffer) override
+    {
+        m_render_state.setup(m_width, m_height, cmd_buffer);
+
+        if (m_scene)
+        {
+            m_scene->update(m_render_state);
+            m_resource_manager->update_residency(m_render_state);
+        }
+
+        m_renderer->render(m_render_state);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void shutdown() override
+    {
+        m_scene.reset();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    Settings intial_settings() override
+    {
+        Settings settings;
+
+        settings.resizable = false;
+        settings.width     = m_config.width;
+        settings.height    = m_config.height;
+        settings.title     = "Helios Bench";
+
+        return settings;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+private:
+    inline SceneResults& current_results() { return m_results[m_scene_idx]; }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool load_cold()
+    {
+        const std::string& path = m_config.scenes[m_scene_idx];
+
+        // Start from an empty resource cache so that every mesh and texture is read from disk again.
+        m_vk_backend->wait_idle();
+        m_scene.reset();
+        m_resource_manager.reset(new ResourceManager(m_vk_backend, m_renderer->shader_cache()));
+
+        HELIOS_LOG_INFO("Benchmarking " + path + " (run " + std::to_string(m_run_idx + 1) + " of " + std::to_string(m_config.runs) + ")");
+
+        m_load_start = std::chrono::steady_clock::now();
+        m_scene      = m_resource_manager->load_scene(path);
+
+        if (!m_scene)
+        {
+            HELIOS_LOG_ERROR("Failed to load scene: " + path);
+            return false;
+        }
+
+        current_results().metrics[METRIC_LOAD_COLD].push_back(elapsed_ms(m_load_start));
+
+        m_renderer->path_integrator()->restart_bake();
+
+        m_render_start = std::chrono::steady_clock::now();
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void load_warm()
+    {
+        auto       start = std::chrono::steady_clock::now();
+        Scene::Ptr scene = m_resource_manager->load_scene(m_config.scenes[m_scene_idx]);
+
+        current_results().metrics[METRIC_LOAD_WARM].push_back(elapsed_ms(start));
+
+        // Never rendered, so it can be released straight away.
+        scene.reset();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Rebuilds the BLAS of every unique mesh in the scene in a single batch. Only the submission is timed, acceleration structure
+    // allocation is not part of the measurement.
+    void build_blas()
+    {
+        std::unordered_set<Mesh*> visited;
+        std::vector<Mesh::Ptr>    meshes;
+        vk::BatchUploader         uploader(m_vk_backend);
+
+        for (auto& mesh_node : m_render_state.meshes())
+        {
+            Mesh::Ptr mesh = mesh_node->mesh();
+
+            if (!mesh || visited.find(mesh.get()) != visited.end())
+                continue;
+
+            visited.insert(mesh.get());
+            meshes.push_back(Mesh::create(m_vk_backend, mesh->vertex_buffer(), mesh->index_buffer(), mesh->sub_meshes(), mesh->materials(), uploader, mesh->path()));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        uploader.submit();
+
+        current_results().metrics[METRIC_BLAS_BUILD].push_back(elapsed_ms(start));
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void next_run()
+    {
+        m_run_idx++;
+
+        if (m_run_idx == m_config.runs)
+        {
+            m_run_idx = 0;
+            m_scene_idx++;
+        }
+
+        if (m_scene_idx == m_config.scenes.size())
+        {
+            write_results();
+
+            m_phase = PHASE_DONE;
+            request_exit();
+        }
+        else
+            m_phase = PHASE_LOAD;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void sample_memory()
+    {
+        if (m_scene_idx >= m_results.size())
+            return;
+
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+        vmaGetBudget(m_vk_backend->allocator(), budgets);
+
+        const VkPhysicalDeviceMemoryProperties* memory_properties = nullptr;
+        vmaGetMemoryProperties(m_vk_backend->allocator(), &memory_properties);
+
+        uint64_t device_memory = 0;
+
+        for (uint32_t i = 0; i < memory_properties->memoryHeapCount; i++)
+        {
+            if (memory_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+                device_memory += budgets[i].blockBytes;
+        }
+
+        SceneResults& results = current_results();
+
+        results.peak_device_memory = std::max(results.peak_device_memory, device_memory);
+        results.peak_host_memory   = std::max(results.peak_host_memory, peak_host_memory());
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void write_results()
+    {
+        FILE* f = fopen(m_config.output_path.c_str(), "w");
+
+        if (!f)
+        {
+            HELIOS_LOG_ERROR("Failed to open benchmark results for writing: " + m_config.output_path);
+            return;
+        }
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(m_vk_backend->physical_device(), &properties);
+
+        time_t now = time(nullptr);
+        char   date[64];
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+        fprintf(f, "{\n");
+        fprintf(f, "    \"schema_version\": %d,\n", BENCH_SCHEMA_VERSION);
+        fprintf(f, "    \"date\": \"%s\",\n", date);
+        fprintf(f, "    \"backend\": ");
+        utility::write_json_string(f, m_config.backend.c_str());
+        fprintf(f, ",\n");
+        fprintf(f, "    \"device\": { \"name\": ");
+        utility::write_json_string(f, properties.deviceName);
+        fprintf(f, ", \"vendor_id\": %u, \"device_id\": %u, \"driver_version\": %u },\n", properties.vendorID, properties.deviceID, properties.driverVersion);
+        fprintf(f, "    \"config\": { \"width\": %u, \"height\": %u, \"spp\": %u, \"runs\": %u, \"max_ray_bounces\": %u, \"ray_statistics\": %s },\n", m_width, m_height, m_config.spp, m_config.runs, m_renderer->path_integrator()->max_ray_bounces(), m_config.ray_stats ? "true" : "false");
+        fprintf(f, "    \"scenes\": [\n");
+
+        for (uint32_t i = 0; i < m_results.size(); i++)
+        {
+            SceneResults& results = m_results[i];
+
+            fprintf(f, "        {\n");
+            fprintf(f, "            \"path\": ");
+            utility::write_json_string(f, results.path.c_str());
+            fprintf(f, ",\n");
+            fprintf(f, "            \"peak_host_memory_bytes\": %llu,\n", (unsigned long long)results.peak_host_memory);
+            fprintf(f, "            \"peak_device_memory_bytes\": %llu,\n", (unsigned long long)results.peak_device_memory);
+            fprintf(f, "            \"metrics\": {");
+
+            bool first = true;
+
+            for (uint32_t metric = 0; metric < METRIC_COUNT; metric++)
+            {
+                // Optional metrics that were not collected are left out.
+                if (results.metrics[metric].size() == 0)
+                    continue;
+
+                std::vector<double> sorted = results.metrics[metric];
+                std::sort(sorted.begin(), sorted.end());
+
+                fprintf(f, "%s\n", first ? "" : ",");
+                fprintf(f, "                \"%s\": { \"median\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"samples\": [", kMetricNames[metric], percentile(sorted, 0.5), percentile(sorted, 0.95), percentile(sorted, 0.99));
+
+                for (uint32_t j = 0; j < results.metrics[metric].size(); j++)
+                    fprintf(f, "%s%.4f", j == 0 ? "" : ", ", results.metrics[metric][j]);
+
+                fprintf(f, "] }");
+
+                first = false;
+            }
+
+            fprintf(f, "\n            }\n");
+            fprintf(f, "        }%s\n", i == m_results.size() - 1 ? "" : ",");
+        }
+
+        fprintf(f, "    ]\n");
+        fprintf(f, "}\n");
+
+        fclose(f);
+
+        HELIOS_LOG_INFO("Wrote benchmark results: " + m_config.output_path);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+private:
+    BenchConfig                           m_config;
+    BenchPhase                            m_phase        = PHASE_LOAD;
+    uint32_t                              m_scene_idx    = 0;
+    uint32_t                              m_run_idx      = 0;
+    uint32_t                              m_drain_frames = 0;
+    std::vector<SceneResults>             m_results;
+    std::chrono::steady_clock::time_point m_load_start;
+    std::chrono::steady_clock::time_point m_render_start;
+    RenderState                           m_render_state;
+    Scene::Ptr                            m_scene;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace helios
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, const char* argv[])
+{
+    helios::BenchConfig config;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--runs" && i + 1 < argc)
+            config.runs = std::max(std::stoi(argv[++i]), 1);
+        else if (arg == "--spp" && i + 1 < argc)
+            config.spp = std::max(std::stoi(argv[++i]), 1);
+        else if (arg == "--resolution" && i + 2 < argc)
+        {
+            config.width  = std::stoi(argv[i + 1]);
+            config.height = std::stoi(argv[i + 2]);
+            i += 2;
+        }
+        else if (arg == "--bounces" && i + 1 < argc)
+            config.bounces = std::stoi(argv[++i]);
+        else if (arg == "--output" && i + 1 < argc)
+            config.output_path = argv[++i];
+        else if (arg == "--backend" && i + 1 < argc)
+            config.backend = argv[++i];
+        else if (arg == "--ray-stats")
+            config.ray_stats = true;
+        else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0)
+        {
+            printf("usage: helios_bench [--runs <count>] [--spp <count>] [--resolution <width> <height>] [--bounces <count>] [--output <path>] [--backend <gpu|cpu>] [--ray-stats] <scene.json...>\n");
+            return 1;
+        }
+        else
+            config.scenes.push_back(arg);
+    }
+
+    helios::Bench app(config);
+
+    return app.run(argc, argv);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
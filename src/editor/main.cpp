@@ -37,7 +37,8 @@ static const std::vector<std::string> node_types = {
     "Directional Light",
     "Spot Light",
     "Point Light",
-    "IBL"
+    "IBL",
+    "Probe Volume"
 };
 
 static const std::vector<std::string> tone_map_operators = {
@@ -45,6 +46,16 @@ static const std::vector<std::string> tone_map_operators = {
     "Reinhard"
 };
 
+static const std::vector<std::string> sampler_types = {
+    "Sobol",
+    "Blue Noise"
+};
+
+static const std::vector<std::string> integrator_modes = {
+    "Path Trace",
+    "Direct Lighting"
+};
+
 static const std::vector<std::string> output_buffers = {
     "Albedo",
     "Normals",
@@ -79,10 +90,12 @@ protected:
 
                 m_vk_backend->queue_object_deletion(m_scene);
 
-                m_scene = m_resource_manager->load_scene(path);
+                m_scene_load = m_resource_manager->load_scene_async(path);
 
-                if (!m_scene)
+                if (!m_scene_load)
                     return false;
+
+                m_scene = m_scene_load->scene();
             }
             else
                 return false;
@@ -104,8 +117,17 @@ protected:
 
         m_editor_camera->update(m_render_state);
 
+        m_resource_manager->reload_changed_resources();
+        m_resource_manager->update_scene_loads();
+
+        if (m_scene_load && m_scene_load->is_complete())
+            m_scene_load = nullptr;
+
         if (m_scene)
+        {
             m_scene->update(m_render_state);
+            m_resource_manager->update_residency(m_render_state);
+        }
 
         m_renderer->render(m_render_state);
     }
@@ -182,15 +204,26 @@ protected:
                     m_vk_backend->queue_object_deletion(m_scene);
                     m_selected_node = nullptr;
 
-                    m_scene = m_resource_manager->load_scene(path);
+                    m_scene_load = m_resource_manager->load_scene_async(path);
+                    m_scene      = m_scene_load ? m_scene_load->scene() : nullptr;
                 }
             }
 
             ImVec2 region = ImGui::GetContentRegionAvail();
 
+            if (m_scene_load)
+            {
+                std::string overlay_text = std::to_string(m_scene_load->num_loaded_meshes()) + " / " + std::to_string(m_scene_load->num_meshes()) + " Meshes";
+
+                ImGui::ProgressBar(m_scene_load->progress(), ImVec2(region.x, 0.0f), overlay_text.c_str());
+            }
+
             ImGui::Spacing();
 
-            if (!m_scene)
+            // Meshes that are still loading would be missing from the saved scene
+            const bool can_save = m_scene && !m_scene_load;
+
+            if (!can_save)
                 ImGui::PushDisabled();
 
             if (ImGui::Button("Save", ImVec2(region.x, 30.0f)))
@@ -209,7 +242,7 @@ protected:
                 }
             }
 
-            if (!m_scene)
+            if (!can_save)
                 ImGui::PopDisabled();
 
             ImGui::Spacing();
@@ -277,6 +310,8 @@ protected:
                         inspector_point_light();
                     else if (m_selected_node->type() == NODE_IBL)
                         inspector_ibl();
+                    else if (m_selected_node->type() == NODE_PROBE_VOLUME)
+                        inspector_probe_volume();
                     else if (m_selected_node->type() == NODE_ROOT)
                         inspector_transform(true, true, false);
 
@@ -322,6 +357,38 @@ protected:
                     m_renderer->save_image_to_disk(path + ".png");
                 }
             }
+
+            if (ImGui::Button("Save Checkpoint", ImVec2(region.x, 30.0f)))
+            {
+                nfdchar_t*  out_path = NULL;
+                nfdresult_t result   = NFD_SaveDialog("hckp", NULL, &out_path);
+
+                if (result == NFD_OKAY)
+                {
+                    std::string path;
+                    path.resize(strlen(out_path));
+                    strcpy(path.data(), out_path);
+                    free(out_path);
+
+                    m_renderer->save_checkpoint(path + ".hckp");
+                }
+            }
+
+            if (ImGui::Button("Resume From Checkpoint", ImVec2(region.x, 30.0f)))
+            {
+                nfdchar_t*  out_path = NULL;
+                nfdresult_t result   = NFD_OpenDialog("hckp", NULL, &out_path);
+
+                if (result == NFD_OKAY)
+                {
+                    std::string path;
+                    path.resize(strlen(out_path));
+                    strcpy(path.data(), out_path);
+                    free(out_path);
+
+                    m_renderer->resume_from_checkpoint(path);
+                }
+            }
         }
         if (ImGui::CollapsingHeader("Ray Debug View"))
         {
@@ -354,6 +421,9 @@ protected:
         if (ImGui::CollapsingHeader("Profiler"))
             profiler_gui();
 
+        if (ImGui::CollapsingHeader("Memory"))
+            memory_gui();
+
         if (ImGui::CollapsingHeader("Settings"))
         {
             bool tiled = m_renderer->path_integrator()->is_tiled();
@@ -409,6 +479,50 @@ protected:
                 m_renderer->path_integrator()->restart_bake();
             }
 
+            if (ImGui::BeginCombo("Sampler", sampler_types[m_renderer->path_integrator()->sampler_type()].c_str()))
+            {
+                for (uint32_t i = 0; i < sampler_types.size(); i++)
+                {
+                    const bool is_selected = (i == m_renderer->path_integrator()->sampler_type());
+
+                    if (ImGui::Selectable(sampler_types[i].c_str(), is_selected))
+                    {
+                        m_renderer->path_integrator()->set_sampler_type((SamplerType)i);
+                        m_renderer->path_integrator()->restart_bake();
+                    }
+
+                    if (is_selected)
+                        ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
+            }
+
+            if (ImGui::BeginCombo("Integrator", integrator_modes[m_renderer->path_integrator()->integrator_mode()].c_str()))
+            {
+                for (uint32_t i = 0; i < integrator_modes.size(); i++)
+                {
+                    const bool is_selected = (i == m_renderer->path_integrator()->integrator_mode());
+
+                    if (ImGui::Selectable(integrator_modes[i].c_str(), is_selected))
+                    {
+                        m_renderer->path_integrator()->set_integrator_mode((IntegratorMode)i);
+                        m_renderer->path_integrator()->restart_bake();
+                    }
+
+                    if (is_selected)
+                        ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
+            }
+
+            bool visualize_nans = m_renderer->path_integrator()->visualize_nans();
+
+            if (ImGui::Checkbox("Visualize NaNs", &visualize_nans))
+            {
+                m_renderer->path_integrator()->set_visualize_nans(visualize_nans);
+                m_renderer->path_integrator()->restart_bake();
+            }
+
             if (ImGui::BeginCombo("Tone Map Operator", tone_map_operators[m_renderer->tone_map_operator()].c_str()))
             {
                 for (uint32_t i = 0; i < tone_map_operators.size(); i++)
@@ -430,6 +544,32 @@ protected:
 
             m_renderer->set_exposure(exposure);
 
+            bool light_groups = m_renderer->light_groups_enabled();
+
+            if (ImGui::Checkbox("Light Groups", &light_groups))
+                m_renderer->set_light_groups_enabled(light_groups);
+
+            if (light_groups)
+            {
+                for (uint32_t i = 0; i < MAX_LIGHT_GROUPS; i++)
+                {
+                    ImGui::PushID(i);
+
+                    float     scale = m_renderer->light_group_scale(i);
+                    glm::vec3 tint  = m_renderer->light_group_tint(i);
+
+                    ImGui::Text("Light Group %u", i);
+
+                    if (ImGui::SliderFloat("Scale", &scale, 0.0f, 10.0f))
+                        m_renderer->set_light_group_scale(i, scale);
+
+                    if (ImGui::ColorEdit3("Tint", &tint.x))
+                        m_renderer->set_light_group_tint(i, tint);
+
+                    ImGui::PopID();
+                }
+            }
+
             ImGui::SliderFloat("Camera Speed", &m_camera_speed, 20.0f, 200.0f);
             ImGui::SliderFloat("Look Sensitivity", &m_camera_sensitivity, 0.01f, 0.5f);
 
@@ -612,6 +752,53 @@ private:
 
         profiler::ui();
 
+        if (profiler::capture_mode() == profiler::CAPTURE_RING || profiler::capture_mode() == profiler::CAPTURE_FULL)
+        {
+            ImGui::Spacing();
+
+            if (ImGui::Button("Export Trace"))
+            {
+                nfdchar_t*  out_path = NULL;
+                nfdresult_t result   = NFD_SaveDialog("json", NULL, &out_path);
+
+                if (result == NFD_OKAY)
+                {
+                    std::string path;
+                    path.resize(strlen(out_path));
+                    strcpy(path.data(), out_path);
+                    free(out_path);
+
+                    profiler::export_trace(path + ".json");
+                }
+            }
+        }
+
+        ImGui::Spacing();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void memory_gui()
+    {
+        const float kMegabyte = 1024.0f * 1024.0f;
+
+        MemoryStatistics stats = m_resource_manager->memory_statistics();
+
+        ImGui::Spacing();
+
+        ImGui::Text("Device Usage  : %.1f / %.1f MB", float(stats.device.usage) / kMegabyte, float(stats.budget) / kMegabyte);
+        ImGui::Text("VMA Blocks    : %.1f MB (%.1f MB allocated)", float(stats.device.block_bytes) / kMegabyte, float(stats.device.allocation_bytes) / kMegabyte);
+        ImGui::Text("Textures      : %u (%u evicted), %.1f MB", stats.num_textures, stats.num_evicted_textures, float(stats.texture_bytes) / kMegabyte);
+        ImGui::Text("Meshes        : %u, %.1f MB", stats.num_meshes, float(stats.mesh_bytes) / kMegabyte);
+
+        ImGui::Spacing();
+
+        // Zero follows the budget reported by the driver
+        int32_t budget_mb = int32_t(m_resource_manager->memory_budget() / (1024 * 1024));
+
+        if (ImGui::InputInt("Memory Budget (MB)", &budget_mb, 256, 1024))
+            m_resource_manager->set_memory_budget(VkDeviceSize(std::max(budget_mb, 0)) * 1024 * 1024);
+
         ImGui::Spacing();
     }
 
@@ -745,8 +932,73 @@ private:
 
                 Material::Ptr material = m_resource_manager->load_material(path);
                 mesh_node->set_material_override(material);
+            }
+        }
 
-                m_scene->force_update();
+        if (mesh_node->material_override())
+        {
+            int light_group = mesh_node->material_override()->light_group();
+
+            if (ImGui::SliderInt("Emissive Light Group", &light_group, 0, MAX_LIGHT_GROUPS - 1))
+                mesh_node->material_override()->set_light_group(light_group);
+        }
+
+        if (mesh_node->mesh())
+        {
+            pos = ImGui::GetCursorPos();
+            ImGui::SetCursorPos(ImVec2(pos.x, pos.y + 25.0f));
+
+            glm::ivec2 lightmap_size = glm::ivec2(m_lightmap_bake_settings.width, m_lightmap_bake_settings.height);
+
+            if (ImGui::InputInt2("Lightmap Size", &lightmap_size.x))
+            {
+                m_lightmap_bake_settings.width  = std::max(lightmap_size.x, 1);
+                m_lightmap_bake_settings.height = std::max(lightmap_size.y, 1);
+            }
+
+            int samples_per_launch = m_lightmap_bake_settings.samples_per_launch;
+
+            if (ImGui::InputInt("Samples per Launch", &samples_per_launch))
+                m_lightmap_bake_settings.samples_per_launch = std::max(samples_per_launch, 1);
+
+            int min_samples = m_lightmap_bake_settings.min_samples;
+            int max_samples = m_lightmap_bake_settings.max_samples;
+
+            if (ImGui::InputInt("Min Samples", &min_samples))
+                m_lightmap_bake_settings.min_samples = std::max(min_samples, 0);
+
+            if (ImGui::InputInt("Max Samples", &max_samples))
+                m_lightmap_bake_settings.max_samples = std::max(max_samples, 1);
+
+            int dilation_iterations = m_lightmap_bake_settings.dilation_iterations;
+
+            if (ImGui::InputInt("Dilation", &dilation_iterations))
+                m_lightmap_bake_settings.dilation_iterations = std::max(dilation_iterations, 0);
+
+            ImGui::InputFloat("Convergence Threshold", &m_lightmap_bake_settings.convergence_threshold);
+            ImGui::InputFloat("Normal Offset", &m_lightmap_bake_settings.normal_offset);
+
+            LightmapBake::Ptr lightmap_bake = m_renderer->lightmap_bake();
+
+            if (lightmap_bake)
+                ImGui::Text("Baking: %u/%u texels converged, %u samples", lightmap_bake->num_converged_texels(), lightmap_bake->num_texels(), lightmap_bake->num_samples());
+
+            ImVec2 region = ImGui::GetContentRegionAvail();
+
+            if (ImGui::Button("Bake Lightmap", ImVec2(region.x, 30.0f)))
+            {
+                nfdchar_t*  out_path = NULL;
+                nfdresult_t result   = NFD_SaveDialog("hdr", NULL, &out_path);
+
+                if (result == NFD_OKAY)
+                {
+                    std::string path;
+                    path.resize(strlen(out_path));
+                    strcpy(path.data(), out_path);
+                    free(out_path);
+
+                    m_renderer->bake_lightmap(mesh_node, m_lightmap_bake_settings, path + ".hdr");
+                }
             }
         }
 
@@ -810,6 +1062,33 @@ private:
         if (ImGui::Button("Apply Camera Transform", ImVec2(ImGui::GetContentRegionAvailWidth(), 30.0f)))
             camera_node->set_from_global_transform(m_editor_camera->global_transform());
 
+        ImGui::InputInt("Cubemap Size", &m_cubemap_size);
+        ImGui::InputInt("Cubemap Samples", &m_cubemap_samples);
+
+        ViewSet::Ptr cubemap = m_renderer->cubemap();
+
+        if (cubemap)
+            ImGui::Text("Rendering cubemap: %u/%d samples", cubemap->num_accumulated_samples(), m_cubemap_samples);
+
+        if (ImGui::Button("Render Cubemap", ImVec2(ImGui::GetContentRegionAvailWidth(), 30.0f)))
+        {
+            nfdchar_t*  out_path = NULL;
+            nfdresult_t result   = NFD_SaveDialog("hdr", NULL, &out_path);
+
+            if (result == NFD_OKAY)
+            {
+                std::string path;
+                path.resize(strlen(out_path));
+                strcpy(path.data(), out_path);
+                free(out_path);
+
+                m_cubemap_size    = std::max(m_cubemap_size, 1);
+                m_cubemap_samples = std::max(m_cubemap_samples, 1);
+
+                m_renderer->render_cubemap(camera_node->global_position(), m_cubemap_size, m_cubemap_samples, path);
+            }
+        }
+
         pos = ImGui::GetCursorPos();
         ImGui::SetCursorPos(ImVec2(pos.x, pos.y + 25.0f));
 
@@ -832,30 +1111,26 @@ private:
         ImGui::InputFloat("Intensity", &intensity);
 
         if (intensity != light_node->intensity())
-        {
-            m_scene->force_update();
             light_node->set_intensity(intensity);
-        }
 
         glm::vec3 color = light_node->color();
 
         ImGui::ColorPicker3("Color", &color.x);
 
         if (color != light_node->color())
-        {
-            m_scene->force_update();
             light_node->set_color(color);
-        }
 
         float radius = light_node->radius();
 
         ImGui::InputFloat("Radius", &radius);
 
         if (radius != light_node->radius())
-        {
-            m_scene->force_update();
             light_node->set_radius(radius);
-        }
+
+        int light_group = light_node->light_group();
+
+        if (ImGui::SliderInt("Light Group", &light_group, 0, MAX_LIGHT_GROUPS - 1))
+            light_node->set_light_group(light_group);
 
         pos = ImGui::GetCursorPos();
         ImGui::SetCursorPos(ImVec2(pos.x, pos.y + 25.0f));
@@ -879,30 +1154,26 @@ private:
         ImGui::InputFloat("Intensity", &intensity);
 
         if (intensity != light_node->intensity())
-        {
-            m_scene->force_update();
             light_node->set_intensity(intensity);
-        }
 
         glm::vec3 color = light_node->color();
 
         ImGui::ColorPicker3("Color", &color.x);
 
         if (color != light_node->color())
-        {
-            m_scene->force_update();
             light_node->set_color(color);
-        }
 
         float radius = light_node->radius();
 
         ImGui::InputFloat("Radius", &radius);
 
         if (radius != light_node->radius())
-        {
-            m_scene->force_update();
             light_node->set_radius(radius);
-        }
+
+        int light_group = light_node->light_group();
+
+        if (ImGui::SliderInt("Light Group", &light_group, 0, MAX_LIGHT_GROUPS - 1))
+            light_node->set_light_group(light_group);
 
         pos = ImGui::GetCursorPos();
         ImGui::SetCursorPos(ImVec2(pos.x, pos.y + 25.0f));
@@ -926,30 +1197,26 @@ private:
         ImGui::InputFloat("Intensity", &intensity);
 
         if (intensity != light_node->intensity())
-        {
-            m_scene->force_update();
             light_node->set_intensity(intensity);
-        }
 
         glm::vec3 color = light_node->color();
 
         ImGui::ColorPicker3("Color", &color.x);
 
         if (color != light_node->color())
-        {
-            m_scene->force_update();
             light_node->set_color(color);
-        }
 
         float radius = light_node->radius();
 
         ImGui::InputFloat("Radius", &radius);
 
         if (radius != light_node->radius())
-        {
-            m_scene->force_update();
             light_node->set_radius(radius);
-        }
+
+        int light_group = light_node->light_group();
+
+        if (ImGui::SliderInt("Light Group", &light_group, 0, MAX_LIGHT_GROUPS - 1))
+            light_node->set_light_group(light_group);
 
         pos = ImGui::GetCursorPos();
         ImGui::SetCursorPos(ImVec2(pos.x, pos.y + 25.0f));
@@ -992,6 +1259,77 @@ private:
             }
         }
 
+        int light_group = ibl_node->light_group();
+
+        if (ImGui::SliderInt("Light Group", &light_group, 0, MAX_LIGHT_GROUPS - 1))
+            ibl_node->set_light_group(light_group);
+
+        pos = ImGui::GetCursorPos();
+        ImGui::SetCursorPos(ImVec2(pos.x, pos.y + 25.0f));
+
+        ImGui::Separator();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void inspector_probe_volume()
+    {
+        inspector_transform(true, true, true);
+
+        ImVec2 pos = ImGui::GetCursorPos();
+        ImGui::SetCursorPos(ImVec2(pos.x, pos.y + 25.0f));
+
+        ProbeVolumeNode::Ptr probe_volume_node = std::dynamic_pointer_cast<ProbeVolumeNode>(m_selected_node);
+
+        glm::ivec3 resolution = glm::ivec3(probe_volume_node->resolution());
+
+        if (ImGui::InputInt3("Resolution", &resolution.x))
+            probe_volume_node->set_resolution(glm::uvec3(glm::max(resolution, glm::ivec3(1))));
+
+        int sh_bands = probe_volume_node->sh_bands();
+
+        if (ImGui::SliderInt("SH Bands", &sh_bands, 2, 3))
+            probe_volume_node->set_sh_bands(sh_bands);
+
+        int rays_per_lane = m_probe_bake_settings.rays_per_lane;
+
+        if (ImGui::InputInt("Rays per Lane", &rays_per_lane))
+            m_probe_bake_settings.rays_per_lane = std::max(rays_per_lane, 1);
+
+        int min_samples = m_probe_bake_settings.min_samples;
+        int max_samples = m_probe_bake_settings.max_samples;
+
+        if (ImGui::InputInt("Min Samples", &min_samples))
+            m_probe_bake_settings.min_samples = std::max(min_samples, 0);
+
+        if (ImGui::InputInt("Max Samples", &max_samples))
+            m_probe_bake_settings.max_samples = std::max(max_samples, 1);
+
+        ImGui::InputFloat("Convergence Threshold", &m_probe_bake_settings.convergence_threshold);
+
+        ProbeBake::Ptr probe_bake = m_renderer->probe_bake();
+
+        if (probe_bake)
+            ImGui::Text("Baking: %u/%u probes converged, %u samples", probe_bake->num_converged_probes(), probe_bake->num_probes(), probe_bake->num_samples());
+
+        ImVec2 region = ImGui::GetContentRegionAvail();
+
+        if (ImGui::Button("Bake Probes", ImVec2(region.x, 30.0f)))
+        {
+            nfdchar_t*  out_path = NULL;
+            nfdresult_t result   = NFD_SaveDialog("hprb", NULL, &out_path);
+
+            if (result == NFD_OKAY)
+            {
+                std::string path;
+                path.resize(strlen(out_path));
+                strcpy(path.data(), out_path);
+                free(out_path);
+
+                m_renderer->bake_probes(probe_volume_node, m_probe_bake_settings, path + ".hprb");
+            }
+        }
+
         pos = ImGui::GetCursorPos();
         ImGui::SetCursorPos(ImVec2(pos.x, pos.y + 25.0f));
 
@@ -1137,6 +1475,8 @@ private:
             new_node = std::shared_ptr<PointLightNode>(new PointLightNode("New Node " + std::to_string(m_new_node_counter)));
         else if (m_node_type_to_add == NODE_IBL)
             new_node = std::shared_ptr<IBLNode>(new IBLNode("New Node " + std::to_string(m_new_node_counter)));
+        else if (m_node_type_to_add == NODE_PROBE_VOLUME)
+            new_node = std::shared_ptr<ProbeVolumeNode>(new ProbeVolumeNode("New Node " + std::to_string(m_new_node_counter)));
 
         m_new_node_counter++;
 
@@ -1160,6 +1500,8 @@ private:
             return ICON_FA_LIGHTBULB;
         else if (type == NODE_IBL)
             return ICON_FA_IMAGE;
+        else if (type == NODE_PROBE_VOLUME)
+            return ICON_FA_CUBES;
         else
             return ICON_FA_SITEMAP;
     }
@@ -1380,31 +1722,36 @@ private:
     // -----------------------------------------------------------------------------------------------------------------------------------
 
 private:
-    ImGuizmo::OPERATION m_current_operation = ImGuizmo::TRANSLATE;
-    ImGuizmo::MODE      m_current_mode      = ImGuizmo::WORLD;
-    RenderState         m_render_state;
-    Scene::Ptr          m_scene;
-    glm::vec3           m_snap                        = glm::vec3(1.0f);
-    bool                m_use_snap                    = false;
-    bool                m_show_gui                    = true;
-    bool                m_mouse_look                  = false;
-    bool                m_ray_debug_mode              = false;
-    Node::Ptr           m_selected_node               = nullptr;
-    bool                m_should_remove_selected_node = false;
-    bool                m_should_add_new_node         = false;
-    NodeType            m_node_type_to_add            = NODE_MESH;
-    Node*               m_node_to_attach_to           = nullptr;
-    float               m_camera_yaw                  = 0.0f;
-    float               m_camera_pitch                = 0.0f;
-    float               m_heading_speed               = 0.0f;
-    float               m_sideways_speed              = 0.0f;
-    float               m_camera_sensitivity          = 0.05f;
-    float               m_camera_speed                = 50.0f;
-    float               m_smooth_frametime            = 0.0f;
-    int32_t             m_num_debug_rays              = 32;
-    uint32_t            m_new_node_counter            = 0;
-    std::string         m_string_buffer;
-    CameraNode::Ptr     m_editor_camera;
+    ImGuizmo::OPERATION  m_current_operation = ImGuizmo::TRANSLATE;
+    ImGuizmo::MODE       m_current_mode      = ImGuizmo::WORLD;
+    RenderState          m_render_state;
+    Scene::Ptr           m_scene;
+    SceneLoad::Ptr       m_scene_load;
+    glm::vec3            m_snap                        = glm::vec3(1.0f);
+    bool                 m_use_snap                    = false;
+    bool                 m_show_gui                    = true;
+    bool                 m_mouse_look                  = false;
+    bool                 m_ray_debug_mode              = false;
+    Node::Ptr            m_selected_node               = nullptr;
+    bool                 m_should_remove_selected_node = false;
+    bool                 m_should_add_new_node         = false;
+    NodeType             m_node_type_to_add            = NODE_MESH;
+    ProbeBakeSettings    m_probe_bake_settings;
+    LightmapBakeSettings m_lightmap_bake_settings;
+    int32_t              m_cubemap_size                = 512;
+    int32_t              m_cubemap_samples             = 256;
+    Node*                m_node_to_attach_to           = nullptr;
+    float                m_camera_yaw                  = 0.0f;
+    float                m_camera_pitch                = 0.0f;
+    float                m_heading_speed               = 0.0f;
+    float                m_sideways_speed              = 0.0f;
+    float                m_camera_sensitivity          = 0.05f;
+    float                m_camera_speed                = 50.0f;
+    float                m_smooth_frametime            = 0.0f;
+    int32_t              m_num_debug_rays              = 32;
+    uint32_t             m_new_node_counter            = 0;
+    std::string          m_string_buffer;
+    CameraNode::Ptr      m_editor_camera;
 };
 } // namespace helios
 
@@ -127,7 +127,7 @@ bool Application::init_base(int argc, const char* argv[])
                                        {});
 
     m_renderer         = std::unique_ptr<Renderer>(new Renderer(m_vk_backend));
-    m_resource_manager = std::unique_ptr<ResourceManager>(new ResourceManager(m_vk_backend));
+    m_resource_manager = std::unique_ptr<ResourceManager>(new ResourceManager(m_vk_backend, m_renderer->shader_cache()));
 
     m_image_available_semaphores.resize(vk::Backend::kMaxFramesInFlight);
     m_render_finished_semaphores.resize(vk::Backend::kMaxFramesInFlight);
@@ -197,6 +197,7 @@ void Application::shutdown_base()
     // Close logger streams.
     logger::close_file_stream();
     logger::close_console_stream();
+    logger::shutdown();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
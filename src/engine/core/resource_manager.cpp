@@ -3,9 +3,13 @@
 #include <utility/utility.h>
 #include <loader/loader.h>
 #include <vk_mem_alloc.h>
+#include <gtc/packing.hpp>
 #include <imgui.h>
 #include <ImGuizmo.h>
 #include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
 namespace helios
 {
@@ -45,7 +49,41 @@ const VkFormat kSRGBFormats[][4] {
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Texture::Ptr create_image(const std::string& path, const ast::Image& image, bool srgb, VkImageViewType image_view_type, vk::Backend::Ptr backend, vk::BatchUploader& uploader)
+const uint64_t kColdTextureFrames  = 300; // Frames a texture has to go unused before it may be evicted
+const uint32_t kEvictedTextureSize = 64;  // Largest dimension of the mips that stay resident for an evicted texture
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+const size_t kMaxPendingSceneLoadAssets = 16;   // Read assets the worker of a scene load may get ahead of the uploads by
+const double kSceneLoadFrameBudget      = 8.0; // Milliseconds spent uploading the assets of scenes being loaded every frame
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+enum SceneLoadAssetType
+{
+    SCENE_LOAD_ASSET_MESH,
+    SCENE_LOAD_ASSET_MATERIAL,
+    SCENE_LOAD_ASSET_TEXTURE_2D,
+    SCENE_LOAD_ASSET_TEXTURE_CUBE
+};
+
+// An asset file read by the worker of a SceneLoad. The parsed data is null if the file could not be read.
+struct SceneLoadAsset
+{
+    SceneLoadAssetType             type;
+    std::string                    path;
+    std::string                    full_path;
+    bool                           srgb = false;
+    std::shared_ptr<ast::Mesh>     mesh;
+    std::shared_ptr<ast::Material> material;
+    std::shared_ptr<ast::Image>    image;
+    AlphaCoverage::Ptr             alpha_coverage;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Creates the image of the mips from resident_mip onwards and queues their upload.
+void create_image_resources(const ast::Image& image, bool srgb, VkImageViewType image_view_type, uint32_t resident_mip, vk::Backend::Ptr backend, vk::BatchUploader& uploader, LinearAllocator& scratch_allocator, vk::Image::Ptr& vk_image, vk::ImageView::Ptr& vk_image_view)
 {
     uint32_t type = 0;
 
@@ -68,35 +106,51 @@ Texture::Ptr create_image(const std::string& path, const ast::Image& image, bool
 
     VkImageCreateFlags flags = image_view_type == VK_IMAGE_VIEW_TYPE_CUBE ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
 
-    vk::Image::Ptr     vk_image      = vk::Image::create(backend, VK_IMAGE_TYPE_2D, image.data[0][0].width, image.data[0][0].height, 1, image.mip_slices, image.array_slices, format, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0, nullptr, flags);
-    vk::ImageView::Ptr vk_image_view = vk::ImageView::create(backend, vk_image, image_view_type, VK_IMAGE_ASPECT_COLOR_BIT, 0, image.mip_slices, 0, image.array_slices);
+    const uint32_t num_mips = image.mip_slices - resident_mip;
+
+    vk_image      = vk::Image::create(backend, VK_IMAGE_TYPE_2D, image.data[0][resident_mip].width, image.data[0][resident_mip].height, 1, num_mips, image.array_slices, format, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0, nullptr, flags);
+    vk_image_view = vk::ImageView::create(backend, vk_image, image_view_type, VK_IMAGE_ASPECT_COLOR_BIT, 0, num_mips, 0, image.array_slices);
 
     size_t              total_size = 0;
     std::vector<size_t> mip_level_sizes;
 
     for (int32_t i = 0; i < image.array_slices; i++)
     {
-        for (int32_t j = 0; j < image.mip_slices; j++)
+        for (int32_t j = resident_mip; j < image.mip_slices; j++)
         {
             total_size += image.data[i][j].size;
             mip_level_sizes.push_back(image.data[i][j].size);
         }
     }
 
-    std::vector<uint8_t> image_data(total_size);
+    // The uploader copies the levels into its staging buffers right away, so the scratch memory can be released after the call.
+    LinearAllocator::Marker marker     = scratch_allocator.marker();
+    uint8_t*                image_data = scratch_allocator.allocate_array<uint8_t>(total_size);
 
     size_t offset = 0;
 
     for (int32_t i = 0; i < image.array_slices; i++)
     {
-        for (int32_t j = 0; j < image.mip_slices; j++)
+        for (int32_t j = resident_mip; j < image.mip_slices; j++)
         {
-            memcpy(image_data.data() + offset, image.data[i][j].data, image.data[i][j].size);
+            memcpy(image_data + offset, image.data[i][j].data, image.data[i][j].size);
             offset += image.data[i][j].size;
         }
     }
 
-    uploader.upload_image_data(vk_image, image_data.data(), mip_level_sizes);
+    uploader.upload_image_data(vk_image, image_data, mip_level_sizes);
+
+    scratch_allocator.rewind(marker);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Texture::Ptr create_image(const std::string& path, const ast::Image& image, bool srgb, VkImageViewType image_view_type, vk::Backend::Ptr backend, vk::BatchUploader& uploader, LinearAllocator& scratch_allocator)
+{
+    vk::Image::Ptr     vk_image;
+    vk::ImageView::Ptr vk_image_view;
+
+    create_image_resources(image, srgb, image_view_type, 0, backend, uploader, scratch_allocator, vk_image, vk_image_view);
 
     if (image_view_type == VK_IMAGE_VIEW_TYPE_2D)
         return Texture2D::create(backend, vk_image, vk_image_view, path);
@@ -108,117 +162,1279 @@ Texture::Ptr create_image(const std::string& path, const ast::Image& image, bool
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-ResourceManager::ResourceManager(vk::Backend::Ptr backend) :
-    m_backend(backend)
+// Reads the alpha of the top mip of a texture for the alpha test classification of mesh triangles. Safe to call from the scene load
+// worker. Returns null for BC7, which is not decoded.
+AlphaCoverage::Ptr create_alpha_coverage(const ast::Image& image)
+{
+    if (image.array_slices < 1 || image.mip_slices < 1)
+        return nullptr;
+
+    const uint32_t       width  = image.data[0][0].width;
+    const uint32_t       height = image.data[0][0].height;
+    const uint8_t*       src    = (const uint8_t*)image.data[0][0].data;
+    std::vector<uint8_t> alpha(size_t(width) * size_t(height));
+
+    if (image.compression == ast::CompressionType::COMPRESSION_NONE)
+    {
+        // Formats without an alpha channel read back an alpha of one
+        if (image.components < 4)
+            return AlphaCoverage::create_opaque();
+
+        const size_t component_size = image.type == ast::PIXEL_TYPE_FLOAT32 ? 4 : (image.type == ast::PIXEL_TYPE_FLOAT16 ? 2 : 1);
+
+        if (image.data[0][0].size < alpha.size() * 4 * component_size)
+            return nullptr;
+
+        for (size_t i = 0; i < alpha.size(); i++)
+        {
+            const uint8_t* texel = src + (i * 4 + 3) * component_size;
+            float          value = 0.0f;
+
+            if (image.type == ast::PIXEL_TYPE_FLOAT32)
+                value = *(const float*)texel;
+            else if (image.type == ast::PIXEL_TYPE_FLOAT16)
+                value = glm::unpackHalf1x16(*(const uint16_t*)texel);
+            else
+                value = texel[0] / 255.0f;
+
+            alpha[i] = uint8_t(std::round(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+        }
+
+        return AlphaCoverage::create(width, height, alpha);
+    }
+
+    const VkFormat format = kCompressedFormats[image.compression][0];
+
+    if (format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || format == VK_FORMAT_BC4_UNORM_BLOCK || format == VK_FORMAT_BC5_UNORM_BLOCK || format == VK_FORMAT_BC6H_SFLOAT_BLOCK)
+        return AlphaCoverage::create_opaque();
+    else if (format != VK_FORMAT_BC1_RGBA_UNORM_BLOCK && format != VK_FORMAT_BC2_UNORM_BLOCK && format != VK_FORMAT_BC3_UNORM_BLOCK)
+        return nullptr;
+
+    const uint32_t blocks_x   = (width + 3) / 4;
+    const uint32_t blocks_y   = (height + 3) / 4;
+    const size_t   block_size = format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK ? 8 : 16;
+
+    if (image.data[0][0].size < size_t(blocks_x) * size_t(blocks_y) * block_size)
+        return nullptr;
+
+    for (uint32_t by = 0; by < blocks_y; by++)
+    {
+        for (uint32_t bx = 0; bx < blocks_x; bx++)
+        {
+            const uint8_t* block = src + (size_t(by) * blocks_x + bx) * block_size;
+            uint8_t        block_alpha[16];
+
+            if (format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK)
+            {
+                // Index 3 is transparent black when the endpoints are not in descending order
+                const uint16_t color0  = block[0] | (block[1] << 8);
+                const uint16_t color1  = block[2] | (block[3] << 8);
+                const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (uint32_t(block[7]) << 24);
+
+                for (uint32_t i = 0; i < 16; i++)
+                    block_alpha[i] = (color0 <= color1 && ((indices >> (2 * i)) & 3) == 3) ? 0 : 255;
+            }
+            else if (format == VK_FORMAT_BC2_UNORM_BLOCK)
+            {
+                for (uint32_t i = 0; i < 16; i++)
+                    block_alpha[i] = ((block[i / 2] >> (4 * (i % 2))) & 0xF) * 17;
+            }
+            else
+            {
+                const uint32_t alpha0  = block[0];
+                const uint32_t alpha1  = block[1];
+                uint64_t       indices = 0;
+
+                for (uint32_t i = 0; i < 6; i++)
+                    indices |= uint64_t(block[2 + i]) << (8 * i);
+
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    const uint32_t idx = (indices >> (3 * i)) & 7;
+
+                    if (idx == 0)
+                        block_alpha[i] = alpha0;
+                    else if (idx == 1)
+                        block_alpha[i] = alpha1;
+                    else if (alpha0 > alpha1)
+                        block_alpha[i] = ((8 - idx) * alpha0 + (idx - 1) * alpha1) / 7;
+                    else if (idx < 6)
+                        block_alpha[i] = ((6 - idx) * alpha0 + (idx - 1) * alpha1) / 5;
+                    else
+                        block_alpha[i] = idx == 6 ? 0 : 255;
+                }
+            }
+
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+            {
+                for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+                    alpha[size_t(by * 4 + y) * width + bx * 4 + x] = block_alpha[y * 4 + x];
+            }
+        }
+    }
+
+    return AlphaCoverage::create(width, height, alpha);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Sorts the triangles of a submesh with an alpha tested material into those the alpha test never cuts out, those it has to run for
+// and those it always cuts out, in the order the BLAS expects them.
+void sort_alpha_tested_triangles(SubMesh& submesh, Material::Ptr material, const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    // Without a texture the alpha comes from the albedo value, which can be edited at any time, so the alpha test is left to run
+    Texture2D::Ptr texture = material->albedo_texture();
+
+    if (!texture || !texture->alpha_coverage())
+        return;
+
+    AlphaCoverage::Ptr    alpha_coverage = texture->alpha_coverage();
+    std::vector<uint32_t> opaque;
+    std::vector<uint32_t> alpha_tested;
+    std::vector<uint32_t> cut_out;
+
+    for (uint32_t i = submesh.base_index; i + 2 < submesh.base_index + submesh.index_count; i += 3)
+    {
+        const uint32_t* triangle = &indices[i];
+        uint8_t         flags    = 0;
+
+        if (submesh.base_vertex + std::max(std::max(triangle[0], triangle[1]), triangle[2]) < vertices.size())
+        {
+            flags = alpha_coverage->classify(glm::vec2(vertices[submesh.base_vertex + triangle[0]].tex_coord),
+                                             glm::vec2(vertices[submesh.base_vertex + triangle[1]].tex_coord),
+                                             glm::vec2(vertices[submesh.base_vertex + triangle[2]].tex_coord));
+        }
+
+        std::vector<uint32_t>& dst = (flags & ALPHA_COVERAGE_OPAQUE) ? opaque : ((flags & ALPHA_COVERAGE_CUT_OUT) ? cut_out : alpha_tested);
+        dst.insert(dst.end(), triangle, triangle + 3);
+    }
+
+    std::copy(opaque.begin(), opaque.end(), indices.begin() + submesh.base_index);
+    std::copy(alpha_tested.begin(), alpha_tested.end(), indices.begin() + submesh.base_index + opaque.size());
+    std::copy(cut_out.begin(), cut_out.end(), indices.begin() + submesh.base_index + opaque.size() + alpha_tested.size());
+
+    submesh.opaque_triangle_count  = opaque.size() / 3;
+    submesh.cut_out_triangle_count = cut_out.size() / 3;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+VkDeviceSize resource_size(Texture::Ptr texture)
+{
+    return texture->image()->allocation_size();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+VkDeviceSize resource_size(Mesh::Ptr mesh)
+{
+    VkDeviceSize size = mesh->vertex_buffer()->size() + mesh->index_buffer()->size() + mesh->acceleration_structure()->build_sizes().accelerationStructureSize;
+
+    if (mesh->has_override_acceleration_structure())
+        size += mesh->override_acceleration_structure()->build_sizes().accelerationStructureSize;
+
+    return size;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string resource_full_path(const std::string& path)
+{
+    return std::filesystem::path(path).is_absolute() ? path : utility::path_for_resource("assets/" + path);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Releases cached resources that nothing outside of the cache references, least recently used first, until at least the given
+// number of bytes is freed. The frames in flight may still use them, so their destruction goes through the deletion queue.
+template <typename T>
+VkDeviceSize release_unreferenced_resources(std::unordered_map<std::string, std::shared_ptr<T>>& cache, VkDeviceSize bytes, vk::Backend::Ptr backend, FileWatcher& file_watcher)
+{
+    std::vector<std::pair<uint64_t, std::string>> candidates;
+
+    for (auto& it : cache)
+    {
+        if (it.second.use_count() == 1)
+            candidates.push_back({ it.second->last_used_frame(), it.first });
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+
+    VkDeviceSize freed = 0;
+
+    for (auto& candidate : candidates)
+    {
+        if (freed >= bytes)
+            break;
+
+        auto it = cache.find(candidate.second);
+
+        freed += resource_size(it->second);
+        backend->queue_object_deletion(it->second);
+        file_watcher.unwatch(resource_full_path(it->first));
+        cache.erase(it);
+    }
+
+    return freed;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+SceneLoad::SceneLoad() :
+    m_is_cancelled(false),
+    m_num_assets(0)
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+SceneLoad::~SceneLoad()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_is_cancelled = true;
+    }
+
+    m_condition.notify_all();
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void SceneLoad::start()
+{
+    m_num_meshes = m_mesh_paths.size();
+    m_num_assets = m_mesh_paths.size() + m_texture_cube_paths.size();
+
+    m_thread = std::thread(&SceneLoad::read_assets, this);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Runs on the worker thread. Only reads and parses files, everything that touches the device or the caches is left to the main
+// thread.
+void SceneLoad::read_assets()
+{
+    std::unordered_set<std::string>           queued_paths = m_cached_paths;
+    std::vector<std::pair<std::string, bool>> texture_paths;
+
+    auto read_material = [&](const std::string& path) {
+        if (!queued_paths.insert(path).second)
+            return true;
+
+        auto asset = std::make_shared<SceneLoadAsset>();
+
+        asset->type      = SCENE_LOAD_ASSET_MATERIAL;
+        asset->path      = path;
+        asset->full_path = resource_full_path(path);
+        asset->material  = std::make_shared<ast::Material>();
+
+        m_num_assets++;
+
+        if (ast::load_material(asset->full_path, *asset->material))
+        {
+            for (auto& ast_texture : asset->material->textures)
+            {
+                if (queued_paths.insert(ast_texture.path).second)
+                {
+                    texture_paths.push_back({ ast_texture.path, ast_texture.srgb });
+                    m_num_assets++;
+                }
+            }
+        }
+        else
+            asset->material = nullptr;
+
+        return push(asset);
+    };
+
+    auto read_image = [&](SceneLoadAssetType type, const std::string& path, bool srgb) {
+        auto asset = std::make_shared<SceneLoadAsset>();
+
+        asset->type      = type;
+        asset->path      = path;
+        asset->full_path = resource_full_path(path);
+        asset->srgb      = srgb;
+        asset->image     = std::make_shared<ast::Image>();
+
+        if (!ast::load_image(asset->full_path, *asset->image))
+            asset->image = nullptr;
+        else if (type == SCENE_LOAD_ASSET_TEXTURE_2D)
+            asset->alpha_coverage = create_alpha_coverage(*asset->image);
+
+        return push(asset);
+    };
+
+    // Meshes come first so that the scene takes shape as early as possible. Their materials are read right before them since the
+    // BLAS depends on whether the materials are opaque, while the textures the materials reference are only read at the end.
+    for (auto& path : m_mesh_paths)
+    {
+        if (m_is_cancelled)
+            return;
+
+        auto asset = std::make_shared<SceneLoadAsset>();
+
+        asset->type      = SCENE_LOAD_ASSET_MESH;
+        asset->path      = path;
+        asset->full_path = resource_full_path(path);
+        asset->mesh      = std::make_shared<ast::Mesh>();
+
+        if (ast::load_mesh(asset->full_path, *asset->mesh))
+        {
+            for (auto& material_path : asset->mesh->material_paths)
+            {
+                if (!read_material(material_path))
+                    return;
+            }
+        }
+        else
+            asset->mesh = nullptr;
+
+        if (!push(asset))
+            return;
+    }
+
+    for (auto& path : m_material_paths)
+    {
+        if (m_is_cancelled || !read_material(path))
+            return;
+    }
+
+    for (auto& path : m_texture_cube_paths)
+    {
+        if (m_is_cancelled || !read_image(SCENE_LOAD_ASSET_TEXTURE_CUBE, path, false))
+            return;
+    }
+
+    for (auto& texture_path : texture_paths)
+    {
+        if (m_is_cancelled || !read_image(SCENE_LOAD_ASSET_TEXTURE_2D, texture_path.first, texture_path.second))
+            return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_is_read = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Blocks while the main thread is too far behind. Returns false if the load was cancelled.
+bool SceneLoad::push(std::shared_ptr<SceneLoadAsset> asset)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_condition.wait(lock, [this] { return m_assets.size() < kMaxPendingSceneLoadAssets || m_is_cancelled; });
+
+    if (m_is_cancelled)
+        return false;
+
+    m_assets.push_back(asset);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<SceneLoadAsset> SceneLoad::pop()
+{
+    std::shared_ptr<SceneLoadAsset> asset;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_assets.empty())
+            return nullptr;
+
+        asset = m_assets.front();
+        m_assets.pop_front();
+    }
+
+    m_condition.notify_all();
+
+    return asset;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// True once every asset has been read and handed over to the main thread.
+bool SceneLoad::is_read()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_is_read && m_assets.empty();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ResourceManager::ResourceManager(vk::Backend::Ptr backend, ShaderCache::Ptr shader_cache) :
+    m_backend(backend), m_shader_cache(shader_cache)
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ResourceManager::~ResourceManager()
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Texture2D::Ptr ResourceManager::load_texture_2d(const std::string& path, bool srgb)
+{
+    if (!m_backend.expired())
+    {
+        vk::BatchUploader uploader(m_backend.lock());
+
+        auto resource = load_texture_2d_internal(path, srgb, uploader);
+
+        uploader.submit();
+
+        return resource;
+    }
+    else
+        return nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TextureCube::Ptr ResourceManager::load_texture_cube(const std::string& path, bool srgb)
+{
+    if (!m_backend.expired())
+    {
+        vk::BatchUploader uploader(m_backend.lock());
+
+        auto resource = load_texture_cube_internal(path, srgb, uploader);
+
+        uploader.submit();
+
+        return resource;
+    }
+    else
+        return nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Material::Ptr ResourceManager::load_material(const std::string& path)
+{
+    if (!m_backend.expired())
+    {
+        vk::BatchUploader uploader(m_backend.lock());
+
+        auto resource = load_material_internal(path, uploader);
+
+        uploader.submit();
+
+        return resource;
+    }
+    else
+        return nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Mesh::Ptr ResourceManager::load_mesh(const std::string& path)
+{
+    if (!m_backend.expired())
+    {
+        vk::BatchUploader uploader(m_backend.lock());
+
+        auto resource = load_mesh_internal(path, uploader);
+
+        uploader.submit();
+
+        return resource;
+    }
+    else
+        return nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Scene::Ptr ResourceManager::load_scene(const std::string& path)
+{
+    if (!m_backend.expired())
+    {
+        vk::Backend::Ptr  backend = m_backend.lock();
+        vk::BatchUploader uploader(backend);
+
+        ast::Scene  ast_scene;
+        std::string full_path = std::filesystem::path(path).is_absolute() ? path : utility::path_for_resource("assets/" + path);
+
+        if (ast::load_scene(full_path, ast_scene))
+        {
+            Node::Ptr root_node = create_node(ast_scene.scene_graph, uploader);
+
+            uploader.submit();
+
+            if (root_node)
+                return Scene::create(backend, m_shader_cache, ast_scene.name, root_node, full_path);
+            else
+                return nullptr;
+        }
+        else
+            return nullptr;
+    }
+    else
+        return nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+SceneLoad::Ptr ResourceManager::load_scene_async(const std::string& path)
+{
+    if (m_backend.expired())
+        return nullptr;
+
+    vk::Backend::Ptr  backend = m_backend.lock();
+    vk::BatchUploader uploader(backend);
+
+    ast::Scene  ast_scene;
+    std::string full_path = std::filesystem::path(path).is_absolute() ? path : utility::path_for_resource("assets/" + path);
+
+    if (!ast::load_scene(full_path, ast_scene))
+        return nullptr;
+
+    SceneLoad::Ptr load = std::shared_ptr<SceneLoad>(new SceneLoad());
+
+    // The nodes only record the meshes, materials and cubemaps they need while the load is set
+    m_loading_scene     = load;
+    Node::Ptr root_node = create_node(ast_scene.scene_graph, uploader);
+    m_loading_scene     = nullptr;
+
+    uploader.submit();
+
+    if (!root_node)
+        return nullptr;
+
+    load->m_scene = Scene::create(backend, m_shader_cache, ast_scene.name, root_node, full_path);
+
+    // Whatever is cached already is attached right away, the worker only reads the rest
+    std::vector<std::string> mesh_paths;
+
+    for (auto& mesh_path : load->m_mesh_paths)
+    {
+        if (m_meshes.find(mesh_path) != m_meshes.end())
+        {
+            for (auto& node : load->m_mesh_nodes[mesh_path])
+                node->set_mesh(m_meshes[mesh_path]);
+
+            load->m_mesh_nodes.erase(mesh_path);
+        }
+        else
+            mesh_paths.push_back(mesh_path);
+    }
+
+    std::vector<std::string> material_paths;
+
+    for (auto& material_path : load->m_material_paths)
+    {
+        if (m_materials.find(material_path) != m_materials.end())
+        {
+            for (auto& node : load->m_override_nodes[material_path])
+                node->set_material_override(m_materials[material_path]);
+
+            load->m_override_nodes.erase(material_path);
+        }
+        else
+            material_paths.push_back(material_path);
+    }
+
+    std::vector<std::string> texture_cube_paths;
+
+    for (auto& texture_path : load->m_texture_cube_paths)
+    {
+        if (m_textures_cube.find(texture_path) != m_textures_cube.end())
+        {
+            for (auto& node : load->m_ibl_nodes[texture_path])
+                node->set_image(m_textures_cube[texture_path]);
+
+            load->m_ibl_nodes.erase(texture_path);
+        }
+        else
+            texture_cube_paths.push_back(texture_path);
+    }
+
+    load->m_mesh_paths         = mesh_paths;
+    load->m_material_paths     = material_paths;
+    load->m_texture_cube_paths = texture_cube_paths;
+
+    for (auto& it : m_materials)
+        load->m_cached_paths.insert(it.first);
+
+    for (auto& it : m_textures_2d)
+        load->m_cached_paths.insert(it.first);
+
+    load->start();
+
+    m_scene_loads.push_back(load);
+
+    return load;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ResourceManager::update_scene_loads()
+{
+    if (m_backend.expired())
+        return;
+
+    // Loads whose handle was dropped have been cancelled by its destructor
+    m_scene_loads.erase(std::remove_if(m_scene_loads.begin(), m_scene_loads.end(), [](const std::weak_ptr<SceneLoad>& load) { return load.expired() || load.lock()->is_complete(); }), m_scene_loads.end());
+
+    for (auto& load : m_scene_loads)
+        update_scene_load(load.lock());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ResourceManager::update_scene_load(SceneLoad::Ptr load)
+{
+    vk::BatchUploader uploader(m_backend.lock());
+
+    std::vector<std::pair<std::string, Mesh::Ptr>>        meshes;
+    std::vector<std::pair<std::string, TextureCube::Ptr>> texture_cubes;
+    bool                                                  has_new_textures = false;
+
+    auto waits_for_alpha_textures = [&](const Mesh::Ptr& mesh) {
+        for (auto& pending : load->m_pending_materials)
+        {
+            const auto& materials = mesh->materials();
+
+            if (pending.material->is_alpha_tested() && std::find(materials.begin(), materials.end(), pending.material) != materials.end())
+                return true;
+        }
+
+        return false;
+    };
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // At least one asset is uploaded every frame, however long it takes
+    while (std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() < kSceneLoadFrameBudget)
+    {
+        std::shared_ptr<SceneLoadAsset> asset = load->pop();
+
+        if (!asset)
+            break;
+
+        load->m_num_loaded_assets++;
+
+        if (asset->type == SCENE_LOAD_ASSET_MESH)
+        {
+            Mesh::Ptr mesh = nullptr;
+
+            if (m_meshes.find(asset->path) != m_meshes.end())
+                mesh = m_meshes[asset->path];
+            else if (asset->mesh)
+            {
+                // The materials were handed over before the mesh, so they are found in the cache
+                mesh = create_mesh(asset->full_path, *asset->mesh, uploader);
+
+                if (mesh)
+                {
+                    m_meshes[asset->path] = mesh;
+                    m_file_watcher.watch(asset->full_path);
+
+                    if (waits_for_alpha_textures(mesh))
+                        load->m_deferred_meshes.push_back({ mesh, asset->full_path, asset->mesh });
+                }
+            }
+
+            if (!mesh)
+                HELIOS_LOG_ERROR("Failed to load Mesh: " + asset->path);
+
+            meshes.push_back({ asset->path, mesh });
+        }
+        else if (asset->type == SCENE_LOAD_ASSET_MATERIAL)
+        {
+            if (m_materials.find(asset->path) == m_materials.end() && asset->material)
+            {
+                // Textures are uploaded last, so for now the material goes without the ones that are not cached yet
+                Material::Ptr material = create_material(asset->full_path, *asset->material, uploader, true);
+
+                m_materials[asset->path] = material;
+                m_file_watcher.watch(asset->full_path);
+
+                load->m_pending_materials.push_back({ material, asset->full_path, asset->material });
+            }
+
+            if (m_materials.find(asset->path) != m_materials.end())
+            {
+                for (auto& node : load->m_override_nodes[asset->path])
+                    node->set_material_override(m_materials[asset->path]);
+            }
+            else
+                HELIOS_LOG_ERROR("Failed to load Material: " + asset->path);
+
+            load->m_override_nodes.erase(asset->path);
+        }
+        else if (asset->type == SCENE_LOAD_ASSET_TEXTURE_2D)
+        {
+            Texture2D::Ptr texture = nullptr;
+
+            if (m_textures_2d.find(asset->path) != m_textures_2d.end())
+                texture = m_textures_2d[asset->path];
+            else if (asset->image)
+                texture = cache_texture_2d(asset->path, asset->full_path, *asset->image, asset->srgb, asset->alpha_coverage, uploader);
+
+            if (texture)
+                load->m_textures.push_back(texture);
+            else
+            {
+                load->m_failed_textures.insert(asset->path);
+                HELIOS_LOG_ERROR("Failed to load Texture: " + asset->path);
+            }
+
+            has_new_textures = true;
+        }
+        else if (asset->type == SCENE_LOAD_ASSET_TEXTURE_CUBE)
+        {
+            TextureCube::Ptr texture = nullptr;
+
+            if (m_textures_cube.find(asset->path) != m_textures_cube.end())
+                texture = m_textures_cube[asset->path];
+            else if (asset->image)
+                texture = cache_texture_cube(asset->path, asset->full_path, *asset->image, asset->srgb, uploader);
+
+            if (!texture)
+                HELIOS_LOG_ERROR("Failed to load cubemap: " + asset->path);
+
+            texture_cubes.push_back({ asset->path, texture });
+        }
+    }
+
+    bool is_read = load->is_read();
+
+    // A material is completed once every texture it references was either loaded or failed to load. Textures that were cached
+    // when the load started may have been released since, which is only given up on once everything else has arrived.
+    if (has_new_textures || is_read)
+    {
+        std::vector<SceneLoad::PendingMaterial> pending_materials;
+
+        for (auto& pending : load->m_pending_materials)
+        {
+            bool is_complete = true;
+
+            for (auto& ast_texture : pending.ast_material->textures)
+            {
+                if (m_textures_2d.find(ast_texture.path) == m_textures_2d.end() && load->m_failed_textures.find(ast_texture.path) == load->m_failed_textures.end())
+                    is_complete = false;
+            }
+
+            if (is_complete || is_read)
+                pending.material->replace(create_material(pending.full_path, *pending.ast_material, uploader, true));
+            else
+                pending_materials.push_back(pending);
+        }
+
+        load->m_pending_materials = pending_materials;
+    }
+
+    std::vector<std::pair<Mesh::Ptr, Mesh::Ptr>> mesh_changes;
+    std::vector<SceneLoad::DeferredMesh>         deferred_meshes;
+
+    // The alpha tested triangles of meshes whose materials are complete now are sorted again, this time against their textures
+    for (auto& deferred : load->m_deferred_meshes)
+    {
+        if (waits_for_alpha_textures(deferred.mesh))
+            deferred_meshes.push_back(deferred);
+        else
+        {
+            Mesh::Ptr sorted = create_mesh(deferred.full_path, *deferred.ast_mesh, uploader);
+
+            if (sorted)
+                mesh_changes.push_back({ deferred.mesh, sorted });
+        }
+    }
+
+    load->m_deferred_meshes = deferred_meshes;
+
+    // Builds the BLAS of the new meshes before they are added to the scene
+    uploader.submit();
+
+    for (auto& change : mesh_changes)
+        change.first->replace_geometry(change.second);
+
+    for (auto& mesh : meshes)
+    {
+        if (mesh.second)
+        {
+            for (auto& node : load->m_mesh_nodes[mesh.first])
+                node->set_mesh(mesh.second);
+        }
+
+        load->m_mesh_nodes.erase(mesh.first);
+        load->m_num_loaded_meshes++;
+    }
+
+    for (auto& texture_cube : texture_cubes)
+    {
+        if (texture_cube.second)
+        {
+            for (auto& node : load->m_ibl_nodes[texture_cube.first])
+                node->set_image(texture_cube.second);
+        }
+
+        load->m_ibl_nodes.erase(texture_cube.first);
+    }
+
+    if (meshes.size() > 0 || texture_cubes.size() > 0)
+        load->m_scene->force_update();
+
+    if (is_read && load->m_pending_materials.empty())
+    {
+        load->m_is_complete = true;
+        load->m_textures.clear();
+        load->m_failed_textures.clear();
+
+        HELIOS_LOG_INFO("Loaded Scene: " + load->m_scene->path());
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ResourceManager::update_residency(RenderState& render_state)
+{
+    if (m_backend.expired())
+        return;
+
+    m_residency_frame++;
+
+    for (auto mesh_node : render_state.meshes())
+        touch(mesh_node->mesh().get(), mesh_node->material_override().get());
+
+    for (auto instancer : render_state.instancers())
+        touch(instancer->mesh().get(), instancer->material_override().get());
+
+    if (render_state.ibl_environment_map() && render_state.ibl_environment_map()->image())
+        render_state.ibl_environment_map()->image()->m_last_used_frame = m_residency_frame;
+
+    if (m_textures_to_restore.size() > 0)
+        restore_textures();
+
+    if (m_residency_frame < m_next_enforce_frame)
+        return;
+
+    vk::MemoryBudget   device = m_backend.lock()->memory_budget();
+    const VkDeviceSize limit  = budget_limit(device);
+
+    if (device.usage <= limit)
+    {
+        m_over_budget = false;
+        return;
+    }
+
+    const VkDeviceSize excess = device.usage - limit;
+
+    VkDeviceSize freed = release_unreferenced(excess);
+
+    if (freed < excess)
+        freed += evict_cold_textures(excess - freed);
+
+    // Released resources are only destroyed once the frames in flight are done with them, so the usage reported until then is stale
+    m_next_enforce_frame = m_residency_frame + vk::Backend::kMaxFramesInFlight + 1;
+
+    if (freed < excess && !m_over_budget)
+        HELIOS_LOG_ERROR("Device memory is " + std::to_string((excess - freed) / (1024 * 1024)) + " MB over budget and no cold resources are left to evict.");
+
+    m_over_budget = freed < excess;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ResourceManager::reload_changed_resources()
+{
+    if (m_backend.expired())
+        return;
+
+    m_changed_files.clear();
+    m_file_watcher.poll(m_changed_files);
+
+    if (m_changed_files.empty())
+        return;
+
+    vk::Backend::Ptr             backend = m_backend.lock();
+    vk::BatchUploader            uploader(backend);
+    std::vector<ResidencyChange> texture_changes;
+    std::vector<Mesh::Ptr>       meshes_to_reload;
+
+    std::vector<std::pair<TextureCube::Ptr, TextureCube::Ptr>> texture_cube_changes;
+
+    auto reload_meshes_using = [&](const Material::Ptr& material) {
+        for (auto& mesh_it : m_meshes)
+        {
+            auto& materials = mesh_it.second->m_materials;
+
+            if (std::find(materials.begin(), materials.end(), material) != materials.end())
+                meshes_to_reload.push_back(mesh_it.second);
+        }
+    };
+
+    for (auto& path : m_changed_files)
+    {
+        for (auto& it : m_textures_2d)
+        {
+            ResidencyChange change;
+
+            if (it.second->m_path == path && upload_resident_mips(it.second, 0, uploader, change, true))
+            {
+                texture_changes.push_back(change);
+                HELIOS_LOG_INFO("Reloaded Texture: " + path);
+
+                // Alpha tested triangles were sorted against the previous alpha channel
+                for (auto& material_it : m_materials)
+                {
+                    if (material_it.second->is_alpha_tested() && material_it.second->albedo_texture() == it.second)
+                        reload_meshes_using(material_it.second);
+                }
+            }
+        }
+
+        for (auto& it : m_textures_cube)
+        {
+            if (it.second->m_path != path)
+                continue;
+
+            ast::Image ast_image;
+
+            if (!ast::load_image(path, ast_image))
+            {
+                HELIOS_LOG_ERROR("Failed to reload Texture: " + path);
+                continue;
+            }
+
+            auto reloaded = std::dynamic_pointer_cast<TextureCube>(create_image(path, ast_image, it.second->m_srgb, VK_IMAGE_VIEW_TYPE_CUBE, backend, uploader, m_scratch_allocator));
+
+            if (reloaded)
+            {
+                texture_cube_changes.push_back({ it.second, reloaded });
+                HELIOS_LOG_INFO("Reloaded Texture: " + path);
+            }
+            else
+                HELIOS_LOG_ERROR("Failed to reload Texture: " + path);
+        }
+
+        for (auto& it : m_materials)
+        {
+            Material::Ptr material = it.second;
+
+            if (material->m_path != path)
+                continue;
+
+            Material::Ptr reloaded = create_material(path, uploader);
+
+            if (!reloaded)
+            {
+                HELIOS_LOG_ERROR("Failed to reload Material: " + path);
+                continue;
+            }
+
+            // The geometry flags of the BLAS depend on whether the material is opaque, and alpha tested triangles are sorted
+            // against the albedo texture
+            bool is_opaque          = material->type() == MATERIAL_OPAQUE && !material->is_alpha_tested();
+            bool is_reloaded_opaque = reloaded->type() == MATERIAL_OPAQUE && !reloaded->is_alpha_tested();
+            bool is_alpha_tested    = material->is_alpha_tested() || reloaded->is_alpha_tested();
+
+            material->replace(reloaded);
+
+            if (is_opaque != is_reloaded_opaque || is_alpha_tested)
+                reload_meshes_using(material);
+
+            HELIOS_LOG_INFO("Reloaded Material: " + path);
+        }
+
+        for (auto& it : m_meshes)
+        {
+            if (it.second->m_path == path)
+                meshes_to_reload.push_back(it.second);
+        }
+    }
+
+    std::sort(meshes_to_reload.begin(), meshes_to_reload.end());
+    meshes_to_reload.erase(std::unique(meshes_to_reload.begin(), meshes_to_reload.end()), meshes_to_reload.end());
+
+    std::vector<std::pair<Mesh::Ptr, Mesh::Ptr>> mesh_changes;
+
+    // Materials are replaced first so that reloaded meshes build their BLAS with the new opacity
+    for (auto& mesh : meshes_to_reload)
+    {
+        Mesh::Ptr reloaded = create_mesh(mesh->m_path, uploader);
+
+        if (reloaded)
+        {
+            mesh_changes.push_back({ mesh, reloaded });
+            HELIOS_LOG_INFO("Reloaded Mesh: " + mesh->m_path);
+        }
+        else
+            HELIOS_LOG_ERROR("Failed to reload Mesh: " + mesh->m_path);
+    }
+
+    uploader.submit();
+
+    apply_residency_changes(texture_changes);
+
+    for (auto& change : texture_cube_changes)
+        change.first->replace_image(change.second);
+
+    for (auto& change : mesh_changes)
+        change.first->replace_geometry(change.second);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ResourceManager::set_memory_budget(VkDeviceSize bytes)
+{
+    m_memory_budget      = bytes;
+    m_next_enforce_frame = 0;
+    m_over_budget        = false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+MemoryStatistics ResourceManager::memory_statistics()
+{
+    MemoryStatistics stats;
+
+    if (m_backend.expired())
+        return stats;
+
+    stats.device = m_backend.lock()->memory_budget();
+    stats.budget = budget_limit(stats.device);
+
+    for (auto& it : m_textures_2d)
+    {
+        stats.texture_bytes += resource_size(it.second);
+        stats.num_textures++;
+
+        if (it.second->is_evicted())
+            stats.num_evicted_textures++;
+    }
+
+    for (auto& it : m_textures_cube)
+    {
+        stats.texture_bytes += resource_size(it.second);
+        stats.num_textures++;
+    }
+
+    for (auto& it : m_meshes)
+    {
+        stats.mesh_bytes += resource_size(it.second);
+        stats.num_meshes++;
+    }
+
+    return stats;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ResourceManager::touch(Mesh* mesh, Material* material_override)
+{
+    if (material_override)
+        touch(material_override);
+
+    // Meshes are usually shared by many nodes, their materials only have to be visited once a frame
+    if (!mesh || mesh->m_last_used_frame == m_residency_frame)
+        return;
+
+    mesh->m_last_used_frame = m_residency_frame;
+
+    for (auto& material : mesh->m_materials)
+        touch(material.get());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ResourceManager::touch(Material* material)
 {
+    for (auto& texture : material->m_textures)
+    {
+        if (!texture || texture->m_last_used_frame == m_residency_frame)
+            continue;
+
+        texture->m_last_used_frame = m_residency_frame;
+
+        if (texture->m_resident_mip > 0)
+            m_textures_to_restore.push_back(texture);
+    }
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-ResourceManager::~ResourceManager()
+VkDeviceSize ResourceManager::budget_limit(const vk::MemoryBudget& device)
 {
+    if (m_memory_budget > 0)
+        return std::min(m_memory_budget, device.budget);
+    else
+        return device.budget;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Texture2D::Ptr ResourceManager::load_texture_2d(const std::string& path, bool srgb)
+VkDeviceSize ResourceManager::release_unreferenced(VkDeviceSize bytes)
 {
-    if (!m_backend.expired())
+    vk::Backend::Ptr backend = m_backend.lock();
+
+    // Meshes keep their materials alive and materials their textures, so they are released in that order. Materials own no device
+    // memory and would only pin their textures, so all of the unreferenced ones are dropped.
+    VkDeviceSize freed = release_unreferenced_resources(m_meshes, bytes, backend, m_file_watcher);
+
+    for (auto it = m_materials.begin(); it != m_materials.end();)
     {
-        vk::BatchUploader uploader(m_backend.lock());
+        if (it->second.use_count() == 1)
+        {
+            m_file_watcher.unwatch(resource_full_path(it->first));
+            it = m_materials.erase(it);
+        }
+        else
+            it++;
+    }
 
-        auto resource = load_texture_2d_internal(path, srgb, uploader);
+    if (freed < bytes)
+        freed += release_unreferenced_resources(m_textures_2d, bytes - freed, backend, m_file_watcher);
 
-        uploader.submit();
+    if (freed < bytes)
+        freed += release_unreferenced_resources(m_textures_cube, bytes - freed, backend, m_file_watcher);
 
-        return resource;
-    }
-    else
-        return nullptr;
+    return freed;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-TextureCube::Ptr ResourceManager::load_texture_cube(const std::string& path, bool srgb)
+VkDeviceSize ResourceManager::evict_cold_textures(VkDeviceSize bytes)
 {
-    if (!m_backend.expired())
+    std::vector<Texture2D::Ptr> candidates;
+
+    for (auto& it : m_textures_2d)
     {
-        vk::BatchUploader uploader(m_backend.lock());
+        Texture2D::Ptr texture = it.second;
 
-        auto resource = load_texture_cube_internal(path, srgb, uploader);
+        if (texture->m_resident_mip == 0 && texture->m_image->mip_levels() > 1 && texture->m_last_used_frame + kColdTextureFrames < m_residency_frame)
+            candidates.push_back(texture);
+    }
 
-        uploader.submit();
+    std::sort(candidates.begin(), candidates.end(), [](const Texture2D::Ptr& a, const Texture2D::Ptr& b) {
+        return a->m_last_used_frame < b->m_last_used_frame;
+    });
 
-        return resource;
+    vk::BatchUploader            uploader(m_backend.lock());
+    std::vector<ResidencyChange> changes;
+    VkDeviceSize                 freed = 0;
+
+    for (auto& texture : candidates)
+    {
+        if (freed >= bytes)
+            break;
+
+        vk::Image::Ptr image = texture->m_image;
+
+        uint32_t resident_mip = 0;
+
+        while (resident_mip + 1 < image->mip_levels() && (std::max(image->width(), image->height()) >> resident_mip) > kEvictedTextureSize)
+            resident_mip++;
+
+        ResidencyChange change;
+
+        if (resident_mip > 0 && upload_resident_mips(texture, resident_mip, uploader, change))
+        {
+            freed += image->allocation_size() - std::min(image->allocation_size(), change.image->allocation_size());
+            changes.push_back(change);
+        }
     }
-    else
-        return nullptr;
+
+    uploader.submit();
+
+    apply_residency_changes(changes);
+
+    return freed;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Material::Ptr ResourceManager::load_material(const std::string& path)
+void ResourceManager::restore_textures()
 {
-    if (!m_backend.expired())
+    vk::BatchUploader            uploader(m_backend.lock());
+    std::vector<ResidencyChange> changes;
+
+    for (auto& texture : m_textures_to_restore)
     {
-        vk::BatchUploader uploader(m_backend.lock());
+        ResidencyChange change;
 
-        auto resource = load_material_internal(path, uploader);
+        if (upload_resident_mips(texture, 0, uploader, change))
+            changes.push_back(change);
+    }
 
-        uploader.submit();
+    m_textures_to_restore.clear();
 
-        return resource;
-    }
-    else
-        return nullptr;
+    uploader.submit();
+
+    apply_residency_changes(changes);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Mesh::Ptr ResourceManager::load_mesh(const std::string& path)
+bool ResourceManager::upload_resident_mips(Texture2D::Ptr texture, uint32_t resident_mip, vk::BatchUploader& uploader, ResidencyChange& change, bool update_alpha_coverage)
 {
-    if (!m_backend.expired())
+    ast::Image ast_image;
+
+    if (!ast::load_image(texture->m_path, ast_image))
     {
-        vk::BatchUploader uploader(m_backend.lock());
+        HELIOS_LOG_ERROR("Failed to reload Texture: " + texture->m_path);
+        return false;
+    }
 
-        auto resource = load_mesh_internal(path, uploader);
+    change.texture      = texture;
+    change.resident_mip = std::min(resident_mip, uint32_t(ast_image.mip_slices - 1));
 
-        uploader.submit();
+    // Only used on the CPU, so it does not have to wait for the image to be swapped
+    if (update_alpha_coverage)
+        texture->m_alpha_coverage = create_alpha_coverage(ast_image);
 
-        return resource;
-    }
-    else
-        return nullptr;
+    create_image_resources(ast_image, texture->m_srgb, VK_IMAGE_VIEW_TYPE_2D, change.resident_mip, m_backend.lock(), uploader, m_scratch_allocator, change.image, change.image_view);
+
+    return true;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Scene::Ptr ResourceManager::load_scene(const std::string& path)
+void ResourceManager::apply_residency_changes(const std::vector<ResidencyChange>& changes)
 {
-    if (!m_backend.expired())
+    if (changes.empty())
+        return;
+
+    vk::Backend::Ptr backend = m_backend.lock();
+
+    // Bindless slots are rewritten in place, which is only safe once no frame in flight samples them anymore
+    backend->wait_idle();
+
+    for (auto& change : changes)
     {
-        vk::Backend::Ptr  backend = m_backend.lock();
-        vk::BatchUploader uploader(backend);
+        Texture2D::Ptr texture = change.texture;
 
-        ast::Scene  ast_scene;
-        std::string full_path = std::filesystem::path(path).is_absolute() ? path : utility::path_for_resource("assets/" + path);
+        backend->update_bindless_texture(texture->m_bindless_index, change.image_view);
+        backend->queue_object_deletion(texture->m_image_view);
+        backend->queue_object_deletion(texture->m_image);
 
-        if (ast::load_scene(full_path, ast_scene))
-        {
-            Node::Ptr root_node = create_node(ast_scene.scene_graph, uploader);
+        texture->m_image        = change.image;
+        texture->m_image_view   = change.image_view;
+        texture->m_resident_mip = change.resident_mip;
+    }
 
-            uploader.submit();
+    // The bindless indices did not change, but scenes using the textures have to restart their accumulation
+    for (auto& it : m_materials)
+    {
+        Material::Ptr material = it.second;
 
-            if (root_node)
-                return Scene::create(backend, ast_scene.name, root_node, full_path);
-            else
-                return nullptr;
+        for (auto& change : changes)
+        {
+            if (std::find(material->m_textures.begin(), material->m_textures.end(), change.texture) != material->m_textures.end())
+            {
+                material->increment_version();
+                break;
+            }
         }
-        else
-            return nullptr;
     }
-    else
-        return nullptr;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -229,25 +1445,11 @@ Texture2D::Ptr ResourceManager::load_texture_2d_internal(const std::string& path
         return m_textures_2d[path];
     else
     {
-        vk::Backend::Ptr backend = m_backend.lock();
-        ast::Image       ast_image;
-        std::string      full_path = std::filesystem::path(path).is_absolute() ? path : utility::path_for_resource("assets/" + path);
+        ast::Image  ast_image;
+        std::string full_path = std::filesystem::path(path).is_absolute() ? path : utility::path_for_resource("assets/" + path);
 
         if (ast::load_image(full_path, ast_image))
-        {
-            auto texture = create_image(full_path, ast_image, srgb, VK_IMAGE_VIEW_TYPE_2D, backend, uploader);
-
-            if (texture)
-            {
-                auto texture_2d = std::dynamic_pointer_cast<Texture2D>(texture);
-
-                m_textures_2d[path] = texture_2d;
-
-                return texture_2d;
-            }
-            else
-                return nullptr;
-        }
+            return cache_texture_2d(path, full_path, ast_image, srgb, create_alpha_coverage(ast_image), uploader);
         else
         {
             HELIOS_LOG_ERROR("Failed to load Texture: " + path);
@@ -258,31 +1460,38 @@ Texture2D::Ptr ResourceManager::load_texture_2d_internal(const std::string& path
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+Texture2D::Ptr ResourceManager::cache_texture_2d(const std::string& path, const std::string& full_path, const ast::Image& ast_image, bool srgb, AlphaCoverage::Ptr alpha_coverage, vk::BatchUploader& uploader)
+{
+    auto texture = create_image(full_path, ast_image, srgb, VK_IMAGE_VIEW_TYPE_2D, m_backend.lock(), uploader, m_scratch_allocator);
+
+    if (texture)
+    {
+        auto texture_2d = std::dynamic_pointer_cast<Texture2D>(texture);
+
+        texture_2d->m_srgb           = srgb;
+        texture_2d->m_alpha_coverage = alpha_coverage;
+        m_textures_2d[path]          = texture_2d;
+        m_file_watcher.watch(full_path);
+
+        return texture_2d;
+    }
+    else
+        return nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 TextureCube::Ptr ResourceManager::load_texture_cube_internal(const std::string& path, bool srgb, vk::BatchUploader& uploader)
 {
     if (m_textures_cube.find(path) != m_textures_cube.end())
         return m_textures_cube[path];
     else
     {
-        vk::Backend::Ptr backend = m_backend.lock();
-        ast::Image       ast_image;
-        std::string      full_path = std::filesystem::path(path).is_absolute() ? path : utility::path_for_resource("assets/" + path);
+        ast::Image  ast_image;
+        std::string full_path = std::filesystem::path(path).is_absolute() ? path : utility::path_for_resource("assets/" + path);
 
         if (ast::load_image(full_path, ast_image))
-        {
-            auto texture = create_image(full_path, ast_image, srgb, VK_IMAGE_VIEW_TYPE_CUBE, backend, uploader);
-
-            if (texture)
-            {
-                auto texture_cube = std::dynamic_pointer_cast<TextureCube>(texture);
-
-                m_textures_cube[path] = texture_cube;
-
-                return texture_cube;
-            }
-            else
-                return nullptr;
-        }
+            return cache_texture_cube(path, full_path, ast_image, srgb, uploader);
         else
         {
             HELIOS_LOG_ERROR("Failed to load Texture: " + path);
@@ -293,134 +1502,182 @@ TextureCube::Ptr ResourceManager::load_texture_cube_internal(const std::string&
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+TextureCube::Ptr ResourceManager::cache_texture_cube(const std::string& path, const std::string& full_path, const ast::Image& ast_image, bool srgb, vk::BatchUploader& uploader)
+{
+    auto texture = create_image(full_path, ast_image, srgb, VK_IMAGE_VIEW_TYPE_CUBE, m_backend.lock(), uploader, m_scratch_allocator);
+
+    if (texture)
+    {
+        auto texture_cube = std::dynamic_pointer_cast<TextureCube>(texture);
+
+        texture_cube->m_srgb  = srgb;
+        m_textures_cube[path] = texture_cube;
+        m_file_watcher.watch(full_path);
+
+        return texture_cube;
+    }
+    else
+        return nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 Material::Ptr ResourceManager::load_material_internal(const std::string& path, vk::BatchUploader& uploader)
 {
     if (m_materials.find(path) != m_materials.end())
         return m_materials[path];
     else
     {
-        vk::Backend::Ptr backend = m_backend.lock();
-        ast::Material    ast_material;
-        std::string      full_path = std::filesystem::path(path).is_absolute() ? path : utility::path_for_resource("assets/" + path);
+        std::string   full_path = std::filesystem::path(path).is_absolute() ? path : utility::path_for_resource("assets/" + path);
+        Material::Ptr material  = create_material(full_path, uploader);
 
-        if (ast::load_material(full_path, ast_material))
+        if (material)
         {
-            std::string path_to_root = utility::path_without_file(full_path);
-
-            MaterialType type = ast_material.material_type == ast::MATERIAL_OPAQUE ? MATERIAL_OPAQUE : MATERIAL_TRANSPARENT;
+            m_materials[path] = material;
+            m_file_watcher.watch(full_path);
 
-            std::vector<Texture2D::Ptr>               textures;
-            std::unordered_map<std::string, uint32_t> texture_index_map;
+            return material;
+        }
+        else
+        {
+            HELIOS_LOG_ERROR("Failed to load Material: " + path);
+            return nullptr;
+        }
+    }
+}
 
-            TextureInfo albedo_texture_info;
-            TextureInfo emissive_texture_info;
-            TextureInfo normal_texture_info;
-            TextureInfo metallic_texture_info;
-            TextureInfo roughness_texture_info;
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-            glm::vec4 albedo_value    = glm::vec4(0.0f);
-            glm::vec4 emissive_value  = glm::vec4(0.0f);
-            float     metallic_value  = 0.0f;
-            float     roughness_value = 1.0f;
+// Builds a material from its file without going through the cache, the textures it references are loaded through the cache.
+Material::Ptr ResourceManager::create_material(const std::string& full_path, vk::BatchUploader& uploader)
+{
+    ast::Material ast_material;
 
-            for (auto ast_texture : ast_material.textures)
-            {
-                if (ast_texture.type == ast::TEXTURE_ALBEDO)
-                {
-                    if (texture_index_map.find(ast_texture.path) == texture_index_map.end())
-                    {
-                        Texture2D::Ptr texture = load_texture_2d_internal(ast_texture.path, ast_texture.srgb, uploader);
+    if (!ast::load_material(full_path, ast_material))
+        return nullptr;
 
-                        texture_index_map[ast_texture.path] = textures.size();
+    return create_material(full_path, ast_material, uploader);
+}
 
-                        textures.push_back(texture);
-                    }
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-                    albedo_texture_info.array_index   = texture_index_map[ast_texture.path];
-                    albedo_texture_info.channel_index = ast_texture.channel_index;
-                }
-                else if (ast_texture.type == ast::TEXTURE_EMISSIVE)
-                {
-                    if (texture_index_map.find(ast_texture.path) == texture_index_map.end())
-                    {
-                        Texture2D::Ptr texture = load_texture_2d_internal(ast_texture.path, ast_texture.srgb, uploader);
+// With cached_textures_only, textures that are not in the cache yet are left out instead of being loaded, and a missing albedo
+// texture is stood in for by a neutral grey.
+Material::Ptr ResourceManager::create_material(const std::string& full_path, const ast::Material& ast_material, vk::BatchUploader& uploader, bool cached_textures_only)
+{
+    vk::Backend::Ptr backend = m_backend.lock();
 
-                        texture_index_map[ast_texture.path] = textures.size();
+    MaterialType type = ast_material.material_type == ast::MATERIAL_OPAQUE ? MATERIAL_OPAQUE : MATERIAL_TRANSPARENT;
 
-                        textures.push_back(texture);
-                    }
+    std::vector<Texture2D::Ptr>               textures;
+    std::unordered_map<std::string, uint32_t> texture_index_map;
 
-                    emissive_texture_info.array_index   = texture_index_map[ast_texture.path];
-                    emissive_texture_info.channel_index = ast_texture.channel_index;
-                }
-                else if (ast_texture.type == ast::TEXTURE_NORMAL)
-                {
-                    if (texture_index_map.find(ast_texture.path) == texture_index_map.end())
-                    {
-                        Texture2D::Ptr texture = load_texture_2d_internal(ast_texture.path, ast_texture.srgb, uploader);
+    TextureInfo albedo_texture_info;
+    TextureInfo emissive_texture_info;
+    TextureInfo normal_texture_info;
+    TextureInfo metallic_texture_info;
+    TextureInfo roughness_texture_info;
 
-                        texture_index_map[ast_texture.path] = textures.size();
+    glm::vec4 albedo_value    = glm::vec4(0.0f);
+    glm::vec4 emissive_value  = glm::vec4(0.0f);
+    float     metallic_value  = 0.0f;
+    float     roughness_value = 1.0f;
 
-                        textures.push_back(texture);
-                    }
+    for (auto ast_texture : ast_material.textures)
+    {
+        if (cached_textures_only && m_textures_2d.find(ast_texture.path) == m_textures_2d.end())
+        {
+            if (ast_texture.type == ast::TEXTURE_ALBEDO)
+                albedo_value = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
 
-                    normal_texture_info.array_index   = texture_index_map[ast_texture.path];
-                    normal_texture_info.channel_index = ast_texture.channel_index;
-                }
-                else if (ast_texture.type == ast::TEXTURE_METALLIC)
-                {
-                    if (texture_index_map.find(ast_texture.path) == texture_index_map.end())
-                    {
-                        Texture2D::Ptr texture = load_texture_2d_internal(ast_texture.path, ast_texture.srgb, uploader);
+            continue;
+        }
 
-                        texture_index_map[ast_texture.path] = textures.size();
+        if (ast_texture.type == ast::TEXTURE_ALBEDO)
+        {
+            if (texture_index_map.find(ast_texture.path) == texture_index_map.end())
+            {
+                Texture2D::Ptr texture = load_texture_2d_internal(ast_texture.path, ast_texture.srgb, uploader);
 
-                        textures.push_back(texture);
-                    }
+                texture_index_map[ast_texture.path] = textures.size();
 
-                    metallic_texture_info.array_index   = texture_index_map[ast_texture.path];
-                    metallic_texture_info.channel_index = ast_texture.channel_index;
-                }
-                else if (ast_texture.type == ast::TEXTURE_ROUGHNESS)
-                {
-                    if (texture_index_map.find(ast_texture.path) == texture_index_map.end())
-                    {
-                        Texture2D::Ptr texture = load_texture_2d_internal(ast_texture.path, ast_texture.srgb, uploader);
+                textures.push_back(texture);
+            }
 
-                        texture_index_map[ast_texture.path] = textures.size();
+            albedo_texture_info.array_index   = texture_index_map[ast_texture.path];
+            albedo_texture_info.channel_index = ast_texture.channel_index;
+        }
+        else if (ast_texture.type == ast::TEXTURE_EMISSIVE)
+        {
+            if (texture_index_map.find(ast_texture.path) == texture_index_map.end())
+            {
+                Texture2D::Ptr texture = load_texture_2d_internal(ast_texture.path, ast_texture.srgb, uploader);
 
-                        textures.push_back(texture);
-                    }
+                texture_index_map[ast_texture.path] = textures.size();
 
-                    roughness_texture_info.array_index   = texture_index_map[ast_texture.path];
-                    roughness_texture_info.channel_index = ast_texture.channel_index;
-                }
+                textures.push_back(texture);
             }
 
-            for (auto ast_property : ast_material.properties)
+            emissive_texture_info.array_index   = texture_index_map[ast_texture.path];
+            emissive_texture_info.channel_index = ast_texture.channel_index;
+        }
+        else if (ast_texture.type == ast::TEXTURE_NORMAL)
+        {
+            if (texture_index_map.find(ast_texture.path) == texture_index_map.end())
             {
-                if (ast_property.type == ast::PROPERTY_ALBEDO)
-                    albedo_value = glm::vec4(ast_property.vec4_value[0], ast_property.vec4_value[1], ast_property.vec4_value[2], ast_property.vec4_value[3]);
-                if (ast_property.type == ast::PROPERTY_EMISSIVE)
-                    emissive_value = glm::vec4(ast_property.vec4_value[0], ast_property.vec4_value[1], ast_property.vec4_value[2], ast_property.vec4_value[3]);
-                if (ast_property.type == ast::PROPERTY_METALLIC)
-                    metallic_value = ast_property.float_value;
-                if (ast_property.type == ast::PROPERTY_ROUGHNESS)
-                    roughness_value = ast_property.float_value;
+                Texture2D::Ptr texture = load_texture_2d_internal(ast_texture.path, ast_texture.srgb, uploader);
+
+                texture_index_map[ast_texture.path] = textures.size();
+
+                textures.push_back(texture);
             }
 
-            Material::Ptr material = Material::create(backend, type, textures, albedo_texture_info, normal_texture_info, metallic_texture_info, roughness_texture_info, emissive_texture_info, albedo_value, emissive_value, metallic_value, roughness_value, ast_material.alpha_mask, full_path);
+            normal_texture_info.array_index   = texture_index_map[ast_texture.path];
+            normal_texture_info.channel_index = ast_texture.channel_index;
+        }
+        else if (ast_texture.type == ast::TEXTURE_METALLIC)
+        {
+            if (texture_index_map.find(ast_texture.path) == texture_index_map.end())
+            {
+                Texture2D::Ptr texture = load_texture_2d_internal(ast_texture.path, ast_texture.srgb, uploader);
 
-            m_materials[path] = material;
+                texture_index_map[ast_texture.path] = textures.size();
 
-            return material;
+                textures.push_back(texture);
+            }
+
+            metallic_texture_info.array_index   = texture_index_map[ast_texture.path];
+            metallic_texture_info.channel_index = ast_texture.channel_index;
         }
-        else
+        else if (ast_texture.type == ast::TEXTURE_ROUGHNESS)
         {
-            HELIOS_LOG_ERROR("Failed to load Material: " + path);
-            return nullptr;
+            if (texture_index_map.find(ast_texture.path) == texture_index_map.end())
+            {
+                Texture2D::Ptr texture = load_texture_2d_internal(ast_texture.path, ast_texture.srgb, uploader);
+
+                texture_index_map[ast_texture.path] = textures.size();
+
+                textures.push_back(texture);
+            }
+
+            roughness_texture_info.array_index   = texture_index_map[ast_texture.path];
+            roughness_texture_info.channel_index = ast_texture.channel_index;
         }
     }
+
+    for (auto ast_property : ast_material.properties)
+    {
+        if (ast_property.type == ast::PROPERTY_ALBEDO)
+            albedo_value = glm::vec4(ast_property.vec4_value[0], ast_property.vec4_value[1], ast_property.vec4_value[2], ast_property.vec4_value[3]);
+        if (ast_property.type == ast::PROPERTY_EMISSIVE)
+            emissive_value = glm::vec4(ast_property.vec4_value[0], ast_property.vec4_value[1], ast_property.vec4_value[2], ast_property.vec4_value[3]);
+        if (ast_property.type == ast::PROPERTY_METALLIC)
+            metallic_value = ast_property.float_value;
+        if (ast_property.type == ast::PROPERTY_ROUGHNESS)
+            roughness_value = ast_property.float_value;
+    }
+
+    return Material::create(backend, type, textures, albedo_texture_info, normal_texture_info, metallic_texture_info, roughness_texture_info, emissive_texture_info, albedo_value, emissive_value, metallic_value, roughness_value, ast_material.alpha_mask, full_path);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -431,53 +1688,13 @@ Mesh::Ptr ResourceManager::load_mesh_internal(const std::string& path, vk::Batch
         return m_meshes[path];
     else
     {
-        vk::Backend::Ptr backend = m_backend.lock();
-        ast::Mesh        ast_mesh;
-        std::string      full_path = std::filesystem::path(path).is_absolute() ? path : utility::path_for_resource("assets/" + path);
+        std::string full_path = std::filesystem::path(path).is_absolute() ? path : utility::path_for_resource("assets/" + path);
+        Mesh::Ptr   mesh      = create_mesh(full_path, uploader);
 
-        if (ast::load_mesh(full_path, ast_mesh))
+        if (mesh)
         {
-            std::string path_to_root = utility::path_without_file(full_path);
-
-            std::vector<Vertex>        vertices(ast_mesh.vertices.size());
-            std::vector<SubMesh>       submeshes(ast_mesh.submeshes.size());
-            std::vector<Material::Ptr> materials(ast_mesh.materials.size());
-
-            for (int i = 0; i < ast_mesh.vertices.size(); i++)
-            {
-                vertices[i].position  = glm::vec4(ast_mesh.vertices[i].position, 0.0f);
-                vertices[i].tex_coord = glm::vec4(ast_mesh.vertices[i].tex_coord, 0.0f, 0.0f);
-                vertices[i].normal    = glm::vec4(ast_mesh.vertices[i].normal, 0.0f);
-                vertices[i].tangent   = glm::vec4(ast_mesh.vertices[i].tangent, 0.0f);
-                vertices[i].bitangent = glm::vec4(ast_mesh.vertices[i].bitangent, 0.0f);
-            }
-
-            for (int i = 0; i < ast_mesh.submeshes.size(); i++)
-            {
-                submeshes[i].name         = ast_mesh.submeshes[i].name;
-                submeshes[i].mat_idx      = ast_mesh.submeshes[i].material_index;
-                submeshes[i].index_count  = ast_mesh.submeshes[i].index_count;
-                submeshes[i].vertex_count = ast_mesh.submeshes[i].vertex_count;
-                submeshes[i].base_vertex  = ast_mesh.submeshes[i].base_vertex;
-                submeshes[i].base_index   = ast_mesh.submeshes[i].base_index;
-                submeshes[i].max_extents  = ast_mesh.submeshes[i].max_extents;
-                submeshes[i].min_extents  = ast_mesh.submeshes[i].min_extents;
-            }
-
-            for (int submesh_idx = 0; submesh_idx < submeshes.size(); submesh_idx++)
-            {
-                const auto& submesh = submeshes[submesh_idx];
-
-                for (int i = submesh.base_index; i < (submesh.base_index + submesh.index_count); i++)
-                    vertices[submesh.base_vertex + ast_mesh.indices[i]].position.w = float(submesh_idx);
-            }
-
-            for (int i = 0; i < ast_mesh.material_paths.size(); i++)
-                materials[i] = load_material_internal(ast_mesh.material_paths[i], uploader);
-
-            Mesh::Ptr mesh = Mesh::create(backend, vertices, ast_mesh.indices, submeshes, materials, uploader, full_path);
-
             m_meshes[path] = mesh;
+            m_file_watcher.watch(full_path);
 
             return mesh;
         }
@@ -491,6 +1708,76 @@ Mesh::Ptr ResourceManager::load_mesh_internal(const std::string& path, vk::Batch
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+// Builds a mesh from its file without going through the cache, the materials it references are loaded through the cache.
+Mesh::Ptr ResourceManager::create_mesh(const std::string& full_path, vk::BatchUploader& uploader)
+{
+    ast::Mesh ast_mesh;
+
+    if (!ast::load_mesh(full_path, ast_mesh))
+        return nullptr;
+
+    return create_mesh(full_path, ast_mesh, uploader);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Mesh::Ptr ResourceManager::create_mesh(const std::string& full_path, const ast::Mesh& ast_mesh, vk::BatchUploader& uploader)
+{
+    vk::Backend::Ptr backend = m_backend.lock();
+
+    std::vector<Vertex>        vertices(ast_mesh.vertices.size());
+    std::vector<SubMesh>       submeshes(ast_mesh.submeshes.size());
+    std::vector<Material::Ptr> materials(ast_mesh.materials.size());
+
+    // The lightmap UVs live in tex_coord.zw. The mesh format only stores one UV set, so the lightmap is baked over it and
+    // expects it to be free of overlaps.
+    for (int i = 0; i < ast_mesh.vertices.size(); i++)
+    {
+        vertices[i].position  = glm::vec4(ast_mesh.vertices[i].position, 0.0f);
+        vertices[i].tex_coord = glm::vec4(ast_mesh.vertices[i].tex_coord, ast_mesh.vertices[i].tex_coord);
+        vertices[i].normal    = glm::vec4(ast_mesh.vertices[i].normal, 0.0f);
+        vertices[i].tangent   = glm::vec4(ast_mesh.vertices[i].tangent, 0.0f);
+        vertices[i].bitangent = glm::vec4(ast_mesh.vertices[i].bitangent, 0.0f);
+    }
+
+    for (int i = 0; i < ast_mesh.submeshes.size(); i++)
+    {
+        submeshes[i].name         = ast_mesh.submeshes[i].name;
+        submeshes[i].mat_idx      = ast_mesh.submeshes[i].material_index;
+        submeshes[i].index_count  = ast_mesh.submeshes[i].index_count;
+        submeshes[i].vertex_count = ast_mesh.submeshes[i].vertex_count;
+        submeshes[i].base_vertex  = ast_mesh.submeshes[i].base_vertex;
+        submeshes[i].base_index   = ast_mesh.submeshes[i].base_index;
+        submeshes[i].max_extents  = ast_mesh.submeshes[i].max_extents;
+        submeshes[i].min_extents  = ast_mesh.submeshes[i].min_extents;
+    }
+
+    for (int submesh_idx = 0; submesh_idx < submeshes.size(); submesh_idx++)
+    {
+        const auto& submesh = submeshes[submesh_idx];
+
+        for (int i = submesh.base_index; i < (submesh.base_index + submesh.index_count); i++)
+            vertices[submesh.base_vertex + ast_mesh.indices[i]].position.w = float(submesh_idx);
+    }
+
+    for (int i = 0; i < ast_mesh.material_paths.size(); i++)
+        materials[i] = load_material_internal(ast_mesh.material_paths[i], uploader);
+
+    std::vector<uint32_t> indices = ast_mesh.indices;
+
+    for (auto& submesh : submeshes)
+    {
+        Material::Ptr material = materials[submesh.mat_idx];
+
+        if (material && material->is_alpha_tested())
+            sort_alpha_tested_triangles(submesh, material, vertices, indices);
+    }
+
+    return Mesh::create(backend, vertices, indices, submeshes, materials, uploader, full_path);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 Node::Ptr ResourceManager::create_node(std::shared_ptr<ast::SceneNode> ast_node, vk::BatchUploader& uploader)
 {
     if (ast_node->type == ast::SCENE_NODE_MESH)
@@ -519,7 +1806,23 @@ MeshNode::Ptr ResourceManager::create_mesh_node(std::shared_ptr<ast::MeshNode> a
 
     Mesh::Ptr mesh = nullptr;
 
-    if (ast_node->mesh != "")
+    if (ast_node->mesh != "" && m_loading_scene)
+    {
+        // Scenes loaded in the background get their meshes and materials once they have been read
+        if (m_loading_scene->m_mesh_nodes.find(ast_node->mesh) == m_loading_scene->m_mesh_nodes.end())
+            m_loading_scene->m_mesh_paths.push_back(ast_node->mesh);
+
+        m_loading_scene->m_mesh_nodes[ast_node->mesh].push_back(mesh_node);
+
+        if (ast_node->material_override != "")
+        {
+            if (m_loading_scene->m_override_nodes.find(ast_node->material_override) == m_loading_scene->m_override_nodes.end())
+                m_loading_scene->m_material_paths.push_back(ast_node->material_override);
+
+            m_loading_scene->m_override_nodes[ast_node->material_override].push_back(mesh_node);
+        }
+    }
+    else if (ast_node->mesh != "")
     {
         mesh = load_mesh_internal(ast_node->mesh, uploader);
 
@@ -621,7 +1924,14 @@ IBLNode::Ptr ResourceManager::create_ibl_node(std::shared_ptr<ast::IBLNode> ast_
 
     TextureCube::Ptr texture_cube = nullptr;
 
-    if (ast_node->image != "")
+    if (ast_node->image != "" && m_loading_scene)
+    {
+        if (m_loading_scene->m_ibl_nodes.find(ast_node->image) == m_loading_scene->m_ibl_nodes.end())
+            m_loading_scene->m_texture_cube_paths.push_back(ast_node->image);
+
+        m_loading_scene->m_ibl_nodes[ast_node->image].push_back(ibl_node);
+    }
+    else if (ast_node->image != "")
     {
         texture_cube = load_texture_cube_internal(ast_node->image, false, uploader);
 
@@ -0,0 +1,286 @@
+#include <gfx/checkpoint.h>
+#include <resource/material.h>
+#include <resource/mesh.h>
+#include <resource/texture.h>
+#include <utility/logger.h>
+#include <utility/utility.h>
+#include <unordered_set>
+#include <stdio.h>
+
+namespace helios
+{
+namespace checkpoint
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// 64-bit FNV-1a
+struct Hasher
+{
+    uint64_t value = 14695981039346656037ull;
+
+    void add(const void* data, size_t size)
+    {
+        const uint8_t* bytes = (const uint8_t*)data;
+
+        for (size_t i = 0; i < size; i++)
+        {
+            value ^= bytes[i];
+            value *= 1099511628211ull;
+        }
+    }
+
+    template <typename T>
+    void add(const T& v)
+    {
+        add(&v, sizeof(T));
+    }
+
+    void add(const std::string& str)
+    {
+        add(str.data(), str.size());
+    }
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Textures are identified by their path, their ids are only stable within a session.
+static void add_texture(Hasher& hasher, std::shared_ptr<Texture> texture, TextureInfo info)
+{
+    hasher.add(texture ? texture->path() : std::string());
+    hasher.add(info.channel_index);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void add_material(Hasher& hasher, std::unordered_set<Material*>& visited, Material* material)
+{
+    if (!material || !visited.insert(material).second)
+        return;
+
+    hasher.add(material->path());
+    hasher.add(material->type());
+    hasher.add(material->is_alpha_tested());
+    hasher.add(material->albedo_value());
+    hasher.add(material->emissive_value());
+    hasher.add(material->metallic_value());
+    hasher.add(material->roughness_value());
+    hasher.add(material->light_group());
+
+    add_texture(hasher, material->albedo_texture(), material->albedo_texture_info());
+    add_texture(hasher, material->normal_texture(), material->normal_texture_info());
+    add_texture(hasher, material->metallic_texture(), material->metallic_texture_info());
+    add_texture(hasher, material->roughness_texture(), material->roughness_texture_info());
+    add_texture(hasher, material->emissive_texture(), material->emissive_texture_info());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t fingerprint(RenderState& render_state, PathIntegrator::Ptr path_integrator, uint32_t width, uint32_t height)
+{
+    Hasher hasher;
+
+    hasher.add(width);
+    hasher.add(height);
+
+    if (render_state.scene())
+    {
+        hasher.add(render_state.scene()->name());
+        hasher.add(render_state.scene()->path());
+    }
+
+    if (render_state.camera())
+    {
+        CameraNode* camera = render_state.camera();
+
+        hasher.add(camera->global_transform());
+        hasher.add(camera->fov());
+        hasher.add(camera->near_plane());
+        hasher.add(camera->far_plane());
+        hasher.add(camera->focal_length());
+        hasher.add(camera->aperture_radius());
+    }
+
+    // Materials are shared by many meshes, each is hashed where it is first used
+    std::unordered_set<Material*> materials;
+
+    for (auto& mesh_node : render_state.meshes())
+    {
+        hasher.add(mesh_node->global_transform());
+        add_material(hasher, materials, mesh_node->material_override().get());
+
+        if (mesh_node->mesh())
+        {
+            hasher.add(mesh_node->mesh()->path());
+
+            for (auto& material : mesh_node->mesh()->materials())
+                add_material(hasher, materials, material.get());
+        }
+    }
+
+    for (auto& instancer : render_state.instancers())
+    {
+        hasher.add(instancer->global_transform());
+        hasher.add(instancer->mesh()->path());
+        hasher.add(instancer->instance_transforms().data(), sizeof(glm::mat3x4) * instancer->instance_count());
+        add_material(hasher, materials, instancer->material_override().get());
+
+        for (auto& material : instancer->mesh()->materials())
+            add_material(hasher, materials, material.get());
+    }
+
+    // The environment map takes precedence over the sky, whose sun follows the first directional light
+    if (render_state.ibl_environment_map() && render_state.ibl_environment_map()->image())
+    {
+        hasher.add(render_state.ibl_environment_map()->image()->path());
+        hasher.add(render_state.ibl_environment_map()->light_group());
+    }
+    else if (render_state.directional_lights().size() > 0 && render_state.scene())
+    {
+        hasher.add(render_state.scene()->sky_model()->turbidity());
+        hasher.add(render_state.scene()->sky_model()->albedo());
+    }
+
+    for (auto& light : render_state.directional_lights())
+    {
+        hasher.add(light->global_transform());
+        hasher.add(light->color());
+        hasher.add(light->intensity());
+        hasher.add(light->radius());
+    }
+
+    for (auto& light : render_state.spot_lights())
+    {
+        hasher.add(light->global_transform());
+        hasher.add(light->color());
+        hasher.add(light->intensity());
+        hasher.add(light->radius());
+        hasher.add(light->inner_cone_angle());
+        hasher.add(light->outer_cone_angle());
+    }
+
+    for (auto& light : render_state.point_lights())
+    {
+        hasher.add(light->global_transform());
+        hasher.add(light->color());
+        hasher.add(light->intensity());
+        hasher.add(light->radius());
+    }
+
+    hasher.add(path_integrator->max_ray_bounces());
+    hasher.add(path_integrator->max_samples());
+    hasher.add(path_integrator->is_tiled());
+    hasher.add(path_integrator->shadow_ray_bias());
+    hasher.add(path_integrator->sampler_type());
+    hasher.add(path_integrator->integrator_mode());
+
+    return hasher.value;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool write(const std::string& path, const CheckpointHeader& header, const float* rgba)
+{
+    return utility::write_file_atomic(path, [&header, rgba](const std::string& temp_path) {
+        FILE* f = fopen(temp_path.c_str(), "wb");
+
+        if (!f)
+            return false;
+
+        bool success = fwrite(&header, sizeof(CheckpointHeader), 1, f) == 1;
+
+        // Alpha is always 1.0 in the accumulation buffer, so only RGB is stored.
+        const size_t       row_pixels = header.width;
+        std::vector<float> row(row_pixels * 3);
+
+        for (size_t y = 0; y < header.height && success; y++)
+        {
+            const float* src = rgba + y * row_pixels * 4;
+
+            for (size_t x = 0; x < row_pixels; x++)
+            {
+                row[x * 3 + 0] = src[x * 4 + 0];
+                row[x * 3 + 1] = src[x * 4 + 1];
+                row[x * 3 + 2] = src[x * 4 + 2];
+            }
+
+            success = fwrite(row.data(), sizeof(float) * 3, row_pixels, f) == row_pixels;
+        }
+
+        return (fclose(f) == 0) && success;
+    });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool read(const std::string& path, CheckpointHeader& header, std::vector<float>& rgba)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+
+    if (!f)
+    {
+        HELIOS_LOG_ERROR("Failed to open checkpoint: " + path);
+        return false;
+    }
+
+    if (fread(&header, sizeof(CheckpointHeader), 1, f) != 1 || header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_VERSION)
+    {
+        HELIOS_LOG_ERROR("Invalid checkpoint: " + path);
+        fclose(f);
+        return false;
+    }
+
+    const size_t       num_pixels = size_t(header.width) * size_t(header.height);
+    std::vector<float> rgb(num_pixels * 3);
+
+    if (fread(rgb.data(), sizeof(float) * 3, num_pixels, f) != num_pixels)
+    {
+        HELIOS_LOG_ERROR("Truncated checkpoint: " + path);
+        fclose(f);
+        return false;
+    }
+
+    fclose(f);
+
+    rgba.resize(num_pixels * 4);
+
+    for (size_t i = 0; i < num_pixels; i++)
+    {
+        rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = 1.0f;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<uint32_t> sample_counts(const CheckpointHeader& header)
+{
+    const JobSplitMode split_mode = (JobSplitMode)header.split_mode;
+
+    std::vector<uint32_t>   counts(size_t(header.width) * size_t(header.height), 0);
+    std::vector<glm::uvec2> tile_coords = PathIntegrator::generate_tile_coords(header.width, header.height, header.tiled, split_mode, header.job_index, header.job_count);
+    glm::uvec2              tile_size   = PathIntegrator::tile_size(header.width, header.height, header.tiled);
+
+    // Tiles before the current one are complete, the current one is partially done and the rest have not been started.
+    for (uint32_t tile_idx = 0; tile_idx < tile_coords.size() && tile_idx <= header.tile_idx; tile_idx++)
+    {
+        const uint32_t   count = tile_idx < header.tile_idx ? header.job_samples : header.num_accumulated_samples;
+        const glm::uvec2 start = tile_coords[tile_idx];
+        const glm::uvec2 end   = glm::min(start + tile_size, glm::uvec2(header.width, header.height));
+
+        for (uint32_t y = start.y; y < end.y; y++)
+        {
+            for (uint32_t x = start.x; x < end.x; x++)
+                counts[size_t(y) * header.width + x] = count;
+        }
+    }
+
+    return counts;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace checkpoint
+} // namespace helios
@@ -0,0 +1,243 @@
+#include <gfx/image_readback.h>
+#include <utility/macros.h>
+#include <utility/logger.h>
+#include <vk_mem_alloc.h>
+
+namespace helios
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ImageReadback::ImageReadback(vk::Backend::Ptr backend) :
+    m_backend(backend)
+{
+    m_thread = std::thread(&ImageReadback::worker, this);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ImageReadback::~ImageReadback()
+{
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+
+    m_ready_cv.notify_all();
+    m_thread.join();
+
+    for (int i = 0; i < IMAGE_READBACK_RING_SIZE; i++)
+        m_slots[i].buffer.reset();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ImageReadback::request(vk::CommandBuffer::Ptr cmd_buf, vk::Image::Ptr image, VkImageLayout layout, uint32_t bytes_per_pixel, ImageReadbackCallback callback)
+{
+    auto backend = m_backend.lock();
+
+    int32_t slot_idx = -1;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (int i = 0; i < IMAGE_READBACK_RING_SIZE; i++)
+        {
+            if (m_slots[i].state == SLOT_STATE_FREE)
+            {
+                slot_idx = i;
+                break;
+            }
+        }
+    }
+
+    if (slot_idx == -1)
+        return false;
+
+    Slot&        slot = m_slots[slot_idx];
+    const size_t size = size_t(image->width()) * size_t(image->height()) * bytes_per_pixel;
+
+    // Free slots are never touched by the GPU or the worker thread so the buffer can be replaced directly.
+    if (!slot.buffer || slot.buffer->size() < size)
+        slot.buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT, size, VMA_MEMORY_USAGE_GPU_TO_CPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+    VkImageSubresourceRange subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    vk::utilities::set_image_layout(
+        cmd_buf->handle(),
+        image->handle(),
+        layout,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        subresource_range);
+
+    VkBufferImageCopy copy_region;
+    HELIOS_ZERO_MEMORY(copy_region);
+
+    copy_region.bufferOffset                    = 0;
+    copy_region.bufferRowLength                 = 0;
+    copy_region.bufferImageHeight               = 0;
+    copy_region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    copy_region.imageSubresource.mipLevel       = 0;
+    copy_region.imageSubresource.baseArrayLayer = 0;
+    copy_region.imageSubresource.layerCount     = 1;
+    copy_region.imageExtent.width               = image->width();
+    copy_region.imageExtent.height              = image->height();
+    copy_region.imageExtent.depth               = 1;
+
+    vkCmdCopyImageToBuffer(cmd_buf->handle(), image->handle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer->handle(), 1, &copy_region);
+
+    vk::utilities::set_image_layout(
+        cmd_buf->handle(),
+        image->handle(),
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        layout,
+        subresource_range);
+
+    // Make the copied data available to the host once the frame fence signals
+    VkBufferMemoryBarrier buffer_barrier;
+    HELIOS_ZERO_MEMORY(buffer_barrier);
+
+    buffer_barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    buffer_barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    buffer_barrier.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+    buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.buffer              = slot.buffer->handle();
+    buffer_barrier.offset              = 0;
+    buffer_barrier.size                = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    slot.state        = SLOT_STATE_COPY_PENDING;
+    slot.frame_idx    = backend->current_frame_idx();
+    slot.frame_number = m_frame_number;
+    slot.width        = image->width();
+    slot.height       = image->height();
+    slot.size         = size;
+    slot.callback     = callback;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ImageReadback::update()
+{
+    auto backend = m_backend.lock();
+
+    bool ready = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_frame_number++;
+
+        for (int i = 0; i < IMAGE_READBACK_RING_SIZE; i++)
+        {
+            Slot& slot = m_slots[i];
+
+            // The in-flight fence of a frame is only meaningful once the frame that recorded the copy has been submitted.
+            if (slot.state == SLOT_STATE_COPY_PENDING && slot.frame_number < m_frame_number && backend->is_frame_done(slot.frame_idx))
+            {
+                slot.state = SLOT_STATE_PROCESSING;
+                m_ready_slots.push_back(i);
+                ready = true;
+            }
+        }
+    }
+
+    if (ready)
+        m_ready_cv.notify_one();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ImageReadback::flush()
+{
+    auto backend = m_backend.lock();
+
+    backend->wait_idle();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for (int i = 0; i < IMAGE_READBACK_RING_SIZE; i++)
+    {
+        if (m_slots[i].state == SLOT_STATE_COPY_PENDING)
+        {
+            m_slots[i].state = SLOT_STATE_PROCESSING;
+            m_ready_slots.push_back(i);
+        }
+    }
+
+    m_ready_cv.notify_one();
+
+    m_free_cv.wait(lock, [this]() {
+        for (int i = 0; i < IMAGE_READBACK_RING_SIZE; i++)
+        {
+            if (m_slots[i].state != SLOT_STATE_FREE)
+                return false;
+        }
+
+        return true;
+    });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ImageReadback::has_free_slot()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (int i = 0; i < IMAGE_READBACK_RING_SIZE; i++)
+    {
+        if (m_slots[i].state == SLOT_STATE_FREE)
+            return true;
+    }
+
+    return false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ImageReadback::worker()
+{
+    while (true)
+    {
+        uint32_t slot_idx;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            m_ready_cv.wait(lock, [this]() { return m_quit || !m_ready_slots.empty(); });
+
+            if (m_ready_slots.empty())
+                return;
+
+            slot_idx = m_ready_slots.front();
+            m_ready_slots.pop_front();
+        }
+
+        // The slot is owned by this thread until it is marked as free again.
+        Slot& slot = m_slots[slot_idx];
+
+        slot.buffer->invalidate_mapped_data();
+
+        if (slot.callback)
+            slot.callback(slot.buffer->mapped_ptr(), slot.size, slot.width, slot.height);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            slot.state    = SLOT_STATE_FREE;
+            slot.callback = nullptr;
+        }
+
+        m_free_cv.notify_all();
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace helios
@@ -0,0 +1,532 @@
+#include <gfx/lightmap_bake.h>
+#include <resource/mesh.h>
+#include <utility/macros.h>
+#include <utility/logger.h>
+#include <utility/utility.h>
+#include <vk_mem_alloc.h>
+#include <stb_image_write.h>
+#include <gtc/matrix_inverse.hpp>
+#include <algorithm>
+#include <thread>
+#include <float.h>
+#include <string.h>
+#include <stdio.h>
+
+namespace helios
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Keep in sync with LightmapBuffer in lightmap_bake_rgen.glsl
+struct LightmapBufferHeader
+{
+    glm::uvec4 counts; // x: width, y: height, z: samples per launch, w: minimum samples per texel
+    glm::vec4  params; // x: convergence threshold
+};
+
+// Keep in sync with LightmapTexel in lightmap_bake_rgen.glsl
+struct LightmapTexelData
+{
+    glm::vec4 mean;    // xyz: mean irradiance, w: sample count
+    glm::vec4 moments; // x: mean luminance, y: sum of squared differences from the mean luminance, z: converged flag
+};
+
+struct LightmapTriangle
+{
+    glm::vec2 uv[3]; // In texels
+    glm::vec3 position[3];
+    glm::vec3 normal[3];
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void read_back_buffer(vk::Backend::Ptr backend, vk::Buffer::Ptr buffer, size_t size, std::vector<uint8_t>& data)
+{
+    vk::Buffer::Ptr staging = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT, size, VMA_MEMORY_USAGE_GPU_TO_CPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+    vk::CommandBuffer::Ptr cmd_buf = backend->allocate_graphics_command_buffer(true);
+
+    VkBufferCopy copy_region;
+    HELIOS_ZERO_MEMORY(copy_region);
+
+    copy_region.size = size;
+
+    vkCmdCopyBuffer(cmd_buf->handle(), buffer->handle(), staging->handle(), 1, &copy_region);
+
+    vkEndCommandBuffer(cmd_buf->handle());
+
+    backend->flush_graphics({ cmd_buf });
+
+    staging->invalidate_mapped_data();
+
+    data.resize(size);
+    memcpy(data.data(), staging->mapped_ptr(), size);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float edge_function(const glm::vec2& a, const glm::vec2& b, const glm::vec2& p)
+{
+    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static glm::vec2 closest_point_on_segment(const glm::vec2& a, const glm::vec2& b, const glm::vec2& p)
+{
+    const glm::vec2 ab     = b - a;
+    const float     length = glm::dot(ab, ab);
+
+    if (length == 0.0f)
+        return a;
+
+    return a + ab * glm::clamp(glm::dot(p - a, ab) / length, 0.0f, 1.0f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Writes every texel of the rows [first_row, last_row) that overlaps a triangle. A texel whose center lies inside a triangle takes
+// that triangle, other texels take the closest point of the closest overlapping triangle so that the charts extend to the edges of
+// their texels.
+static void rasterize_rows(const std::vector<LightmapTriangle>& triangles, uint32_t width, uint32_t first_row, uint32_t last_row, float normal_offset, std::vector<float>& distances, std::vector<glm::vec4>& texels)
+{
+    for (const auto& tri : triangles)
+    {
+        const float area = edge_function(tri.uv[0], tri.uv[1], tri.uv[2]);
+
+        if (fabsf(area) < 1e-12f)
+            continue;
+
+        // Makes the edge functions positive inside the triangle regardless of its winding in UV space
+        const float orientation = area > 0.0f ? 1.0f : -1.0f;
+
+        const glm::vec2 min_uv = glm::min(tri.uv[0], glm::min(tri.uv[1], tri.uv[2]));
+        const glm::vec2 max_uv = glm::max(tri.uv[0], glm::max(tri.uv[1], tri.uv[2]));
+
+        const int32_t min_x = std::max(int32_t(floorf(min_uv.x)), 0);
+        const int32_t max_x = std::min(int32_t(ceilf(max_uv.x)), int32_t(width));
+        const int32_t min_y = std::max(int32_t(floorf(min_uv.y)), int32_t(first_row));
+        const int32_t max_y = std::min(int32_t(ceilf(max_uv.y)), int32_t(last_row));
+
+        for (int32_t y = min_y; y < max_y; y++)
+        {
+            for (int32_t x = min_x; x < max_x; x++)
+            {
+                const glm::vec2 center = glm::vec2(float(x) + 0.5f, float(y) + 0.5f);
+
+                bool  overlaps = true;
+                bool  inside   = true;
+                float e[3];
+
+                for (int i = 0; i < 3; i++)
+                {
+                    const glm::vec2& a = tri.uv[i];
+                    const glm::vec2& b = tri.uv[(i + 1) % 3];
+
+                    e[i] = orientation * edge_function(a, b, center);
+
+                    // The largest value of the edge function over the texel, found at the corner furthest along its gradient
+                    const float extent = 0.5f * (fabsf(b.y - a.y) + fabsf(b.x - a.x));
+
+                    if (e[i] + extent < 0.0f)
+                    {
+                        overlaps = false;
+                        break;
+                    }
+
+                    inside = inside && e[i] >= 0.0f;
+                }
+
+                if (!overlaps)
+                    continue;
+
+                glm::vec2 p        = center;
+                float     distance = 0.0f;
+
+                if (!inside)
+                {
+                    distance = FLT_MAX;
+
+                    for (int i = 0; i < 3; i++)
+                    {
+                        const glm::vec2 q = closest_point_on_segment(tri.uv[i], tri.uv[(i + 1) % 3], center);
+                        const float     d = glm::length(q - center);
+
+                        if (d < distance)
+                        {
+                            distance = d;
+                            p        = q;
+                        }
+                    }
+                }
+
+                const uint32_t idx = y * width + x;
+
+                if (distance >= distances[idx])
+                    continue;
+
+                distances[idx] = distance;
+
+                const float b1 = edge_function(tri.uv[2], tri.uv[0], p) / area;
+                const float b2 = edge_function(tri.uv[0], tri.uv[1], p) / area;
+                const float b0 = 1.0f - b1 - b2;
+
+                const glm::vec3 position = tri.position[0] * b0 + tri.position[1] * b1 + tri.position[2] * b2;
+                glm::vec3       normal   = tri.normal[0] * b0 + tri.normal[1] * b1 + tri.normal[2] * b2;
+
+                if (glm::dot(normal, normal) == 0.0f)
+                    normal = glm::cross(tri.position[1] - tri.position[0], tri.position[2] - tri.position[0]);
+
+                normal = glm::normalize(normal);
+
+                texels[2 * idx]     = glm::vec4(position + normal * normal_offset, 1.0f);
+                texels[2 * idx + 1] = glm::vec4(normal, 0.0f);
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+LightmapBake::LightmapBake(vk::Backend::Ptr backend, vk::DescriptorSetLayout::Ptr lightmap_ds_layout, MeshNode::Ptr node, const LightmapBakeSettings& settings) :
+    m_backend(backend), m_settings(settings)
+{
+    if (m_settings.width == 0 || m_settings.height == 0 || m_settings.samples_per_launch == 0)
+    {
+        HELIOS_LOG_FATAL("A lightmap bake needs a non-empty atlas and at least one sample per launch");
+        throw std::runtime_error("A lightmap bake needs a non-empty atlas and at least one sample per launch");
+    }
+
+    if (!node->mesh())
+    {
+        HELIOS_LOG_FATAL("A lightmap bake needs a mesh");
+        throw std::runtime_error("A lightmap bake needs a mesh");
+    }
+
+    const uint32_t n = m_settings.width * m_settings.height;
+
+    std::vector<glm::vec4> texels(2 * n, glm::vec4(0.0f));
+
+    rasterize(node, texels);
+
+    m_coverage.resize(n);
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        m_coverage[i] = texels[2 * i].w != 0.0f;
+
+        if (m_coverage[i])
+            m_num_texels++;
+    }
+
+    if (m_num_texels == 0)
+        HELIOS_LOG_ERROR("The lightmap UVs of " + node->name() + " do not cover any texel");
+
+    std::vector<uint8_t> gbuffer_data(sizeof(LightmapBufferHeader) + sizeof(glm::vec4) * texels.size());
+
+    LightmapBufferHeader* header = (LightmapBufferHeader*)gbuffer_data.data();
+
+    header->counts = glm::uvec4(m_settings.width, m_settings.height, m_settings.samples_per_launch, m_settings.min_samples);
+    header->params = glm::vec4(m_settings.convergence_threshold, 0.0f, 0.0f, 0.0f);
+
+    memcpy(gbuffer_data.data() + sizeof(LightmapBufferHeader), texels.data(), sizeof(glm::vec4) * texels.size());
+
+    // Written once, so the upload can go through a staging buffer
+    m_gbuffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, gbuffer_data.size(), VMA_MEMORY_USAGE_GPU_ONLY, 0, gbuffer_data.data());
+    m_gbuffer->set_name("Lightmap Bake G-Buffer");
+
+    m_texel_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(LightmapTexelData) * n, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    m_texel_buffer->set_name("Lightmap Bake Texels");
+
+    // Number of converged texels
+    m_state_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(uint32_t), VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    m_state_buffer->set_name("Lightmap Bake State");
+
+    for (uint32_t i = 0; i < vk::Backend::kMaxFramesInFlight; i++)
+    {
+        m_state_readback[i] = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(uint32_t), VMA_MEMORY_USAGE_GPU_TO_CPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+        m_state_pending[i]  = false;
+        m_state_bake_id[i]  = 0;
+    }
+
+    m_lightmap_ds = backend->allocate_descriptor_set(lightmap_ds_layout);
+
+    vk::Buffer::Ptr buffers[] = { m_gbuffer, m_texel_buffer, m_state_buffer };
+
+    VkDescriptorBufferInfo buffer_infos[3];
+    VkWriteDescriptorSet   write_datas[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        HELIOS_ZERO_MEMORY(buffer_infos[i]);
+
+        buffer_infos[i].buffer = buffers[i]->handle();
+        buffer_infos[i].offset = 0;
+        buffer_infos[i].range  = VK_WHOLE_SIZE;
+
+        HELIOS_ZERO_MEMORY(write_datas[i]);
+
+        write_datas[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write_datas[i].descriptorCount = 1;
+        write_datas[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write_datas[i].pBufferInfo     = &buffer_infos[i];
+        write_datas[i].dstBinding      = i;
+        write_datas[i].dstSet          = m_lightmap_ds->handle();
+    }
+
+    vkUpdateDescriptorSets(backend->device(), 3, &write_datas[0], 0, nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+LightmapBake::~LightmapBake()
+{
+    auto backend = m_backend.lock();
+
+    // The bake may be released while its last launches are still in flight
+    if (backend)
+    {
+        for (uint32_t i = 0; i < vk::Backend::kMaxFramesInFlight; i++)
+            backend->queue_object_deletion(m_state_readback[i]);
+
+        backend->queue_object_deletion(m_lightmap_ds);
+        backend->queue_object_deletion(m_state_buffer);
+        backend->queue_object_deletion(m_texel_buffer);
+        backend->queue_object_deletion(m_gbuffer);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void LightmapBake::restart()
+{
+    m_num_launches         = 0;
+    m_num_converged_texels = 0;
+    m_needs_clear          = true;
+    m_bake_id++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool LightmapBake::save(const std::string& path)
+{
+    auto backend = m_backend.lock();
+
+    backend->wait_idle();
+
+    const uint32_t width  = m_settings.width;
+    const uint32_t height = m_settings.height;
+    const uint32_t n      = width * height;
+
+    std::vector<uint8_t> texel_data;
+
+    read_back_buffer(backend, m_texel_buffer, sizeof(LightmapTexelData) * n, texel_data);
+
+    const LightmapTexelData* texels = (const LightmapTexelData*)texel_data.data();
+
+    std::vector<glm::vec3> pixels(n, glm::vec3(0.0f));
+    std::vector<bool>      valid = m_coverage;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (valid[i])
+            pixels[i] = glm::vec3(texels[i].mean);
+    }
+
+    // Bilinear filtering and mip mapping read texels outside of the charts, so every ring around them takes the average of its
+    // neighbours from the previous ring.
+    for (uint32_t iteration = 0; iteration < m_settings.dilation_iterations; iteration++)
+    {
+        std::vector<bool> dilated = valid;
+
+        for (int32_t y = 0; y < int32_t(height); y++)
+        {
+            for (int32_t x = 0; x < int32_t(width); x++)
+            {
+                const uint32_t idx = y * width + x;
+
+                if (valid[idx])
+                    continue;
+
+                glm::vec3 sum   = glm::vec3(0.0f);
+                uint32_t  count = 0;
+
+                for (int32_t dy = -1; dy <= 1; dy++)
+                {
+                    for (int32_t dx = -1; dx <= 1; dx++)
+                    {
+                        const int32_t nx = x + dx;
+                        const int32_t ny = y + dy;
+
+                        if (nx < 0 || ny < 0 || nx >= int32_t(width) || ny >= int32_t(height) || !valid[ny * width + nx])
+                            continue;
+
+                        sum += pixels[ny * width + nx];
+                        count++;
+                    }
+                }
+
+                if (count > 0)
+                {
+                    pixels[idx]  = sum / float(count);
+                    dilated[idx] = true;
+                }
+            }
+        }
+
+        valid = dilated;
+    }
+
+    return utility::write_file_atomic(path, [width, height, &pixels](const std::string& temp_path) {
+        return stbi_write_hdr(temp_path.c_str(), width, height, 3, &pixels[0].x) != 0;
+    });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void LightmapBake::rasterize(MeshNode::Ptr node, std::vector<glm::vec4>& texels)
+{
+    auto backend = m_backend.lock();
+    auto mesh    = node->mesh();
+
+    const auto& submeshes = mesh->sub_meshes();
+
+    // The geometry only lives on the GPU
+    std::vector<uint8_t> vertex_data;
+    std::vector<uint8_t> index_data;
+
+    read_back_buffer(backend, mesh->vertex_buffer(), mesh->vertex_buffer()->size(), vertex_data);
+    read_back_buffer(backend, mesh->index_buffer(), mesh->index_buffer()->size(), index_data);
+
+    const Vertex*   vertices = (const Vertex*)vertex_data.data();
+    const uint32_t* indices  = (const uint32_t*)index_data.data();
+
+    const glm::mat4 model_mat  = node->global_transform();
+    const glm::mat3 normal_mat = glm::inverseTranspose(glm::mat3(model_mat));
+    const glm::vec2 size       = glm::vec2(float(m_settings.width), float(m_settings.height));
+
+    std::vector<LightmapTriangle> triangles;
+
+    for (const auto& submesh : submeshes)
+    {
+        for (uint32_t i = 0; i < submesh.index_count; i += 3)
+        {
+            LightmapTriangle tri;
+
+            // Indices address the whole vertex buffer, like they do in the hit shaders
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                const Vertex& v = vertices[indices[submesh.base_index + i + j]];
+
+                tri.uv[j]       = glm::vec2(v.tex_coord.z, v.tex_coord.w) * size;
+                tri.position[j] = glm::vec3(model_mat * glm::vec4(glm::vec3(v.position), 1.0f));
+                tri.normal[j]   = normal_mat * glm::vec3(v.normal);
+            }
+
+            triangles.push_back(tri);
+        }
+    }
+
+    // Every thread owns a band of rows, so no texel is written by more than one of them
+    const uint32_t num_threads   = std::max(1u, std::min(std::thread::hardware_concurrency(), m_settings.height));
+    const uint32_t rows_per_band = (m_settings.height + num_threads - 1) / num_threads;
+
+    std::vector<float>       distances(m_settings.width * m_settings.height, FLT_MAX);
+    std::vector<std::thread> threads;
+
+    for (uint32_t i = 0; i < num_threads; i++)
+    {
+        const uint32_t first_row = i * rows_per_band;
+        const uint32_t last_row  = std::min(first_row + rows_per_band, m_settings.height);
+
+        threads.push_back(std::thread(rasterize_rows, std::cref(triangles), m_settings.width, first_row, last_row, m_settings.normal_offset, std::ref(distances), std::ref(texels)));
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void LightmapBake::begin_launch(vk::CommandBuffer::Ptr cmd_buf, uint32_t frame_idx)
+{
+    // The backend has already waited on the fence of this frame, so the count copied the last time it was used is available.
+    resolve_converged_texels(frame_idx);
+
+    if (m_needs_clear)
+    {
+        // Keep the previous launch and the copies of the converged count ahead of the clear
+        VkMemoryBarrier memory_barrier;
+        memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memory_barrier.pNext         = nullptr;
+        memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+        // Zero sample counts and zero flags mean that every texel starts over
+        vkCmdFillBuffer(cmd_buf->handle(), m_texel_buffer->handle(), 0, VK_WHOLE_SIZE, 0);
+        vkCmdFillBuffer(cmd_buf->handle(), m_state_buffer->handle(), 0, VK_WHOLE_SIZE, 0);
+
+        m_needs_clear = false;
+    }
+
+    VkMemoryBarrier memory_barrier;
+    memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.pNext         = nullptr;
+    memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void LightmapBake::end_launch(vk::CommandBuffer::Ptr cmd_buf, uint32_t frame_idx)
+{
+    VkMemoryBarrier memory_barrier;
+    memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.pNext         = nullptr;
+    memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy copy_region;
+    HELIOS_ZERO_MEMORY(copy_region);
+
+    copy_region.size = sizeof(uint32_t);
+
+    vkCmdCopyBuffer(cmd_buf->handle(), m_state_buffer->handle(), m_state_readback[frame_idx]->handle(), 1, &copy_region);
+
+    // Make the copied count available to the host once the frame fence signals
+    memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+    m_state_pending[frame_idx] = true;
+    m_state_bake_id[frame_idx] = m_bake_id;
+
+    m_num_launches++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void LightmapBake::resolve_converged_texels(uint32_t frame_idx)
+{
+    if (!m_state_pending[frame_idx])
+        return;
+
+    m_state_pending[frame_idx] = false;
+
+    // Launches recorded before the bake was restarted belong to the previous one.
+    if (m_state_bake_id[frame_idx] != m_bake_id)
+        return;
+
+    m_state_readback[frame_idx]->invalidate_mapped_data();
+
+    m_num_converged_texels = std::max(m_num_converged_texels, *(const uint32_t*)m_state_readback[frame_idx]->mapped_ptr());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace helios
@@ -1,10 +1,14 @@
 #include <gfx/path_integrator.h>
 #include <utility/profiler.h>
+#include <utility/logger.h>
+#include <utility/macros.h>
 #include <vk_mem_alloc.h>
 
 namespace helios
 {
 #define TILE_SIZE 128
+#define MAX_RAY_PAYLOAD_SIZE (64 + sizeof(glm::vec3) * (MAX_LIGHT_GROUPS - 1)) // Room for the radiance of every light group
+#define MAX_HIT_ATTRIBUTE_SIZE sizeof(glm::vec2)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
@@ -21,17 +25,43 @@ struct PushConstants
     uint32_t   num_lights;
     uint32_t   num_frames;
     uint32_t   debug_vis;
-    uint32_t   max_ray_bounces;
     float      shadow_ray_bias;
     float      focal_length;
     float      aperture_radius;
+    uint32_t   sample_offset;
+    uint32_t   environment_light_group;
+    uint32_t   light_group_samples; // Samples in the light group layers, which may have been restarted after num_frames
 };
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-PathIntegrator::PathIntegrator(vk::Backend::Ptr backend) :
-    m_backend(backend)
+PathIntegrator::PathIntegrator(vk::Backend::Ptr backend, ShaderCache::Ptr shader_cache) :
+    m_backend(backend), m_shader_cache(shader_cache)
 {
+    vk::DescriptorSetLayout::Desc ds_layout_desc;
+
+    ds_layout_desc.add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+
+    m_view_ds_layout = vk::DescriptorSetLayout::create(backend, ds_layout_desc);
+    m_view_ds_layout->set_name("View Descriptor Set Layout");
+
+    vk::DescriptorSetLayout::Desc probe_ds_layout_desc;
+
+    for (uint32_t i = 0; i < 4; i++)
+        probe_ds_layout_desc.add_binding(i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+
+    m_probe_ds_layout = vk::DescriptorSetLayout::create(backend, probe_ds_layout_desc);
+    m_probe_ds_layout->set_name("Probe Bake Descriptor Set Layout");
+
+    vk::DescriptorSetLayout::Desc lightmap_ds_layout_desc;
+
+    for (uint32_t i = 0; i < 3; i++)
+        lightmap_ds_layout_desc.add_binding(i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+
+    m_lightmap_ds_layout = vk::DescriptorSetLayout::create(backend, lightmap_ds_layout_desc);
+    m_lightmap_ds_layout->set_name("Lightmap Bake Descriptor Set Layout");
+
+    create_ray_statistics_resources();
     create_pipeline();
     create_ray_debug_pipeline();
     compute_tile_coords();
@@ -50,17 +80,22 @@ void PathIntegrator::render(RenderState& render_state)
     HELIOS_SCOPED_SAMPLE("Path Trace");
 
     if (render_state.scene_state() != SCENE_STATE_READY)
-    {
-        m_tile_idx                = 0;
-        m_num_accumulated_samples = 0;
-    }
+        restart_bake();
 
-    if (m_tile_idx < m_tile_coords.size())
-    {
-        auto backend = m_backend.lock();
+    auto backend = m_backend.lock();
+
+    // The backend has already waited on the fence of this frame, so the counters copied the last time it was used are available.
+    resolve_ray_statistics(backend->current_frame_idx());
+
+    update_pipelines();
 
+    if (!is_complete())
+    {
         auto extents = backend->swap_chain_extents();
 
+        if (m_ray_statistics_enabled)
+            begin_ray_statistics(render_state.cmd_buffer());
+
         launch_rays(render_state,
                     m_path_trace_pipeline,
                     m_path_trace_pipeline_layout,
@@ -73,12 +108,17 @@ void PathIntegrator::render(RenderState& render_state)
                     m_tile_coords[m_tile_idx],
                     glm::ivec2(0));
 
+        if (m_ray_statistics_enabled)
+            end_ray_statistics(render_state.cmd_buffer());
+
         m_num_accumulated_samples++;
+        m_num_light_group_samples++;
     }
 
-    if (m_num_accumulated_samples == m_max_samples)
+    if (m_num_accumulated_samples > 0 && m_num_accumulated_samples == job_samples())
     {
         m_num_accumulated_samples = 0;
+        m_num_light_group_samples = 0;
         m_tile_idx++;
     }
 }
@@ -87,6 +127,8 @@ void PathIntegrator::render(RenderState& render_state)
 
 void PathIntegrator::gather_debug_rays(const glm::ivec2& pixel_coord, const uint32_t& num_debug_rays, const glm::mat4& view, const glm::mat4& projection, RenderState& render_state)
 {
+    update_pipelines();
+
     auto backend = m_backend.lock();
 
     auto extents = backend->swap_chain_extents();
@@ -106,6 +148,199 @@ void PathIntegrator::gather_debug_rays(const glm::ivec2& pixel_coord, const uint
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void PathIntegrator::render_views(RenderState& render_state, ViewSet::Ptr view_set)
+{
+    HELIOS_SCOPED_SAMPLE("Path Trace Views");
+
+    if (render_state.scene_state() != SCENE_STATE_READY)
+        view_set->restart();
+
+    update_pipelines();
+
+    // The multi-view ray generation shader is only compiled once it is needed
+    if (!m_multi_view_pipeline)
+    {
+        create_multi_view_ray_gen_library();
+        link_multi_view_pipeline();
+    }
+
+    auto cmd_buf = render_state.cmd_buffer();
+
+    view_set->begin_launch(cmd_buf);
+
+    vkCmdBindPipeline(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_multi_view_pipeline->handle());
+
+    int32_t push_constant_stages = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR;
+
+    // The camera is taken from the view buffer
+    PushConstants push_constants;
+    HELIOS_ZERO_MEMORY(push_constants);
+
+    push_constants.launch_id_size          = glm::uvec4(0, 0, view_set->width(), view_set->height());
+    push_constants.num_lights              = render_state.num_lights();
+    push_constants.num_frames              = view_set->num_accumulated_samples();
+    push_constants.accumulation            = float(push_constants.num_frames) / float(push_constants.num_frames + 1);
+    push_constants.shadow_ray_bias         = m_shadow_ray_bias;
+    push_constants.sample_offset           = 0;
+    push_constants.environment_light_group = render_state.environment_light_group();
+
+    vkCmdPushConstants(cmd_buf->handle(), m_path_trace_pipeline_layout->handle(), push_constant_stages, 0, sizeof(PushConstants), &push_constants);
+
+    const uint32_t write_index = (uint32_t)view_set->m_ping_pong;
+    const uint32_t read_index  = (uint32_t)!view_set->m_ping_pong;
+
+    VkDescriptorSet descriptor_sets[] = {
+        render_state.scene_descriptor_set()->handle(),
+        render_state.vbo_descriptor_set()->handle(),
+        render_state.ibo_descriptor_set()->handle(),
+        render_state.material_indices_descriptor_set()->handle(),
+        render_state.texture_descriptor_set()->handle(),
+        view_set->m_output_storage_image_ds[read_index]->handle(),
+        view_set->m_output_storage_image_ds[write_index]->handle(),
+        m_ray_statistics_ds->handle()
+    };
+
+    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_path_trace_pipeline_layout->handle(), 0, 8, descriptor_sets, 0, nullptr);
+    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_path_trace_pipeline_layout->handle(), 9, 1, &view_set->m_view_ds->handle(), 0, nullptr);
+
+    trace_rays(cmd_buf, m_multi_view_pipeline, m_multi_view_sbt, view_set->width(), view_set->height(), view_set->num_views());
+
+    view_set->end_launch(cmd_buf);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ViewSet::Ptr PathIntegrator::create_view_set(uint32_t width, uint32_t height, const std::vector<View>& views)
+{
+    return std::shared_ptr<ViewSet>(new ViewSet(m_backend.lock(), m_view_ds_layout, width, height, views));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::render_probes(RenderState& render_state, ProbeBake::Ptr probe_bake)
+{
+    HELIOS_SCOPED_SAMPLE("Bake Probes");
+
+    if (render_state.scene_state() != SCENE_STATE_READY)
+        probe_bake->restart();
+
+    update_pipelines();
+
+    // The probe ray generation shader is only compiled once it is needed
+    if (!m_probe_bake_pipeline)
+    {
+        create_probe_bake_ray_gen_library();
+        link_probe_bake_pipeline();
+    }
+
+    auto backend = m_backend.lock();
+    auto cmd_buf = render_state.cmd_buffer();
+
+    probe_bake->begin_launch(cmd_buf, backend->current_frame_idx());
+
+    vkCmdBindPipeline(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_probe_bake_pipeline->handle());
+
+    int32_t push_constant_stages = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR;
+
+    // The probes replace the camera
+    PushConstants push_constants;
+    HELIOS_ZERO_MEMORY(push_constants);
+
+    push_constants.num_lights              = render_state.num_lights();
+    push_constants.num_frames              = probe_bake->m_num_launches;
+    push_constants.shadow_ray_bias         = m_shadow_ray_bias;
+    push_constants.environment_light_group = render_state.environment_light_group();
+
+    vkCmdPushConstants(cmd_buf->handle(), m_path_trace_pipeline_layout->handle(), push_constant_stages, 0, sizeof(PushConstants), &push_constants);
+
+    VkDescriptorSet descriptor_sets[] = {
+        render_state.scene_descriptor_set()->handle(),
+        render_state.vbo_descriptor_set()->handle(),
+        render_state.ibo_descriptor_set()->handle(),
+        render_state.material_indices_descriptor_set()->handle(),
+        render_state.texture_descriptor_set()->handle()
+    };
+
+    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_path_trace_pipeline_layout->handle(), 0, 5, descriptor_sets, 0, nullptr);
+    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_path_trace_pipeline_layout->handle(), 7, 1, &m_ray_statistics_ds->handle(), 0, nullptr);
+    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_path_trace_pipeline_layout->handle(), 10, 1, &probe_bake->m_probe_ds[probe_bake->m_ping_pong]->handle(), 0, nullptr);
+
+    trace_rays(cmd_buf, m_probe_bake_pipeline, m_probe_bake_sbt, PROBE_BAKE_LANES, probe_bake->num_probes(), 1);
+
+    probe_bake->end_launch(cmd_buf, backend->current_frame_idx());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ProbeBake::Ptr PathIntegrator::create_probe_bake(ProbeVolumeNode::Ptr node, const ProbeBakeSettings& settings)
+{
+    return std::shared_ptr<ProbeBake>(new ProbeBake(m_backend.lock(), m_probe_ds_layout, node, settings));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::render_lightmap(RenderState& render_state, LightmapBake::Ptr lightmap_bake)
+{
+    HELIOS_SCOPED_SAMPLE("Bake Lightmap");
+
+    if (render_state.scene_state() != SCENE_STATE_READY)
+        lightmap_bake->restart();
+
+    update_pipelines();
+
+    // The lightmap ray generation shader is only compiled once it is needed
+    if (!m_lightmap_bake_pipeline)
+    {
+        create_lightmap_bake_ray_gen_library();
+        link_lightmap_bake_pipeline();
+    }
+
+    auto backend = m_backend.lock();
+    auto cmd_buf = render_state.cmd_buffer();
+
+    lightmap_bake->begin_launch(cmd_buf, backend->current_frame_idx());
+
+    vkCmdBindPipeline(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_lightmap_bake_pipeline->handle());
+
+    int32_t push_constant_stages = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR;
+
+    // The texels replace the camera
+    PushConstants push_constants;
+    HELIOS_ZERO_MEMORY(push_constants);
+
+    push_constants.num_lights              = render_state.num_lights();
+    push_constants.num_frames              = lightmap_bake->m_num_launches;
+    push_constants.shadow_ray_bias         = m_shadow_ray_bias;
+    push_constants.environment_light_group = render_state.environment_light_group();
+
+    vkCmdPushConstants(cmd_buf->handle(), m_path_trace_pipeline_layout->handle(), push_constant_stages, 0, sizeof(PushConstants), &push_constants);
+
+    VkDescriptorSet descriptor_sets[] = {
+        render_state.scene_descriptor_set()->handle(),
+        render_state.vbo_descriptor_set()->handle(),
+        render_state.ibo_descriptor_set()->handle(),
+        render_state.material_indices_descriptor_set()->handle(),
+        render_state.texture_descriptor_set()->handle()
+    };
+
+    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_path_trace_pipeline_layout->handle(), 0, 5, descriptor_sets, 0, nullptr);
+    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_path_trace_pipeline_layout->handle(), 7, 1, &m_ray_statistics_ds->handle(), 0, nullptr);
+    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_path_trace_pipeline_layout->handle(), 11, 1, &lightmap_bake->m_lightmap_ds->handle(), 0, nullptr);
+
+    trace_rays(cmd_buf, m_lightmap_bake_pipeline, m_lightmap_bake_sbt, lightmap_bake->width(), lightmap_bake->height(), 1);
+
+    lightmap_bake->end_launch(cmd_buf, backend->current_frame_idx());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+LightmapBake::Ptr PathIntegrator::create_lightmap_bake(MeshNode::Ptr node, const LightmapBakeSettings& settings)
+{
+    return std::shared_ptr<LightmapBake>(new LightmapBake(m_backend.lock(), m_lightmap_ds_layout, node, settings));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 void PathIntegrator::on_window_resize()
 {
     restart_bake();
@@ -122,12 +357,174 @@ void PathIntegrator::set_tiled(bool tiled)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void PathIntegrator::set_max_ray_bounces(const uint32_t& n)
+{
+    if (m_max_ray_bounces == n)
+        return;
+
+    m_max_ray_bounces = n;
+    m_hit_dirty       = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::set_sampler_type(const SamplerType& type)
+{
+    if (m_sampler_type == type)
+        return;
+
+    m_sampler_type  = type;
+    m_ray_gen_dirty = true;
+    m_hit_dirty     = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::set_integrator_mode(const IntegratorMode& mode)
+{
+    if (m_integrator_mode == mode)
+        return;
+
+    m_integrator_mode = mode;
+    m_hit_dirty       = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::set_visualize_nans(const bool& visualize)
+{
+    if (m_visualize_nans == visualize)
+        return;
+
+    m_visualize_nans = visualize;
+    m_ray_gen_dirty  = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::set_job(JobSplitMode mode, uint32_t job_index, uint32_t job_count)
+{
+    if (job_count == 0 || job_index >= job_count)
+    {
+        HELIOS_LOG_ERROR("Invalid job index " + std::to_string(job_index) + " of " + std::to_string(job_count));
+        return;
+    }
+
+    m_split_mode = mode;
+    m_job_index  = job_index;
+    m_job_count  = job_count;
+
+    // Splitting by tiles only makes sense when the image is rendered in tiles
+    if (m_split_mode == JOB_SPLIT_TILES)
+        m_tiled = true;
+
+    compute_tile_coords();
+    restart_bake();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::set_ray_statistics_enabled(const bool& enabled)
+{
+    if (m_ray_statistics_enabled == enabled)
+        return;
+
+    m_ray_statistics_enabled = enabled;
+    m_ray_gen_dirty          = true;
+    m_hit_dirty              = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::set_light_groups_enabled(const bool& enabled)
+{
+    if (m_light_groups_enabled == enabled)
+        return;
+
+    m_light_groups_enabled = enabled;
+    m_ray_gen_dirty        = true;
+    m_hit_dirty            = true;
+
+    restart_bake();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::flush_ray_statistics()
+{
+    auto backend = m_backend.lock();
+
+    backend->wait_idle();
+
+    for (uint32_t i = 0; i < vk::Backend::kMaxFramesInFlight; i++)
+        resolve_ray_statistics(i);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t PathIntegrator::sample_offset()
+{
+    if (m_split_mode == JOB_SPLIT_SAMPLES)
+        return uint32_t((uint64_t(m_max_samples) * m_job_index) / m_job_count);
+    else
+        return 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t PathIntegrator::job_samples()
+{
+    if (m_split_mode == JOB_SPLIT_SAMPLES)
+        return uint32_t((uint64_t(m_max_samples) * (m_job_index + 1)) / m_job_count) - sample_offset();
+    else
+        return m_max_samples;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<glm::uvec2> PathIntegrator::generate_tile_coords(uint32_t width, uint32_t height, bool tiled, JobSplitMode mode, uint32_t job_index, uint32_t job_count)
+{
+    std::vector<glm::uvec2> tile_coords;
+
+    if (tiled)
+    {
+        glm::uvec2 num_tiles = glm::uvec2(ceilf(float(width) / float(TILE_SIZE)), ceilf(float(height) / float(TILE_SIZE)));
+
+        for (int x = 0; x < num_tiles.x; x++)
+        {
+            for (int y = 0; y < num_tiles.y; y++)
+            {
+                uint32_t idx = x * num_tiles.y + y;
+
+                // Interleave tiles between jobs so that each one gets a similar mix of cheap and expensive regions
+                if (mode != JOB_SPLIT_TILES || idx % job_count == job_index)
+                    tile_coords.push_back(glm::uvec2(x * TILE_SIZE, y * TILE_SIZE));
+            }
+        }
+    }
+    else
+        tile_coords.push_back(glm::uvec2(0, 0));
+
+    return tile_coords;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::uvec2 PathIntegrator::tile_size(uint32_t width, uint32_t height, bool tiled)
+{
+    if (tiled)
+        return glm::uvec2(TILE_SIZE, TILE_SIZE);
+    else
+        return glm::uvec2(width, height);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 void PathIntegrator::launch_rays(RenderState& render_state, vk::RayTracingPipeline::Ptr pipeline, vk::PipelineLayout::Ptr pipeline_layout, vk::ShaderBindingTable::Ptr sbt, const uint32_t& x, const uint32_t& y, const uint32_t& z, const glm::mat4& view, const glm::mat4& projection, const glm::ivec2& tile_coord, const glm::ivec2& pixel_coord)
 {
     auto backend = m_backend.lock();
 
-    auto  extents           = backend->swap_chain_extents();
-    auto& rt_pipeline_props = backend->ray_tracing_pipeline_properties();
+    auto extents = backend->swap_chain_extents();
 
     vkCmdBindPipeline(render_state.cmd_buffer()->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, pipeline->handle());
 
@@ -143,20 +540,22 @@ void PathIntegrator::launch_rays(RenderState& render_state, vk::RayTracingPipeli
 
     PushConstants push_constants;
 
-    push_constants.ray_debug_pixel_coord = glm::ivec4(pixel_coord.x, extents.height - pixel_coord.y, extents.width, extents.height);
-    push_constants.launch_id_size        = glm::ivec4(tile_coord.x, tile_coord.y, extents.width, extents.height);
-    push_constants.camera_pos            = glm::vec4(render_state.camera()->global_position(), 0.0f);
-    push_constants.up_direction          = glm::vec4(up, 0.0f);
-    push_constants.right_direction       = glm::vec4(right, 0.0f);
-    push_constants.focal_plane           = focal_plane;
-    push_constants.view_proj_inverse     = glm::inverse(projection * view);
-    push_constants.num_lights            = render_state.num_lights();
-    push_constants.num_frames            = m_num_accumulated_samples;
-    push_constants.accumulation          = float(push_constants.num_frames) / float(push_constants.num_frames + 1);
-    push_constants.max_ray_bounces       = m_max_ray_bounces;
-    push_constants.shadow_ray_bias       = m_shadow_ray_bias;
-    push_constants.focal_length       = render_state.camera()->focal_length();
-    push_constants.aperture_radius       = render_state.camera()->aperture_radius();
+    push_constants.ray_debug_pixel_coord   = glm::ivec4(pixel_coord.x, extents.height - pixel_coord.y, extents.width, extents.height);
+    push_constants.launch_id_size          = glm::ivec4(tile_coord.x, tile_coord.y, extents.width, extents.height);
+    push_constants.camera_pos              = glm::vec4(render_state.camera()->global_position(), 0.0f);
+    push_constants.up_direction            = glm::vec4(up, 0.0f);
+    push_constants.right_direction         = glm::vec4(right, 0.0f);
+    push_constants.focal_plane             = focal_plane;
+    push_constants.view_proj_inverse       = glm::inverse(projection * view);
+    push_constants.num_lights              = render_state.num_lights();
+    push_constants.num_frames              = m_num_accumulated_samples;
+    push_constants.accumulation            = float(push_constants.num_frames) / float(push_constants.num_frames + 1);
+    push_constants.shadow_ray_bias         = m_shadow_ray_bias;
+    push_constants.focal_length            = render_state.camera()->focal_length();
+    push_constants.aperture_radius         = render_state.camera()->aperture_radius();
+    push_constants.sample_offset           = sample_offset();
+    push_constants.environment_light_group = render_state.environment_light_group();
+    push_constants.light_group_samples     = m_num_light_group_samples;
 
     vkCmdPushConstants(render_state.cmd_buffer()->handle(), pipeline_layout->handle(), push_constant_stages, 0, sizeof(PushConstants), &push_constants);
 
@@ -182,12 +581,28 @@ void PathIntegrator::launch_rays(RenderState& render_state, vk::RayTracingPipeli
             render_state.material_indices_descriptor_set()->handle(),
             render_state.texture_descriptor_set()->handle(),
             render_state.read_image_descriptor_set()->handle(),
-            render_state.write_image_descriptor_set()->handle()
+            render_state.write_image_descriptor_set()->handle(),
+            m_ray_statistics_ds->handle(),
+            render_state.light_group_descriptor_set() ? render_state.light_group_descriptor_set()->handle() : VK_NULL_HANDLE
         };
 
-        vkCmdBindDescriptorSets(render_state.cmd_buffer()->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, pipeline_layout->handle(), 0, 7, descriptor_sets, 0, nullptr);
+        // The light group set is only declared by the shaders when light groups are compiled in
+        const uint32_t num_descriptor_sets = m_light_groups_enabled && render_state.light_group_descriptor_set() ? 9 : 8;
+
+        vkCmdBindDescriptorSets(render_state.cmd_buffer()->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, pipeline_layout->handle(), 0, num_descriptor_sets, descriptor_sets, 0, nullptr);
     }
 
+    trace_rays(render_state.cmd_buffer(), pipeline, sbt, x, y, z);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::trace_rays(vk::CommandBuffer::Ptr cmd_buf, vk::RayTracingPipeline::Ptr pipeline, vk::ShaderBindingTable::Ptr sbt, const uint32_t& x, const uint32_t& y, const uint32_t& z)
+{
+    auto backend = m_backend.lock();
+
+    auto& rt_pipeline_props = backend->ray_tracing_pipeline_properties();
+
     VkDeviceSize group_size   = vk::utilities::aligned_size(rt_pipeline_props.shaderGroupHandleSize, rt_pipeline_props.shaderGroupBaseAlignment);
     VkDeviceSize group_stride = group_size;
 
@@ -196,7 +611,7 @@ void PathIntegrator::launch_rays(RenderState& render_state, vk::RayTracingPipeli
     const VkStridedDeviceAddressRegionKHR hit_sbt      = { pipeline->shader_binding_table_buffer()->device_address() + sbt->hit_group_offset(), group_stride, group_size * 2 };
     const VkStridedDeviceAddressRegionKHR callable_sbt = { VK_NULL_HANDLE, 0, 0 };
 
-    vkCmdTraceRaysKHR(render_state.cmd_buffer()->handle(), &raygen_sbt, &miss_sbt, &hit_sbt, &callable_sbt, x, y, z);
+    vkCmdTraceRaysKHR(cmd_buf->handle(), &raygen_sbt, &miss_sbt, &hit_sbt, &callable_sbt, x, y, z);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -205,32 +620,6 @@ void PathIntegrator::create_pipeline()
 {
     auto backend = m_backend.lock();
 
-    // ---------------------------------------------------------------------------
-    // Create shader modules
-    // ---------------------------------------------------------------------------
-
-    vk::ShaderModule::Ptr rgen             = vk::ShaderModule::create_from_file(backend, "assets/shader/path_trace.rgen.spv");
-    vk::ShaderModule::Ptr rchit            = vk::ShaderModule::create_from_file(backend, "assets/shader/path_trace.rchit.spv");
-    vk::ShaderModule::Ptr rahit            = vk::ShaderModule::create_from_file(backend, "assets/shader/path_trace.rahit.spv");
-    vk::ShaderModule::Ptr rmiss            = vk::ShaderModule::create_from_file(backend, "assets/shader/path_trace.rmiss.spv");
-    vk::ShaderModule::Ptr rchit_visibility = vk::ShaderModule::create_from_file(backend, "assets/shader/path_trace_shadow.rchit.spv");
-    vk::ShaderModule::Ptr rmiss_visibility = vk::ShaderModule::create_from_file(backend, "assets/shader/path_trace_shadow.rmiss.spv");
-
-    vk::ShaderBindingTable::Desc sbt_desc;
-
-    sbt_desc.add_ray_gen_group(rgen, "main");
-    sbt_desc.add_hit_group(rchit, "main", rahit, "main");
-    sbt_desc.add_hit_group(rchit_visibility, "main", rahit, "main");
-    sbt_desc.add_miss_group(rmiss, "main");
-    sbt_desc.add_miss_group(rmiss_visibility, "main");
-
-    m_path_trace_sbt = vk::ShaderBindingTable::create(backend, sbt_desc);
-
-    vk::RayTracingPipeline::Desc desc;
-
-    desc.set_max_pipeline_ray_recursion_depth(8);
-    desc.set_shader_binding_table(m_path_trace_sbt);
-
     // ---------------------------------------------------------------------------
     // Create pipeline layout
     // ---------------------------------------------------------------------------
@@ -246,93 +635,625 @@ void PathIntegrator::create_pipeline()
     pl_desc.add_descriptor_set_layout(backend->combined_sampler_array_descriptor_set_layout());
     pl_desc.add_descriptor_set_layout(backend->image_descriptor_set_layout());
     pl_desc.add_descriptor_set_layout(backend->image_descriptor_set_layout());
+    pl_desc.add_descriptor_set_layout(m_ray_statistics_ds_layout);
+    pl_desc.add_descriptor_set_layout(backend->image_descriptor_set_layout());
+    pl_desc.add_descriptor_set_layout(m_view_ds_layout);
+    pl_desc.add_descriptor_set_layout(m_probe_ds_layout);
+    pl_desc.add_descriptor_set_layout(m_lightmap_ds_layout);
 
     m_path_trace_pipeline_layout = vk::PipelineLayout::create(backend, pl_desc);
 
-    desc.set_pipeline_layout(m_path_trace_pipeline_layout);
+    // ---------------------------------------------------------------------------
+    // Create pipeline libraries
+    // ---------------------------------------------------------------------------
+
+    create_ray_gen_library();
+    create_hit_library();
+
+    // ---------------------------------------------------------------------------
+    // Link pipeline
+    // ---------------------------------------------------------------------------
 
-    m_path_trace_pipeline = vk::RayTracingPipeline::create(backend, desc);
+    link_pipeline();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void PathIntegrator::create_ray_debug_pipeline()
+void PathIntegrator::create_ray_gen_library()
 {
     auto backend = m_backend.lock();
 
-    // ---------------------------------------------------------------------------
-    // Create shader modules
-    // ---------------------------------------------------------------------------
+    backend->queue_object_deletion(m_path_trace_ray_gen_library);
 
-    vk::ShaderModule::Ptr rgen             = vk::ShaderModule::create_from_file(backend, "assets/shader/path_trace_debug.rgen.spv");
-    vk::ShaderModule::Ptr rchit            = vk::ShaderModule::create_from_file(backend, "assets/shader/path_trace_debug.rchit.spv");
-    vk::ShaderModule::Ptr rmiss            = vk::ShaderModule::create_from_file(backend, "assets/shader/path_trace_debug.rmiss.spv");
-    vk::ShaderModule::Ptr rchit_visibility = vk::ShaderModule::create_from_file(backend, "assets/shader/path_trace_shadow.rchit.spv");
-    vk::ShaderModule::Ptr rmiss_visibility = vk::ShaderModule::create_from_file(backend, "assets/shader/path_trace_shadow.rmiss.spv");
+    m_path_trace_ray_gen_library = build_ray_gen_library("path_trace.rgen", ray_gen_defines());
+}
 
-    vk::ShaderBindingTable::Desc sbt_desc;
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-    sbt_desc.add_ray_gen_group(rgen, "main");
-    sbt_desc.add_hit_group(rchit, "main");
-    sbt_desc.add_hit_group(rchit_visibility, "main");
-    sbt_desc.add_miss_group(rmiss, "main");
-    sbt_desc.add_miss_group(rmiss_visibility, "main");
+void PathIntegrator::create_multi_view_ray_gen_library()
+{
+    auto backend = m_backend.lock();
 
-    m_ray_debug_sbt = vk::ShaderBindingTable::create(backend, sbt_desc);
+    backend->queue_object_deletion(m_multi_view_ray_gen_library);
 
-    vk::RayTracingPipeline::Desc desc;
+    m_multi_view_ray_gen_library = build_ray_gen_library("path_trace.rgen", multi_view_ray_gen_defines());
+}
 
-    desc.set_max_pipeline_ray_recursion_depth(8);
-    desc.set_shader_binding_table(m_ray_debug_sbt);
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-    // ---------------------------------------------------------------------------
-    // Create pipeline layout
-    // ---------------------------------------------------------------------------
+void PathIntegrator::create_probe_bake_ray_gen_library()
+{
+    auto backend = m_backend.lock();
 
-    vk::PipelineLayout::Desc pl_desc;
+    backend->queue_object_deletion(m_probe_bake_ray_gen_library);
 
-    pl_desc.add_push_constant_range(VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR, 0, sizeof(PushConstants));
+    m_probe_bake_ray_gen_library = build_ray_gen_library("probe_bake.rgen", bake_ray_gen_defines());
+}
 
-    pl_desc.add_descriptor_set_layout(backend->scene_descriptor_set_layout());
-    pl_desc.add_descriptor_set_layout(backend->buffer_array_descriptor_set_layout());
-    pl_desc.add_descriptor_set_layout(backend->buffer_array_descriptor_set_layout());
-    pl_desc.add_descriptor_set_layout(backend->buffer_array_descriptor_set_layout());
-    pl_desc.add_descriptor_set_layout(backend->combined_sampler_array_descriptor_set_layout());
-    pl_desc.add_descriptor_set_layout(backend->ray_debug_descriptor_set_layout());
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::create_lightmap_bake_ray_gen_library()
+{
+    auto backend = m_backend.lock();
+
+    backend->queue_object_deletion(m_lightmap_bake_ray_gen_library);
+
+    m_lightmap_bake_ray_gen_library = build_ray_gen_library("lightmap_bake.rgen", bake_ray_gen_defines());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+vk::RayTracingPipeline::Ptr PathIntegrator::build_ray_gen_library(const std::string& shader, const std::vector<std::string>& defines)
+{
+    auto backend = m_backend.lock();
+
+    vk::ShaderBindingTable::Desc sbt_desc;
+
+    sbt_desc.add_ray_gen_group(m_shader_cache->load(shader, defines), "main");
+
+    set_specialization_constants(sbt_desc);
+
+    vk::RayTracingPipeline::Desc desc;
+
+    desc.set_library(true);
+    desc.set_pipeline_interface(MAX_RAY_PAYLOAD_SIZE, MAX_HIT_ATTRIBUTE_SIZE);
+    desc.set_max_pipeline_ray_recursion_depth(8);
+    desc.set_shader_binding_table(vk::ShaderBindingTable::create(backend, sbt_desc));
+    desc.set_pipeline_layout(m_path_trace_pipeline_layout);
+
+    return vk::RayTracingPipeline::create(backend, desc);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::create_hit_library()
+{
+    auto backend = m_backend.lock();
+
+    vk::ShaderModule::Ptr rchit            = m_shader_cache->load("path_trace.rchit", hit_defines());
+    vk::ShaderModule::Ptr rahit            = m_shader_cache->load("path_trace.rahit", any_hit_defines());
+    vk::ShaderModule::Ptr rmiss            = m_shader_cache->load("path_trace.rmiss", miss_defines());
+    vk::ShaderModule::Ptr rchit_visibility = m_shader_cache->load("path_trace_shadow.rchit");
+    vk::ShaderModule::Ptr rmiss_visibility = m_shader_cache->load("path_trace_shadow.rmiss");
+
+    vk::ShaderBindingTable::Desc sbt_desc;
+
+    sbt_desc.add_hit_group(rchit, "main", rahit, "main");
+    sbt_desc.add_hit_group(rchit_visibility, "main", rahit, "main");
+    sbt_desc.add_miss_group(rmiss, "main");
+    sbt_desc.add_miss_group(rmiss_visibility, "main");
+
+    set_specialization_constants(sbt_desc);
+
+    vk::RayTracingPipeline::Desc desc;
+
+    desc.set_library(true);
+    desc.set_pipeline_interface(MAX_RAY_PAYLOAD_SIZE, MAX_HIT_ATTRIBUTE_SIZE);
+    desc.set_max_pipeline_ray_recursion_depth(8);
+    desc.set_shader_binding_table(vk::ShaderBindingTable::create(backend, sbt_desc));
+    desc.set_pipeline_layout(m_path_trace_pipeline_layout);
+
+    backend->queue_object_deletion(m_path_trace_hit_library);
+
+    m_path_trace_hit_library = vk::RayTracingPipeline::create(backend, desc);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::link_pipeline()
+{
+    auto backend = m_backend.lock();
+
+    backend->queue_object_deletion(m_path_trace_pipeline);
+
+    m_path_trace_pipeline = build_pipeline(m_path_trace_ray_gen_library, "path_trace.rgen", ray_gen_defines());
+    m_path_trace_sbt      = m_path_trace_pipeline->shader_binding_table();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::link_multi_view_pipeline()
+{
+    auto backend = m_backend.lock();
+
+    backend->queue_object_deletion(m_multi_view_pipeline);
+
+    m_multi_view_pipeline = build_pipeline(m_multi_view_ray_gen_library, "path_trace.rgen", multi_view_ray_gen_defines());
+    m_multi_view_sbt      = m_multi_view_pipeline->shader_binding_table();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::link_probe_bake_pipeline()
+{
+    auto backend = m_backend.lock();
 
-    m_ray_debug_pipeline_layout = vk::PipelineLayout::create(backend, pl_desc);
+    backend->queue_object_deletion(m_probe_bake_pipeline);
+
+    m_probe_bake_pipeline = build_pipeline(m_probe_bake_ray_gen_library, "probe_bake.rgen", bake_ray_gen_defines());
+    m_probe_bake_sbt      = m_probe_bake_pipeline->shader_binding_table();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::link_lightmap_bake_pipeline()
+{
+    auto backend = m_backend.lock();
+
+    backend->queue_object_deletion(m_lightmap_bake_pipeline);
+
+    m_lightmap_bake_pipeline = build_pipeline(m_lightmap_bake_ray_gen_library, "lightmap_bake.rgen", bake_ray_gen_defines());
+    m_lightmap_bake_sbt      = m_lightmap_bake_pipeline->shader_binding_table();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+vk::RayTracingPipeline::Ptr PathIntegrator::build_pipeline(vk::RayTracingPipeline::Ptr ray_gen_library, const std::string& ray_gen_shader, const std::vector<std::string>& ray_gen_library_defines)
+{
+    auto backend = m_backend.lock();
+
+    // The ray generation stage and the hit/miss stages live in separate libraries so that changing one of them does not require
+    // compiling the other again. The linked groups end up in library order, which matches the ray gen, miss, hit order of the
+    // shader binding table. The modules only describe the table layout here and are already cached.
+    vk::ShaderBindingTable::Desc sbt_desc;
+
+    sbt_desc.add_ray_gen_group(m_shader_cache->load(ray_gen_shader, ray_gen_library_defines), "main");
+    sbt_desc.add_hit_group(m_shader_cache->load("path_trace.rchit", hit_defines()), "main", m_shader_cache->load("path_trace.rahit", any_hit_defines()), "main");
+    sbt_desc.add_hit_group(m_shader_cache->load("path_trace_shadow.rchit"), "main", m_shader_cache->load("path_trace.rahit", any_hit_defines()), "main");
+    sbt_desc.add_miss_group(m_shader_cache->load("path_trace.rmiss", miss_defines()), "main");
+    sbt_desc.add_miss_group(m_shader_cache->load("path_trace_shadow.rmiss"), "main");
+
+    vk::RayTracingPipeline::Desc desc;
+
+    desc.set_max_pipeline_ray_recursion_depth(8);
+    desc.set_shader_binding_table(vk::ShaderBindingTable::create(backend, sbt_desc));
+    desc.set_pipeline_interface(MAX_RAY_PAYLOAD_SIZE, MAX_HIT_ATTRIBUTE_SIZE);
+    desc.add_library(ray_gen_library);
+    desc.add_library(m_path_trace_hit_library);
+    desc.set_pipeline_layout(m_path_trace_pipeline_layout);
+
+    return vk::RayTracingPipeline::create(backend, desc);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::create_ray_debug_pipeline()
+{
+    auto backend = m_backend.lock();
+
+    // ---------------------------------------------------------------------------
+    // Create shader modules
+    // ---------------------------------------------------------------------------
+
+    std::vector<std::string> defines = { "RAY_DEBUG_VIEW" };
+
+    vk::ShaderModule::Ptr rgen             = m_shader_cache->load("path_trace.rgen", defines);
+    vk::ShaderModule::Ptr rchit            = m_shader_cache->load("path_trace.rchit", defines);
+    vk::ShaderModule::Ptr rmiss            = m_shader_cache->load("path_trace.rmiss", defines);
+    vk::ShaderModule::Ptr rchit_visibility = m_shader_cache->load("path_trace_shadow.rchit");
+    vk::ShaderModule::Ptr rmiss_visibility = m_shader_cache->load("path_trace_shadow.rmiss");
+
+    vk::ShaderBindingTable::Desc sbt_desc;
+
+    sbt_desc.add_ray_gen_group(rgen, "main");
+    sbt_desc.add_hit_group(rchit, "main");
+    sbt_desc.add_hit_group(rchit_visibility, "main");
+    sbt_desc.add_miss_group(rmiss, "main");
+    sbt_desc.add_miss_group(rmiss_visibility, "main");
+
+    set_specialization_constants(sbt_desc);
+
+    m_ray_debug_sbt = vk::ShaderBindingTable::create(backend, sbt_desc);
+
+    vk::RayTracingPipeline::Desc desc;
+
+    desc.set_max_pipeline_ray_recursion_depth(8);
+    desc.set_shader_binding_table(m_ray_debug_sbt);
+
+    // ---------------------------------------------------------------------------
+    // Create pipeline layout
+    // ---------------------------------------------------------------------------
+
+    if (!m_ray_debug_pipeline_layout)
+    {
+        vk::PipelineLayout::Desc pl_desc;
+
+        pl_desc.add_push_constant_range(VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR, 0, sizeof(PushConstants));
+
+        pl_desc.add_descriptor_set_layout(backend->scene_descriptor_set_layout());
+        pl_desc.add_descriptor_set_layout(backend->buffer_array_descriptor_set_layout());
+        pl_desc.add_descriptor_set_layout(backend->buffer_array_descriptor_set_layout());
+        pl_desc.add_descriptor_set_layout(backend->buffer_array_descriptor_set_layout());
+        pl_desc.add_descriptor_set_layout(backend->combined_sampler_array_descriptor_set_layout());
+        pl_desc.add_descriptor_set_layout(backend->ray_debug_descriptor_set_layout());
+
+        m_ray_debug_pipeline_layout = vk::PipelineLayout::create(backend, pl_desc);
+    }
 
     desc.set_pipeline_layout(m_ray_debug_pipeline_layout);
 
+    backend->queue_object_deletion(m_ray_debug_pipeline);
+
     m_ray_debug_pipeline = vk::RayTracingPipeline::create(backend, desc);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void PathIntegrator::compute_tile_coords()
+void PathIntegrator::create_ray_statistics_resources()
 {
     auto backend = m_backend.lock();
-    auto extents = backend->swap_chain_extents();
 
-    m_tile_coords.clear();
+    // Subgroup aggregation needs ballot support in every stage that increments a counter, otherwise each invocation does its own atomic.
+    VkPhysicalDeviceSubgroupProperties subgroup_properties;
+    HELIOS_ZERO_MEMORY(subgroup_properties);
+
+    subgroup_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 device_properties2;
+    HELIOS_ZERO_MEMORY(device_properties2);
+
+    device_properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    device_properties2.pNext = &subgroup_properties;
+
+    vkGetPhysicalDeviceProperties2(backend->physical_device(), &device_properties2);
+
+    const VkShaderStageFlags     counter_stages     = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR;
+    const VkSubgroupFeatureFlags counter_operations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_BALLOT_BIT;
+
+    m_subgroup_ray_statistics = (subgroup_properties.supportedStages & counter_stages) == counter_stages && (subgroup_properties.supportedOperations & counter_operations) == counter_operations;
+    m_timestamp_period        = device_properties2.properties.limits.timestampPeriod;
+
+    vk::DescriptorSetLayout::Desc ds_layout_desc;
+
+    ds_layout_desc.add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR);
+
+    m_ray_statistics_ds_layout = vk::DescriptorSetLayout::create(backend, ds_layout_desc);
+    m_ray_statistics_ds_layout->set_name("Ray Statistics Descriptor Set Layout");
+
+    m_ray_statistics_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(uint32_t) * RAY_COUNTER_COUNT, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    m_ray_statistics_buffer->set_name("Ray Statistics");
 
-    if (m_tiled)
+    for (uint32_t i = 0; i < vk::Backend::kMaxFramesInFlight; i++)
     {
-        glm::uvec2 num_tiles = glm::uvec2(ceilf(float(extents.width) / float(TILE_SIZE)), ceilf(float(extents.height) / float(TILE_SIZE)));
+        m_ray_statistics_readback[i] = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(uint32_t) * RAY_COUNTER_COUNT, VMA_MEMORY_USAGE_GPU_TO_CPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+        m_ray_statistics_pending[i]  = false;
+        m_ray_statistics_bake_id[i]  = 0;
+    }
 
-        for (int x = 0; x < num_tiles.x; x++)
-        {
-            for (int y = 0; y < num_tiles.y; y++)
-                m_tile_coords.push_back(glm::uvec2(x * TILE_SIZE, y * TILE_SIZE));
-        }
+    // Start and end timestamps of the launch recorded in each frame.
+    m_ray_statistics_query_pool = vk::QueryPool::create(backend, VK_QUERY_TYPE_TIMESTAMP, vk::Backend::kMaxFramesInFlight * 2);
+
+    m_ray_statistics_ds = backend->allocate_descriptor_set(m_ray_statistics_ds_layout);
+
+    VkDescriptorBufferInfo buffer_info;
+
+    HELIOS_ZERO_MEMORY(buffer_info);
+
+    buffer_info.buffer = m_ray_statistics_buffer->handle();
+    buffer_info.offset = 0;
+    buffer_info.range  = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet write_data;
+
+    HELIOS_ZERO_MEMORY(write_data);
+
+    write_data.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write_data.descriptorCount = 1;
+    write_data.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write_data.pBufferInfo     = &buffer_info;
+    write_data.dstBinding      = 0;
+    write_data.dstSet          = m_ray_statistics_ds->handle();
+
+    vkUpdateDescriptorSets(backend->device(), 1, &write_data, 0, nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::begin_ray_statistics(vk::CommandBuffer::Ptr cmd_buf)
+{
+    auto backend = m_backend.lock();
+
+    const uint32_t frame_idx = backend->current_frame_idx();
+
+    // The previous launch copied the counters out, so clearing has to wait for that copy to finish.
+    VkBufferMemoryBarrier buffer_barrier;
+    HELIOS_ZERO_MEMORY(buffer_barrier);
+
+    buffer_barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    buffer_barrier.srcAccessMask       = VK_ACCESS_TRANSFER_READ_BIT;
+    buffer_barrier.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.buffer              = m_ray_statistics_buffer->handle();
+    buffer_barrier.offset              = 0;
+    buffer_barrier.size                = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
+
+    vkCmdFillBuffer(cmd_buf->handle(), m_ray_statistics_buffer->handle(), 0, VK_WHOLE_SIZE, 0);
+
+    buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    buffer_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
+
+    vkCmdResetQueryPool(cmd_buf->handle(), m_ray_statistics_query_pool->handle(), frame_idx * 2, 2);
+    vkCmdWriteTimestamp(cmd_buf->handle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_ray_statistics_query_pool->handle(), frame_idx * 2);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::end_ray_statistics(vk::CommandBuffer::Ptr cmd_buf)
+{
+    auto backend = m_backend.lock();
+
+    const uint32_t frame_idx = backend->current_frame_idx();
+
+    vkCmdWriteTimestamp(cmd_buf->handle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_ray_statistics_query_pool->handle(), frame_idx * 2 + 1);
+
+    VkBufferMemoryBarrier buffer_barrier;
+    HELIOS_ZERO_MEMORY(buffer_barrier);
+
+    buffer_barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    buffer_barrier.srcAccessMask       = VK_ACCESS_SHADER_WRITE_BIT;
+    buffer_barrier.dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT;
+    buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.buffer              = m_ray_statistics_buffer->handle();
+    buffer_barrier.offset              = 0;
+    buffer_barrier.size                = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
 
-        m_tile_size = glm::uvec2(TILE_SIZE, TILE_SIZE);
+    VkBufferCopy copy_region;
+    HELIOS_ZERO_MEMORY(copy_region);
+
+    copy_region.size = sizeof(uint32_t) * RAY_COUNTER_COUNT;
+
+    vkCmdCopyBuffer(cmd_buf->handle(), m_ray_statistics_buffer->handle(), m_ray_statistics_readback[frame_idx]->handle(), 1, &copy_region);
+
+    // Make the copied counters available to the host once the frame fence signals
+    buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    buffer_barrier.buffer        = m_ray_statistics_readback[frame_idx]->handle();
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
+
+    m_ray_statistics_pending[frame_idx] = true;
+    m_ray_statistics_bake_id[frame_idx] = m_bake_id;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::resolve_ray_statistics(uint32_t frame_idx)
+{
+    if (!m_ray_statistics_pending[frame_idx])
+        return;
+
+    m_ray_statistics_pending[frame_idx] = false;
+
+    uint64_t timestamps[2] = { 0, 0 };
+
+    if (!m_ray_statistics_query_pool->results(frame_idx * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT))
+        return;
+
+    m_ray_statistics_readback[frame_idx]->invalidate_mapped_data();
+
+    const uint32_t* counters = (const uint32_t*)m_ray_statistics_readback[frame_idx]->mapped_ptr();
+
+    RayStatistics statistics;
+
+    for (uint32_t i = 0; i < RAY_COUNTER_COUNT; i++)
+        statistics.counters[i] = counters[i];
+
+    statistics.num_launches = 1;
+    statistics.gpu_time     = double(timestamps[1] - timestamps[0]) * double(m_timestamp_period) * 1e-6;
+
+    m_last_ray_statistics = statistics;
+
+    // Launches recorded before the bake was restarted belong to the previous one.
+    if (m_ray_statistics_bake_id[frame_idx] == m_bake_id)
+        m_bake_ray_statistics.add(statistics);
+
+    profiler::set_counter("Primary Rays (Mrays/s)", statistics.mrays_per_second(RAY_COUNTER_PRIMARY));
+    profiler::set_counter("Shadow Rays (Mrays/s)", statistics.mrays_per_second(RAY_COUNTER_SHADOW));
+    profiler::set_counter("Indirect Rays (Mrays/s)", statistics.mrays_per_second(RAY_COUNTER_INDIRECT));
+    profiler::set_counter("Total Rays (Mrays/s)", statistics.mrays_per_second(statistics.total_rays()));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::update_pipelines()
+{
+    if (!m_ray_gen_dirty && !m_hit_dirty)
+        return;
+
+    if (m_ray_gen_dirty)
+        create_ray_gen_library();
+
+    if (m_hit_dirty)
+        create_hit_library();
+
+    link_pipeline();
+    create_ray_debug_pipeline();
+
+    if (m_multi_view_pipeline)
+    {
+        if (m_ray_gen_dirty)
+            create_multi_view_ray_gen_library();
+
+        link_multi_view_pipeline();
     }
-    else
+
+    if (m_probe_bake_pipeline)
+    {
+        if (m_ray_gen_dirty)
+            create_probe_bake_ray_gen_library();
+
+        link_probe_bake_pipeline();
+    }
+
+    if (m_lightmap_bake_pipeline)
     {
-        m_tile_coords.push_back(glm::uvec2(0, 0));
-        m_tile_size = glm::uvec2(extents.width, extents.height);
+        if (m_ray_gen_dirty)
+            create_lightmap_bake_ray_gen_library();
+
+        link_lightmap_bake_pipeline();
     }
+
+    m_ray_gen_dirty = false;
+    m_hit_dirty     = false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::set_specialization_constants(vk::ShaderBindingTable::Desc& sbt_desc)
+{
+    // Keep in sync with the constant_id declarations in common.glsl and random.glsl
+    struct SpecializationConstants
+    {
+        uint32_t max_ray_bounces;
+        uint32_t sampler_type;
+    };
+
+    SpecializationConstants constants;
+
+    constants.max_ray_bounces = m_max_ray_bounces;
+    constants.sampler_type    = m_sampler_type;
+
+    std::vector<VkSpecializationMapEntry> entries = {
+        { 0, offsetof(SpecializationConstants, max_ray_bounces), sizeof(uint32_t) },
+        { 1, offsetof(SpecializationConstants, sampler_type), sizeof(uint32_t) }
+    };
+
+    sbt_desc.set_specialization_constants(entries, &constants, sizeof(SpecializationConstants));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<std::string> PathIntegrator::ray_gen_defines()
+{
+    std::vector<std::string> defines;
+
+    if (m_visualize_nans)
+        defines.push_back("VISUALIZE_NANS");
+
+    if (m_light_groups_enabled)
+        defines.push_back("LIGHT_GROUPS");
+
+    add_ray_statistics_defines(defines);
+
+    return defines;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<std::string> PathIntegrator::multi_view_ray_gen_defines()
+{
+    std::vector<std::string> defines = ray_gen_defines();
+
+    defines.push_back("MULTI_VIEW");
+
+    return defines;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<std::string> PathIntegrator::bake_ray_gen_defines()
+{
+    std::vector<std::string> defines;
+
+    // The payload has to match the one of the hit library
+    if (m_light_groups_enabled)
+        defines.push_back("LIGHT_GROUPS");
+
+    add_ray_statistics_defines(defines);
+
+    return defines;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<std::string> PathIntegrator::hit_defines()
+{
+    std::vector<std::string> defines;
+
+    if (m_integrator_mode == INTEGRATOR_DIRECT_LIGHTING)
+        defines.push_back("DIRECT_LIGHTING_INTEGRATOR");
+
+    if (m_light_groups_enabled)
+        defines.push_back("LIGHT_GROUPS");
+
+    add_ray_statistics_defines(defines);
+
+    return defines;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<std::string> PathIntegrator::any_hit_defines()
+{
+    std::vector<std::string> defines;
+
+    add_ray_statistics_defines(defines);
+
+    return defines;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<std::string> PathIntegrator::miss_defines()
+{
+    std::vector<std::string> defines;
+
+    if (m_light_groups_enabled)
+        defines.push_back("LIGHT_GROUPS");
+
+    return defines;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::add_ray_statistics_defines(std::vector<std::string>& defines)
+{
+    if (!m_ray_statistics_enabled)
+        return;
+
+    defines.push_back("RAY_STATISTICS");
+
+    if (m_subgroup_ray_statistics)
+        defines.push_back("RAY_STATISTICS_SUBGROUP");
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PathIntegrator::compute_tile_coords()
+{
+    auto backend = m_backend.lock();
+    auto extents = backend->swap_chain_extents();
+
+    m_tile_coords = generate_tile_coords(extents.width, extents.height, m_tiled, m_split_mode, m_job_index, m_job_count);
+    m_tile_size   = tile_size(extents.width, extents.height, m_tiled);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
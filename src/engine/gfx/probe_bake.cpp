@@ -0,0 +1,317 @@
+#include <gfx/probe_bake.h>
+#include <utility/macros.h>
+#include <utility/logger.h>
+#include <utility/utility.h>
+#include <vk_mem_alloc.h>
+#include <stdio.h>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+namespace helios
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Keep in sync with ProbeBuffer in probe_bake_rgen.glsl
+struct ProbeBufferHeader
+{
+    glm::uvec4 counts; // x: number of probes, y: rays per lane, z: SH coefficients, w: minimum rays per probe
+    glm::vec4  params; // x: convergence threshold
+};
+
+// Keep in sync with ProbeLane in probe_bake_rgen.glsl
+struct ProbeLaneData
+{
+    glm::vec4 coefficients[PROBE_BAKE_MAX_SH_COEFFICIENTS]; // Mean of radiance * Y_lm over the rays of the lane, w of the first one is the ray count
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ProbeBake::ProbeBake(vk::Backend::Ptr backend, vk::DescriptorSetLayout::Ptr probe_ds_layout, ProbeVolumeNode::Ptr node, const ProbeBakeSettings& settings) :
+    m_backend(backend), m_settings(settings), m_resolution(node->resolution()), m_sh_bands(node->sh_bands()), m_transform(node->global_transform())
+{
+    if (m_settings.rays_per_lane == 0)
+    {
+        HELIOS_LOG_FATAL("A probe bake needs at least one ray per lane");
+        throw std::runtime_error("A probe bake needs at least one ray per lane");
+    }
+
+    const uint32_t n = num_probes();
+
+    std::vector<uint8_t> probe_data(sizeof(ProbeBufferHeader) + sizeof(glm::vec4) * n);
+
+    ProbeBufferHeader* header    = (ProbeBufferHeader*)probe_data.data();
+    glm::vec4*         positions = (glm::vec4*)(probe_data.data() + sizeof(ProbeBufferHeader));
+
+    header->counts = glm::uvec4(n, m_settings.rays_per_lane, m_sh_bands * m_sh_bands, m_settings.min_samples);
+    header->params = glm::vec4(m_settings.convergence_threshold, 0.0f, 0.0f, 0.0f);
+
+    for (uint32_t z = 0; z < m_resolution.z; z++)
+    {
+        for (uint32_t y = 0; y < m_resolution.y; y++)
+        {
+            for (uint32_t x = 0; x < m_resolution.x; x++)
+                positions[(z * m_resolution.y + y) * m_resolution.x + x] = glm::vec4(node->probe_position(x, y, z), 1.0f);
+        }
+    }
+
+    // Written once, so the upload can go through a staging buffer
+    m_probe_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, probe_data.size(), VMA_MEMORY_USAGE_GPU_ONLY, 0, probe_data.data());
+    m_probe_buffer->set_name("Probe Bake Probes");
+
+    for (int i = 0; i < 2; i++)
+    {
+        m_lane_buffers[i] = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(ProbeLaneData) * PROBE_BAKE_LANES * n, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+        m_lane_buffers[i]->set_name("Probe Bake Lanes " + std::to_string(i));
+    }
+
+    // Number of converged probes followed by a flag per probe
+    m_state_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(uint32_t) * (n + 1), VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    m_state_buffer->set_name("Probe Bake State");
+
+    for (uint32_t i = 0; i < vk::Backend::kMaxFramesInFlight; i++)
+    {
+        m_state_readback[i] = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(uint32_t), VMA_MEMORY_USAGE_GPU_TO_CPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+        m_state_pending[i]  = false;
+        m_state_bake_id[i]  = 0;
+    }
+
+    // Each launch reads the lanes written by the previous one and writes the other buffer
+    for (int i = 0; i < 2; i++)
+    {
+        m_probe_ds[i] = backend->allocate_descriptor_set(probe_ds_layout);
+
+        vk::Buffer::Ptr buffers[] = { m_probe_buffer, m_lane_buffers[i], m_lane_buffers[!i], m_state_buffer };
+
+        VkDescriptorBufferInfo buffer_infos[4];
+        VkWriteDescriptorSet   write_datas[4];
+
+        for (int j = 0; j < 4; j++)
+        {
+            HELIOS_ZERO_MEMORY(buffer_infos[j]);
+
+            buffer_infos[j].buffer = buffers[j]->handle();
+            buffer_infos[j].offset = 0;
+            buffer_infos[j].range  = VK_WHOLE_SIZE;
+
+            HELIOS_ZERO_MEMORY(write_datas[j]);
+
+            write_datas[j].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write_datas[j].descriptorCount = 1;
+            write_datas[j].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write_datas[j].pBufferInfo     = &buffer_infos[j];
+            write_datas[j].dstBinding      = j;
+            write_datas[j].dstSet          = m_probe_ds[i]->handle();
+        }
+
+        vkUpdateDescriptorSets(backend->device(), 4, &write_datas[0], 0, nullptr);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ProbeBake::~ProbeBake()
+{
+    auto backend = m_backend.lock();
+
+    // The bake may be released while its last launches are still in flight
+    if (backend)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            backend->queue_object_deletion(m_probe_ds[i]);
+            backend->queue_object_deletion(m_lane_buffers[i]);
+        }
+
+        for (uint32_t i = 0; i < vk::Backend::kMaxFramesInFlight; i++)
+            backend->queue_object_deletion(m_state_readback[i]);
+
+        backend->queue_object_deletion(m_state_buffer);
+        backend->queue_object_deletion(m_probe_buffer);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProbeBake::restart()
+{
+    m_num_launches         = 0;
+    m_num_converged_probes = 0;
+    m_needs_clear          = true;
+    m_bake_id++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ProbeBake::save(const std::string& path)
+{
+    auto backend = m_backend.lock();
+
+    backend->wait_idle();
+
+    // The most recent launch wrote the buffer that the next one reads
+    const size_t    lane_buffer_size = sizeof(ProbeLaneData) * PROBE_BAKE_LANES * num_probes();
+    vk::Buffer::Ptr staging          = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT, lane_buffer_size, VMA_MEMORY_USAGE_GPU_TO_CPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+    vk::CommandBuffer::Ptr cmd_buf = backend->allocate_graphics_command_buffer(true);
+
+    VkBufferCopy copy_region;
+    HELIOS_ZERO_MEMORY(copy_region);
+
+    copy_region.size = lane_buffer_size;
+
+    vkCmdCopyBuffer(cmd_buf->handle(), m_lane_buffers[m_ping_pong]->handle(), staging->handle(), 1, &copy_region);
+
+    vkEndCommandBuffer(cmd_buf->handle());
+
+    backend->flush_graphics({ cmd_buf });
+
+    staging->invalidate_mapped_data();
+
+    const ProbeLaneData* lanes = (const ProbeLaneData*)staging->mapped_ptr();
+
+    // Convolution with the clamped cosine lobe turns radiance into irradiance
+    const float band_factors[] = { float(M_PI), 2.0f * float(M_PI) / 3.0f, float(M_PI) / 4.0f };
+    const int   band_of_coefficient[PROBE_BAKE_MAX_SH_COEFFICIENTS] = { 0, 1, 1, 1, 2, 2, 2, 2, 2 };
+
+    const uint32_t num_coefficients = m_sh_bands * m_sh_bands;
+
+    std::vector<glm::vec3> coefficients(num_coefficients * num_probes());
+
+    for (uint32_t probe_idx = 0; probe_idx < num_probes(); probe_idx++)
+    {
+        const ProbeLaneData* probe_lanes = lanes + probe_idx * PROBE_BAKE_LANES;
+
+        float num_rays = 0.0f;
+
+        for (uint32_t lane_idx = 0; lane_idx < PROBE_BAKE_LANES; lane_idx++)
+            num_rays += probe_lanes[lane_idx].coefficients[0].w;
+
+        for (uint32_t i = 0; i < num_coefficients; i++)
+        {
+            glm::vec3 mean = glm::vec3(0.0f);
+
+            // Lanes are combined weighted by their ray counts
+            if (num_rays > 0.0f)
+            {
+                for (uint32_t lane_idx = 0; lane_idx < PROBE_BAKE_LANES; lane_idx++)
+                    mean += glm::vec3(probe_lanes[lane_idx].coefficients[i]) * (probe_lanes[lane_idx].coefficients[0].w / num_rays);
+            }
+
+            // Monte Carlo estimate over the sphere
+            coefficients[probe_idx * num_coefficients + i] = mean * 4.0f * float(M_PI) * band_factors[band_of_coefficient[i]];
+        }
+    }
+
+    ProbeVolumeHeader header;
+
+    header.sh_bands         = m_sh_bands;
+    header.num_coefficients = num_coefficients;
+    header.resolution[0]    = m_resolution.x;
+    header.resolution[1]    = m_resolution.y;
+    header.resolution[2]    = m_resolution.z;
+    header.num_samples      = num_samples();
+    header.transform        = m_transform;
+
+    return utility::write_file_atomic(path, [&header, &coefficients](const std::string& temp_path) {
+        FILE* f = fopen(temp_path.c_str(), "wb");
+
+        if (!f)
+            return false;
+
+        bool success = fwrite(&header, sizeof(ProbeVolumeHeader), 1, f) == 1;
+
+        success = success && fwrite(coefficients.data(), sizeof(glm::vec3), coefficients.size(), f) == coefficients.size();
+
+        return (fclose(f) == 0) && success;
+    });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProbeBake::begin_launch(vk::CommandBuffer::Ptr cmd_buf, uint32_t frame_idx)
+{
+    // The backend has already waited on the fence of this frame, so the count copied the last time it was used is available.
+    resolve_converged_probes(frame_idx);
+
+    if (m_needs_clear)
+    {
+        // Keep the previous launch and the copies of the converged count ahead of the clear
+        VkMemoryBarrier memory_barrier;
+        memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memory_barrier.pNext         = nullptr;
+        memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+        // Zero ray counts and zero flags mean that every probe starts over
+        for (int i = 0; i < 2; i++)
+            vkCmdFillBuffer(cmd_buf->handle(), m_lane_buffers[i]->handle(), 0, VK_WHOLE_SIZE, 0);
+
+        vkCmdFillBuffer(cmd_buf->handle(), m_state_buffer->handle(), 0, VK_WHOLE_SIZE, 0);
+
+        m_needs_clear = false;
+    }
+
+    VkMemoryBarrier memory_barrier;
+    memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.pNext         = nullptr;
+    memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProbeBake::end_launch(vk::CommandBuffer::Ptr cmd_buf, uint32_t frame_idx)
+{
+    VkMemoryBarrier memory_barrier;
+    memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.pNext         = nullptr;
+    memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy copy_region;
+    HELIOS_ZERO_MEMORY(copy_region);
+
+    copy_region.size = sizeof(uint32_t);
+
+    vkCmdCopyBuffer(cmd_buf->handle(), m_state_buffer->handle(), m_state_readback[frame_idx]->handle(), 1, &copy_region);
+
+    // Make the copied count available to the host once the frame fence signals
+    memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+    m_state_pending[frame_idx] = true;
+    m_state_bake_id[frame_idx] = m_bake_id;
+
+    m_ping_pong = !m_ping_pong;
+    m_num_launches++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProbeBake::resolve_converged_probes(uint32_t frame_idx)
+{
+    if (!m_state_pending[frame_idx])
+        return;
+
+    m_state_pending[frame_idx] = false;
+
+    // Launches recorded before the bake was restarted belong to the previous one.
+    if (m_state_bake_id[frame_idx] != m_bake_id)
+        return;
+
+    m_state_readback[frame_idx]->invalidate_mapped_data();
+
+    m_num_converged_probes = std::max(m_num_converged_probes, *(const uint32_t*)m_state_readback[frame_idx]->mapped_ptr());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace helios
@@ -6,6 +6,7 @@
 #include <vk_mem_alloc.h>
 #include <imgui.h>
 #include <examples/imgui_impl_vulkan.h>
+#include <algorithm>
 #include <resource/scene.h>
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
@@ -30,6 +31,13 @@ struct ToneMapPushConstants
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+struct LightGroupCompositePushConstants
+{
+    glm::vec4 weights[MAX_LIGHT_GROUPS];
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 struct DebugVisualizationPushConstants
 {
     glm::mat4 view_proj;
@@ -43,10 +51,19 @@ struct DebugVisualizationPushConstants
 Renderer::Renderer(vk::Backend::Ptr backend) :
     m_backend(backend)
 {
-    m_path_integrator = std::shared_ptr<PathIntegrator>(new PathIntegrator(backend));
+    m_shader_cache    = std::shared_ptr<ShaderCache>(new ShaderCache(backend));
+    m_path_integrator = std::shared_ptr<PathIntegrator>(new PathIntegrator(backend, m_shader_cache));
+    m_image_readback  = std::shared_ptr<ImageReadback>(new ImageReadback(backend));
+
+    for (int i = 0; i < MAX_LIGHT_GROUPS; i++)
+    {
+        m_light_group_scales[i] = 1.0f;
+        m_light_group_tints[i]  = glm::vec3(1.0f);
+    }
 
     create_output_images();
     create_tone_map_render_pass();
+    create_light_group_composite_render_pass();
     create_swapchain_render_pass();
     create_depth_prepass_render_pass();
     create_tone_map_framebuffer();
@@ -54,6 +71,7 @@ Renderer::Renderer(vk::Backend::Ptr backend) :
     create_swapchain_framebuffers();
     create_tone_map_pipeline();
     create_copy_pipeline();
+    create_light_group_composite_pipeline();
     create_ray_debug_buffers();
     create_ray_debug_pipeline();
     create_debug_visualization_pipeline();
@@ -67,6 +85,9 @@ Renderer::Renderer(vk::Backend::Ptr backend) :
 
 Renderer::~Renderer()
 {
+    // Wait for any in-flight readbacks to be written out before releasing their buffers
+    m_image_readback.reset();
+
     for (int i = 0; i < 2; i++)
     {
         m_output_images[i].reset();
@@ -75,6 +96,17 @@ Renderer::~Renderer()
         m_input_combined_sampler_ds[i].reset();
     }
 
+    m_light_group_storage_image_ds.reset();
+    m_light_group_combined_sampler_ds.reset();
+    m_light_group_composite_ds.reset();
+    m_light_group_composite_framebuffer.reset();
+    m_light_group_composite_image_view.reset();
+    m_light_group_composite_image.reset();
+    m_light_group_image_view.reset();
+    m_light_group_image.reset();
+    m_light_group_composite_pipeline.reset();
+    m_light_group_composite_pipeline_layout.reset();
+    m_light_group_composite_render_pass.reset();
     m_swapchain_framebuffers.clear();
     m_swapchain_renderpass.reset();
     m_debug_visualization_pipeline.reset();
@@ -82,7 +114,6 @@ Renderer::~Renderer()
     m_depth_prepass_framebuffer.reset();
     m_depth_prepass_renderpass.reset();
     m_debug_visualization_pipeline_layout.reset();
-    m_save_to_disk_image.reset();
     m_tone_map_ds.reset();
     m_tone_map_image_view.reset();
     m_tone_map_image.reset();
@@ -100,6 +131,7 @@ Renderer::~Renderer()
     m_copy_pipeline_layout.reset();
     m_copy_pipeline.reset();
     m_path_integrator.reset();
+    m_shader_cache.reset();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -110,17 +142,22 @@ void Renderer::render(RenderState& render_state)
 
     auto backend = m_backend.lock();
 
+    // Hand completed readbacks over to the worker thread
+    m_image_readback->update();
+
     if (render_state.m_scene && render_state.m_scene_state == SCENE_STATE_HIERARCHY_UPDATED)
     {
+        HELIOS_SCOPED_SAMPLE("TLAS Build");
+
         auto& tlas_data = render_state.m_scene->acceleration_structure_data();
 
-        if (render_state.m_meshes.size() > 0)
+        if (render_state.m_num_instances > 0)
         {
             VkBufferCopy copy_region;
             HELIOS_ZERO_MEMORY(copy_region);
 
             copy_region.dstOffset = 0;
-            copy_region.size      = sizeof(VkAccelerationStructureInstanceKHR) * render_state.m_meshes.size();
+            copy_region.size      = sizeof(VkAccelerationStructureInstanceKHR) * render_state.m_num_instances;
 
             vkCmdCopyBuffer(render_state.m_cmd_buffer->handle(), tlas_data.instance_buffer_host->handle(), tlas_data.instance_buffer_device->handle(), 1, &copy_region);
         }
@@ -158,7 +195,7 @@ void Renderer::render(RenderState& render_state)
 
         VkAccelerationStructureBuildRangeInfoKHR build_range_info;
 
-        build_range_info.primitiveCount  = render_state.m_meshes.size();
+        build_range_info.primitiveCount  = render_state.m_num_instances;
         build_range_info.primitiveOffset = 0;
         build_range_info.firstVertex     = 0;
         build_range_info.transformOffset = 0;
@@ -187,8 +224,16 @@ void Renderer::render(RenderState& render_state)
     render_state.m_read_image_ds  = m_output_storage_image_ds[read_index];
     render_state.m_ray_debug_ds   = m_ray_debug_ds;
 
-    VkImageSubresourceRange color_subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-    VkImageSubresourceRange depth_subresource_range = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+    if (m_light_groups_enabled)
+        render_state.m_light_group_ds = m_light_group_storage_image_ds;
+
+    // Restore a checkpointed accumulation once the scene has finished loading
+    if (m_resume_pending && render_state.m_scene && render_state.m_scene_state == SCENE_STATE_READY)
+        upload_checkpoint(render_state);
+
+    VkImageSubresourceRange color_subresource_range       = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    VkImageSubresourceRange depth_subresource_range       = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+    VkImageSubresourceRange light_group_subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, MAX_LIGHT_GROUPS };
 
     // Transition write image to general layout during the first frame
     if (m_output_image_recreated)
@@ -209,6 +254,19 @@ void Renderer::render(RenderState& render_state)
         VK_IMAGE_LAYOUT_GENERAL,
         color_subresource_range);
 
+    // The light group image stays in general layout since it is both accumulated into and sampled
+    if (m_light_groups_enabled && m_light_group_recreated)
+    {
+        vk::utilities::set_image_layout(
+            render_state.m_cmd_buffer->handle(),
+            m_light_group_image->handle(),
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_GENERAL,
+            light_group_subresource_range);
+
+        m_light_group_recreated = false;
+    }
+
     if (render_state.m_scene_state != SCENE_STATE_READY || m_path_integrator->num_accumulated_samples() == 0 && m_path_integrator->tile_idx() == 0)
     {
         VkClearColorValue color;
@@ -220,12 +278,81 @@ void Renderer::render(RenderState& render_state)
 
         vkCmdClearColorImage(render_state.m_cmd_buffer->handle(), m_output_images[write_index]->handle(), VK_IMAGE_LAYOUT_GENERAL, &color, 1, &color_subresource_range);
         vkCmdClearColorImage(render_state.m_cmd_buffer->handle(), m_output_images[read_index]->handle(), VK_IMAGE_LAYOUT_GENERAL, &color, 1, &color_subresource_range);
+
+        m_light_groups_resumed = false;
+
+        if (m_light_groups_enabled)
+        {
+            vkCmdClearColorImage(render_state.m_cmd_buffer->handle(), m_light_group_image->handle(), VK_IMAGE_LAYOUT_GENERAL, &color, 1, &light_group_subresource_range);
+
+            VkMemoryBarrier memory_barrier;
+            memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            memory_barrier.pNext         = nullptr;
+            memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+            vkCmdPipelineBarrier(render_state.m_cmd_buffer->handle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+        }
     }
 
     // Begin path trace iteration
     if (render_state.m_scene)
+    {
+        uint32_t tile_idx = m_path_integrator->tile_idx();
+
         m_path_integrator->render(render_state);
 
+        if (m_path_integrator->is_tiled() && m_path_integrator->tile_idx() == tile_idx + 1)
+            copy_completed_tile(render_state, tile_idx);
+
+        if (m_probe_bake)
+        {
+            // Completion is only known once the last launch has been submitted, so it is checked before recording another one
+            if (m_probe_bake->is_complete())
+            {
+                if (m_probe_bake->save(m_probe_bake_path))
+                    HELIOS_LOG_INFO("Saved probe volume: " + m_probe_bake_path);
+
+                m_probe_bake.reset();
+            }
+            else
+                m_path_integrator->render_probes(render_state, m_probe_bake);
+        }
+
+        if (m_lightmap_bake)
+        {
+            if (m_lightmap_bake->is_complete())
+            {
+                if (m_lightmap_bake->save(m_lightmap_bake_path))
+                    HELIOS_LOG_INFO("Saved lightmap: " + m_lightmap_bake_path);
+
+                m_lightmap_bake.reset();
+            }
+            else
+                m_path_integrator->render_lightmap(render_state, m_lightmap_bake);
+        }
+
+        if (m_cubemap)
+        {
+            if (m_cubemap->num_accumulated_samples() >= m_cubemap_samples)
+            {
+                static const char* kFaceSuffixes[] = { "_px.hdr", "_nx.hdr", "_py.hdr", "_ny.hdr", "_pz.hdr", "_nz.hdr" };
+
+                std::vector<std::string> paths;
+
+                for (auto suffix : kFaceSuffixes)
+                    paths.push_back(m_cubemap_path + suffix);
+
+                if (m_cubemap->save(paths))
+                    HELIOS_LOG_INFO("Saved cubemap: " + m_cubemap_path);
+
+                m_cubemap.reset();
+            }
+            else
+                m_path_integrator->render_views(render_state, m_cubemap);
+        }
+    }
+
     if (m_ray_debug_view_added)
     {
         m_ray_debug_view_added = false;
@@ -257,12 +384,67 @@ void Renderer::render(RenderState& render_state)
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
         color_subresource_range);
 
-    // Tone map output
-    tone_map(render_state.m_cmd_buffer, m_input_combined_sampler_ds[write_index]);
+    // Tone map output, recombining the light groups with their current weights if they are enabled. After a resume the layers only
+    // hold the samples traced since, and none at all for tiles that were already complete, so the total is shown until the next
+    // restart instead.
+    if (m_light_groups_enabled && !m_light_groups_resumed)
+    {
+        composite_light_groups(render_state.m_cmd_buffer);
+        tone_map(render_state.m_cmd_buffer, m_light_group_composite_ds);
+    }
+    else
+        tone_map(render_state.m_cmd_buffer, m_input_combined_sampler_ds[write_index]);
 
-    // Copy screenshot
-    if (m_save_image_to_disk)
-        copy_and_save_tone_mapped_image(render_state.m_cmd_buffer);
+    // Copy screenshot. If every readback slot is busy, try again next frame.
+    if (m_save_image_to_disk && save_tone_mapped_image(render_state.m_cmd_buffer, m_image_save_path))
+    {
+        m_save_image_to_disk = false;
+        m_image_save_path    = "";
+    }
+
+    // Periodic progress snapshots are simply skipped when the ring is full so that they never stall the frame.
+    if (m_snapshot_interval > 0)
+    {
+        uint32_t num_samples = m_path_integrator->num_accumulated_samples();
+
+        if (num_samples < m_last_snapshot_sample)
+            m_last_snapshot_sample = 0;
+
+        if (num_samples > 0 && num_samples % m_snapshot_interval == 0 && num_samples != m_last_snapshot_sample)
+        {
+            m_last_snapshot_sample = num_samples;
+
+            if (!save_tone_mapped_image(render_state.m_cmd_buffer, m_snapshot_path + "_" + std::to_string(num_samples) + "spp.png"))
+                HELIOS_LOG_WARNING("Skipped progress snapshot: all readback slots are in use.");
+        }
+    }
+
+    // Checkpoints are taken from the accumulation buffer that was written this frame
+    if (render_state.m_scene && render_state.m_scene_state == SCENE_STATE_READY && m_path_integrator->num_accumulated_samples() > 0)
+    {
+        if (m_save_checkpoint && write_checkpoint(render_state, write_index, m_checkpoint_save_path))
+        {
+            m_save_checkpoint      = false;
+            m_checkpoint_save_path = "";
+        }
+
+        if (m_checkpoint_interval > 0)
+        {
+            uint32_t num_samples = m_path_integrator->num_accumulated_samples();
+
+            if (num_samples < m_last_checkpoint_sample)
+                m_last_checkpoint_sample = 0;
+
+            if (num_samples - m_last_checkpoint_sample >= m_checkpoint_interval && write_checkpoint(render_state, write_index, m_checkpoint_path))
+                m_last_checkpoint_sample = num_samples;
+        }
+
+        // Once a distributed job has rendered its share, write it out for helios_merge
+        if (m_job_output_path.length() > 0 && !m_job_output_requested && m_path_integrator->is_complete())
+            m_job_output_requested = write_checkpoint(render_state, write_index, m_job_output_path);
+
+        capture_accumulation(render_state, write_index);
+    }
 
     if (m_ray_debug_views.size() > 0)
         render_depth_prepass(render_state);
@@ -429,6 +611,83 @@ void Renderer::tone_map(vk::CommandBuffer::Ptr cmd_buf, vk::DescriptorSet::Ptr r
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void Renderer::composite_light_groups(vk::CommandBuffer::Ptr cmd_buf)
+{
+    HELIOS_SCOPED_SAMPLE("Light Group Composite");
+
+    auto backend = m_backend.lock();
+    auto extents = backend->swap_chain_extents();
+
+    {
+        VkMemoryBarrier memory_barrier;
+        memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memory_barrier.pNext         = nullptr;
+        memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+    }
+
+    VkRenderPassBeginInfo info    = {};
+    info.sType                    = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    info.renderPass               = m_light_group_composite_render_pass->handle();
+    info.framebuffer              = m_light_group_composite_framebuffer->handle();
+    info.renderArea.extent.width  = extents.width;
+    info.renderArea.extent.height = extents.height;
+    info.clearValueCount          = 0;
+    info.pClearValues             = nullptr;
+
+    vkCmdBeginRenderPass(cmd_buf->handle(), &info, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport vp;
+
+    vp.x        = 0.0f;
+    vp.y        = 0.0f;
+    vp.width    = (float)extents.width;
+    vp.height   = (float)extents.height;
+    vp.minDepth = 0.0f;
+    vp.maxDepth = 1.0f;
+
+    vkCmdSetViewport(cmd_buf->handle(), 0, 1, &vp);
+
+    VkRect2D scissor_rect;
+
+    scissor_rect.extent.width  = extents.width;
+    scissor_rect.extent.height = extents.height;
+    scissor_rect.offset.x      = 0;
+    scissor_rect.offset.y      = 0;
+
+    vkCmdSetScissor(cmd_buf->handle(), 0, 1, &scissor_rect);
+
+    vkCmdBindPipeline(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_light_group_composite_pipeline->handle());
+
+    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_light_group_composite_pipeline_layout->handle(), 0, 1, &m_light_group_combined_sampler_ds->handle(), 0, nullptr);
+
+    LightGroupCompositePushConstants pc;
+
+    for (int i = 0; i < MAX_LIGHT_GROUPS; i++)
+        pc.weights[i] = glm::vec4(m_light_group_tints[i] * m_light_group_scales[i], 0.0f);
+
+    vkCmdPushConstants(cmd_buf->handle(), m_light_group_composite_pipeline_layout->handle(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(LightGroupCompositePushConstants), &pc);
+
+    vkCmdDraw(cmd_buf->handle(), 3, 1, 0, 0);
+
+    vkCmdEndRenderPass(cmd_buf->handle());
+
+    // The next iteration must not accumulate into the light groups before they have been read
+    {
+        VkMemoryBarrier memory_barrier;
+        memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memory_barrier.pNext         = nullptr;
+        memory_barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 void Renderer::copy(vk::CommandBuffer::Ptr cmd_buf)
 {
     HELIOS_SCOPED_SAMPLE("Copy");
@@ -516,12 +775,8 @@ void Renderer::render_debug_visualization(RenderState& render_state)
 
     vkCmdBindDescriptorSets(render_state.cmd_buffer()->handle(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_debug_visualization_pipeline_layout->handle(), 0, 3, descriptor_sets, 0, nullptr);
 
-    const auto& meshes = render_state.meshes();
-
-    for (int mesh_idx = 0; mesh_idx < meshes.size(); mesh_idx++)
-    {
-        const auto& mesh = meshes[mesh_idx]->mesh();
-
+    // Instancers are drawn with hardware instancing, the shaders add gl_InstanceIndex to the instance ID.
+    auto draw_instances = [&](const Mesh::Ptr& mesh, uint32_t instance_id, uint32_t instance_count) {
         const VkBuffer     buffer = mesh->vertex_buffer()->handle();
         const VkDeviceSize size   = 0;
         vkCmdBindVertexBuffers(render_state.cmd_buffer()->handle(), 0, 1, &buffer, &size);
@@ -535,14 +790,31 @@ void Renderer::render_debug_visualization(RenderState& render_state)
 
             DebugVisualizationPushConstants push_constants;
             push_constants.view_proj             = render_state.camera()->projection_matrix() * render_state.camera()->view_matrix();
-            push_constants.instance_id           = mesh_idx;
+            push_constants.instance_id           = instance_id;
             push_constants.submesh_id            = submesh_idx;
             push_constants.current_output_buffer = m_current_output_buffer;
 
             vkCmdPushConstants(render_state.cmd_buffer()->handle(), m_debug_visualization_pipeline_layout->handle(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DebugVisualizationPushConstants), &push_constants);
 
-            vkCmdDrawIndexed(render_state.cmd_buffer()->handle(), submesh.index_count, 1, submesh.base_index, submesh.base_vertex, 0);
+            vkCmdDrawIndexed(render_state.cmd_buffer()->handle(), submesh.index_count, instance_count, submesh.base_index, submesh.base_vertex, 0);
         }
+    };
+
+    const auto& meshes = render_state.meshes();
+
+    for (int mesh_idx = 0; mesh_idx < meshes.size(); mesh_idx++)
+        draw_instances(meshes[mesh_idx]->mesh(), mesh_idx, 1);
+
+    uint32_t instance_id = meshes.size();
+
+    for (auto& instancer : render_state.instancers())
+    {
+        const uint32_t instance_count = std::min(instancer->instance_count(), render_state.num_instances() - instance_id);
+
+        if (instance_count > 0)
+            draw_instances(instancer->mesh(), instance_id, instance_count);
+
+        instance_id += instance_count;
     }
 }
 
@@ -601,12 +873,7 @@ void Renderer::render_depth_prepass(RenderState& render_state)
 
     vkCmdBindDescriptorSets(render_state.cmd_buffer()->handle(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_debug_visualization_pipeline_layout->handle(), 0, 3, descriptor_sets, 0, nullptr);
 
-    const auto& meshes = render_state.meshes();
-
-    for (int mesh_idx = 0; mesh_idx < meshes.size(); mesh_idx++)
-    {
-        const auto& mesh = meshes[mesh_idx]->mesh();
-
+    auto draw_instances = [&](const Mesh::Ptr& mesh, uint32_t instance_id, uint32_t instance_count) {
         const VkBuffer     buffer = mesh->vertex_buffer()->handle();
         const VkDeviceSize size   = 0;
         vkCmdBindVertexBuffers(render_state.cmd_buffer()->handle(), 0, 1, &buffer, &size);
@@ -620,13 +887,30 @@ void Renderer::render_depth_prepass(RenderState& render_state)
 
             DebugVisualizationPushConstants push_constants;
             push_constants.view_proj   = render_state.camera()->projection_matrix() * render_state.camera()->view_matrix();
-            push_constants.instance_id = mesh_idx;
+            push_constants.instance_id = instance_id;
             push_constants.submesh_id  = submesh_idx;
 
             vkCmdPushConstants(render_state.cmd_buffer()->handle(), m_debug_visualization_pipeline_layout->handle(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DebugVisualizationPushConstants), &push_constants);
 
-            vkCmdDrawIndexed(render_state.cmd_buffer()->handle(), submesh.index_count, 1, submesh.base_index, submesh.base_vertex, 0);
+            vkCmdDrawIndexed(render_state.cmd_buffer()->handle(), submesh.index_count, instance_count, submesh.base_index, submesh.base_vertex, 0);
         }
+    };
+
+    const auto& meshes = render_state.meshes();
+
+    for (int mesh_idx = 0; mesh_idx < meshes.size(); mesh_idx++)
+        draw_instances(meshes[mesh_idx]->mesh(), mesh_idx, 1);
+
+    uint32_t instance_id = meshes.size();
+
+    for (auto& instancer : render_state.instancers())
+    {
+        const uint32_t instance_count = std::min(instancer->instance_count(), render_state.num_instances() - instance_id);
+
+        if (instance_count > 0)
+            draw_instances(instancer->mesh(), instance_id, instance_count);
+
+        instance_id += instance_count;
     }
 
     vkCmdEndRenderPass(render_state.m_cmd_buffer->handle());
@@ -634,80 +918,226 @@ void Renderer::render_depth_prepass(RenderState& render_state)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Renderer::copy_and_save_tone_mapped_image(vk::CommandBuffer::Ptr cmd_buf)
+bool Renderer::save_tone_mapped_image(vk::CommandBuffer::Ptr cmd_buf, const std::string& path)
+{
+    // PNG encoding happens on the readback worker thread once the frame that recorded the copy has completed.
+    return m_image_readback->request(cmd_buf, m_tone_map_image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 4, [path](const void* data, size_t size, uint32_t width, uint32_t height) {
+        if (stbi_write_png(path.c_str(), width, height, 4, data, sizeof(char) * 4 * width) == 0)
+            HELIOS_LOG_ERROR("Failed to write image to disk: " + path);
+    });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Renderer::write_checkpoint(RenderState& render_state, uint32_t image_idx, const std::string& path)
+{
+    CheckpointHeader header;
+
+    header.width                   = m_output_images[image_idx]->width();
+    header.height                  = m_output_images[image_idx]->height();
+    header.num_accumulated_samples = m_path_integrator->num_tile_samples();
+    header.tile_idx                = m_path_integrator->tile_idx();
+    header.sample_idx              = m_path_integrator->num_tile_samples();
+    header.fingerprint             = checkpoint::fingerprint(render_state, m_path_integrator, header.width, header.height);
+    header.tiled                   = m_path_integrator->is_tiled();
+    header.split_mode              = m_path_integrator->job_split_mode();
+    header.job_index               = m_path_integrator->job_index();
+    header.job_count               = m_path_integrator->job_count();
+    header.job_samples             = m_path_integrator->job_samples();
+    header.sample_offset           = m_path_integrator->sample_offset();
+
+    return m_image_readback->request(render_state.m_cmd_buffer, m_output_images[image_idx], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, sizeof(float) * 4, [path, header](const void* data, size_t size, uint32_t width, uint32_t height) {
+        checkpoint::write(path, header, (const float*)data);
+    });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::capture_accumulation(RenderState& render_state, uint32_t image_idx)
+{
+    const uint32_t num_samples = m_path_integrator->num_accumulated_samples();
+
+    if (m_capture_idx == m_capture_samples.size() || m_capture_samples[m_capture_idx] > num_samples)
+        return;
+
+    AccumulationCallback callback = m_capture_callback;
+
+    auto readback_callback = [callback, num_samples](const void* data, size_t size, uint32_t width, uint32_t height) {
+        callback((const float*)data, width, height, num_samples);
+    };
+
+    // Waiting for a slot would stall the frame, so if every readback slot is busy try again next frame with the samples reached by then.
+    if (!m_image_readback->request(render_state.m_cmd_buffer, m_output_images[image_idx], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, sizeof(float) * 4, readback_callback))
+        return;
+
+    while (m_capture_idx < m_capture_samples.size() && m_capture_samples[m_capture_idx] <= num_samples)
+        m_capture_idx++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::upload_checkpoint(RenderState& render_state)
 {
     auto backend = m_backend.lock();
     auto extents = backend->swap_chain_extents();
 
-    if (m_copy_started)
-    {
-        backend->wait_idle();
+    m_resume_pending = false;
 
-        // Get layout of the image (including row pitch)
-        VkImageSubresource  subResource { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0 };
-        VkSubresourceLayout subResourceLayout;
-        vkGetImageSubresourceLayout(backend->device(), m_save_to_disk_image->handle(), &subResource, &subResourceLayout);
+    if (m_resume_header.width != extents.width || m_resume_header.height != extents.height)
+    {
+        HELIOS_LOG_ERROR("Checkpoint resolution does not match the output resolution, starting from scratch.");
+        m_resume_data.clear();
+        return;
+    }
 
-        if (stbi_write_png(m_image_save_path.c_str(), extents.width, extents.height, 4, m_save_to_disk_image->mapped_ptr(), sizeof(char) * 4 * extents.width) == 0)
-            HELIOS_LOG_ERROR("Failed to write image to disk.");
+    if (m_resume_header.fingerprint != checkpoint::fingerprint(render_state, m_path_integrator, extents.width, extents.height))
+    {
+        HELIOS_LOG_ERROR("Checkpoint was taken from a different scene, camera or integrator setup, starting from scratch.");
+        m_resume_data.clear();
+        return;
+    }
 
-        m_copy_started       = false;
-        m_save_image_to_disk = false;
-        m_image_save_path    = "";
+    if (m_resume_header.split_mode != m_path_integrator->job_split_mode() || m_resume_header.job_index != m_path_integrator->job_index() || m_resume_header.job_count != m_path_integrator->job_count())
+    {
+        HELIOS_LOG_ERROR("Checkpoint belongs to a different render job, starting from scratch.");
+        m_resume_data.clear();
+        return;
     }
-    else
+
+    vk::Buffer::Ptr staging = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, sizeof(float) * m_resume_data.size(), VMA_MEMORY_USAGE_CPU_ONLY, VMA_ALLOCATION_CREATE_MAPPED_BIT, m_resume_data.data());
+
+    VkImageSubresourceRange subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    VkBufferImageCopy copy_region;
+    HELIOS_ZERO_MEMORY(copy_region);
+
+    copy_region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copy_region.imageSubresource.layerCount = 1;
+    copy_region.imageExtent.width           = extents.width;
+    copy_region.imageExtent.height          = extents.height;
+    copy_region.imageExtent.depth           = 1;
+
+    const uint32_t write_index = (uint32_t)m_output_ping_pong;
+
+    for (uint32_t i = 0; i < 2; i++)
     {
-        VkImageSubresourceRange subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        // Leave both images in the layouts render() expects at the start of a regular frame
+        const VkImageLayout final_layout = i == write_index ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
         vk::utilities::set_image_layout(
-            cmd_buf->handle(),
-            m_tone_map_image->handle(),
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            render_state.m_cmd_buffer->handle(),
+            m_output_images[i]->handle(),
+            m_output_image_recreated ? VK_IMAGE_LAYOUT_UNDEFINED : final_layout,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             subresource_range);
 
+        vkCmdCopyBufferToImage(render_state.m_cmd_buffer->handle(), staging->handle(), m_output_images[i]->handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy_region);
+
         vk::utilities::set_image_layout(
-            cmd_buf->handle(),
-            m_save_to_disk_image->handle(),
-            VK_IMAGE_LAYOUT_UNDEFINED,
+            render_state.m_cmd_buffer->handle(),
+            m_output_images[i]->handle(),
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            final_layout,
             subresource_range);
+    }
 
-        VkImageCopy image_copy_region {};
-        image_copy_region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        image_copy_region.srcSubresource.layerCount = 1;
-        image_copy_region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        image_copy_region.dstSubresource.layerCount = 1;
-        image_copy_region.extent.width              = extents.width;
-        image_copy_region.extent.height             = extents.height;
-        image_copy_region.extent.depth              = 1;
-
-        // Issue the copy command
-        vkCmdCopyImage(
-            cmd_buf->handle(),
-            m_tone_map_image->handle(),
-            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-            m_save_to_disk_image->handle(),
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &image_copy_region);
+    backend->queue_object_deletion(staging);
 
-        vk::utilities::set_image_layout(
-            cmd_buf->handle(),
-            m_tone_map_image->handle(),
-            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-            subresource_range);
+    // Checkpoints only hold the total, so the light group layers start over with their own sample count
+    if (m_light_groups_enabled)
+    {
+        VkImageSubresourceRange light_group_subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, MAX_LIGHT_GROUPS };
 
-        vk::utilities::set_image_layout(
-            cmd_buf->handle(),
-            m_save_to_disk_image->handle(),
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            VK_IMAGE_LAYOUT_GENERAL,
-            subresource_range);
+        if (m_light_group_recreated)
+        {
+            vk::utilities::set_image_layout(
+                render_state.m_cmd_buffer->handle(),
+                m_light_group_image->handle(),
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_GENERAL,
+                light_group_subresource_range);
+
+            m_light_group_recreated = false;
+        }
+
+        VkClearColorValue color;
 
-        m_copy_started = true;
+        color.float32[0] = 0.0f;
+        color.float32[1] = 0.0f;
+        color.float32[2] = 0.0f;
+        color.float32[3] = 1.0f;
+
+        vkCmdClearColorImage(render_state.m_cmd_buffer->handle(), m_light_group_image->handle(), VK_IMAGE_LAYOUT_GENERAL, &color, 1, &light_group_subresource_range);
+
+        VkMemoryBarrier memory_barrier;
+        memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memory_barrier.pNext         = nullptr;
+        memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(render_state.m_cmd_buffer->handle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+        m_light_groups_resumed = true;
+        HELIOS_LOG_INFO("Light groups do not survive a checkpoint, showing the total until the accumulation restarts.");
     }
+
+    m_output_image_recreated = false;
+    m_path_integrator->restore_progress(m_resume_header.num_accumulated_samples, m_resume_header.tile_idx);
+
+    m_resume_data.clear();
+    m_resume_data.shrink_to_fit();
+
+    HELIOS_LOG_INFO("Resumed accumulation from checkpoint at " + std::to_string(m_path_integrator->num_accumulated_samples()) + " samples.");
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::copy_completed_tile(RenderState& render_state, uint32_t tile_idx)
+{
+    // A finished tile is only present in the image written this frame, the other image still holds the tile minus its final sample.
+    // Copy it across so that both images agree on every completed tile, no matter which one is read back later.
+    const uint32_t write_index = (uint32_t)m_output_ping_pong;
+    const uint32_t read_index  = (uint32_t)!m_output_ping_pong;
+
+    auto tile_coord  = m_path_integrator->tile_coord(tile_idx);
+    auto tile_extent = PathIntegrator::tile_size(m_output_images[write_index]->width(), m_output_images[write_index]->height(), true);
+
+    VkMemoryBarrier memory_barrier;
+    HELIOS_ZERO_MEMORY(memory_barrier);
+
+    memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(render_state.m_cmd_buffer->handle(), VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+    VkImageCopy image_copy_region;
+    HELIOS_ZERO_MEMORY(image_copy_region);
+
+    image_copy_region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    image_copy_region.srcSubresource.layerCount = 1;
+    image_copy_region.srcOffset.x               = tile_coord.x;
+    image_copy_region.srcOffset.y               = tile_coord.y;
+    image_copy_region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    image_copy_region.dstSubresource.layerCount = 1;
+    image_copy_region.dstOffset.x               = tile_coord.x;
+    image_copy_region.dstOffset.y               = tile_coord.y;
+    image_copy_region.extent.width              = std::min(tile_extent.x, m_output_images[write_index]->width() - tile_coord.x);
+    image_copy_region.extent.height             = std::min(tile_extent.y, m_output_images[write_index]->height() - tile_coord.y);
+    image_copy_region.extent.depth              = 1;
+
+    vkCmdCopyImage(render_state.m_cmd_buffer->handle(),
+                   m_output_images[write_index]->handle(),
+                   VK_IMAGE_LAYOUT_GENERAL,
+                   m_output_images[read_index]->handle(),
+                   VK_IMAGE_LAYOUT_GENERAL,
+                   1,
+                   &image_copy_region);
+
+    memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(render_state.m_cmd_buffer->handle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -721,15 +1151,61 @@ void Renderer::on_window_resize()
     backend->wait_idle();
 
     create_output_images();
+    create_light_group_images();
     create_tone_map_framebuffer();
     create_swapchain_framebuffers();
     create_depth_prepass_framebuffer();
     update_dynamic_descriptor_sets();
+    update_light_group_descriptor_sets();
     m_path_integrator->on_window_resize();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void Renderer::set_light_groups_enabled(bool enabled)
+{
+    if (m_light_groups_enabled == enabled)
+        return;
+
+    auto backend = m_backend.lock();
+
+    // The light group descriptor sets may still be referenced by frames in flight
+    backend->wait_idle();
+
+    m_light_groups_enabled = enabled;
+
+    create_light_group_images();
+    update_light_group_descriptor_sets();
+    m_path_integrator->set_light_groups_enabled(enabled);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::bake_probes(ProbeVolumeNode::Ptr node, const ProbeBakeSettings& settings, const std::string& path)
+{
+    m_probe_bake      = m_path_integrator->create_probe_bake(node, settings);
+    m_probe_bake_path = path;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::bake_lightmap(MeshNode::Ptr node, const LightmapBakeSettings& settings, const std::string& path)
+{
+    m_lightmap_bake      = m_path_integrator->create_lightmap_bake(node, settings);
+    m_lightmap_bake_path = path;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::render_cubemap(const glm::vec3& position, uint32_t size, uint32_t num_samples, const std::string& path)
+{
+    m_cubemap         = m_path_integrator->create_view_set(size, size, ViewSet::cubemap_views(position));
+    m_cubemap_samples = std::max(num_samples, 1u);
+    m_cubemap_path    = path;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 void Renderer::add_ray_debug_view(const glm::ivec2& pixel_coord, const uint32_t& num_debug_rays, const glm::mat4& view, const glm::mat4& projection)
 {
     m_ray_debug_views.push_back({ pixel_coord, num_debug_rays, view, projection });
@@ -766,6 +1242,88 @@ void Renderer::save_image_to_disk(const std::string& path)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void Renderer::set_progress_snapshots(uint32_t sample_interval, const std::string& path)
+{
+    if (sample_interval > 0 && path.length() == 0)
+    {
+        HELIOS_LOG_ERROR("A valid path is required to save progress snapshots");
+        return;
+    }
+
+    m_snapshot_interval    = sample_interval;
+    m_snapshot_path        = path;
+    m_last_snapshot_sample = 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::save_checkpoint(const std::string& path)
+{
+    if (path.length() == 0)
+    {
+        HELIOS_LOG_ERROR("A valid path is required to save a checkpoint");
+        return;
+    }
+
+    m_save_checkpoint      = true;
+    m_checkpoint_save_path = path;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::set_checkpoint_interval(uint32_t sample_interval, const std::string& path)
+{
+    if (sample_interval > 0 && path.length() == 0)
+    {
+        HELIOS_LOG_ERROR("A valid path is required to save checkpoints");
+        return;
+    }
+
+    m_checkpoint_interval    = sample_interval;
+    m_checkpoint_path        = path;
+    m_last_checkpoint_sample = 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::set_job_output(const std::string& path)
+{
+    m_job_output_path      = path;
+    m_job_output_requested = false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::set_accumulation_captures(const std::vector<uint32_t>& sample_counts, AccumulationCallback callback)
+{
+    m_capture_samples  = sample_counts;
+    m_capture_idx      = 0;
+    m_capture_callback = callback;
+
+    std::sort(m_capture_samples.begin(), m_capture_samples.end());
+
+    // Skip counts that were already passed, e.g. when the captures are set up in the middle of a bake.
+    const uint32_t num_samples = m_path_integrator->num_accumulated_samples();
+
+    while (m_capture_idx < m_capture_samples.size() && m_capture_samples[m_capture_idx] < num_samples)
+        m_capture_idx++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Renderer::resume_from_checkpoint(const std::string& path)
+{
+    if (!checkpoint::read(path, m_resume_header, m_resume_data))
+        return false;
+
+    // The upload is deferred until the scene is ready so that the fingerprint can be validated against it.
+    m_resume_pending = true;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 void Renderer::create_tone_map_render_pass()
 {
     auto backend = m_backend.lock();
@@ -835,6 +1393,63 @@ void Renderer::create_tone_map_framebuffer()
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void Renderer::create_light_group_composite_render_pass()
+{
+    auto backend = m_backend.lock();
+
+    VkAttachmentDescription attachment;
+    HELIOS_ZERO_MEMORY(attachment);
+
+    // Color attachment, every pixel is overwritten so the previous contents are not needed
+    attachment.format         = VK_FORMAT_R32G32B32A32_SFLOAT;
+    attachment.samples        = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp         = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment.finalLayout    = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkAttachmentReference color_reference;
+    color_reference.attachment = 0;
+    color_reference.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    std::vector<VkSubpassDescription> subpass_description(1);
+
+    subpass_description[0].pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass_description[0].colorAttachmentCount    = 1;
+    subpass_description[0].pColorAttachments       = &color_reference;
+    subpass_description[0].pDepthStencilAttachment = nullptr;
+    subpass_description[0].inputAttachmentCount    = 0;
+    subpass_description[0].pInputAttachments       = nullptr;
+    subpass_description[0].preserveAttachmentCount = 0;
+    subpass_description[0].pPreserveAttachments    = nullptr;
+    subpass_description[0].pResolveAttachments     = nullptr;
+
+    // Subpass dependencies for layout transitions
+    std::vector<VkSubpassDependency> dependencies(2);
+
+    dependencies[0].srcSubpass      = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass      = 0;
+    dependencies[0].srcStageMask    = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[0].dstStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].srcAccessMask   = VK_ACCESS_SHADER_READ_BIT;
+    dependencies[0].dstAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    dependencies[1].srcSubpass      = 0;
+    dependencies[1].dstSubpass      = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].dstStageMask    = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[1].srcAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstAccessMask   = VK_ACCESS_SHADER_READ_BIT;
+    dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    m_light_group_composite_render_pass = vk::RenderPass::create(backend, { attachment }, subpass_description, dependencies);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 void Renderer::create_depth_prepass_render_pass()
 {
     auto backend = m_backend.lock();
@@ -1008,7 +1623,23 @@ void Renderer::create_tone_map_pipeline()
     pl_desc.add_push_constant_range(VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(ToneMapPushConstants));
 
     m_tone_map_pipeline_layout = vk::PipelineLayout::create(backend, pl_desc);
-    m_tone_map_pipeline        = vk::GraphicsPipeline::create_for_post_process(backend, "assets/shader/triangle.vert.spv", "assets/shader/tone_map.frag.spv", m_tone_map_pipeline_layout, m_tone_map_render_pass);
+    m_tone_map_pipeline        = vk::GraphicsPipeline::create_for_post_process(backend, m_shader_cache->load("triangle.vert"), m_shader_cache->load("tone_map.frag"), m_tone_map_pipeline_layout, m_tone_map_render_pass);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::create_light_group_composite_pipeline()
+{
+    auto backend = m_backend.lock();
+
+    vk::PipelineLayout::Desc pl_desc;
+
+    pl_desc.add_descriptor_set_layout(backend->combined_sampler_descriptor_set_layout());
+
+    pl_desc.add_push_constant_range(VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(LightGroupCompositePushConstants));
+
+    m_light_group_composite_pipeline_layout = vk::PipelineLayout::create(backend, pl_desc);
+    m_light_group_composite_pipeline        = vk::GraphicsPipeline::create_for_post_process(backend, m_shader_cache->load("triangle.vert"), m_shader_cache->load("light_group_composite.frag"), m_light_group_composite_pipeline_layout, m_light_group_composite_render_pass);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -1022,7 +1653,7 @@ void Renderer::create_copy_pipeline()
     ds_desc.add_descriptor_set_layout(backend->combined_sampler_descriptor_set_layout());
 
     m_copy_pipeline_layout = vk::PipelineLayout::create(backend, ds_desc);
-    m_copy_pipeline        = vk::GraphicsPipeline::create_for_post_process(backend, "assets/shader/triangle.vert.spv", "assets/shader/copy.frag.spv", m_copy_pipeline_layout, backend->swapchain_render_pass());
+    m_copy_pipeline        = vk::GraphicsPipeline::create_for_post_process(backend, m_shader_cache->load("triangle.vert"), m_shader_cache->load("copy.frag"), m_copy_pipeline_layout, backend->swapchain_render_pass());
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -1037,8 +1668,8 @@ void Renderer::create_ray_debug_pipeline()
 
     std::vector<char> spirv;
 
-    vk::ShaderModule::Ptr vs = vk::ShaderModule::create_from_file(backend, "assets/shader/debug_ray.vert.spv");
-    vk::ShaderModule::Ptr fs = vk::ShaderModule::create_from_file(backend, "assets/shader/debug_ray.frag.spv");
+    vk::ShaderModule::Ptr vs = m_shader_cache->load("debug_ray.vert");
+    vk::ShaderModule::Ptr fs = m_shader_cache->load("debug_ray.frag");
 
     vk::GraphicsPipeline::Desc pso_desc;
 
@@ -1185,8 +1816,8 @@ void Renderer::create_debug_visualization_pipeline()
 
     std::vector<char> spirv;
 
-    vk::ShaderModule::Ptr vs = vk::ShaderModule::create_from_file(backend, "assets/shader/debug_visualization.vert.spv");
-    vk::ShaderModule::Ptr fs = vk::ShaderModule::create_from_file(backend, "assets/shader/debug_visualization.frag.spv");
+    vk::ShaderModule::Ptr vs = m_shader_cache->load("debug_visualization.vert");
+    vk::ShaderModule::Ptr fs = m_shader_cache->load("debug_visualization.frag");
 
     vk::GraphicsPipeline::Desc pso_desc;
 
@@ -1339,8 +1970,8 @@ void Renderer::create_depth_prepass_pipeline()
 
     std::vector<char> spirv;
 
-    vk::ShaderModule::Ptr vs = vk::ShaderModule::create_from_file(backend, "assets/shader/depth_prepass.vert.spv");
-    vk::ShaderModule::Ptr fs = vk::ShaderModule::create_from_file(backend, "assets/shader/empty.frag.spv");
+    vk::ShaderModule::Ptr vs = m_shader_cache->load("depth_prepass.vert");
+    vk::ShaderModule::Ptr fs = m_shader_cache->load("empty.frag");
 
     vk::GraphicsPipeline::Desc pso_desc;
 
@@ -1490,17 +2121,50 @@ void Renderer::create_output_images()
         backend->queue_object_deletion(m_output_image_views[i]);
         backend->queue_object_deletion(m_output_images[i]);
 
-        m_output_images[i]      = vk::Image::create(backend, VK_IMAGE_TYPE_2D, extents.width, extents.height, 1, 1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_SAMPLE_COUNT_1_BIT);
+        m_output_images[i]      = vk::Image::create(backend, VK_IMAGE_TYPE_2D, extents.width, extents.height, 1, 1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_SAMPLE_COUNT_1_BIT);
         m_output_image_views[i] = vk::ImageView::create(backend, m_output_images[i], VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT);
     }
 
     backend->queue_object_deletion(m_tone_map_image_view);
     backend->queue_object_deletion(m_tone_map_image);
-    backend->queue_object_deletion(m_save_to_disk_image);
 
     m_tone_map_image      = vk::Image::create(backend, VK_IMAGE_TYPE_2D, extents.width, extents.height, 1, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_SAMPLE_COUNT_1_BIT);
     m_tone_map_image_view = vk::ImageView::create(backend, m_tone_map_image, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT);
-    m_save_to_disk_image  = vk::Image::create(backend, VK_IMAGE_TYPE_2D, extents.width, extents.height, 1, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, VMA_MEMORY_USAGE_GPU_TO_CPU, VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0, nullptr, 0, VK_IMAGE_TILING_LINEAR);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::create_light_group_images()
+{
+    auto backend = m_backend.lock();
+    auto extents = backend->swap_chain_extents();
+
+    backend->queue_object_deletion(m_light_group_composite_framebuffer);
+    backend->queue_object_deletion(m_light_group_composite_image_view);
+    backend->queue_object_deletion(m_light_group_composite_image);
+    backend->queue_object_deletion(m_light_group_image_view);
+    backend->queue_object_deletion(m_light_group_image);
+
+    // The light groups cost MAX_LIGHT_GROUPS extra accumulation buffers, so they only exist while enabled
+    if (!m_light_groups_enabled)
+    {
+        m_light_group_composite_framebuffer.reset();
+        m_light_group_composite_image_view.reset();
+        m_light_group_composite_image.reset();
+        m_light_group_image_view.reset();
+        m_light_group_image.reset();
+
+        return;
+    }
+
+    m_light_group_image      = vk::Image::create(backend, VK_IMAGE_TYPE_2D, extents.width, extents.height, 1, 1, MAX_LIGHT_GROUPS, VK_FORMAT_R32G32B32A32_SFLOAT, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_SAMPLE_COUNT_1_BIT);
+    m_light_group_image_view = vk::ImageView::create(backend, m_light_group_image, VK_IMAGE_VIEW_TYPE_2D_ARRAY, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, MAX_LIGHT_GROUPS);
+
+    m_light_group_composite_image       = vk::Image::create(backend, VK_IMAGE_TYPE_2D, extents.width, extents.height, 1, 1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_SAMPLE_COUNT_1_BIT);
+    m_light_group_composite_image_view  = vk::ImageView::create(backend, m_light_group_composite_image, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT);
+    m_light_group_composite_framebuffer = vk::Framebuffer::create(backend, m_light_group_composite_render_pass, { m_light_group_composite_image_view }, extents.width, extents.height, 1);
+
+    m_light_group_recreated = true;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -1573,6 +2237,10 @@ void Renderer::create_dynamic_descriptor_sets()
     }
 
     m_tone_map_ds = backend->allocate_descriptor_set(backend->combined_sampler_descriptor_set_layout());
+
+    m_light_group_storage_image_ds    = backend->allocate_descriptor_set(backend->image_descriptor_set_layout());
+    m_light_group_combined_sampler_ds = backend->allocate_descriptor_set(backend->combined_sampler_descriptor_set_layout());
+    m_light_group_composite_ds        = backend->allocate_descriptor_set(backend->combined_sampler_descriptor_set_layout());
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -1668,5 +2336,54 @@ void Renderer::update_dynamic_descriptor_sets()
     vkUpdateDescriptorSets(backend->device(), write_datas.size(), &write_datas[0], 0, nullptr);
 }
 
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Renderer::update_light_group_descriptor_sets()
+{
+    if (!m_light_groups_enabled)
+        return;
+
+    auto backend = m_backend.lock();
+
+    VkDescriptorImageInfo image_descriptors[3];
+
+    HELIOS_ZERO_MEMORY(image_descriptors[0]);
+
+    image_descriptors[0].sampler     = nullptr;
+    image_descriptors[0].imageView   = m_light_group_image_view->handle();
+    image_descriptors[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    HELIOS_ZERO_MEMORY(image_descriptors[1]);
+
+    image_descriptors[1].sampler     = backend->nearest_sampler()->handle();
+    image_descriptors[1].imageView   = m_light_group_image_view->handle();
+    image_descriptors[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    HELIOS_ZERO_MEMORY(image_descriptors[2]);
+
+    image_descriptors[2].sampler     = backend->bilinear_sampler()->handle();
+    image_descriptors[2].imageView   = m_light_group_composite_image_view->handle();
+    image_descriptors[2].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    const VkDescriptorType       descriptor_types[] = { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER };
+    const vk::DescriptorSet::Ptr descriptor_sets[]  = { m_light_group_storage_image_ds, m_light_group_combined_sampler_ds, m_light_group_composite_ds };
+
+    VkWriteDescriptorSet write_datas[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        HELIOS_ZERO_MEMORY(write_datas[i]);
+
+        write_datas[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write_datas[i].descriptorCount = 1;
+        write_datas[i].descriptorType  = descriptor_types[i];
+        write_datas[i].pImageInfo      = &image_descriptors[i];
+        write_datas[i].dstBinding      = 0;
+        write_datas[i].dstSet          = descriptor_sets[i]->handle();
+    }
+
+    vkUpdateDescriptorSets(backend->device(), 3, &write_datas[0], 0, nullptr);
+}
+
 // -----------------------------------------------------------------------------------------------------------------------------------
 } // namespace helios
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include <gfx/shader_cache.h>
+#include <utility/utility.h>
+#include <utility/logger.h>
+#include <glslang/Public/ShaderLang.h>
+#include <SPIRV/GlslangToSpv.h>
+#include <StandAlone/ResourceLimits.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace helios
+{
+// Bump whenever the compiler options change so that stale SPIR-V is not picked up from the disk cache.
+#define SHADER_CACHE_VERSION 1
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static const char* kShaderSourceDirectory = "assets/shader/src/";
+static const char* kShaderCacheDirectory  = "shader_cache/";
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool read_text_file(const std::string& path, std::string& text)
+{
+    std::ifstream file(path);
+
+    if (!file.is_open())
+        return false;
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+
+    text = stream.str();
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// 64-bit FNV-1a
+static uint64_t hash_string(const std::string& str, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < str.size(); i++)
+    {
+        hash ^= (uint8_t)str[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool find_stage(const std::string& path, EShLanguage& stage)
+{
+    static const std::unordered_map<std::string, EShLanguage> kStages = {
+        { ".vert", EShLangVertex },
+        { ".frag", EShLangFragment },
+        { ".comp", EShLangCompute },
+        { ".rgen", EShLangRayGen },
+        { ".rchit", EShLangClosestHit },
+        { ".rahit", EShLangAnyHit },
+        { ".rmiss", EShLangMiss },
+        { ".rint", EShLangIntersect },
+        { ".rcall", EShLangCallable }
+    };
+
+    auto it = kStages.find(utility::file_extension(path));
+
+    if (it == kStages.end())
+        return false;
+
+    stage = it->second;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+class ShaderIncluder : public glslang::TShader::Includer
+{
+public:
+    IncludeResult* includeLocal(const char* header_name, const char* includer_name, size_t inclusion_depth) override
+    {
+        std::string  path   = utility::path_for_resource(kShaderSourceDirectory + std::string(header_name));
+        std::string* source = new std::string();
+
+        if (!read_text_file(path, *source))
+        {
+            delete source;
+            return nullptr;
+        }
+
+        return new IncludeResult(path, source->c_str(), source->size(), source);
+    }
+
+    void releaseInclude(IncludeResult* result) override
+    {
+        if (result)
+        {
+            delete (std::string*)result->userData;
+            delete result;
+        }
+    }
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderCache::ShaderCache(vk::Backend::Ptr backend) :
+    m_backend(backend)
+{
+    glslang::InitializeProcess();
+
+    std::error_code ec;
+    std::filesystem::create_directories(utility::path_for_resource(kShaderCacheDirectory), ec);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderCache::~ShaderCache()
+{
+    m_modules.clear();
+
+    glslang::FinalizeProcess();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+vk::ShaderModule::Ptr ShaderCache::load(const std::string& path, const std::vector<std::string>& defines)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Hashing the fully gathered source means that editing an included file invalidates every permutation that depends on it.
+    std::string              sources;
+    std::vector<std::string> visited;
+
+    if (!gather_sources(path, sources, visited))
+    {
+        HELIOS_LOG_FATAL("Failed to read shader source: " + path);
+        throw std::runtime_error("Failed to read shader source: " + path);
+    }
+
+    uint64_t hash = hash_string(sources);
+
+    hash = hash_string(path, hash);
+    hash = hash_string(std::to_string(SHADER_CACHE_VERSION), hash);
+
+    for (auto& define : defines)
+        hash = hash_string(define + "\n", hash);
+
+    auto it = m_modules.find(hash);
+
+    if (it != m_modules.end())
+        return it->second;
+
+    auto backend = m_backend.lock();
+
+    char hash_str[17];
+    snprintf(hash_str, sizeof(hash_str), "%016llx", (unsigned long long)hash);
+
+    std::string       cache_path = utility::path_for_resource(kShaderCacheDirectory + std::string(hash_str) + ".spv");
+    std::vector<char> spirv;
+
+    std::ifstream cache_file(cache_path, std::ios::ate | std::ios::binary);
+
+    if (cache_file.is_open())
+    {
+        spirv.resize((size_t)cache_file.tellg());
+
+        cache_file.seekg(0);
+
+        if (!cache_file.read(spirv.data(), spirv.size()) || spirv.size() % sizeof(uint32_t) != 0)
+            spirv.clear();
+    }
+
+    if (spirv.size() == 0)
+    {
+        std::vector<uint32_t> words;
+
+        if (!compile(path, defines, words))
+        {
+            HELIOS_LOG_FATAL("Failed to compile shader: " + path);
+            throw std::runtime_error("Failed to compile shader: " + path);
+        }
+
+        spirv.resize(words.size() * sizeof(uint32_t));
+        memcpy(spirv.data(), words.data(), spirv.size());
+
+        // Write under a temporary name first so that a concurrent job never reads a partial file
+        std::string temp_path = cache_path + ".tmp";
+
+        {
+            std::ofstream file(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+            if (file.is_open())
+                file.write(spirv.data(), spirv.size());
+        }
+
+        remove(cache_path.c_str());
+        rename(temp_path.c_str(), cache_path.c_str());
+    }
+
+    vk::ShaderModule::Ptr module = vk::ShaderModule::create(backend, spirv);
+
+    m_modules[hash] = module;
+
+    return module;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderCache::gather_sources(const std::string& path, std::string& sources, std::vector<std::string>& visited)
+{
+    if (std::find(visited.begin(), visited.end(), path) != visited.end())
+        return true;
+
+    visited.push_back(path);
+
+    std::string source;
+
+    if (!read_text_file(utility::path_for_resource(kShaderSourceDirectory + path), source))
+        return false;
+
+    sources += source;
+
+    std::istringstream stream(source);
+    std::string        line;
+
+    while (std::getline(stream, line))
+    {
+        size_t include_pos = line.find("#include");
+
+        if (include_pos == std::string::npos)
+            continue;
+
+        size_t begin = line.find('"', include_pos);
+        size_t end   = line.find('"', begin + 1);
+
+        if (begin != std::string::npos && end != std::string::npos)
+        {
+            if (!gather_sources(line.substr(begin + 1, end - begin - 1), sources, visited))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderCache::compile(const std::string& path, const std::vector<std::string>& defines, std::vector<uint32_t>& spirv)
+{
+    EShLanguage stage;
+
+    if (!find_stage(path, stage))
+    {
+        HELIOS_LOG_ERROR("Unknown shader stage: " + path);
+        return false;
+    }
+
+    std::string source;
+
+    if (!read_text_file(utility::path_for_resource(kShaderSourceDirectory + path), source))
+        return false;
+
+    std::string preamble;
+
+    for (auto& define : defines)
+        preamble += "#define " + define + "\n";
+
+    const char* source_str = source.c_str();
+    const char* name_str   = path.c_str();
+
+    glslang::TShader shader(stage);
+
+    shader.setStringsWithLengthsAndNames(&source_str, nullptr, &name_str, 1);
+    shader.setPreamble(preamble.c_str());
+    shader.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_2);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_4);
+
+    EShMessages    messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
+    ShaderIncluder includer;
+
+    if (!shader.parse(&glslang::DefaultTBuiltInResource, 460, false, messages, includer))
+    {
+        HELIOS_LOG_ERROR(std::string(shader.getInfoLog()));
+        return false;
+    }
+
+    glslang::TProgram program;
+
+    program.addShader(&shader);
+
+    if (!program.link(messages))
+    {
+        HELIOS_LOG_ERROR(std::string(program.getInfoLog()));
+        return false;
+    }
+
+    glslang::GlslangToSpv(*program.getIntermediate(stage), spirv);
+
+    HELIOS_LOG_INFO("Compiled shader permutation: " + path + (preamble.length() > 0 ? " (" + std::to_string(defines.size()) + " defines)" : ""));
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace helios
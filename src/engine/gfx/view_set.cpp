@@ -0,0 +1,318 @@
+#include <gfx/view_set.h>
+#include <utility/macros.h>
+#include <utility/logger.h>
+#include <vk_mem_alloc.h>
+#include <stb_image_write.h>
+#include <gtc/matrix_transform.hpp>
+
+namespace helios
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Keep in sync with View in common.glsl
+struct ViewData
+{
+    glm::mat4  view_proj_inverse;
+    glm::vec4  camera_pos;
+    glm::vec4  up_direction;
+    glm::vec4  right_direction;
+    glm::vec4  focal_plane;
+    glm::uvec4 projection; // x: projection type, y: cubemap face
+    glm::vec4  lens;       // x: aperture radius
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ViewSet::ViewSet(vk::Backend::Ptr backend, vk::DescriptorSetLayout::Ptr view_ds_layout, uint32_t width, uint32_t height, const std::vector<View>& views) :
+    m_backend(backend), m_width(width), m_height(height), m_views(views)
+{
+    if (m_views.size() == 0 || m_views.size() > MAX_VIEWS_PER_LAUNCH)
+    {
+        HELIOS_LOG_FATAL("A view set needs between 1 and " + std::to_string(MAX_VIEWS_PER_LAUNCH) + " views, got " + std::to_string(m_views.size()));
+        throw std::runtime_error("A view set needs between 1 and " + std::to_string(MAX_VIEWS_PER_LAUNCH) + " views");
+    }
+
+    const uint32_t num_views = m_views.size();
+
+    for (int i = 0; i < 2; i++)
+    {
+        m_output_images[i]      = vk::Image::create(backend, VK_IMAGE_TYPE_2D, m_width, m_height, 1, 1, num_views, VK_FORMAT_R32G32B32A32_SFLOAT, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_SAMPLE_COUNT_1_BIT);
+        m_output_image_views[i] = vk::ImageView::create(backend, m_output_images[i], VK_IMAGE_VIEW_TYPE_2D_ARRAY, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, num_views);
+        m_output_images[i]->set_name("View Set Output " + std::to_string(i));
+
+        m_output_storage_image_ds[i] = backend->allocate_descriptor_set(backend->image_descriptor_set_layout());
+    }
+
+    m_view_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(ViewData) * num_views, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    m_view_buffer->set_name("View Set Views");
+
+    m_view_ds = backend->allocate_descriptor_set(view_ds_layout);
+
+    VkDescriptorImageInfo image_infos[2];
+    VkDescriptorBufferInfo buffer_info;
+    VkWriteDescriptorSet   write_datas[3];
+
+    for (int i = 0; i < 2; i++)
+    {
+        HELIOS_ZERO_MEMORY(image_infos[i]);
+
+        image_infos[i].sampler     = nullptr;
+        image_infos[i].imageView   = m_output_image_views[i]->handle();
+        image_infos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        HELIOS_ZERO_MEMORY(write_datas[i]);
+
+        write_datas[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write_datas[i].descriptorCount = 1;
+        write_datas[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        write_datas[i].pImageInfo      = &image_infos[i];
+        write_datas[i].dstBinding      = 0;
+        write_datas[i].dstSet          = m_output_storage_image_ds[i]->handle();
+    }
+
+    HELIOS_ZERO_MEMORY(buffer_info);
+
+    buffer_info.buffer = m_view_buffer->handle();
+    buffer_info.offset = 0;
+    buffer_info.range  = VK_WHOLE_SIZE;
+
+    HELIOS_ZERO_MEMORY(write_datas[2]);
+
+    write_datas[2].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write_datas[2].descriptorCount = 1;
+    write_datas[2].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write_datas[2].pBufferInfo     = &buffer_info;
+    write_datas[2].dstBinding      = 0;
+    write_datas[2].dstSet          = m_view_ds->handle();
+
+    vkUpdateDescriptorSets(backend->device(), 3, &write_datas[0], 0, nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ViewSet::~ViewSet()
+{
+    auto backend = m_backend.lock();
+
+    // The set may be released while its last launches are still in flight
+    if (backend)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            backend->queue_object_deletion(m_output_storage_image_ds[i]);
+            backend->queue_object_deletion(m_output_image_views[i]);
+            backend->queue_object_deletion(m_output_images[i]);
+        }
+
+        backend->queue_object_deletion(m_view_ds);
+        backend->queue_object_deletion(m_view_buffer);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ViewSet::set_views(const std::vector<View>& views)
+{
+    if (views.size() != m_views.size())
+    {
+        HELIOS_LOG_ERROR("The number of views of a view set can not change, create a new one instead.");
+        return;
+    }
+
+    m_views       = views;
+    m_views_dirty = true;
+
+    restart();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ViewSet::restart()
+{
+    m_num_accumulated_samples = 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ViewSet::save(const std::vector<std::string>& paths)
+{
+    if (paths.size() != m_views.size())
+    {
+        HELIOS_LOG_ERROR("A view set needs one path per view to be saved.");
+        return false;
+    }
+
+    auto backend = m_backend.lock();
+
+    backend->wait_idle();
+
+    const size_t    layer_size = sizeof(glm::vec4) * m_width * m_height;
+    vk::Buffer::Ptr staging    = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT, layer_size * num_views(), VMA_MEMORY_USAGE_GPU_TO_CPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+    vk::CommandBuffer::Ptr cmd_buf = backend->allocate_graphics_command_buffer(true);
+
+    // The output stays in general layout, which transfers can read from directly
+    VkBufferImageCopy copy_region;
+    HELIOS_ZERO_MEMORY(copy_region);
+
+    copy_region.bufferOffset                    = 0;
+    copy_region.bufferRowLength                 = 0;
+    copy_region.bufferImageHeight               = 0;
+    copy_region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    copy_region.imageSubresource.mipLevel       = 0;
+    copy_region.imageSubresource.baseArrayLayer = 0;
+    copy_region.imageSubresource.layerCount     = num_views();
+    copy_region.imageExtent.width               = m_width;
+    copy_region.imageExtent.height              = m_height;
+    copy_region.imageExtent.depth               = 1;
+
+    vkCmdCopyImageToBuffer(cmd_buf->handle(), output_image()->handle(), VK_IMAGE_LAYOUT_GENERAL, staging->handle(), 1, &copy_region);
+
+    vkEndCommandBuffer(cmd_buf->handle());
+
+    backend->flush_graphics({ cmd_buf });
+
+    staging->invalidate_mapped_data();
+
+    const uint8_t* layers = (const uint8_t*)staging->mapped_ptr();
+
+    for (uint32_t i = 0; i < num_views(); i++)
+    {
+        if (stbi_write_hdr(paths[i].c_str(), m_width, m_height, 4, (const float*)(layers + layer_size * i)) == 0)
+        {
+            HELIOS_LOG_ERROR("Failed to write view: " + paths[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+View ViewSet::perspective_view(const glm::mat4& view, const glm::mat4& projection, float focal_length, float aperture_radius)
+{
+    View v;
+
+    v.projection_type = VIEW_PROJECTION_PERSPECTIVE;
+    v.position        = glm::vec3(glm::inverse(view)[3]);
+    v.view            = view;
+    v.projection      = projection;
+    v.focal_length    = focal_length;
+    v.aperture_radius = aperture_radius;
+
+    return v;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+View ViewSet::equirectangular_view(const glm::vec3& position)
+{
+    View v;
+
+    v.projection_type = VIEW_PROJECTION_EQUIRECTANGULAR;
+    v.position        = position;
+
+    return v;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<View> ViewSet::stereo_views(const glm::mat4& view, const glm::mat4& projection, float eye_separation, float focal_length, float aperture_radius)
+{
+    // Parallel eyes offset along the view space x axis, left eye first.
+    const glm::mat4 left  = glm::translate(glm::mat4(1.0f), glm::vec3(eye_separation * 0.5f, 0.0f, 0.0f)) * view;
+    const glm::mat4 right = glm::translate(glm::mat4(1.0f), glm::vec3(-eye_separation * 0.5f, 0.0f, 0.0f)) * view;
+
+    return { perspective_view(left, projection, focal_length, aperture_radius), perspective_view(right, projection, focal_length, aperture_radius) };
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<View> ViewSet::cubemap_views(const glm::vec3& position)
+{
+    std::vector<View> views(6);
+
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        views[i].projection_type = VIEW_PROJECTION_CUBEMAP_FACE;
+        views[i].position        = position;
+        views[i].cubemap_face    = i;
+    }
+
+    return views;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ViewSet::begin_launch(vk::CommandBuffer::Ptr cmd_buf)
+{
+    if (m_images_recreated)
+    {
+        VkImageSubresourceRange subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, num_views() };
+
+        for (int i = 0; i < 2; i++)
+            vk::utilities::set_image_layout(cmd_buf->handle(), m_output_images[i]->handle(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, subresource_range);
+
+        m_images_recreated = false;
+    }
+
+    if (m_views_dirty)
+    {
+        std::vector<ViewData> view_data(m_views.size());
+
+        for (uint32_t i = 0; i < m_views.size(); i++)
+        {
+            const View& view = m_views[i];
+            ViewData&   data = view_data[i];
+
+            const glm::mat4 camera_to_world = glm::inverse(view.view);
+            const glm::vec3 right           = glm::vec3(camera_to_world[0]);
+            const glm::vec3 up              = glm::vec3(camera_to_world[1]);
+            const glm::vec3 forward         = -glm::vec3(camera_to_world[2]);
+            const glm::vec3 focal_point     = view.position + forward * view.focal_length;
+
+            data.view_proj_inverse = glm::inverse(view.projection * view.view);
+            data.camera_pos        = glm::vec4(view.position, 0.0f);
+            data.up_direction      = glm::vec4(up, 0.0f);
+            data.right_direction   = glm::vec4(right, 0.0f);
+            data.focal_plane       = glm::vec4(-forward, glm::dot(forward, focal_point));
+            data.projection        = glm::uvec4(view.projection_type, view.cubemap_face, 0, 0);
+            data.lens              = glm::vec4(view.projection_type == VIEW_PROJECTION_PERSPECTIVE ? view.aperture_radius : 0.0f, 0.0f, 0.0f, 0.0f);
+        }
+
+        // At most MAX_VIEWS_PER_LAUNCH views, which stays below the 64 KiB limit of vkCmdUpdateBuffer
+        vkCmdUpdateBuffer(cmd_buf->handle(), m_view_buffer->handle(), 0, sizeof(ViewData) * view_data.size(), view_data.data());
+
+        m_views_dirty = false;
+    }
+
+    // Make the view data and the previous accumulation visible, and keep the previous consumers of the output ahead of the launch
+    VkMemoryBarrier memory_barrier;
+    memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.pNext         = nullptr;
+    memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ViewSet::end_launch(vk::CommandBuffer::Ptr cmd_buf)
+{
+    // The output can be sampled, copied or read by a compute shader right after the launch
+    VkMemoryBarrier memory_barrier;
+    memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.pNext         = nullptr;
+    memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+    vkCmdPipelineBarrier(cmd_buf->handle(), VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+    m_ping_pong = !m_ping_pong;
+    m_num_accumulated_samples++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace helios
@@ -29,6 +29,28 @@ const std::vector<const char*> kValidationLayers = {
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+const char*    kPipelineCachePath    = "pipeline_cache.bin";
+const uint32_t kPipelineCacheMagic   = 0x43504c48; // "HLPC"
+const uint32_t kPipelineCacheVersion = 1;
+
+const uint32_t kInitialBindlessTextureCapacity = 256;
+
+// Prepended to the driver's cache blob. The driver is supposed to reject blobs from a different device or driver on its own,
+// but not all of them do so gracefully, so nothing is handed to vkCreatePipelineCache unless this matches exactly.
+struct PipelineCacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    uint8_t  driver_uuid[VK_UUID_SIZE];
+    uint8_t  pipeline_cache_uuid[VK_UUID_SIZE];
+    uint64_t data_size;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 const char* kDeviceTypes[] = {
     "VK_PHYSICAL_DEVICE_TYPE_OTHER",
     "VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU",
@@ -233,6 +255,7 @@ Image::Image(Backend::Ptr backend, VkImageType type, uint32_t width, uint32_t he
 
     m_vk_device_memory = alloc_info.deviceMemory;
     m_mapped_ptr       = alloc_info.pMappedData;
+    m_allocation_size  = alloc_info.size;
 
     if (data)
     {
@@ -747,9 +770,9 @@ void Buffer::upload_data(void* data, size_t size, size_t offset)
     else
     {
         if (!m_mapped_ptr)
-            vkMapMemory(backend->device(), m_vk_device_memory, 0, size, 0, &m_mapped_ptr);
+            vkMapMemory(backend->device(), m_vk_device_memory, 0, VK_WHOLE_SIZE, 0, &m_mapped_ptr);
 
-        memcpy(m_mapped_ptr, data, size);
+        memcpy((uint8_t*)m_mapped_ptr + offset, data, size);
 
         // If host coherency hasn't been requested, do a manual flush to make writes visible
         if ((m_vk_memory_property & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
@@ -769,6 +792,27 @@ void Buffer::upload_data(void* data, size_t size, size_t offset)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void Buffer::invalidate_mapped_data()
+{
+    // Make device writes visible to the host if the memory isn't host coherent
+    if (m_mapped_ptr && (m_vk_memory_property & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
+    {
+        auto backend = m_vk_backend.lock();
+
+        VkMappedMemoryRange mapped_range;
+        HELIOS_ZERO_MEMORY(mapped_range);
+
+        mapped_range.sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        mapped_range.memory = m_vk_device_memory;
+        mapped_range.offset = 0;
+        mapped_range.size   = VK_WHOLE_SIZE;
+
+        vkInvalidateMappedMemoryRanges(backend->device(), 1, &mapped_range);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 CommandPool::Ptr CommandPool::create(Backend::Ptr backend, uint32_t queue_family_index)
 {
     return std::shared_ptr<CommandPool>(new CommandPool(backend, queue_family_index));
@@ -1694,19 +1738,12 @@ GraphicsPipeline::Desc& GraphicsPipeline::Desc::set_base_pipeline_index(const in
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-GraphicsPipeline::Ptr GraphicsPipeline::create_for_post_process(Backend::Ptr backend, std::string vs, std::string fs, std::shared_ptr<PipelineLayout> pipeline_layout, RenderPass::Ptr render_pass)
+GraphicsPipeline::Ptr GraphicsPipeline::create_for_post_process(Backend::Ptr backend, ShaderModule::Ptr vs, ShaderModule::Ptr fs, std::shared_ptr<PipelineLayout> pipeline_layout, RenderPass::Ptr render_pass)
 {
-    // ---------------------------------------------------------------------------
-    // Create shader modules
-    // ---------------------------------------------------------------------------
-
-    vk::ShaderModule::Ptr vs_module = vk::ShaderModule::create_from_file(backend, vs);
-    vk::ShaderModule::Ptr fs_module = vk::ShaderModule::create_from_file(backend, fs);
-
     vk::GraphicsPipeline::Desc pso_desc;
 
-    pso_desc.add_shader_stage(VK_SHADER_STAGE_VERTEX_BIT, vs_module, "main")
-        .add_shader_stage(VK_SHADER_STAGE_FRAGMENT_BIT, fs_module, "main");
+    pso_desc.add_shader_stage(VK_SHADER_STAGE_VERTEX_BIT, vs, "main")
+        .add_shader_stage(VK_SHADER_STAGE_FRAGMENT_BIT, fs, "main");
 
     // ---------------------------------------------------------------------------
     // Vertex input state
@@ -1837,7 +1874,7 @@ GraphicsPipeline::GraphicsPipeline(Backend::Ptr backend, Desc desc) :
     desc.dynamic_state.pDynamicStates    = &desc.dynamic_states[0];
     desc.create_info.pDynamicState       = &desc.dynamic_state;
 
-    if (vkCreateGraphicsPipelines(backend->device(), nullptr, 1, &desc.create_info, nullptr, &m_vk_pipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(backend->device(), backend->pipeline_cache(), 1, &desc.create_info, nullptr, &m_vk_pipeline) != VK_SUCCESS)
     {
         HELIOS_LOG_FATAL("(Vulkan) Failed to create Graphics Pipeline.");
         throw std::runtime_error("(Vulkan) Failed to create Graphics Pipeline.");
@@ -1925,7 +1962,7 @@ ComputePipeline::Ptr ComputePipeline::create(Backend::Ptr backend, Desc desc)
 ComputePipeline::ComputePipeline(Backend::Ptr backend, Desc desc) :
     Object(backend)
 {
-    if (vkCreateComputePipelines(backend->device(), nullptr, 1, &desc.create_info, nullptr, &m_vk_pipeline) != VK_SUCCESS)
+    if (vkCreateComputePipelines(backend->device(), backend->pipeline_cache(), 1, &desc.create_info, nullptr, &m_vk_pipeline) != VK_SUCCESS)
     {
         HELIOS_LOG_FATAL("(Vulkan) Failed to create Compute Pipeline.");
         throw std::runtime_error("(Vulkan) Failed to create Compute Pipeline.");
@@ -2070,6 +2107,17 @@ ShaderBindingTable::Desc& ShaderBindingTable::Desc::add_miss_group(ShaderModule:
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+ShaderBindingTable::Desc& ShaderBindingTable::Desc::set_specialization_constants(const std::vector<VkSpecializationMapEntry>& entries, const void* data, size_t size)
+{
+    specialization_map_entries = entries;
+    specialization_data.resize(size);
+    memcpy(specialization_data.data(), data, size);
+
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 ShaderBindingTable::Ptr ShaderBindingTable::create(Backend::Ptr backend, Desc desc)
 {
     return std::shared_ptr<ShaderBindingTable>(new ShaderBindingTable(backend, desc));
@@ -2195,6 +2243,23 @@ ShaderBindingTable::ShaderBindingTable(Backend::Ptr backend, Desc desc) :
         m_groups.push_back(group_info);
     }
 
+    // The stages point into this table so the constants stay valid for as long as the table is used to create pipelines
+    m_specialization_map_entries = desc.specialization_map_entries;
+    m_specialization_data        = desc.specialization_data;
+
+    HELIOS_ZERO_MEMORY(m_specialization_info);
+
+    if (m_specialization_map_entries.size() > 0)
+    {
+        m_specialization_info.mapEntryCount = m_specialization_map_entries.size();
+        m_specialization_info.pMapEntries   = m_specialization_map_entries.data();
+        m_specialization_info.dataSize      = m_specialization_data.size();
+        m_specialization_info.pData         = m_specialization_data.data();
+
+        for (auto& stage : m_stages)
+            stage.pSpecializationInfo = &m_specialization_info;
+    }
+
     uint32_t group_size_aligned = utilities::aligned_size(rt_pipeline_props.shaderGroupHandleSize, rt_pipeline_props.shaderGroupBaseAlignment);
 
     m_ray_gen_size    = desc.ray_gen_stages.size() * group_size_aligned;
@@ -2210,6 +2275,11 @@ RayTracingPipeline::Desc::Desc()
 
     create_info.sType = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_CREATE_INFO_KHR;
     create_info.pNext = nullptr;
+
+    HELIOS_ZERO_MEMORY(interface_info);
+
+    interface_info.sType = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_INTERFACE_CREATE_INFO_KHR;
+    interface_info.pNext = nullptr;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -2263,6 +2333,35 @@ RayTracingPipeline::Desc& RayTracingPipeline::Desc::set_base_pipeline_index(int3
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+RayTracingPipeline::Desc& RayTracingPipeline::Desc::set_library(bool library)
+{
+    if (library)
+        create_info.flags |= VK_PIPELINE_CREATE_LIBRARY_BIT_KHR;
+    else
+        create_info.flags &= ~VK_PIPELINE_CREATE_LIBRARY_BIT_KHR;
+
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RayTracingPipeline::Desc& RayTracingPipeline::Desc::set_pipeline_interface(uint32_t max_ray_payload_size, uint32_t max_hit_attribute_size)
+{
+    interface_info.maxPipelineRayPayloadSize      = max_ray_payload_size;
+    interface_info.maxPipelineRayHitAttributeSize = max_hit_attribute_size;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RayTracingPipeline::Desc& RayTracingPipeline::Desc::add_library(RayTracingPipeline::Ptr library)
+{
+    libraries.push_back(library);
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 RayTracingPipeline::Ptr RayTracingPipeline::create(Backend::Ptr backend, Desc desc)
 {
     return std::shared_ptr<RayTracingPipeline>(new RayTracingPipeline(backend, desc));
@@ -2283,6 +2382,7 @@ RayTracingPipeline::~RayTracingPipeline()
     m_vk_buffer.reset();
     m_sbt.reset();
     vkDestroyPipeline(backend->device(), m_vk_pipeline, nullptr);
+    m_libraries.clear();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -2298,17 +2398,59 @@ void RayTracingPipeline::set_name(const std::string& name)
 RayTracingPipeline::RayTracingPipeline(Backend::Ptr backend, Desc desc) :
     Object(backend)
 {
-    m_sbt = desc.sbt;
+    m_sbt       = desc.sbt;
+    m_libraries = desc.libraries;
+    m_library   = (desc.create_info.flags & VK_PIPELINE_CREATE_LIBRARY_BIT_KHR) != 0;
 
     desc.create_info.pGroups = m_sbt->groups().data();
     desc.create_info.pStages = m_sbt->stages().data();
 
-    if (vkCreateRayTracingPipelinesKHR(backend->device(), VK_NULL_HANDLE, VK_NULL_HANDLE, 1, &desc.create_info, VK_NULL_HANDLE, &m_vk_pipeline) != VK_SUCCESS)
+    std::vector<VkPipeline> library_handles;
+
+    VkPipelineLibraryCreateInfoKHR library_info;
+    HELIOS_ZERO_MEMORY(library_info);
+
+    if (m_libraries.size() > 0)
+    {
+        uint32_t num_library_groups = 0;
+
+        for (auto& library : m_libraries)
+        {
+            library_handles.push_back(library->handle());
+            num_library_groups += library->shader_binding_table()->groups().size();
+        }
+
+        if (num_library_groups != m_sbt->groups().size())
+        {
+            HELIOS_LOG_FATAL("(Vulkan) Shader Binding Table does not match the groups of the linked Pipeline Libraries.");
+            throw std::runtime_error("(Vulkan) Shader Binding Table does not match the groups of the linked Pipeline Libraries.");
+        }
+
+        library_info.sType        = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+        library_info.libraryCount = library_handles.size();
+        library_info.pLibraries   = library_handles.data();
+
+        // All the stages come from the libraries
+        desc.create_info.stageCount   = 0;
+        desc.create_info.pStages      = nullptr;
+        desc.create_info.groupCount   = 0;
+        desc.create_info.pGroups      = nullptr;
+        desc.create_info.pLibraryInfo = &library_info;
+    }
+
+    if (m_library || m_libraries.size() > 0)
+        desc.create_info.pLibraryInterface = &desc.interface_info;
+
+    if (vkCreateRayTracingPipelinesKHR(backend->device(), VK_NULL_HANDLE, backend->pipeline_cache(), 1, &desc.create_info, VK_NULL_HANDLE, &m_vk_pipeline) != VK_SUCCESS)
     {
         HELIOS_LOG_FATAL("(Vulkan) Failed to create Ray Tracing Pipeline.");
         throw std::runtime_error("(Vulkan) Failed to create Ray Tracing Pipeline.");
     }
 
+    // Libraries can't be bound, so there are no shader group handles to copy into a table
+    if (m_library)
+        return;
+
     const auto& rt_pipeline_props = backend->ray_tracing_pipeline_properties();
 
     uint32_t group_handle_size  = rt_pipeline_props.shaderGroupHandleSize;
@@ -2550,6 +2692,12 @@ DescriptorSetLayout::Desc& DescriptorSetLayout::Desc::set_next_ptr(void* pnext)
     return *this;
 }
 
+DescriptorSetLayout::Desc& DescriptorSetLayout::Desc::set_create_flags(VkDescriptorSetLayoutCreateFlags flags)
+{
+    create_flags = flags;
+    return *this;
+}
+
 DescriptorSetLayout::Desc& DescriptorSetLayout::Desc::add_binding(uint32_t binding, VkDescriptorType descriptor_type, uint32_t descriptor_count, VkShaderStageFlags stage_flags)
 {
     bindings.push_back({ binding, descriptor_type, descriptor_count, stage_flags, nullptr });
@@ -2584,6 +2732,7 @@ DescriptorSetLayout::DescriptorSetLayout(Backend::Ptr backend, Desc desc) :
 
     layout_info.pNext        = desc.pnext_ptr;
     layout_info.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.flags        = desc.create_flags;
     layout_info.bindingCount = desc.bindings.size();
     layout_info.pBindings    = desc.bindings.data();
 
@@ -3355,6 +3504,13 @@ Backend::Backend(GLFWwindow* window, bool enable_validation_layers, bool require
         throw std::runtime_error("(Vulkan) Failed to find a suitable GPU.");
     }
 
+    // Without the extension VMA estimates the budget from the heap sizes and its own allocations
+    if (check_device_extension_support(m_vk_physical_device, { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME }))
+    {
+        device_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        m_memory_budget_enabled = true;
+    }
+
     if (!create_logical_device(device_extensions))
     {
         HELIOS_LOG_FATAL("(Vulkan) Failed to create logical device.");
@@ -3367,6 +3523,9 @@ Backend::Backend(GLFWwindow* window, bool enable_validation_layers, bool require
     allocator_info.device                 = m_vk_device;
     allocator_info.instance               = m_vk_instance;
 
+    if (m_memory_budget_enabled)
+        allocator_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+
     if (vmaCreateAllocator(&allocator_info, &m_vma_allocator) != VK_SUCCESS)
     {
         HELIOS_LOG_FATAL("(Vulkan) Failed to create Allocator.");
@@ -3374,6 +3533,8 @@ Backend::Backend(GLFWwindow* window, bool enable_validation_layers, bool require
     }
 
     load_VK_EXTENSION_SUBSET(m_vk_instance, vkGetInstanceProcAddr, m_vk_device, vkGetDeviceProcAddr);
+
+    create_pipeline_cache();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -3387,6 +3548,8 @@ Backend::~Backend()
         m_deletion_queue.pop_front();
     }
 
+    m_bindless_texture_descriptor_set.reset();
+    m_bindless_texture_descriptor_pool.reset();
     m_default_cubemap_image_view.reset();
     m_default_cubemap_image.reset();
     m_bilinear_sampler.reset();
@@ -3446,6 +3609,13 @@ Backend::~Backend()
         m_vma_allocator = nullptr;
     }
 
+    if (m_vk_pipeline_cache)
+    {
+        save_pipeline_cache();
+        vkDestroyPipelineCache(m_vk_device, m_vk_pipeline_cache, nullptr);
+        m_vk_pipeline_cache = nullptr;
+    }
+
     if (m_vk_device)
     {
         vkDestroyDevice(m_vk_device, nullptr);
@@ -3503,8 +3673,9 @@ void Backend::initialize()
     m_scene_descriptor_set_layout = DescriptorSetLayout::create(shared_from_this(), scene_ds_layout_desc);
     m_scene_descriptor_set_layout->set_name("Scene Descriptor Set Layout");
 
+    // The array sets are allocated with the number of descriptors the scene needs and may be rewritten while bound.
     std::vector<VkDescriptorBindingFlags> descriptor_binding_flags = {
-        VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+        VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
     };
 
     VkDescriptorSetLayoutBindingFlagsCreateInfo set_layout_binding_flags;
@@ -3517,17 +3688,31 @@ void Backend::initialize()
     // Buffers
     DescriptorSetLayout::Desc buffer_array_ds_layout_desc;
 
-    buffer_array_ds_layout_desc.add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_SCENE_MESH_INSTANCE_COUNT, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR);
+    buffer_array_ds_layout_desc.add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, max_buffer_array_descriptor_count(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR);
     buffer_array_ds_layout_desc.set_next_ptr(&set_layout_binding_flags);
+    buffer_array_ds_layout_desc.set_create_flags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
 
     m_buffer_array_descriptor_set_layout = DescriptorSetLayout::create(shared_from_this(), buffer_array_ds_layout_desc);
     m_buffer_array_descriptor_set_layout->set_name("Buffer Array Descriptor Set Layout");
 
+    // Texture slots are written as textures are created, while frames in flight only read the slots that were written before them.
+    std::vector<VkDescriptorBindingFlags> texture_binding_flags = {
+        VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT
+    };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo texture_layout_binding_flags;
+    HELIOS_ZERO_MEMORY(texture_layout_binding_flags);
+
+    texture_layout_binding_flags.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    texture_layout_binding_flags.bindingCount  = 1;
+    texture_layout_binding_flags.pBindingFlags = texture_binding_flags.data();
+
     // Material Textures
     DescriptorSetLayout::Desc combined_sampler_array_ds_layout_desc;
 
-    combined_sampler_array_ds_layout_desc.add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_SCENE_MATERIAL_TEXTURE_COUNT, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR);
-    combined_sampler_array_ds_layout_desc.set_next_ptr(&set_layout_binding_flags);
+    combined_sampler_array_ds_layout_desc.add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, max_combined_sampler_array_descriptor_count(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR);
+    combined_sampler_array_ds_layout_desc.set_next_ptr(&texture_layout_binding_flags);
+    combined_sampler_array_ds_layout_desc.set_create_flags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
 
     m_combined_sampler_array_descriptor_set_layout = DescriptorSetLayout::create(shared_from_this(), combined_sampler_array_ds_layout_desc);
     m_combined_sampler_array_descriptor_set_layout->set_name("Combined Sampler Array Descriptor Set Layout");
@@ -3610,6 +3795,8 @@ void Backend::initialize()
     uploader.upload_image_data(m_default_cubemap_image, cubemap_data.data(), cubemap_sizes);
 
     uploader.submit();
+
+    grow_bindless_textures(std::min(kInitialBindlessTextureCapacity, max_combined_sampler_array_descriptor_count()));
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -4025,6 +4212,60 @@ size_t Backend::aligned_dynamic_ubo_size(size_t size)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+size_t Backend::min_storage_buffer_alignment()
+{
+    return m_device_properties.limits.minStorageBufferOffsetAlignment;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+size_t Backend::aligned_storage_buffer_size(size_t size)
+{
+    size_t min_ssbo_alignment = m_device_properties.limits.minStorageBufferOffsetAlignment;
+    size_t aligned_size       = size;
+
+    if (min_ssbo_alignment > 0)
+        aligned_size = (aligned_size + min_ssbo_alignment - 1) & ~(min_ssbo_alignment - 1);
+
+    return aligned_size;
+}
+
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Descriptors left over for the non-array bindings that are visible to the same shader stages as the scene arrays.
+static const uint32_t kReservedArrayDescriptors = 32;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t Backend::max_buffer_array_descriptor_count()
+{
+    const VkPhysicalDeviceDescriptorIndexingProperties& props = m_descriptor_indexing_properties;
+
+    uint32_t limit = std::min(props.maxPerStageDescriptorUpdateAfterBindStorageBuffers, props.maxDescriptorSetUpdateAfterBindStorageBuffers);
+    limit          = limit > kReservedArrayDescriptors ? limit - kReservedArrayDescriptors : 0;
+
+    // The VBO, IBO and submesh info arrays are bound together.
+    return std::max(std::min(limit / 3, uint32_t(MAX_SCENE_MESH_COUNT)), 1u);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t Backend::max_combined_sampler_array_descriptor_count()
+{
+    const VkPhysicalDeviceDescriptorIndexingProperties& props = m_descriptor_indexing_properties;
+
+    uint32_t limit = std::min({ props.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                props.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                props.maxDescriptorSetUpdateAfterBindSampledImages,
+                                props.maxDescriptorSetUpdateAfterBindSamplers });
+    limit          = limit > kReservedArrayDescriptors ? limit - kReservedArrayDescriptors : 0;
+
+    return std::max(std::min(limit, uint32_t(MAX_SCENE_MATERIAL_TEXTURE_COUNT)), 1u);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 VkFormat Backend::find_supported_format(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
 {
     for (VkFormat format : candidates)
@@ -4049,6 +4290,21 @@ VkFormat Backend::find_supported_format(const std::vector<VkFormat>& candidates,
 
 void Backend::process_deletion_queue()
 {
+    {
+        std::lock_guard<std::mutex> lock(m_bindless_texture_mutex);
+
+        while (!m_bindless_texture_release_queue.empty())
+        {
+            auto front = m_bindless_texture_release_queue.front();
+
+            if (!is_frame_done(front.second))
+                break;
+
+            m_bindless_texture_free_slots.push_back(front.first);
+            m_bindless_texture_release_queue.pop_front();
+        }
+    }
+
     while (!m_deletion_queue.empty())
     {
         auto front = m_deletion_queue.front();
@@ -4070,6 +4326,322 @@ void Backend::queue_object_deletion(std::shared_ptr<Object> object)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+uint32_t Backend::register_bindless_texture(std::shared_ptr<ImageView> image_view)
+{
+    std::lock_guard<std::mutex> lock(m_bindless_texture_mutex);
+
+    uint32_t slot;
+
+    if (m_bindless_texture_free_slots.size() > 0)
+    {
+        slot = m_bindless_texture_free_slots.back();
+        m_bindless_texture_free_slots.pop_back();
+    }
+    else
+    {
+        slot = m_bindless_textures.size();
+
+        if (slot >= max_combined_sampler_array_descriptor_count())
+        {
+            HELIOS_LOG_ERROR("(Vulkan) Out of bindless texture slots.");
+            return kInvalidBindlessSlot;
+        }
+
+        m_bindless_textures.push_back({});
+
+        if (slot >= m_bindless_texture_capacity)
+            grow_bindless_textures(std::min(m_bindless_texture_capacity * 2, max_combined_sampler_array_descriptor_count()));
+    }
+
+    write_bindless_texture(slot, image_view);
+
+    return slot;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Points an existing slot at a different view of the same texture, e.g. when its resident mips change. The slot is rewritten in
+// place, so the caller has to make sure that no frame in flight still reads it.
+void Backend::update_bindless_texture(uint32_t slot, std::shared_ptr<ImageView> image_view)
+{
+    if (slot == kInvalidBindlessSlot)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_bindless_texture_mutex);
+
+    write_bindless_texture(slot, image_view);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::write_bindless_texture(uint32_t slot, std::shared_ptr<ImageView> image_view)
+{
+    VkDescriptorImageInfo& image_info = m_bindless_textures[slot];
+
+    image_info.sampler     = m_trilinear_sampler->handle();
+    image_info.imageView   = image_view->handle();
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet write_data;
+    HELIOS_ZERO_MEMORY(write_data);
+
+    write_data.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write_data.descriptorCount = 1;
+    write_data.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write_data.pImageInfo      = &image_info;
+    write_data.dstBinding      = 0;
+    write_data.dstArrayElement = slot;
+    write_data.dstSet          = m_bindless_texture_descriptor_set->handle();
+
+    vkUpdateDescriptorSets(m_vk_device, 1, &write_data, 0, nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::release_bindless_texture(uint32_t slot)
+{
+    if (slot == kInvalidBindlessSlot)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_bindless_texture_mutex);
+
+    m_bindless_textures[slot].imageView = VK_NULL_HANDLE;
+
+    // The slot may still be read by the frames in flight, so it is only reused once they are done.
+    m_bindless_texture_release_queue.push_back({ slot, m_current_frame });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+MemoryBudget Backend::memory_budget()
+{
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetBudget(m_vma_allocator, budgets);
+
+    const VkPhysicalDeviceMemoryProperties* memory_properties = nullptr;
+    vmaGetMemoryProperties(m_vma_allocator, &memory_properties);
+
+    MemoryBudget budget;
+
+    // Host heaps only hold staging and readback buffers, which are short lived
+    for (uint32_t i = 0; i < memory_properties->memoryHeapCount; i++)
+    {
+        if (memory_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        {
+            budget.usage += budgets[i].usage;
+            budget.budget += budgets[i].budget;
+            budget.block_bytes += budgets[i].blockBytes;
+            budget.allocation_bytes += budgets[i].allocationBytes;
+        }
+    }
+
+    return budget;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<DescriptorSet> Backend::bindless_texture_descriptor_set()
+{
+    std::lock_guard<std::mutex> lock(m_bindless_texture_mutex);
+
+    return m_bindless_texture_descriptor_set;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::grow_bindless_textures(uint32_t capacity)
+{
+    // The set that is replaced may still be bound by the frames in flight.
+    queue_object_deletion(m_bindless_texture_descriptor_set);
+    queue_object_deletion(m_bindless_texture_descriptor_pool);
+
+    DescriptorPool::Desc dp_desc;
+
+    dp_desc.set_max_sets(1)
+        .set_create_flags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+        .add_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity);
+
+    m_bindless_texture_descriptor_pool = DescriptorPool::create(shared_from_this(), dp_desc);
+    m_bindless_texture_descriptor_pool->set_name("Bindless Texture Descriptor Pool");
+
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variable_ds_alloc_info;
+    HELIOS_ZERO_MEMORY(variable_ds_alloc_info);
+
+    variable_ds_alloc_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+    variable_ds_alloc_info.descriptorSetCount = 1;
+    variable_ds_alloc_info.pDescriptorCounts  = &capacity;
+
+    m_bindless_texture_descriptor_set = DescriptorSet::create(shared_from_this(), m_combined_sampler_array_descriptor_set_layout, m_bindless_texture_descriptor_pool, &variable_ds_alloc_info);
+    m_bindless_texture_descriptor_set->set_name("Bindless Texture Descriptor Set");
+
+    m_bindless_texture_capacity = capacity;
+
+    // Carry the live slots over to the new set.
+    std::vector<VkWriteDescriptorSet> write_datas;
+
+    for (uint32_t i = 0; i < m_bindless_textures.size(); i++)
+    {
+        if (m_bindless_textures[i].imageView == VK_NULL_HANDLE)
+            continue;
+
+        VkWriteDescriptorSet write_data;
+        HELIOS_ZERO_MEMORY(write_data);
+
+        write_data.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write_data.descriptorCount = 1;
+        write_data.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write_data.pImageInfo      = &m_bindless_textures[i];
+        write_data.dstBinding      = 0;
+        write_data.dstArrayElement = i;
+        write_data.dstSet          = m_bindless_texture_descriptor_set->handle();
+
+        write_datas.push_back(write_data);
+    }
+
+    if (write_datas.size() > 0)
+        vkUpdateDescriptorSets(m_vk_device, write_datas.size(), write_datas.data(), 0, nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void fill_pipeline_cache_header(VkPhysicalDevice device, PipelineCacheFileHeader& header)
+{
+    VkPhysicalDeviceIDProperties id_properties;
+    HELIOS_ZERO_MEMORY(id_properties);
+
+    id_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 device_properties2;
+    HELIOS_ZERO_MEMORY(device_properties2);
+
+    device_properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    device_properties2.pNext = &id_properties;
+
+    vkGetPhysicalDeviceProperties2(device, &device_properties2);
+
+    HELIOS_ZERO_MEMORY(header);
+
+    header.magic          = kPipelineCacheMagic;
+    header.version        = kPipelineCacheVersion;
+    header.vendor_id      = device_properties2.properties.vendorID;
+    header.device_id      = device_properties2.properties.deviceID;
+    header.driver_version = device_properties2.properties.driverVersion;
+
+    memcpy(header.driver_uuid, id_properties.driverUUID, VK_UUID_SIZE);
+    memcpy(header.pipeline_cache_uuid, device_properties2.properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::create_pipeline_cache()
+{
+    PipelineCacheFileHeader expected_header;
+    fill_pipeline_cache_header(m_vk_physical_device, expected_header);
+
+    std::vector<uint8_t> data;
+    std::ifstream        file(kPipelineCachePath, std::ios::in | std::ios::binary);
+
+    if (file.is_open())
+    {
+        PipelineCacheFileHeader header;
+
+        if (file.read((char*)&header, sizeof(PipelineCacheFileHeader)))
+        {
+            // Compare everything except the size of the blob itself
+            expected_header.data_size = header.data_size;
+
+            if (memcmp(&header, &expected_header, sizeof(PipelineCacheFileHeader)) == 0 && header.data_size >= sizeof(VkPipelineCacheHeaderVersionOne))
+            {
+                data.resize(header.data_size);
+
+                if (!file.read((char*)data.data(), data.size()))
+                    data.clear();
+            }
+        }
+
+        // Double-check the driver's own header before trusting the blob
+        if (data.size() > 0)
+        {
+            VkPipelineCacheHeaderVersionOne vk_header;
+            memcpy(&vk_header, data.data(), sizeof(VkPipelineCacheHeaderVersionOne));
+
+            if (vk_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || vk_header.vendorID != expected_header.vendor_id || vk_header.deviceID != expected_header.device_id || memcmp(vk_header.pipelineCacheUUID, expected_header.pipeline_cache_uuid, VK_UUID_SIZE) != 0)
+                data.clear();
+        }
+
+        if (data.size() == 0)
+            HELIOS_LOG_WARNING("(Vulkan) Pipeline cache was created by a different device or driver, ignoring it.");
+    }
+
+    VkPipelineCacheCreateInfo create_info;
+    HELIOS_ZERO_MEMORY(create_info);
+
+    create_info.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    create_info.initialDataSize = data.size();
+    create_info.pInitialData    = data.size() > 0 ? data.data() : nullptr;
+
+    if (vkCreatePipelineCache(m_vk_device, &create_info, nullptr, &m_vk_pipeline_cache) != VK_SUCCESS)
+    {
+        // A cache the driver refuses is not fatal, start over with an empty one
+        create_info.initialDataSize = 0;
+        create_info.pInitialData    = nullptr;
+
+        if (vkCreatePipelineCache(m_vk_device, &create_info, nullptr, &m_vk_pipeline_cache) != VK_SUCCESS)
+        {
+            HELIOS_LOG_FATAL("(Vulkan) Failed to create Pipeline Cache.");
+            throw std::runtime_error("(Vulkan) Failed to create Pipeline Cache.");
+        }
+    }
+
+    if (data.size() > 0)
+        HELIOS_LOG_INFO("(Vulkan) Loaded pipeline cache (" + std::to_string(data.size()) + " bytes).");
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Backend::save_pipeline_cache()
+{
+    size_t data_size = 0;
+
+    if (vkGetPipelineCacheData(m_vk_device, m_vk_pipeline_cache, &data_size, nullptr) != VK_SUCCESS || data_size == 0)
+        return false;
+
+    std::vector<uint8_t> data(data_size);
+
+    if (vkGetPipelineCacheData(m_vk_device, m_vk_pipeline_cache, &data_size, data.data()) != VK_SUCCESS)
+        return false;
+
+    PipelineCacheFileHeader header;
+    fill_pipeline_cache_header(m_vk_physical_device, header);
+
+    header.data_size = data_size;
+
+    // Write to a temporary file first so that a crash mid-write never leaves a corrupt cache behind
+    std::string temp_path = std::string(kPipelineCachePath) + ".tmp";
+
+    {
+        std::ofstream file(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open() || !file.write((const char*)&header, sizeof(PipelineCacheFileHeader)) || !file.write((const char*)data.data(), data_size))
+        {
+            HELIOS_LOG_WARNING("(Vulkan) Failed to write pipeline cache.");
+            return false;
+        }
+    }
+
+    remove(kPipelineCachePath);
+
+    if (rename(temp_path.c_str(), kPipelineCachePath) != 0)
+    {
+        HELIOS_LOG_WARNING("(Vulkan) Failed to write pipeline cache.");
+        return false;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 VkFormat Backend::find_depth_format()
 {
     return find_supported_format({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
@@ -4283,6 +4855,15 @@ bool Backend::is_device_suitable(VkPhysicalDevice device, VkPhysicalDeviceType t
             HELIOS_LOG_INFO("(Vulkan) Type   : " + std::string(kDeviceTypes[m_device_properties.deviceType]));
             HELIOS_LOG_INFO("(Vulkan) Driver : " + std::to_string(m_device_properties.driverVersion));
 
+            // Get descriptor indexing properties, these bound the size of the scene descriptor arrays
+            HELIOS_ZERO_MEMORY(m_descriptor_indexing_properties);
+            m_descriptor_indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+            VkPhysicalDeviceProperties2 descriptor_indexing_properties2 {};
+            descriptor_indexing_properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            descriptor_indexing_properties2.pNext = &m_descriptor_indexing_properties;
+            vkGetPhysicalDeviceProperties2(device, &descriptor_indexing_properties2);
+
             if (requires_ray_tracing)
             {
                 // Get ray tracing pipeline properties
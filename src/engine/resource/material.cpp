@@ -1,10 +1,13 @@
 #include <resource/material.h>
+#include <resource/scene.h>
+#include <atomic>
 
 namespace helios
 {
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-static uint32_t g_last_material_id = 0;
+static uint32_t              g_last_material_id = 0;
+static std::atomic<uint64_t> g_last_material_version(0);
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
@@ -77,4 +80,78 @@ bool Material::is_emissive()
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
-} // namespace helios
\ No newline at end of file
+
+void Material::set_albedo_value(const glm::vec4& value)
+{
+    m_albedo_value = value;
+    m_version      = ++g_last_material_version;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Material::set_emissive_value(const glm::vec4& value)
+{
+    m_emissive_value = value;
+    m_version        = ++g_last_material_version;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Material::set_metallic_value(float value)
+{
+    m_metallic_value = value;
+    m_version        = ++g_last_material_version;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Material::set_roughness_value(float value)
+{
+    m_roughness_value = value;
+    m_version         = ++g_last_material_version;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Material::set_light_group(uint32_t group)
+{
+    m_light_group = std::min(group, uint32_t(MAX_LIGHT_GROUPS - 1));
+    m_version     = ++g_last_material_version;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t Material::latest_version()
+{
+    return g_last_material_version;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Material::replace(Material::Ptr other)
+{
+    m_type                   = other->m_type;
+    m_textures               = other->m_textures;
+    m_albedo_texture_info    = other->m_albedo_texture_info;
+    m_normal_texture_info    = other->m_normal_texture_info;
+    m_metallic_texture_info  = other->m_metallic_texture_info;
+    m_roughness_texture_info = other->m_roughness_texture_info;
+    m_emissive_texture_info  = other->m_emissive_texture_info;
+    m_albedo_value           = other->m_albedo_value;
+    m_emissive_value         = other->m_emissive_value;
+    m_metallic_value         = other->m_metallic_value;
+    m_roughness_value        = other->m_roughness_value;
+    m_alpha_test             = other->m_alpha_test;
+
+    increment_version();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Material::increment_version()
+{
+    m_version = ++g_last_material_version;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace helios
@@ -2,12 +2,43 @@
 #include <resource/material.h>
 #include <vk_mem_alloc.h>
 #include <utility/macros.h>
+#include <algorithm>
+#include <atomic>
 
 namespace helios
 {
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-static uint32_t g_last_mesh_id = 0;
+static uint32_t              g_last_mesh_id = 0;
+static std::atomic<uint64_t> g_last_mesh_version(0);
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+struct BLASGeometries
+{
+    std::vector<VkAccelerationStructureBuildRangeInfoKHR> build_ranges;
+    std::vector<VkAccelerationStructureGeometryKHR>       geometries;
+    std::vector<uint32_t>                                 max_primitive_counts;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static vk::AccelerationStructure::Ptr create_blas(vk::Backend::Ptr backend, const BLASGeometries& blas_geometries, vk::BatchUploader& uploader)
+{
+    vk::AccelerationStructure::Desc desc;
+
+    desc.set_type(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR);
+    desc.set_flags(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+    desc.set_geometries(blas_geometries.geometries);
+    desc.set_geometry_count(blas_geometries.geometries.size());
+    desc.set_max_primitive_counts(blas_geometries.max_primitive_counts);
+
+    vk::AccelerationStructure::Ptr blas = vk::AccelerationStructure::create(backend, desc);
+
+    uploader.build_blas(blas, blas_geometries.geometries, blas_geometries.build_ranges);
+
+    return blas;
+}
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
@@ -32,8 +63,8 @@ Mesh::Ptr Mesh::create(vk::Backend::Ptr                       backend,
                        vk::BatchUploader&                     uploader,
                        const std::string&                     path)
 {
-    vk::Buffer::Ptr vbo = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, sizeof(Vertex) * vertices.size(), VMA_MEMORY_USAGE_GPU_ONLY, 0);
-    vk::Buffer::Ptr ibo = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, sizeof(uint32_t) * indices.size(), VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    vk::Buffer::Ptr vbo = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, sizeof(Vertex) * vertices.size(), VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    vk::Buffer::Ptr ibo = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, sizeof(uint32_t) * indices.size(), VMA_MEMORY_USAGE_GPU_ONLY, 0);
 
     uploader.upload_buffer_data(vbo, vertices.data(), 0, sizeof(Vertex) * vertices.size());
     uploader.upload_buffer_data(ibo, indices.data(), 0, sizeof(uint32_t) * indices.size());
@@ -58,23 +89,15 @@ Mesh::Mesh(vk::Backend::Ptr                       backend,
     m_id(g_last_mesh_id++),
     m_path(path)
 {
-    std::vector<VkAccelerationStructureBuildRangeInfoKHR> build_ranges;
-    std::vector<VkAccelerationStructureGeometryKHR>       geometries;
-    std::vector<uint32_t>                                 max_primitive_counts;
-
-    // Populate geometries
-    for (int i = 0; i < submeshes.size(); i++)
-    {
-        Material::Ptr material = materials[submeshes[i].mat_idx];
+    BLASGeometries                                 blas_geometries;
+    BLASGeometries                                 override_blas_geometries;
+    std::vector<std::pair<MeshGeometry, uint32_t>> split_geometries;
+    bool                                           is_sorted = false;
 
+    auto add_geometry = [&](BLASGeometries& dst, const MeshGeometry& mesh_geometry, uint32_t primitive_count, bool is_opaque) {
         VkAccelerationStructureGeometryKHR geometry;
         HELIOS_ZERO_MEMORY(geometry);
 
-        VkGeometryFlagsKHR geometry_flags = 0;
-
-        if (material->type() == MATERIAL_OPAQUE && !material->is_alpha_tested())
-            geometry_flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
-
         geometry.sType                                       = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
         geometry.pNext                                       = nullptr;
         geometry.geometryType                                = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
@@ -82,38 +105,74 @@ Mesh::Mesh(vk::Backend::Ptr                       backend,
         geometry.geometry.triangles.pNext                    = nullptr;
         geometry.geometry.triangles.vertexData.deviceAddress = m_vbo->device_address();
         geometry.geometry.triangles.vertexStride             = sizeof(Vertex);
-        geometry.geometry.triangles.maxVertex                = submeshes[i].vertex_count;
+        geometry.geometry.triangles.maxVertex                = submeshes[mesh_geometry.submesh_idx].vertex_count;
         geometry.geometry.triangles.vertexFormat             = VK_FORMAT_R32G32B32_SFLOAT;
         geometry.geometry.triangles.indexData.deviceAddress  = m_ibo->device_address();
         geometry.geometry.triangles.indexType                = VK_INDEX_TYPE_UINT32;
-        geometry.flags                                       = geometry_flags;
+        geometry.flags                                       = is_opaque ? VK_GEOMETRY_OPAQUE_BIT_KHR : 0;
 
-        geometries.push_back(geometry);
-        max_primitive_counts.push_back(submeshes[i].index_count / 3);
+        dst.geometries.push_back(geometry);
+        dst.max_primitive_counts.push_back(primitive_count);
 
         VkAccelerationStructureBuildRangeInfoKHR build_range;
         HELIOS_ZERO_MEMORY(build_range);
 
-        build_range.primitiveCount  = submeshes[i].index_count / 3;
-        build_range.primitiveOffset = submeshes[i].base_index * sizeof(uint32_t);
+        build_range.primitiveCount  = primitive_count;
+        build_range.primitiveOffset = mesh_geometry.primitive_offset * 3 * sizeof(uint32_t);
         build_range.firstVertex     = 0;
         build_range.transformOffset = 0;
 
-        build_ranges.push_back(build_range);
-    }
+        dst.build_ranges.push_back(build_range);
+    };
 
-    // Create blas
-    vk::AccelerationStructure::Desc desc;
+    // Populate geometries
+    for (uint32_t i = 0; i < submeshes.size(); i++)
+    {
+        const SubMesh& submesh        = submeshes[i];
+        Material::Ptr  material       = materials[submesh.mat_idx];
+        const uint32_t first_triangle = submesh.base_index / 3;
+        const uint32_t triangle_count = submesh.index_count / 3;
+        const bool     is_opaque      = material->type() == MATERIAL_OPAQUE;
+
+        m_geometries.push_back({ i, first_triangle });
+
+        // The override BLAS has a geometry per submesh like the regular one, so both share the submesh info of the mesh
+        add_geometry(override_blas_geometries, { i, first_triangle }, triangle_count, is_opaque && !material->is_alpha_tested());
+
+        if (!material->is_alpha_tested())
+            add_geometry(blas_geometries, { i, first_triangle }, triangle_count, is_opaque);
+        else
+        {
+            const uint32_t opaque_count       = std::min(submesh.opaque_triangle_count, triangle_count);
+            const uint32_t alpha_tested_count = triangle_count - opaque_count - std::min(submesh.cut_out_triangle_count, triangle_count - opaque_count);
+
+            is_sorted |= alpha_tested_count != triangle_count;
+
+            // Only the triangles that may be cut out are left to the any-hit shader, in a geometry of their own
+            if (opaque_count > 0)
+            {
+                add_geometry(blas_geometries, { i, first_triangle }, opaque_count, is_opaque);
+
+                if (alpha_tested_count > 0)
+                    split_geometries.push_back({ { i, first_triangle + opaque_count }, alpha_tested_count });
+            }
+            else
+                add_geometry(blas_geometries, { i, first_triangle }, alpha_tested_count, false);
+        }
+    }
 
-    desc.set_type(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR);
-    desc.set_flags(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
-    desc.set_geometries(geometries);
-    desc.set_geometry_count(geometries.size());
-    desc.set_max_primitive_counts(max_primitive_counts);
+    for (auto& split_geometry : split_geometries)
+    {
+        add_geometry(blas_geometries, split_geometry.first, split_geometry.second, false);
+        m_geometries.push_back(split_geometry.first);
+    }
 
-    m_blas = vk::AccelerationStructure::create(backend, desc);
+    m_blas = create_blas(backend, blas_geometries, uploader);
 
-    uploader.build_blas(m_blas, geometries, build_ranges);
+    // Instances with a material override may cut out other triangles than the materials of the mesh, so they get a BLAS in which
+    // every alpha tested triangle is left to the any-hit shader.
+    if (is_sorted)
+        m_override_blas = create_blas(backend, override_blas_geometries, uploader);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -122,5 +181,40 @@ Mesh::~Mesh()
 {
 }
 
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t Mesh::latest_version()
+{
+    return g_last_mesh_version;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Mesh::replace_geometry(Mesh::Ptr other)
+{
+    auto backend = m_vk_backend.lock();
+
+    if (backend)
+    {
+        backend->queue_object_deletion(m_blas);
+
+        if (m_override_blas)
+            backend->queue_object_deletion(m_override_blas);
+
+        backend->queue_object_deletion(m_vbo);
+        backend->queue_object_deletion(m_ibo);
+    }
+
+    m_blas          = other->m_blas;
+    m_override_blas = other->m_override_blas;
+    m_blas_info     = other->m_blas_info;
+    m_vbo           = other->m_vbo;
+    m_ibo           = other->m_ibo;
+    m_sub_meshes    = other->m_sub_meshes;
+    m_geometries    = other->m_geometries;
+    m_materials     = other->m_materials;
+    m_version       = ++g_last_mesh_version;
+}
+
 // -----------------------------------------------------------------------------------------------------------------------------------
 } // namespace helios
\ No newline at end of file
@@ -3,8 +3,9 @@
 #include <resource/material.h>
 #include <resource/texture.h>
 #include <utility/profiler.h>
+#include <utility/logger.h>
 #include <vk_mem_alloc.h>
-#include <unordered_set>
+#include <algorithm>
 #include <gtx/matrix_decompose.hpp>
 
 namespace helios
@@ -25,7 +26,7 @@ enum LightType
 struct MaterialData
 {
     glm::ivec4 texture_indices0 = glm::ivec4(-1); // x: albedo, y: normals, z: roughness, w: metallic
-    glm::ivec4 texture_indices1 = glm::ivec4(-1); // x: emissive, z: roughness_channel, w: metallic_channel
+    glm::ivec4 texture_indices1 = glm::ivec4(-1); // x: emissive, y: light group, z: roughness_channel, w: metallic_channel
     glm::vec4  albedo;
     glm::vec4  emissive;
     glm::vec4  roughness_metallic;
@@ -38,17 +39,20 @@ struct LightData
     glm::vec4 light_data0; // x: light type, yzw: color    | x: light_type, y: mesh_id, z: material_id, w: primitive_offset
     glm::vec4 light_data1; // xyz: direction, w: intensity | x: primitive_count
     glm::vec4 light_data2; // xyz: position, w: radius
-    glm::vec4 light_data3; // x: cos_inner, y: cos_outer
+    glm::vec4 light_data3; // x: cos_inner, y: cos_outer, w: light group
 };
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+// Keep in sync with Instance in common.glsl
+#define INVALID_MATERIAL_INDEX 0xFFFFFFFF
+
 struct InstanceData
 {
-    glm::mat4 model_matrix;
-    glm::mat4 normal_matrix;
+    glm::vec4 transform[3]; // Rows of the object-to-world matrix, the normal matrix is derived from it in the shaders
     uint32_t  mesh_index;
-    float     padding[3];
+    uint32_t  material_override; // Global material index, or INVALID_MATERIAL_INDEX to use the materials of the submeshes
+    uint32_t  padding[2];
 };
 
 static uint32_t g_node_counter = 0;
@@ -170,6 +174,15 @@ void Node::mark_transforms_as_dirty()
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void Node::update_property_state(RenderState& render_state)
+{
+    // The flag is cleared by the scene once the GPU data of the node has been written.
+    if (m_is_property_dirty)
+        render_state.promote_scene_state(SCENE_STATE_PROPERTIES_UPDATED);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 TransformNode::TransformNode(const NodeType& type, const std::string& name) :
     Node(type, name)
 {
@@ -195,7 +208,7 @@ void TransformNode::update(RenderState& render_state)
         m_model_matrix_without_scale = T * R;
         m_model_matrix               = m_model_matrix_without_scale * S;
 
-        render_state.m_scene_state = SCENE_STATE_HIERARCHY_UPDATED;
+        transform_updated(render_state);
 
         m_is_transform_dirty = false;
     }
@@ -203,6 +216,13 @@ void TransformNode::update(RenderState& render_state)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void TransformNode::transform_updated(RenderState& render_state)
+{
+    render_state.m_scene_state = SCENE_STATE_HIERARCHY_UPDATED;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 glm::vec3 TransformNode::forward()
 {
     return m_orientation * glm::vec3(0.0f, 0.0f, 1.0f);
@@ -465,7 +485,10 @@ void MeshNode::update(RenderState& render_state)
         TransformNode::update(render_state);
 
         if (m_mesh)
+        {
+            update_property_state(render_state);
             render_state.m_meshes.push_back(this);
+        }
 
         update_children(render_state);
     }
@@ -504,33 +527,140 @@ void MeshNode::set_mesh(std::shared_ptr<Mesh> mesh)
     mid_frame_cleanup();
 
     m_mesh = mesh;
-
-    create_instance_data_buffer();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 void MeshNode::set_material_override(std::shared_ptr<Material> material_override)
 {
+    // Emissive materials change the area lights of the scene, anything else only changes the material index of the instance.
+    bool is_emissive = (m_material_override && m_material_override->is_emissive()) || (material_override && material_override->is_emissive());
+
+    if (m_mesh)
+    {
+        for (auto& material : m_mesh->materials())
+            is_emissive |= material->is_emissive();
+    }
+
     mid_frame_material_cleanup();
 
     m_material_override = material_override;
+
+    if (is_emissive)
+        m_is_heirarchy_dirty = true;
+    else
+        m_is_property_dirty = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+InstancerNode::InstancerNode(const std::string& name) :
+    TransformNode(NODE_INSTANCER, name)
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+InstancerNode::~InstancerNode()
+{
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void MeshNode::create_instance_data_buffer()
+void InstancerNode::update(RenderState& render_state)
+{
+    if (m_is_enabled)
+    {
+        TransformNode::update(render_state);
+
+        if (m_mesh && m_instance_transforms.size() > 0)
+            render_state.m_instancers.push_back(this);
+
+        update_children(render_state);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void InstancerNode::mid_frame_cleanup()
 {
     if (m_mesh)
     {
         auto backend = m_mesh->backend().lock();
 
         if (backend)
-        {
-            backend->queue_object_deletion(m_material_indices_buffer);
-            m_material_indices_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(glm::uvec2) * (m_mesh->sub_meshes().size()), VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
-        }
+            backend->queue_object_deletion(m_mesh);
     }
+
+    mid_frame_material_cleanup();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void InstancerNode::mid_frame_material_cleanup()
+{
+    if (m_material_override)
+    {
+        auto backend = m_material_override->backend().lock();
+        backend->queue_object_deletion(m_material_override);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void InstancerNode::set_mesh(std::shared_ptr<Mesh> mesh)
+{
+    mid_frame_cleanup();
+
+    m_mesh               = mesh;
+    m_is_heirarchy_dirty = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void InstancerNode::set_material_override(std::shared_ptr<Material> material_override)
+{
+    mid_frame_material_cleanup();
+
+    m_material_override  = material_override;
+    m_is_heirarchy_dirty = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void InstancerNode::set_instances(const std::vector<glm::mat4>& transforms)
+{
+    m_instance_transforms.resize(transforms.size());
+
+    for (uint32_t i = 0; i < transforms.size(); i++)
+        m_instance_transforms[i] = glm::mat3x4(glm::transpose(transforms[i]));
+
+    m_is_heirarchy_dirty = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void InstancerNode::add_instance(const glm::mat4& transform)
+{
+    m_instance_transforms.push_back(glm::mat3x4(glm::transpose(transform)));
+
+    m_is_heirarchy_dirty = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void InstancerNode::clear_instances()
+{
+    m_instance_transforms.clear();
+
+    m_is_heirarchy_dirty = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::mat4 InstancerNode::instance_transform(uint32_t idx)
+{
+    return global_transform() * glm::transpose(glm::mat4(m_instance_transforms[idx]));
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -553,6 +683,7 @@ void DirectionalLightNode::update(RenderState& render_state)
     if (m_is_enabled)
     {
         TransformNode::update(render_state);
+        update_property_state(render_state);
 
         render_state.m_directional_lights.push_back(this);
 
@@ -562,6 +693,14 @@ void DirectionalLightNode::update(RenderState& render_state)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void DirectionalLightNode::transform_updated(RenderState& render_state)
+{
+    // Moving a light only changes its light data.
+    m_is_property_dirty = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 SpotLightNode::SpotLightNode(const std::string& name) :
     TransformNode(NODE_SPOT_LIGHT, name)
 {
@@ -580,6 +719,7 @@ void SpotLightNode::update(RenderState& render_state)
     if (m_is_enabled)
     {
         TransformNode::update(render_state);
+        update_property_state(render_state);
 
         render_state.m_spot_lights.push_back(this);
 
@@ -589,6 +729,13 @@ void SpotLightNode::update(RenderState& render_state)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void SpotLightNode::transform_updated(RenderState& render_state)
+{
+    m_is_property_dirty = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 PointLightNode::PointLightNode(const std::string& name) :
     TransformNode(NODE_POINT_LIGHT, name)
 {
@@ -607,6 +754,7 @@ void PointLightNode::update(RenderState& render_state)
     if (m_is_enabled)
     {
         TransformNode::update(render_state);
+        update_property_state(render_state);
 
         render_state.m_point_lights.push_back(this);
 
@@ -616,6 +764,13 @@ void PointLightNode::update(RenderState& render_state)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void PointLightNode::transform_updated(RenderState& render_state)
+{
+    m_is_property_dirty = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 CameraNode::CameraNode(const std::string& name) :
     TransformNode(NODE_CAMERA, name)
 {
@@ -661,6 +816,60 @@ glm::vec3 CameraNode::camera_left()
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+ProbeVolumeNode::ProbeVolumeNode(const std::string& name) :
+    TransformNode(NODE_PROBE_VOLUME, name)
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ProbeVolumeNode::~ProbeVolumeNode()
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProbeVolumeNode::update(RenderState& render_state)
+{
+    if (m_is_enabled)
+    {
+        TransformNode::update(render_state);
+        update_children(render_state);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 ProbeVolumeNode::probe_position(uint32_t x, uint32_t y, uint32_t z)
+{
+    glm::vec3 local_position = (glm::vec3(x, y, z) + glm::vec3(0.5f)) / glm::vec3(m_resolution) - glm::vec3(0.5f);
+
+    return glm::vec3(global_transform() * glm::vec4(local_position, 1.0f));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProbeVolumeNode::set_resolution(const glm::uvec3& resolution)
+{
+    m_resolution = glm::clamp(resolution, glm::uvec3(1), glm::uvec3(MAX_PROBE_VOLUME_RESOLUTION));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProbeVolumeNode::set_sh_bands(uint32_t bands)
+{
+    m_sh_bands = glm::clamp(bands, 2u, 3u);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProbeVolumeNode::transform_updated(RenderState& render_state)
+{
+    // The volume is not part of the scene that is rendered.
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 IBLNode::IBLNode(const std::string& name) :
     Node(NODE_IBL, name)
 {
@@ -681,6 +890,7 @@ void IBLNode::update(RenderState& render_state)
         if (!render_state.m_ibl_environment_map)
             render_state.m_ibl_environment_map = this;
 
+        update_property_state(render_state);
         update_children(render_state);
     }
 }
@@ -728,6 +938,7 @@ RenderState::~RenderState()
 void RenderState::clear()
 {
     m_meshes.clear();
+    m_instancers.clear();
     m_directional_lights.clear();
     m_spot_lights.clear();
     m_point_lights.clear();
@@ -743,7 +954,9 @@ void RenderState::clear()
     m_material_indices_ds = nullptr;
     m_texture_ds          = nullptr;
     m_ray_debug_ds        = nullptr;
+    m_light_group_ds      = nullptr;
     m_num_lights          = 0;
+    m_num_instances       = 0;
     m_scene_state         = SCENE_STATE_READY;
 }
 
@@ -759,96 +972,54 @@ void RenderState::setup(uint32_t width, uint32_t height, vk::CommandBuffer::Ptr
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Scene::Ptr Scene::create(vk::Backend::Ptr backend, const std::string& name, Node::Ptr root, const std::string& path)
+uint32_t RenderState::environment_light_group()
 {
-    return std::shared_ptr<Scene>(new Scene(backend, name, root, path));
+    if (m_ibl_environment_map && m_ibl_environment_map->image())
+        return m_ibl_environment_map->light_group();
+    else if (m_directional_lights.size() > 0)
+        return m_directional_lights[0]->light_group();
+    else
+        return 0;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Scene::Scene(vk::Backend::Ptr backend, const std::string& name, Node::Ptr root, const std::string& path) :
-    m_name(name), m_path(path), m_backend(backend), m_root(root), vk::Object(backend)
+Scene::Ptr Scene::create(vk::Backend::Ptr backend, ShaderCache::Ptr shader_cache, const std::string& name, Node::Ptr root, const std::string& path)
 {
-    // Allocate device instance buffer
-    m_tlas.instance_buffer_device = vk::Buffer::create(backend, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, sizeof(VkAccelerationStructureInstanceKHR) * MAX_SCENE_MESH_INSTANCE_COUNT, VMA_MEMORY_USAGE_GPU_ONLY, 0);
-
-    VkDeviceOrHostAddressConstKHR instance_device_address {};
-    instance_device_address.deviceAddress = m_tlas.instance_buffer_device->device_address();
-
-    // Allocate host instance buffer
-    m_tlas.instance_buffer_host = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, sizeof(VkAccelerationStructureInstanceKHR) * MAX_SCENE_MESH_INSTANCE_COUNT, VMA_MEMORY_USAGE_CPU_ONLY, VMA_ALLOCATION_CREATE_MAPPED_BIT);
-
-    // Create TLAS
-    VkAccelerationStructureGeometryKHR tlas_geometry;
-    HELIOS_ZERO_MEMORY(tlas_geometry);
-
-    tlas_geometry.sType                              = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-    tlas_geometry.geometryType                       = VK_GEOMETRY_TYPE_INSTANCES_KHR;
-    tlas_geometry.geometry.instances.sType           = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
-    tlas_geometry.geometry.instances.arrayOfPointers = VK_FALSE;
-    tlas_geometry.geometry.instances.data            = instance_device_address;
-
-    vk::AccelerationStructure::Desc desc;
-
-    desc.set_geometry_count(1);
-    desc.set_geometries({ tlas_geometry });
-    desc.set_max_primitive_counts({ MAX_SCENE_MESH_INSTANCE_COUNT });
-    desc.set_type(VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR);
-    desc.set_flags(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR);
-
-    m_tlas.tlas = vk::AccelerationStructure::create(backend, desc);
+    return std::shared_ptr<Scene>(new Scene(backend, shader_cache, name, root, path));
+}
 
-    // Allocate scratch buffer
-    m_tlas.scratch_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, m_tlas.tlas->build_sizes().buildScratchSize, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+// -----------------------------------------------------------------------------------------------------------------------------------
 
+Scene::Scene(vk::Backend::Ptr backend, ShaderCache::Ptr shader_cache, const std::string& name, Node::Ptr root, const std::string& path) :
+    m_name(name), m_path(path), m_backend(backend), m_root(root), vk::Object(backend)
+{
     vk::DescriptorPool::Desc dp_desc;
 
-    dp_desc.set_max_sets(25)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 10)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_SCENE_MATERIAL_TEXTURE_COUNT)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 * MAX_SCENE_MESH_INSTANCE_COUNT)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 10);
+    dp_desc.set_max_sets(1)
+        .add_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1)
+        .add_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3)
+        .add_pool_size(VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1);
 
     m_descriptor_pool = vk::DescriptorPool::create(backend, dp_desc);
 
     // Allocate descriptor set
-    VkDescriptorSetVariableDescriptorCountAllocateInfo variable_ds_alloc_info;
-    HELIOS_ZERO_MEMORY(variable_ds_alloc_info);
-
-    uint32_t variable_desc_count = MAX_SCENE_MESH_INSTANCE_COUNT;
-
-    variable_ds_alloc_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
-    variable_ds_alloc_info.descriptorSetCount = 1;
-    variable_ds_alloc_info.pDescriptorCounts  = &variable_desc_count;
-
     m_scene_descriptor_set = vk::DescriptorSet::create(backend, backend->scene_descriptor_set_layout(), m_descriptor_pool);
     m_scene_descriptor_set->set_name("Scene Descriptor Set");
 
-    m_vbo_descriptor_set = vk::DescriptorSet::create(backend, backend->buffer_array_descriptor_set_layout(), m_descriptor_pool, &variable_ds_alloc_info);
-    m_vbo_descriptor_set->set_name("VBO Descriptor Set");
-
-    m_ibo_descriptor_set = vk::DescriptorSet::create(backend, backend->buffer_array_descriptor_set_layout(), m_descriptor_pool, &variable_ds_alloc_info);
-    m_ibo_descriptor_set->set_name("IBO Descriptor Set");
-
-    m_material_indices_descriptor_set = vk::DescriptorSet::create(backend, backend->buffer_array_descriptor_set_layout(), m_descriptor_pool, &variable_ds_alloc_info);
-    m_material_indices_descriptor_set->set_name("Material Indices Descriptor Set");
-
-    variable_desc_count       = MAX_SCENE_MATERIAL_TEXTURE_COUNT;
-    m_textures_descriptor_set = vk::DescriptorSet::create(backend, backend->combined_sampler_array_descriptor_set_layout(), m_descriptor_pool, &variable_ds_alloc_info);
-    m_textures_descriptor_set->set_name("Textures Descriptor Set");
+    // Allocate the array descriptor sets
+    ensure_descriptor_capacity(SCENE_INITIAL_MESH_CAPACITY);
 
     // Create light data buffer
-    m_light_data_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(LightData) * MAX_SCENE_LIGHT_COUNT, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    ensure_light_capacity(SCENE_INITIAL_LIGHT_CAPACITY);
 
     // Create material data buffer
-    m_material_data_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(MaterialData) * MAX_SCENE_MATERIAL_COUNT, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
-
-    // Create instance data buffer
-    m_instance_data_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(InstanceData) * MAX_SCENE_MESH_INSTANCE_COUNT, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    ensure_material_capacity(SCENE_INITIAL_MATERIAL_CAPACITY);
 
-    update_static_descriptors();
+    // Create the TLAS and instance buffers, this also writes the static descriptors
+    ensure_instance_capacity(SCENE_INITIAL_INSTANCE_CAPACITY);
 
-    m_sky_model = std::unique_ptr<HosekWilkieSkyModel>(new HosekWilkieSkyModel(backend));
+    m_sky_model = std::unique_ptr<HosekWilkieSkyModel>(new HosekWilkieSkyModel(backend, shader_cache));
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -856,17 +1027,20 @@ Scene::Scene(vk::Backend::Ptr backend, const std::string& name, Node::Ptr root,
 Scene::~Scene()
 {
     m_sky_model.reset();
-    m_textures_descriptor_set.reset();
     m_material_indices_descriptor_set.reset();
     m_ibo_descriptor_set.reset();
     m_vbo_descriptor_set.reset();
     m_scene_descriptor_set.reset();
+    m_array_descriptor_pool.reset();
     m_descriptor_pool.reset();
     m_tlas.scratch_buffer.reset();
     m_tlas.instance_buffer_host.reset();
+    m_tlas.instance_buffer_device.reset();
     m_tlas.tlas.reset();
     m_light_data_buffer.reset();
     m_material_data_buffer.reset();
+    m_instance_data_buffer.reset();
+    m_submesh_info_buffer.reset();
     m_root.reset();
 }
 
@@ -876,12 +1050,9 @@ void Scene::update(RenderState& render_state)
 {
     auto backend = m_backend.lock();
 
-    render_state.m_scene_ds            = m_scene_descriptor_set;
-    render_state.m_vbo_ds              = m_vbo_descriptor_set;
-    render_state.m_ibo_ds              = m_ibo_descriptor_set;
-    render_state.m_material_indices_ds = m_material_indices_descriptor_set;
-    render_state.m_texture_ds          = m_textures_descriptor_set;
-    render_state.m_scene               = this;
+    render_state.m_scene = this;
+
+    m_frame_allocator.reset();
 
     {
         HELIOS_SCOPED_SAMPLE("Gather Render State");
@@ -890,12 +1061,65 @@ void Scene::update(RenderState& render_state)
 
     render_state.m_num_lights = m_num_area_lights + render_state.m_directional_lights.size() + render_state.m_spot_lights.size() + render_state.m_point_lights.size();
 
+    // Mesh nodes come first in the instance buffer, followed by the instances of every instancer in order.
+    size_t num_instances = render_state.m_meshes.size();
+
+    for (auto& instancer : render_state.m_instancers)
+        num_instances += instancer->instance_count();
+
+    render_state.m_num_instances = uint32_t(std::min(num_instances, size_t(MAX_SCENE_INSTANCE_COUNT)));
+
     if (render_state.ibl_environment_map() && render_state.ibl_environment_map()->image())
         render_state.m_num_lights++;
     else if (render_state.m_directional_lights.size() > 0)
     {
         render_state.m_num_lights++;
-        m_sky_model->update(render_state.cmd_buffer(), -render_state.m_directional_lights[0]->forward());
+
+        // The sky is only regenerated when it changed, e.g. through its turbidity, which the nodes know nothing about
+        if (m_sky_model->update(render_state.cmd_buffer(), -render_state.m_directional_lights[0]->forward()))
+            render_state.promote_scene_state(SCENE_STATE_PROPERTIES_UPDATED);
+    }
+
+    // Materials are edited directly rather than through the nodes, so edits are found by comparing versions.
+    if (Material::latest_version() != m_material_version)
+    {
+        for (uint32_t i = 0; i < m_material_slots.size(); i++)
+        {
+            if (m_material_slots[i].material->version() > m_material_version)
+                m_dirty_material_slots.push_back(i);
+        }
+
+        m_material_version = Material::latest_version();
+
+        if (m_dirty_material_slots.size() > 0)
+            render_state.promote_scene_state(SCENE_STATE_PROPERTIES_UPDATED);
+    }
+
+    // Reloaded meshes keep their handle but not their buffers and BLAS, which are only picked up by a hierarchy update.
+    if (Mesh::latest_version() != m_mesh_version)
+    {
+        for (auto mesh_node : render_state.m_meshes)
+        {
+            if (mesh_node->mesh()->version() > m_mesh_version)
+                render_state.promote_scene_state(SCENE_STATE_HIERARCHY_UPDATED);
+        }
+
+        for (auto instancer : render_state.m_instancers)
+        {
+            if (instancer->mesh()->version() > m_mesh_version)
+                render_state.promote_scene_state(SCENE_STATE_HIERARCHY_UPDATED);
+        }
+
+        m_mesh_version = Mesh::latest_version();
+    }
+
+    // A reloaded environment map keeps its handle but not its image view, which is only written by a hierarchy update.
+    if (TextureCube::latest_version() != m_texture_cube_version)
+    {
+        if (render_state.ibl_environment_map() && render_state.ibl_environment_map()->image() && render_state.ibl_environment_map()->image()->version() > m_texture_cube_version)
+            render_state.promote_scene_state(SCENE_STATE_HIERARCHY_UPDATED);
+
+        m_texture_cube_version = TextureCube::latest_version();
     }
 
     if (m_force_update)
@@ -904,245 +1128,369 @@ void Scene::update(RenderState& render_state)
         m_force_update             = false;
     }
 
+    if (render_state.m_scene_state == SCENE_STATE_HIERARCHY_UPDATED && num_instances > MAX_SCENE_INSTANCE_COUNT)
+        HELIOS_LOG_ERROR("Scene has " + std::to_string(num_instances) + " instances, only the first " + std::to_string(MAX_SCENE_INSTANCE_COUNT) + " will be rendered.");
+
     {
         HELIOS_SCOPED_SAMPLE("Upload GPU Resources");
         create_gpu_resources(render_state);
     }
+
+    // The array sets are only known once the GPU resources are up to date as they are reallocated when the scene outgrows them.
+    render_state.m_scene_ds            = m_scene_descriptor_set;
+    render_state.m_vbo_ds              = m_vbo_descriptor_set;
+    render_state.m_ibo_ds              = m_ibo_descriptor_set;
+    render_state.m_material_indices_ds = m_material_indices_descriptor_set;
+    render_state.m_texture_ds          = backend->bindless_texture_descriptor_set();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Scene::create_gpu_resources(RenderState& render_state)
+static void fill_material_data(Material* material, MaterialData& material_data)
 {
-    if (render_state.m_scene_state != SCENE_STATE_READY)
+    material_data.texture_indices0   = glm::ivec4(-1);
+    material_data.texture_indices1   = glm::ivec4(-1);
+    material_data.albedo             = glm::vec4(0.0f);
+    material_data.emissive           = glm::vec4(0.0f);
+    material_data.roughness_metallic = glm::vec4(0.0f);
+
+    if (material->albedo_texture())
+        material_data.texture_indices0.x = int32_t(material->albedo_texture()->bindless_index());
+    else
     {
-        // Copy lights
-        uint32_t   gpu_light_counter = 0;
-        LightData* light_buffer      = (LightData*)m_light_data_buffer->mapped_ptr();
+        material_data.albedo = material->albedo_value();
+        // Covert from sRGB to Linear
+        material_data.albedo = glm::vec4(glm::pow(glm::vec3(material_data.albedo[0], material_data.albedo[1], material_data.albedo[2]), glm::vec3(2.2f)), material_data.albedo.a);
+    }
 
-        if (render_state.m_scene_state == SCENE_STATE_HIERARCHY_UPDATED)
-        {
-            m_num_area_lights = 0;
+    if (material->normal_texture())
+        material_data.texture_indices0.y = int32_t(material->normal_texture()->bindless_index());
 
-            auto backend = m_backend.lock();
+    if (material->roughness_texture())
+    {
+        material_data.texture_indices0.z = int32_t(material->roughness_texture()->bindless_index());
+        material_data.texture_indices1.z = material->roughness_texture_info().array_index;
+    }
+    else
+        material_data.roughness_metallic.x = material->roughness_value();
 
-            backend->wait_idle();
+    if (material->metallic_texture())
+    {
+        material_data.texture_indices0.w = int32_t(material->metallic_texture()->bindless_index());
+        material_data.texture_indices1.w = material->metallic_texture_info().array_index;
+    }
+    else
+        material_data.roughness_metallic.y = material->metallic_value();
 
-            std::unordered_set<uint32_t>           processed_meshes;
-            std::unordered_set<uint32_t>           processed_materials;
-            std::unordered_set<uint32_t>           processed_textures;
-            std::unordered_map<uint32_t, uint32_t> global_material_indices;
-            uint32_t                               mesh_index_counter = 0;
+    if (material->emissive_texture())
+        material_data.texture_indices1.x = int32_t(material->emissive_texture()->bindless_index());
+    else
+        material_data.emissive = material->emissive_value();
 
-            std::vector<VkDescriptorBufferInfo> vbo_descriptors;
-            std::vector<VkDescriptorBufferInfo> ibo_descriptors;
-            std::vector<VkDescriptorImageInfo>  image_descriptors;
-            std::vector<VkDescriptorBufferInfo> material_indices_descriptors;
-            uint32_t                            gpu_material_counter = 0;
-            MaterialData*                       material_buffer      = (MaterialData*)m_material_data_buffer->mapped_ptr();
+    material_data.texture_indices1.y = int32_t(material->light_group());
+}
 
-            for (int mesh_node_idx = 0; mesh_node_idx < render_state.m_meshes.size(); mesh_node_idx++)
-            {
-                auto&       mesh_node = render_state.m_meshes[mesh_node_idx];
-                auto&       mesh      = mesh_node->mesh();
-                const auto& materials = mesh->materials();
-                const auto& submeshes = mesh->sub_meshes();
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-                if (processed_meshes.find(mesh->id()) == processed_meshes.end())
-                {
-                    processed_meshes.insert(mesh->id());
+static void fill_environment_light_data(RenderState& render_state, LightData& light_data)
+{
+    light_data.light_data0 = glm::vec4(float(LIGHT_ENVIRONMENT_MAP), 0.0f, 0.0f, 0.0f);
+    light_data.light_data3 = glm::vec4(0.0f, 0.0f, 0.0f, float(render_state.environment_light_group()));
+}
 
-                    m_global_mesh_indices[mesh->id()] = mesh_index_counter++;
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-                    VkDescriptorBufferInfo ibo_info;
+static void fill_light_data(DirectionalLightNode* light, LightData& light_data)
+{
+    light_data.light_data0 = glm::vec4(float(LIGHT_DIRECTIONAL), light->color());
+    light_data.light_data1 = glm::vec4(light->forward(), light->intensity());
+    light_data.light_data2 = glm::vec4(0.0f, 0.0f, 0.0f, light->radius());
+    light_data.light_data3 = glm::vec4(0.0f, 0.0f, 0.0f, float(light->light_group()));
+}
 
-                    ibo_info.buffer = mesh->index_buffer()->handle();
-                    ibo_info.offset = 0;
-                    ibo_info.range  = VK_WHOLE_SIZE;
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-                    ibo_descriptors.push_back(ibo_info);
+static void fill_light_data(PointLightNode* light, LightData& light_data)
+{
+    light_data.light_data0 = glm::vec4(float(LIGHT_POINT), light->color());
+    light_data.light_data1 = glm::vec4(0.0f, 0.0f, 0.0f, light->intensity());
+    light_data.light_data2 = glm::vec4(light->global_position(), light->radius());
+    light_data.light_data3 = glm::vec4(0.0f, 0.0f, 0.0f, float(light->light_group()));
+}
 
-                    VkDescriptorBufferInfo vbo_info;
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-                    vbo_info.buffer = mesh->vertex_buffer()->handle();
-                    vbo_info.offset = 0;
-                    vbo_info.range  = VK_WHOLE_SIZE;
+static void fill_light_data(SpotLightNode* light, LightData& light_data)
+{
+    light_data.light_data0 = glm::vec4(float(LIGHT_SPOT), light->color());
+    light_data.light_data1 = glm::vec4(light->forward(), light->intensity());
+    light_data.light_data2 = glm::vec4(light->global_position(), light->radius());
+    light_data.light_data3 = glm::vec4(cosf(glm::radians(light->inner_cone_angle())), cosf(glm::radians(light->outer_cone_angle())), 0.0f, float(light->light_group()));
+}
 
-                    vbo_descriptors.push_back(vbo_info);
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-                    for (uint32_t i = 0; i < submeshes.size(); i++)
-                    {
-                        const SubMesh& submesh  = submeshes[i];
-                        auto           material = materials[submesh.mat_idx];
+// 64-bit FNV-1a over the GPU representation of a material.
+static uint64_t hash_material_data(const MaterialData& material_data)
+{
+    const uint8_t* bytes = (const uint8_t*)&material_data;
+    uint64_t       hash  = 14695981039346656037ull;
 
-                        if (mesh_node->material_override())
-                            material = mesh_node->material_override();
+    for (size_t i = 0; i < sizeof(MaterialData); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
 
-                        if (processed_materials.find(material->id()) == processed_materials.end())
-                        {
-                            processed_materials.insert(material->id());
+    return hash;
+}
 
-                            MaterialData& material_data = material_buffer[gpu_material_counter++];
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-                            material_data.texture_indices0   = glm::ivec4(-1);
-                            material_data.texture_indices1   = glm::ivec4(-1);
-                            material_data.albedo             = glm::vec4(0.0f);
-                            material_data.emissive           = glm::vec4(0.0f);
-                            material_data.roughness_metallic = glm::vec4(0.0f);
+static void write_instance(VkAccelerationStructureInstanceKHR& rt_instance, InstanceData& instance_data, uint32_t instance_idx, const glm::mat4& transform, uint32_t mesh_index, uint32_t material_override, uint64_t blas_address)
+{
+    glm::mat3x4 rows = glm::mat3x4(glm::transpose(transform));
 
-                            // Fill GPUMaterial
-                            if (material->albedo_texture())
-                            {
-                                auto texture = material->albedo_texture();
+    // Copy geometry instance data
+    memcpy(&rt_instance.transform, &rows, sizeof(rt_instance.transform));
 
-                                if (processed_textures.find(texture->id()) == processed_textures.end())
-                                {
-                                    processed_textures.insert(texture->id());
+    rt_instance.instanceCustomIndex                    = instance_idx;
+    rt_instance.mask                                   = 0xFF;
+    rt_instance.instanceShaderBindingTableRecordOffset = 0;
+    rt_instance.flags                                  = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+    rt_instance.accelerationStructureReference         = blas_address;
 
-                                    VkDescriptorImageInfo image_info;
+    // Update instance data
+    instance_data.transform[0]      = rows[0];
+    instance_data.transform[1]      = rows[1];
+    instance_data.transform[2]      = rows[2];
+    instance_data.mesh_index        = mesh_index;
+    instance_data.material_override = material_override;
+}
 
-                                    image_info.sampler     = backend->trilinear_sampler()->handle();
-                                    image_info.imageView   = texture->image_view()->handle();
-                                    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-                                    material_data.texture_indices0.x = image_descriptors.size();
+void Scene::create_gpu_resources(RenderState& render_state)
+{
+    // Property edits are patched in place unless they need a new material slot or change the area lights.
+    if (render_state.m_scene_state == SCENE_STATE_PROPERTIES_UPDATED || render_state.m_scene_state == SCENE_STATE_TRANSFORMS_UPDATED)
+    {
+        if (!update_gpu_properties(render_state))
+            render_state.m_scene_state = SCENE_STATE_HIERARCHY_UPDATED;
+        else if (render_state.m_scene_state == SCENE_STATE_PROPERTIES_UPDATED)
+            return;
+    }
 
-                                    image_descriptors.push_back(image_info);
-                                }
-                            }
-                            else
-                            {
-                                material_data.albedo = material->albedo_value();
-                                // Covert from sRGB to Linear
-                                material_data.albedo = glm::vec4(glm::pow(glm::vec3(material_data.albedo[0], material_data.albedo[1], material_data.albedo[2]), glm::vec3(2.2f)), material_data.albedo.a);
-                            }
+    if (render_state.m_scene_state != SCENE_STATE_READY)
+    {
+        auto backend = m_backend.lock();
 
-                            if (material->normal_texture())
-                            {
-                                auto texture = material->normal_texture();
+        // Area lights come first in the light buffer, followed by the environment and punctual lights.
+        uint32_t num_punctual_lights = render_state.m_directional_lights.size() + render_state.m_point_lights.size() + render_state.m_spot_lights.size();
 
-                                if (processed_textures.find(texture->id()) == processed_textures.end())
-                                {
-                                    processed_textures.insert(texture->id());
+        if ((render_state.ibl_environment_map() && render_state.ibl_environment_map()->image()) || render_state.m_directional_lights.size() > 0)
+            num_punctual_lights++;
 
-                                    VkDescriptorImageInfo image_info;
+        // Copy lights
+        uint32_t gpu_light_counter = 0;
 
-                                    image_info.sampler     = backend->trilinear_sampler()->handle();
-                                    image_info.imageView   = texture->image_view()->handle();
-                                    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        if (render_state.m_scene_state == SCENE_STATE_HIERARCHY_UPDATED)
+        {
+            m_num_area_lights = 0;
 
-                                    material_data.texture_indices0.y = image_descriptors.size();
+            backend->wait_idle();
 
-                                    image_descriptors.push_back(image_info);
-                                }
-                            }
+            ensure_instance_capacity(render_state.m_num_instances);
 
-                            if (material->roughness_texture())
-                            {
-                                auto texture = material->roughness_texture();
+            // Every unique mesh gets a single submesh table that is shared by all of its instances. The first instance of each mesh is
+            // the one its emissive submeshes are sampled through.
+            struct UniqueMesh
+            {
+                std::shared_ptr<Mesh>     mesh;
+                std::shared_ptr<Material> material_override;
+                uint32_t                  first_instance;
+            };
 
-                                if (processed_textures.find(texture->id()) == processed_textures.end())
-                                {
-                                    processed_textures.insert(texture->id());
+            // Temporaries come from the frame allocator and the scratch containers, so rebuilding the scene does not churn the heap.
+            LinearVector<UniqueMesh>                unique_meshes(m_frame_allocator);
+            LinearVector<std::shared_ptr<Material>> unique_materials(m_frame_allocator);
 
-                                    VkDescriptorImageInfo image_info;
+            unique_meshes.reserve(render_state.m_meshes.size() + render_state.m_instancers.size());
 
-                                    image_info.sampler     = backend->trilinear_sampler()->handle();
-                                    image_info.imageView   = texture->image_view()->handle();
-                                    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            m_processed_meshes.reset();
+            m_processed_materials.reset();
+            m_global_mesh_indices.reset();
 
-                                    material_data.texture_indices0.z = image_descriptors.size();
-                                    material_data.texture_indices1.z = material->roughness_texture_info().array_index;
+            auto add_material = [&](const std::shared_ptr<Material>& material) {
+                if (m_processed_materials.insert(material->id()))
+                    unique_materials.push_back(material);
+            };
 
-                                    image_descriptors.push_back(image_info);
-                                }
-                            }
-                            else
-                                material_data.roughness_metallic.x = material->roughness_value();
+            auto add_instance = [&](const std::shared_ptr<Mesh>& mesh, const std::shared_ptr<Material>& material_override, uint32_t instance_idx) {
+                if (m_processed_meshes.insert(mesh->id()))
+                {
+                    m_global_mesh_indices[mesh->id()] = unique_meshes.size();
 
-                            if (material->metallic_texture())
-                            {
-                                auto texture = material->metallic_texture();
+                    unique_meshes.push_back({ mesh, material_override, instance_idx });
 
-                                if (processed_textures.find(texture->id()) == processed_textures.end())
-                                {
-                                    processed_textures.insert(texture->id());
+                    for (auto& material : mesh->materials())
+                        add_material(material);
+                }
 
-                                    VkDescriptorImageInfo image_info;
+                if (material_override)
+                    add_material(material_override);
+            };
 
-                                    image_info.sampler     = backend->trilinear_sampler()->handle();
-                                    image_info.imageView   = texture->image_view()->handle();
-                                    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            for (uint32_t mesh_node_idx = 0; mesh_node_idx < render_state.m_meshes.size(); mesh_node_idx++)
+            {
+                auto& mesh_node = render_state.m_meshes[mesh_node_idx];
+                add_instance(mesh_node->mesh(), mesh_node->material_override(), mesh_node_idx);
+            }
 
-                                    material_data.texture_indices0.w = image_descriptors.size();
-                                    material_data.texture_indices1.w = material->metallic_texture_info().array_index;
+            uint32_t instance_offset = render_state.m_meshes.size();
 
-                                    image_descriptors.push_back(image_info);
-                                }
-                            }
-                            else
-                                material_data.roughness_metallic.y = material->metallic_value();
+            for (auto& instancer : render_state.m_instancers)
+            {
+                if (instance_offset >= render_state.m_num_instances)
+                    break;
 
-                            if (material->emissive_texture())
-                            {
-                                auto texture = material->emissive_texture();
+                add_instance(instancer->mesh(), instancer->material_override(), instance_offset);
+                instance_offset += instancer->instance_count();
+            }
 
-                                if (processed_textures.find(texture->id()) == processed_textures.end())
-                                {
-                                    processed_textures.insert(texture->id());
+            for (auto& unique_mesh : unique_meshes)
+            {
+                const auto& materials = unique_mesh.mesh->materials();
 
-                                    VkDescriptorImageInfo image_info;
+                for (auto& submesh : unique_mesh.mesh->sub_meshes())
+                {
+                    auto material = unique_mesh.material_override ? unique_mesh.material_override : materials[submesh.mat_idx];
 
-                                    image_info.sampler     = backend->trilinear_sampler()->handle();
-                                    image_info.imageView   = texture->image_view()->handle();
-                                    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                    if (material->is_emissive())
+                        m_num_area_lights++;
+                }
+            }
 
-                                    material_data.texture_indices1.x = image_descriptors.size();
+            ensure_light_capacity(m_num_area_lights + num_punctual_lights);
+            ensure_material_capacity(unique_materials.size());
 
-                                    image_descriptors.push_back(image_info);
-                                }
-                            }
-                            else
-                                material_data.emissive = material->emissive_value();
+            LinearVector<VkDescriptorBufferInfo> vbo_descriptors(m_frame_allocator);
+            LinearVector<VkDescriptorBufferInfo> ibo_descriptors(m_frame_allocator);
+            LinearVector<VkDescriptorBufferInfo> material_indices_descriptors(m_frame_allocator);
+            uint32_t                             gpu_material_counter = 0;
+            MaterialData*                        material_buffer      = (MaterialData*)m_material_data_buffer->mapped_ptr();
+            LightData*                           light_buffer         = (LightData*)m_light_data_buffer->mapped_ptr();
 
-                            global_material_indices[material->id()] = gpu_material_counter - 1;
-                        }
+            vbo_descriptors.reserve(unique_meshes.size());
+            ibo_descriptors.reserve(unique_meshes.size());
+            material_indices_descriptors.reserve(unique_meshes.size());
 
-                        if (material->is_emissive())
-                        {
-                            m_num_area_lights++;
+            m_global_material_indices.reset();
+            m_material_slots.clear();
+            m_material_slot_users.clear();
+            m_dirty_material_slots.clear();
 
-                            LightData& light_data = light_buffer[gpu_light_counter++];
+            // Materials that end up with identical GPU data share a single entry.
+            m_material_data_indices.reset();
 
-                            light_data.light_data0 = glm::vec4(float(LIGHT_AREA), float(mesh_node_idx), float(global_material_indices[material->id()]), float(submesh.base_index / 3));
-                            light_data.light_data1 = glm::vec4(float(submesh.index_count / 3), 0.0f, 0.0f, 0.0f);
-                        }
-                    }
+            for (auto& material : unique_materials)
+            {
+                MaterialData material_data;
+                fill_material_data(material.get(), material_data);
+
+                const uint64_t hash       = hash_material_data(material_data);
+                uint32_t*      slot_index = m_material_data_indices.find(hash);
+
+                if (slot_index && memcmp(&material_buffer[*slot_index], &material_data, sizeof(MaterialData)) == 0)
+                    m_material_slot_users[*slot_index]++;
+                else
+                {
+                    material_buffer[gpu_material_counter] = material_data;
+                    m_material_data_indices[hash]         = gpu_material_counter++;
+
+                    m_material_slot_users.push_back(1);
+                    slot_index = m_material_data_indices.find(hash);
                 }
 
+                m_global_material_indices[material->id()] = *slot_index;
+                m_material_slots.push_back({ material, *slot_index, material->is_emissive() });
+            }
+
+            // All submesh tables live in one buffer, each starting at an offset that can be bound as a storage buffer.
+            size_t submesh_info_size = 0;
+
+            for (auto& unique_mesh : unique_meshes)
+                submesh_info_size += backend->aligned_storage_buffer_size(sizeof(glm::uvec2) * std::max(unique_mesh.mesh->geometries().size(), size_t(1)));
+
+            if (!m_submesh_info_buffer || m_submesh_info_buffer->size() < submesh_info_size)
+            {
+                backend->queue_object_deletion(m_submesh_info_buffer);
+                m_submesh_info_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, std::max(submesh_info_size, m_submesh_info_buffer ? m_submesh_info_buffer->size() * 2 : size_t(0)), VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+            }
+
+            size_t submesh_info_offset = 0;
+
+            for (auto& unique_mesh : unique_meshes)
+            {
+                auto&       mesh      = unique_mesh.mesh;
+                const auto& materials  = mesh->materials();
+                const auto& submeshes  = mesh->sub_meshes();
+                const auto& geometries = mesh->geometries();
+
+                VkDescriptorBufferInfo ibo_info;
+
+                ibo_info.buffer = mesh->index_buffer()->handle();
+                ibo_info.offset = 0;
+                ibo_info.range  = VK_WHOLE_SIZE;
+
+                ibo_descriptors.push_back(ibo_info);
+
+                VkDescriptorBufferInfo vbo_info;
+
+                vbo_info.buffer = mesh->vertex_buffer()->handle();
+                vbo_info.offset = 0;
+                vbo_info.range  = VK_WHOLE_SIZE;
+
+                vbo_descriptors.push_back(vbo_info);
+
+                const size_t submesh_info_range = sizeof(glm::uvec2) * std::max(geometries.size(), size_t(1));
+
                 VkDescriptorBufferInfo material_indice_info;
 
-                material_indice_info.buffer = mesh_node->material_indices_buffer()->handle();
-                material_indice_info.offset = 0;
-                material_indice_info.range  = VK_WHOLE_SIZE;
+                material_indice_info.buffer = m_submesh_info_buffer->handle();
+                material_indice_info.offset = submesh_info_offset;
+                material_indice_info.range  = submesh_info_range;
 
                 material_indices_descriptors.push_back(material_indice_info);
 
-                glm::uvec2* primitive_offsets_material_indices = (glm::uvec2*)mesh_node->material_indices_buffer()->mapped_ptr();
+                glm::uvec2* primitive_offsets_material_indices = (glm::uvec2*)((uint8_t*)m_submesh_info_buffer->mapped_ptr() + submesh_info_offset);
 
-                // Set submesh materials
-                for (uint32_t i = 0; i < submeshes.size(); i++)
+                submesh_info_offset += backend->aligned_storage_buffer_size(submesh_info_range);
+
+                // Set geometry materials, the first geometries are those of the submeshes in order
+                for (uint32_t i = 0; i < geometries.size(); i++)
                 {
-                    const auto& submesh = submeshes[i];
+                    const MeshGeometry& geometry = geometries[i];
+                    auto                material = materials[submeshes[geometry.submesh_idx].mat_idx];
+
+                    primitive_offsets_material_indices[i] = glm::uvec2(geometry.primitive_offset, m_global_material_indices[material->id()]);
+                }
 
-                    auto material = materials[submeshes[i].mat_idx];
+                for (uint32_t i = 0; i < submeshes.size(); i++)
+                {
+                    const SubMesh& submesh  = submeshes[i];
+                    auto           material = materials[submesh.mat_idx];
 
-                    if (mesh_node->material_override())
-                        material = mesh_node->material_override();
+                    if (unique_mesh.material_override)
+                        material = unique_mesh.material_override;
 
-                    glm::uvec2 pair = glm::uvec2(submesh.base_index / 3, global_material_indices[material->id()]);
+                    if (material->is_emissive())
+                    {
+                        LightData& light_data = light_buffer[gpu_light_counter++];
 
-                    primitive_offsets_material_indices[i] = pair;
+                        light_data.light_data0 = glm::vec4(float(LIGHT_AREA), float(unique_mesh.first_instance), float(m_global_material_indices[material->id()]), float(submesh.base_index / 3));
+                        light_data.light_data1 = glm::vec4(float(submesh.index_count / 3), 0.0f, 0.0f, 0.0f);
+                    }
                 }
             }
 
@@ -1162,7 +1510,20 @@ void Scene::create_gpu_resources(RenderState& render_state)
 
             environment_map_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-            std::vector<VkWriteDescriptorSet> write_datas;
+            ensure_descriptor_capacity(unique_meshes.size());
+
+            if (unique_meshes.size() > m_mesh_capacity)
+            {
+                HELIOS_LOG_ERROR("Scene has " + std::to_string(unique_meshes.size()) + " meshes, the device supports " + std::to_string(m_mesh_capacity) + ".");
+
+                vbo_descriptors.resize(m_mesh_capacity);
+                ibo_descriptors.resize(m_mesh_capacity);
+                material_indices_descriptors.resize(m_mesh_capacity);
+            }
+
+            LinearVector<VkWriteDescriptorSet> write_datas(m_frame_allocator);
+
+            write_datas.reserve(4);
 
             VkWriteDescriptorSet write_data;
             HELIOS_ZERO_MEMORY(write_data);
@@ -1218,102 +1579,186 @@ void Scene::create_gpu_resources(RenderState& render_state)
                 write_datas.push_back(write_data);
             }
 
-            if (image_descriptors.size() > 0)
-            {
-                HELIOS_ZERO_MEMORY(write_data);
-
-                write_data.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-                write_data.descriptorCount = image_descriptors.size();
-                write_data.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-                write_data.pImageInfo      = image_descriptors.data();
-                write_data.dstBinding      = 0;
-                write_data.dstSet          = m_textures_descriptor_set->handle();
-
-                write_datas.push_back(write_data);
-            }
-
             if (write_datas.size() > 0)
                 vkUpdateDescriptorSets(backend->device(), write_datas.size(), write_datas.data(), 0, nullptr);
         }
+        else
+        {
+            gpu_light_counter = m_num_area_lights;
+
+            // Lights can only be reallocated once the frames in flight are done reading them.
+            if (m_num_area_lights + num_punctual_lights > m_light_capacity)
+            {
+                backend->wait_idle();
+                ensure_light_capacity(m_num_area_lights + num_punctual_lights);
+            }
+        }
 
+        LightData*                          light_buffer             = (LightData*)m_light_data_buffer->mapped_ptr();
         InstanceData*                       instance_buffer          = (InstanceData*)m_instance_data_buffer->mapped_ptr();
         VkAccelerationStructureInstanceKHR* geometry_instance_buffer = (VkAccelerationStructureInstanceKHR*)m_tlas.instance_buffer_host->mapped_ptr();
 
-        for (int mesh_node_idx = 0; mesh_node_idx < render_state.m_meshes.size(); mesh_node_idx++)
+        for (uint32_t mesh_node_idx = 0; mesh_node_idx < render_state.m_meshes.size(); mesh_node_idx++)
         {
             auto& mesh_node = render_state.m_meshes[mesh_node_idx];
-            auto& mesh      = mesh_node->mesh();
+            auto  mesh      = mesh_node->mesh();
 
-            // Copy geometry instance data
-            VkAccelerationStructureInstanceKHR& rt_instance = geometry_instance_buffer[mesh_node_idx];
+            const uint32_t material_override = mesh_node->material_override() ? m_global_material_indices[mesh_node->material_override()->id()] : INVALID_MATERIAL_INDEX;
+            const uint64_t blas_address      = mesh_node->material_override() ? mesh->override_acceleration_structure()->device_address() : mesh->acceleration_structure()->device_address();
 
-            glm::mat3x4 transform = glm::mat3x4(glm::transpose(mesh_node->global_transform()));
+            write_instance(geometry_instance_buffer[mesh_node_idx], instance_buffer[mesh_node_idx], mesh_node_idx, mesh_node->global_transform(), m_global_mesh_indices[mesh->id()], material_override, blas_address);
 
-            memcpy(&rt_instance.transform, &transform, sizeof(rt_instance.transform));
+            mesh_node->m_is_property_dirty = false;
+        }
+
+        uint32_t instance_idx = render_state.m_meshes.size();
 
-            rt_instance.instanceCustomIndex                    = mesh_node_idx;
-            rt_instance.mask                                   = 0xFF;
-            rt_instance.instanceShaderBindingTableRecordOffset = 0;
-            rt_instance.flags                                  = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
-            rt_instance.accelerationStructureReference         = mesh->acceleration_structure()->device_address();
+        for (auto& instancer : render_state.m_instancers)
+        {
+            auto mesh = instancer->mesh();
 
-            // Update instance data
-            InstanceData& instance_data = instance_buffer[mesh_node_idx];
+            const glm::mat4 instancer_transform = instancer->global_transform();
+            const uint32_t  mesh_index          = m_global_mesh_indices[mesh->id()];
+            const uint64_t  blas_address        = instancer->material_override() ? mesh->override_acceleration_structure()->device_address() : mesh->acceleration_structure()->device_address();
+            const uint32_t  material_override   = instancer->material_override() ? m_global_material_indices[instancer->material_override()->id()] : INVALID_MATERIAL_INDEX;
+            const auto&     transforms          = instancer->instance_transforms();
+            const uint32_t  num_instances       = std::min(uint32_t(transforms.size()), render_state.m_num_instances - instance_idx);
 
-            // Set mesh data index
-            instance_data.mesh_index    = m_global_mesh_indices[mesh->id()];
-            instance_data.model_matrix  = mesh_node->global_transform();
-            instance_data.normal_matrix = mesh_node->normal_matrix();
+            for (uint32_t i = 0; i < num_instances; i++)
+            {
+                const glm::mat4 transform = instancer_transform * glm::transpose(glm::mat4(transforms[i]));
+
+                write_instance(geometry_instance_buffer[instance_idx], instance_buffer[instance_idx], instance_idx, transform, mesh_index, material_override, blas_address);
+
+                instance_idx++;
+            }
         }
 
         if ((render_state.ibl_environment_map() && render_state.ibl_environment_map()->image()) || render_state.m_directional_lights.size() > 0)
+            fill_environment_light_data(render_state, light_buffer[gpu_light_counter++]);
+
+        if (render_state.m_ibl_environment_map)
+            render_state.m_ibl_environment_map->m_is_property_dirty = false;
+
+        for (auto light : render_state.m_directional_lights)
         {
-            LightData& light_data = light_buffer[gpu_light_counter++];
+            fill_light_data(light, light_buffer[gpu_light_counter++]);
+            light->m_is_property_dirty = false;
+        }
 
-            light_data.light_data0 = glm::vec4(float(LIGHT_ENVIRONMENT_MAP), 0.0f, 0.0f, 0.0f);
+        for (auto light : render_state.m_point_lights)
+        {
+            fill_light_data(light, light_buffer[gpu_light_counter++]);
+            light->m_is_property_dirty = false;
         }
 
-        for (int i = 0; i < render_state.m_directional_lights.size(); i++)
+        for (auto light : render_state.m_spot_lights)
         {
-            auto light = render_state.m_directional_lights[i];
+            fill_light_data(light, light_buffer[gpu_light_counter++]);
+            light->m_is_property_dirty = false;
+        }
+    }
+}
 
-            LightData& light_data = light_buffer[gpu_light_counter++];
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-            light_data.light_data0 = glm::vec4(float(LIGHT_DIRECTIONAL), light->color());
-            light_data.light_data1 = glm::vec4(light->forward(), light->intensity());
-            light_data.light_data2 = glm::vec4(0.0f, 0.0f, 0.0f, light->radius());
-        }
+bool Scene::update_gpu_properties(RenderState& render_state)
+{
+    // Slots shared by identical materials can not be patched for one of them alone, and emissive changes alter the area lights.
+    for (auto slot_idx : m_dirty_material_slots)
+    {
+        const MaterialSlot& slot = m_material_slots[slot_idx];
 
-        for (int i = 0; i < render_state.m_point_lights.size(); i++)
+        if (m_material_slot_users[slot.index] > 1 || slot.material->is_emissive() != slot.is_emissive)
+            return false;
+    }
+
+    // A new material override needs a material slot, which is only allocated by a full update. Meshes with an override BLAS need
+    // their TLAS instance rewritten as well.
+    for (auto mesh_node : render_state.m_meshes)
+    {
+        if (mesh_node->m_is_property_dirty && mesh_node->material_override() && !m_global_material_indices.contains(mesh_node->material_override()->id()))
+            return false;
+
+        if (mesh_node->m_is_property_dirty && mesh_node->mesh()->has_override_acceleration_structure())
+            return false;
+    }
+
+    for (auto slot_idx : m_dirty_material_slots)
+    {
+        const MaterialSlot& slot = m_material_slots[slot_idx];
+
+        MaterialData material_data;
+        fill_material_data(slot.material.get(), material_data);
+
+        m_material_data_buffer->upload_data(&material_data, sizeof(MaterialData), sizeof(MaterialData) * slot.index);
+    }
+
+    m_dirty_material_slots.clear();
+
+    for (uint32_t mesh_node_idx = 0; mesh_node_idx < render_state.m_meshes.size(); mesh_node_idx++)
+    {
+        auto mesh_node = render_state.m_meshes[mesh_node_idx];
+
+        if (mesh_node->m_is_property_dirty)
         {
-            auto light = render_state.m_point_lights[i];
+            uint32_t material_override = mesh_node->material_override() ? m_global_material_indices[mesh_node->material_override()->id()] : INVALID_MATERIAL_INDEX;
 
-            LightData& light_data = light_buffer[gpu_light_counter++];
+            m_instance_data_buffer->upload_data(&material_override, sizeof(uint32_t), sizeof(InstanceData) * mesh_node_idx + offsetof(InstanceData, material_override));
 
-            light_data.light_data0 = glm::vec4(float(LIGHT_POINT), light->color());
-            light_data.light_data1 = glm::vec4(0.0f, 0.0f, 0.0f, light->intensity());
-            light_data.light_data2 = glm::vec4(light->global_position(), light->radius());
-            light_data.light_data3 = glm::vec4(0.0f);
+            mesh_node->m_is_property_dirty = false;
         }
+    }
+
+    // Punctual lights follow the area lights and the environment light in the same order as a full update writes them.
+    uint32_t light_idx = m_num_area_lights;
+
+    if ((render_state.ibl_environment_map() && render_state.ibl_environment_map()->image()) || render_state.m_directional_lights.size() > 0)
+    {
+        // Its light group follows the IBL or the first directional light, so it is cheaper to always rewrite it.
+        LightData light_data;
+        fill_environment_light_data(render_state, light_data);
+
+        m_light_data_buffer->upload_data(&light_data, sizeof(LightData), sizeof(LightData) * light_idx++);
+    }
+
+    if (render_state.m_ibl_environment_map)
+        render_state.m_ibl_environment_map->m_is_property_dirty = false;
 
-        for (int i = 0; i < render_state.m_spot_lights.size(); i++)
+    auto patch_light = [&](auto light) {
+        if (light->m_is_property_dirty)
         {
-            auto light = render_state.m_spot_lights[i];
+            LightData light_data;
+            fill_light_data(light, light_data);
 
-            LightData& light_data = light_buffer[gpu_light_counter++];
+            m_light_data_buffer->upload_data(&light_data, sizeof(LightData), sizeof(LightData) * light_idx);
 
-            light_data.light_data0 = glm::vec4(float(LIGHT_SPOT), light->color());
-            light_data.light_data1 = glm::vec4(light->forward(), light->intensity());
-            light_data.light_data2 = glm::vec4(light->global_position(), light->radius());
-            light_data.light_data3 = glm::vec4(cosf(glm::radians(light->inner_cone_angle())), cosf(glm::radians(light->outer_cone_angle())), 0.0f, 0.0f);
+            light->m_is_property_dirty = false;
         }
-    }
+
+        light_idx++;
+    };
+
+    for (auto light : render_state.m_directional_lights)
+        patch_light(light);
+
+    for (auto light : render_state.m_point_lights)
+        patch_light(light);
+
+    for (auto light : render_state.m_spot_lights)
+        patch_light(light);
+
+    return true;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 void Scene::update_static_descriptors()
 {
+    // The buffers are created one after another while the scene is constructed.
+    if (!m_material_data_buffer || !m_light_data_buffer || !m_instance_data_buffer)
+        return;
+
     auto backend = m_backend.lock();
 
     VkDescriptorBufferInfo material_buffer_info;
@@ -1381,6 +1826,66 @@ void Scene::update_static_descriptors()
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void Scene::ensure_instance_capacity(uint32_t num_instances)
+{
+    if (num_instances <= m_instance_capacity)
+        return;
+
+    auto backend = m_backend.lock();
+
+    // Grow geometrically so that instances added over several frames do not reallocate the TLAS every time.
+    uint32_t capacity = std::max(num_instances, std::max(m_instance_capacity * 2, uint32_t(SCENE_INITIAL_INSTANCE_CAPACITY)));
+    capacity          = std::min(capacity, uint32_t(MAX_SCENE_INSTANCE_COUNT));
+
+    backend->queue_object_deletion(m_tlas.instance_buffer_device);
+    backend->queue_object_deletion(m_tlas.instance_buffer_host);
+    backend->queue_object_deletion(m_tlas.tlas);
+    backend->queue_object_deletion(m_tlas.scratch_buffer);
+    backend->queue_object_deletion(m_instance_data_buffer);
+
+    // Allocate device instance buffer
+    m_tlas.instance_buffer_device = vk::Buffer::create(backend, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, sizeof(VkAccelerationStructureInstanceKHR) * capacity, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+
+    VkDeviceOrHostAddressConstKHR instance_device_address {};
+    instance_device_address.deviceAddress = m_tlas.instance_buffer_device->device_address();
+
+    // Allocate host instance buffer
+    m_tlas.instance_buffer_host = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, sizeof(VkAccelerationStructureInstanceKHR) * capacity, VMA_MEMORY_USAGE_CPU_ONLY, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+    // Create TLAS
+    VkAccelerationStructureGeometryKHR tlas_geometry;
+    HELIOS_ZERO_MEMORY(tlas_geometry);
+
+    tlas_geometry.sType                              = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    tlas_geometry.geometryType                       = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+    tlas_geometry.geometry.instances.sType           = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+    tlas_geometry.geometry.instances.arrayOfPointers = VK_FALSE;
+    tlas_geometry.geometry.instances.data            = instance_device_address;
+
+    vk::AccelerationStructure::Desc desc;
+
+    desc.set_geometry_count(1);
+    desc.set_geometries({ tlas_geometry });
+    desc.set_max_primitive_counts({ capacity });
+    desc.set_type(VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR);
+    desc.set_flags(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR);
+
+    m_tlas.tlas     = vk::AccelerationStructure::create(backend, desc);
+    m_tlas.is_built = false;
+
+    // Allocate scratch buffer
+    m_tlas.scratch_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, m_tlas.tlas->build_sizes().buildScratchSize, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+
+    // Create instance data buffer
+    m_instance_data_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(InstanceData) * capacity, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+    m_instance_capacity = capacity;
+
+    update_static_descriptors();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 void Scene::set_root_node(Node::Ptr node)
 {
     if (m_root)
@@ -1417,4 +1922,96 @@ CameraNode::Ptr Scene::find_camera()
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
-} // namespace helios
\ No newline at end of file
+
+static vk::Buffer::Ptr grow_host_buffer(vk::Backend::Ptr backend, vk::Buffer::Ptr buffer, size_t size)
+{
+    vk::Buffer::Ptr new_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, size, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+    // Keep the existing contents so that entries which are not rewritten this frame stay valid.
+    if (buffer)
+    {
+        memcpy(new_buffer->mapped_ptr(), buffer->mapped_ptr(), buffer->size());
+        backend->queue_object_deletion(buffer);
+    }
+
+    return new_buffer;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Scene::ensure_light_capacity(uint32_t num_lights)
+{
+    if (num_lights <= m_light_capacity)
+        return;
+
+    auto backend = m_backend.lock();
+
+    m_light_capacity    = std::max(num_lights, std::max(m_light_capacity * 2, uint32_t(SCENE_INITIAL_LIGHT_CAPACITY)));
+    m_light_data_buffer = grow_host_buffer(backend, m_light_data_buffer, sizeof(LightData) * m_light_capacity);
+
+    update_static_descriptors();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Scene::ensure_material_capacity(uint32_t num_materials)
+{
+    if (num_materials <= m_material_capacity)
+        return;
+
+    auto backend = m_backend.lock();
+
+    m_material_capacity    = std::max(num_materials, std::max(m_material_capacity * 2, uint32_t(SCENE_INITIAL_MATERIAL_CAPACITY)));
+    m_material_data_buffer = grow_host_buffer(backend, m_material_data_buffer, sizeof(MaterialData) * m_material_capacity);
+
+    update_static_descriptors();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Scene::ensure_descriptor_capacity(uint32_t num_meshes)
+{
+    auto backend = m_backend.lock();
+
+    const uint32_t max_meshes = backend->max_buffer_array_descriptor_count();
+
+    num_meshes = std::min(num_meshes, max_meshes);
+
+    if (num_meshes <= m_mesh_capacity)
+        return;
+
+    m_mesh_capacity = std::min(std::max(num_meshes, std::max(m_mesh_capacity * 2, uint32_t(SCENE_INITIAL_MESH_CAPACITY))), max_meshes);
+
+    // The sets have to be released before the pool they were allocated from.
+    backend->queue_object_deletion(m_vbo_descriptor_set);
+    backend->queue_object_deletion(m_ibo_descriptor_set);
+    backend->queue_object_deletion(m_material_indices_descriptor_set);
+    backend->queue_object_deletion(m_array_descriptor_pool);
+
+    vk::DescriptorPool::Desc dp_desc;
+
+    dp_desc.set_max_sets(3)
+        .set_create_flags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+        .add_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * m_mesh_capacity);
+
+    m_array_descriptor_pool = vk::DescriptorPool::create(backend, dp_desc);
+
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variable_ds_alloc_info;
+    HELIOS_ZERO_MEMORY(variable_ds_alloc_info);
+
+    variable_ds_alloc_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+    variable_ds_alloc_info.descriptorSetCount = 1;
+    variable_ds_alloc_info.pDescriptorCounts  = &m_mesh_capacity;
+
+    m_vbo_descriptor_set = vk::DescriptorSet::create(backend, backend->buffer_array_descriptor_set_layout(), m_array_descriptor_pool, &variable_ds_alloc_info);
+    m_vbo_descriptor_set->set_name("VBO Descriptor Set");
+
+    m_ibo_descriptor_set = vk::DescriptorSet::create(backend, backend->buffer_array_descriptor_set_layout(), m_array_descriptor_pool, &variable_ds_alloc_info);
+    m_ibo_descriptor_set->set_name("IBO Descriptor Set");
+
+    m_material_indices_descriptor_set = vk::DescriptorSet::create(backend, backend->buffer_array_descriptor_set_layout(), m_array_descriptor_pool, &variable_ds_alloc_info);
+    m_material_indices_descriptor_set->set_name("Material Indices Descriptor Set");
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace helios
@@ -1,10 +1,263 @@
 #include <resource/texture.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 
 namespace helios
 {
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-static uint32_t g_last_texture_id = 0;
+static uint32_t              g_last_texture_id = 0;
+static std::atomic<uint64_t> g_last_texture_cube_version(0);
+
+static const uint32_t kMaxAlphaCoverageSize = 512;
+// Triangles whose UVs span more repeats of the texture than this are only checked against the texture as a whole
+static const int32_t kMaxAlphaCoverageRepeats = 16;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint32_t next_power_of_two(uint32_t value)
+{
+    uint32_t result = 1;
+
+    while (result < value)
+        result *= 2;
+
+    return result;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static inline int32_t wrap(int32_t value, int32_t size)
+{
+    int32_t result = value % size;
+    return result < 0 ? result + size : result;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+AlphaCoverage::Ptr AlphaCoverage::create(uint32_t width, uint32_t height, const std::vector<uint8_t>& alpha)
+{
+    if (width == 0 || height == 0 || alpha.size() < size_t(width) * size_t(height))
+        return nullptr;
+
+    return std::shared_ptr<AlphaCoverage>(new AlphaCoverage(width, height, alpha));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+AlphaCoverage::Ptr AlphaCoverage::create_opaque()
+{
+    return std::shared_ptr<AlphaCoverage>(new AlphaCoverage());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+AlphaCoverage::AlphaCoverage(uint32_t width, uint32_t height, const std::vector<uint8_t>& alpha)
+{
+    // A margin of one step on either side of the cutoff absorbs rounding differences between the decoders and the texture units
+    const int32_t cutoff       = int32_t(std::ceil(kAlphaTestCutoff * 255.0f));
+    const int32_t opaque_min   = cutoff + 1;
+    const int32_t cut_out_max  = cutoff - 2;
+    const int32_t level_width  = std::min(next_power_of_two(width), kMaxAlphaCoverageSize);
+    const int32_t level_height = std::min(next_power_of_two(height), kMaxAlphaCoverageSize);
+
+    Level level;
+
+    level.width  = level_width;
+    level.height = level_height;
+    level.flags.resize(level_width * level_height);
+
+    for (int32_t y = 0; y < level_height; y++)
+    {
+        // Texels under the cell, grown by the one texel on either side that bilinear filtering blends in
+        const int32_t y0 = int32_t((int64_t(y) * height) / level_height) - 1;
+        const int32_t y1 = int32_t((int64_t(y + 1) * height + level_height - 1) / level_height) + 1;
+
+        for (int32_t x = 0; x < level_width; x++)
+        {
+            const int32_t x0 = int32_t((int64_t(x) * width) / level_width) - 1;
+            const int32_t x1 = int32_t((int64_t(x + 1) * width + level_width - 1) / level_width) + 1;
+
+            uint8_t flags = ALPHA_COVERAGE_OPAQUE | ALPHA_COVERAGE_CUT_OUT;
+
+            for (int32_t ty = y0; ty < y1 && flags != 0; ty++)
+            {
+                const uint8_t* row = &alpha[size_t(wrap(ty, height)) * width];
+
+                for (int32_t tx = x0; tx < x1 && flags != 0; tx++)
+                {
+                    const int32_t value = row[wrap(tx, width)];
+
+                    if (value < opaque_min)
+                        flags &= ~ALPHA_COVERAGE_OPAQUE;
+
+                    if (value > cut_out_max)
+                        flags &= ~ALPHA_COVERAGE_CUT_OUT;
+                }
+            }
+
+            level.flags[y * level_width + x] = flags;
+        }
+    }
+
+    m_levels.push_back(level);
+
+    while (m_levels.back().width > 1 || m_levels.back().height > 1)
+    {
+        const Level& child = m_levels.back();
+
+        Level parent;
+
+        parent.width  = std::max(child.width / 2, 1u);
+        parent.height = std::max(child.height / 2, 1u);
+        parent.flags.resize(parent.width * parent.height);
+
+        const uint32_t scale_x = child.width / parent.width;
+        const uint32_t scale_y = child.height / parent.height;
+
+        for (uint32_t y = 0; y < parent.height; y++)
+        {
+            for (uint32_t x = 0; x < parent.width; x++)
+            {
+                uint8_t flags = ALPHA_COVERAGE_OPAQUE | ALPHA_COVERAGE_CUT_OUT;
+
+                for (uint32_t cy = y * scale_y; cy < (y + 1) * scale_y; cy++)
+                {
+                    for (uint32_t cx = x * scale_x; cx < (x + 1) * scale_x; cx++)
+                        flags &= child.flags[cy * child.width + cx];
+                }
+
+                parent.flags[y * parent.width + x] = flags;
+            }
+        }
+
+        m_levels.push_back(parent);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+AlphaCoverage::AlphaCoverage()
+{
+    Level level;
+
+    level.width  = 1;
+    level.height = 1;
+    level.flags.push_back(ALPHA_COVERAGE_OPAQUE);
+
+    m_levels.push_back(level);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+AlphaCoverage::~AlphaCoverage()
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint8_t AlphaCoverage::classify(const glm::vec2& uv0, const glm::vec2& uv1, const glm::vec2& uv2)
+{
+    if (!std::isfinite(uv0.x + uv0.y + uv1.x + uv1.y + uv2.x + uv2.y))
+        return 0;
+
+    // Moving the triangle by whole repeats of the texture does not change what it samples, so it is moved into the first one
+    const glm::vec2 offset = glm::floor(glm::min(glm::min(uv0, uv1), uv2));
+    const glm::vec2 p[3]   = { uv0 - offset, uv1 - offset, uv2 - offset };
+
+    Triangle triangle;
+
+    triangle.min_extents = glm::min(glm::min(p[0], p[1]), p[2]);
+    triangle.max_extents = glm::max(glm::max(p[0], p[1]), p[2]);
+
+    const Level& top = m_levels.back();
+
+    if (triangle.max_extents.x >= float(kMaxAlphaCoverageRepeats) || triangle.max_extents.y >= float(kMaxAlphaCoverageRepeats))
+        return top.flags[0];
+
+    const glm::vec2 e0   = p[1] - p[0];
+    const glm::vec2 e1   = p[2] - p[0];
+    const float     area = e0.x * e1.y - e0.y * e1.x;
+
+    // Triangles without area in UV space are only tested against their bounds
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        const glm::vec2& a = p[i];
+        const glm::vec2& b = p[(i + 1) % 3];
+
+        if (area == 0.0f)
+            triangle.edges[i] = glm::vec3(0.0f);
+        else
+        {
+            const float sign = area > 0.0f ? 1.0f : -1.0f;
+            const float nx   = -(b.y - a.y) * sign;
+            const float ny   = (b.x - a.x) * sign;
+
+            triangle.edges[i] = glm::vec3(nx, ny, -(nx * a.x + ny * a.y));
+        }
+    }
+
+    const uint32_t top_level = m_levels.size() - 1;
+    const int32_t  x0        = int32_t(std::floor(triangle.min_extents.x * top.width));
+    const int32_t  y0        = int32_t(std::floor(triangle.min_extents.y * top.height));
+    const int32_t  x1        = int32_t(std::floor(triangle.max_extents.x * top.width));
+    const int32_t  y1        = int32_t(std::floor(triangle.max_extents.y * top.height));
+
+    uint8_t flags = ALPHA_COVERAGE_OPAQUE | ALPHA_COVERAGE_CUT_OUT;
+
+    for (int32_t y = y0; y <= y1 && flags != 0; y++)
+    {
+        for (int32_t x = x0; x <= x1 && flags != 0; x++)
+            flags &= classify_cell(top_level, x, y, triangle);
+    }
+
+    return flags;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint8_t AlphaCoverage::classify_cell(uint32_t level, int32_t x, int32_t y, const Triangle& triangle)
+{
+    const Level&    cell_level = m_levels[level];
+    const glm::vec2 cell_min   = glm::vec2(float(x) / float(cell_level.width), float(y) / float(cell_level.height));
+    const glm::vec2 cell_max   = glm::vec2(float(x + 1) / float(cell_level.width), float(y + 1) / float(cell_level.height));
+
+    // Cells outside of the triangle do not constrain it
+    if (cell_max.x < triangle.min_extents.x || cell_max.y < triangle.min_extents.y || cell_min.x > triangle.max_extents.x || cell_min.y > triangle.max_extents.y)
+        return ALPHA_COVERAGE_OPAQUE | ALPHA_COVERAGE_CUT_OUT;
+
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        const glm::vec3& edge = triangle.edges[i];
+
+        // Largest value of the edge function over the cell, with some slack for rounding
+        const float value = edge.x * (edge.x > 0.0f ? cell_max.x : cell_min.x) + edge.y * (edge.y > 0.0f ? cell_max.y : cell_min.y) + edge.z;
+
+        if (value < -1e-6f)
+            return ALPHA_COVERAGE_OPAQUE | ALPHA_COVERAGE_CUT_OUT;
+    }
+
+    const uint8_t flags = cell_level.flags[wrap(y, cell_level.height) * cell_level.width + wrap(x, cell_level.width)];
+
+    if (flags != 0 || level == 0)
+        return flags;
+
+    // The cell is mixed, so the triangle may still only cover the part of it that is not
+    const Level&  child   = m_levels[level - 1];
+    const int32_t scale_x = child.width / cell_level.width;
+    const int32_t scale_y = child.height / cell_level.height;
+
+    uint8_t result = ALPHA_COVERAGE_OPAQUE | ALPHA_COVERAGE_CUT_OUT;
+
+    for (int32_t cy = y * scale_y; cy < (y + 1) * scale_y && result != 0; cy++)
+    {
+        for (int32_t cx = x * scale_x; cx < (x + 1) * scale_x && result != 0; cx++)
+            result &= classify_cell(level - 1, cx, cy, triangle);
+    }
+
+    return result;
+}
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
@@ -31,12 +284,15 @@ Texture2D::Ptr Texture2D::create(vk::Backend::Ptr backend, vk::Image::Ptr image,
 Texture2D::Texture2D(vk::Backend::Ptr backend, vk::Image::Ptr image, vk::ImageView::Ptr image_view, const std::string& path) :
     Texture(backend, image, image_view, path)
 {
+    m_bindless_index = backend->register_bindless_texture(image_view);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 Texture2D::~Texture2D()
 {
+    if (!m_vk_backend.expired())
+        m_vk_backend.lock()->release_bindless_texture(m_bindless_index);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -59,5 +315,29 @@ TextureCube::~TextureCube()
 {
 }
 
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t TextureCube::latest_version()
+{
+    return g_last_texture_cube_version;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void TextureCube::replace_image(TextureCube::Ptr other)
+{
+    auto backend = m_vk_backend.lock();
+
+    if (backend)
+    {
+        backend->queue_object_deletion(m_image_view);
+        backend->queue_object_deletion(m_image);
+    }
+
+    m_image      = other->m_image;
+    m_image_view = other->m_image_view;
+    m_version    = ++g_last_texture_cube_version;
+}
+
 // -----------------------------------------------------------------------------------------------------------------------------------
 } // namespace helios
\ No newline at end of file
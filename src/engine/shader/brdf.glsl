@@ -133,14 +133,12 @@ float pdf_uber(in SurfaceProperties p, in vec3 Wo, in vec3 Wh, in vec3 Wi)
     return mix(pd, ps, 0.5);
 }
 
-vec3 sample_uber(in SurfaceProperties p, in vec3 Wo, in RNG rng, out vec3 Wi, out float pdf)
+vec3 sample_uber(in SurfaceProperties p, in vec3 Wo, in vec3 rand_value, out vec3 Wi, out float pdf)
 {
     float alpha = p.roughness * p.roughness;
 
     vec3 Wh;
 
-    vec3 rand_value = next_vec3(rng);
-
     bool is_specular = false;
 
     if (rand_value.x < 0.5)
@@ -2,6 +2,7 @@
 #define COMMON_GLSL
 
 #include "random.glsl"
+#include "ray_statistics.glsl"
 
 #define PATH_TRACE_CLOSEST_HIT_SHADER_IDX 0
 #define PATH_TRACE_MISS_SHADER_IDX 0
@@ -15,20 +16,45 @@
 #define LIGHT_ENVIRONMENT_MAP 3
 #define LIGHT_AREA 4
 
+#define INVALID_MATERIAL_INDEX 0xFFFFFFFFu
+
 #define M_PI 3.14159265359
 #define EPSILON 0.0001f
 #define INFINITY 100000.0f
 #define MIN_ROUGHNESS 0.1f
 #define RADIANCE_CLAMP_COLOR vec3(1.0f)
 
-#define MAX_RAY_BOUNCES 5
+// Keep in sync with MAX_LIGHT_GROUPS in scene.h
+#define MAX_LIGHT_GROUPS 4
+
+// Radiance is carried separately for each light group so that the groups can be rescaled after rendering. Without LIGHT_GROUPS
+// everything goes into a single group.
+#if defined(LIGHT_GROUPS)
+#define NUM_RADIANCE_GROUPS MAX_LIGHT_GROUPS
+#else
+#define NUM_RADIANCE_GROUPS 1
+#endif
+
+// Keep in sync with view_set.h
+#define MAX_VIEWS_PER_LAUNCH 256
+
+#define VIEW_PROJECTION_PERSPECTIVE 0
+#define VIEW_PROJECTION_EQUIRECTANGULAR 1
+#define VIEW_PROJECTION_CUBEMAP_FACE 2
+
+// Keep in sync with probe_bake.h
+#define PROBE_BAKE_LANES 16
+#define PROBE_BAKE_MAX_SH_COEFFICIENTS 9
+
+// Specialization constant, set from PathIntegrator::max_ray_bounces().
+layout (constant_id = 0) const uint MAX_RAY_BOUNCES = 5;
 
 struct PathTracePayload
 {
-    vec3 L;
+    vec3 L[NUM_RADIANCE_GROUPS];
     vec3 T;
     uint depth;
-    RNG rng;
+    Sampler sampler_state;
 #if defined(RAY_DEBUG_VIEW)
     vec3 debug_color;
 #endif
@@ -75,12 +101,13 @@ struct SurfaceProperties
     float roughness;   
     float alpha;
     float alpha2; 
+    uint light_group;
 };
 
 struct Material
 {
     ivec4 texture_indices0; // x: albedo, y: normals, z: roughness, w: metallic
-    ivec4 texture_indices1; // x: emissive, z: roughness_channel, w: metallic_channel
+    ivec4 texture_indices1; // x: emissive, y: light group, z: roughness_channel, w: metallic_channel
     vec4  albedo;
     vec4  emissive;
     vec4  roughness_metallic;
@@ -91,7 +118,7 @@ struct Light
     vec4 light_data0; // x: light type, yzw: color    | x: light_type, y: mesh_id, z: material_id, w: primitive_offset
     vec4 light_data1; // xyz: direction, w: intensity | x: primitive_count
     vec4 light_data2; // xyz: position, w: area
-    vec4 light_data3; // x: range, y: cone angle  
+    vec4 light_data3; // x: range, y: cone angle, w: light group
 };
 
 struct HitInfo
@@ -101,11 +128,25 @@ struct HitInfo
     uint primitive_id;
 };
 
+// Keep in sync with ViewData in view_set.cpp
+struct View
+{
+    mat4 view_proj_inverse;
+    vec4 camera_pos;
+    vec4 up_direction;
+    vec4 right_direction;
+    vec4 focal_plane;
+    uvec4 projection; // x: projection type, y: cubemap face
+    vec4 lens; // x: aperture radius
+};
+
+// Keep in sync with InstanceData in scene.cpp
 struct Instance
 {
-    mat4 model_matrix;
-    mat4 normal_matrix;
+    vec4 transform[3]; // Rows of the object-to-world matrix
     uint mesh_idx;
+    uint material_override; // INVALID_MATERIAL_INDEX if the submesh materials are used
+    uint padding[2];
 };
 
 
@@ -113,6 +154,32 @@ struct Instance
 // Functions --------------------------------------------------------------
 // ------------------------------------------------------------------------
 
+mat4 instance_model_matrix(in Instance instance)
+{
+    return transpose(mat4(instance.transform[0], instance.transform[1], instance.transform[2], vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+// ------------------------------------------------------------------------
+
+// Only the model matrix is stored per instance. The cofactor matrix is the inverse transpose scaled by the determinant, which is all
+// that is needed to transform normals that are normalized afterwards, and it also handles non-uniform scale.
+mat3 instance_normal_matrix(in Instance instance)
+{
+    mat3 m = mat3(instance_model_matrix(instance));
+    mat3 cofactor = mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+
+    return dot(m[0], cofactor[0]) < 0.0 ? -cofactor : cofactor;
+}
+
+// ------------------------------------------------------------------------
+
+uint instance_material_index(in Instance instance, uint submesh_material_idx)
+{
+    return instance.material_override != INVALID_MATERIAL_INDEX ? instance.material_override : submesh_material_idx;
+}
+
+// ------------------------------------------------------------------------
+
 bool is_nan(vec3 c)
 {
     return isnan(c.x) || isnan(c.y) || isnan(c.z);
@@ -226,4 +293,26 @@ uint area_light_primitive_count(in Light light)
 
 // ------------------------------------------------------------------------
 
+// Area lights take their group from the emissive material instead.
+uint light_group(in Light light)
+{
+    return uint(light.light_data3.w);
+}
+
+// ------------------------------------------------------------------------
+
+uint material_light_group(in Material material)
+{
+    return uint(max(material.texture_indices1.y, 0));
+}
+
+// ------------------------------------------------------------------------
+
+uint radiance_group(uint light_group)
+{
+    return min(light_group, NUM_RADIANCE_GROUPS - 1);
+}
+
+// ------------------------------------------------------------------------
+
 #endif
\ No newline at end of file
@@ -19,6 +19,7 @@ layout (location = 0) in vec2 FS_IN_TexCoord;
 layout (location = 1) in vec3 FS_IN_Normal;
 layout (location = 2) in vec3 FS_IN_Tangent;
 layout (location = 3) in vec3 FS_IN_Bitangent;
+layout (location = 4) flat in uint FS_IN_InstanceID;
 
 // ------------------------------------------------------------------------
 // Outputs ----------------------------------------------------------------
@@ -141,8 +142,8 @@ vec3 fetch_emissive(in Material material, in vec2 texcoord)
 
 void main()
 {
-    const Instance instance = Instances.data[u_PushConstants.instance_id];
-    const uint material_id = SubmeshInfo[u_PushConstants.instance_id].data[u_PushConstants.submesh_id].y;
+    const Instance instance = Instances.data[FS_IN_InstanceID];
+    const uint material_id = instance_material_index(instance, SubmeshInfo[nonuniformEXT(instance.mesh_idx)].data[u_PushConstants.submesh_id].y);
     const Material material = Materials.data[material_id];
 
     vec4 color = vec4(0.0f, 0.0f, 0.0f, 1.0f);
@@ -23,6 +23,7 @@ layout (location = 0) out vec2 FS_IN_TexCoord;
 layout (location = 1) out vec3 FS_IN_Normal;
 layout (location = 2) out vec3 FS_IN_Tangent;
 layout (location = 3) out vec3 FS_IN_Bitangent;
+layout (location = 4) flat out uint FS_IN_InstanceID;
 
 // ------------------------------------------------------------------------
 // Set 0 ------------------------------------------------------------------
@@ -51,17 +52,21 @@ layout(push_constant) uniform PushConstants
 
 void main()
 {
-    const Instance instance = Instances.data[u_PushConstants.instance_id];
+    // Instancers are drawn with a single instanced draw call per submesh.
+    const uint instance_id = u_PushConstants.instance_id + gl_InstanceIndex;
+    const Instance instance = Instances.data[instance_id];
 
     FS_IN_TexCoord = VS_IN_TexCoord.xy;
+    FS_IN_InstanceID = instance_id;
 
-    mat3 normal_mat = mat3(instance.normal_matrix);
+    mat4 model_mat = instance_model_matrix(instance);
+    mat3 normal_mat = instance_normal_matrix(instance);
 
     FS_IN_Normal = normalize(normal_mat * VS_IN_Normal.xyz);
-    FS_IN_Tangent = normalize(normal_mat * VS_IN_Tangent.xyz);
-    FS_IN_Bitangent = normalize(normal_mat * VS_IN_Bitangent.xyz);
+    FS_IN_Tangent = normalize(mat3(model_mat) * VS_IN_Tangent.xyz);
+    FS_IN_Bitangent = normalize(mat3(model_mat) * VS_IN_Bitangent.xyz);
 
-    gl_Position = u_PushConstants.view_proj * instance.model_matrix * vec4(VS_IN_Position.xyz, 1.0f);
+    gl_Position = u_PushConstants.view_proj * model_mat * vec4(VS_IN_Position.xyz, 1.0f);
 }
 
 // ------------------------------------------------------------------------
\ No newline at end of file
@@ -42,8 +42,8 @@ layout(push_constant) uniform PushConstants
 
 void main()
 {
-    const Instance instance = Instances.data[u_PushConstants.instance_id];
-    gl_Position = u_PushConstants.view_proj * instance.model_matrix * vec4(VS_IN_Position.xyz, 1.0f);
+    const Instance instance = Instances.data[u_PushConstants.instance_id + gl_InstanceIndex];
+    gl_Position = u_PushConstants.view_proj * instance_model_matrix(instance) * vec4(VS_IN_Position.xyz, 1.0f);
 }
 
 // ------------------------------------------------------------------------
\ No newline at end of file
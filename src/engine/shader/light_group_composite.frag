@@ -0,0 +1,25 @@
+#version 450
+
+#define MAX_LIGHT_GROUPS 4 // Keep in sync with common.glsl
+
+layout(set = 0, binding = 0) uniform sampler2DArray samplerLightGroups;
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 outFragColor;
+
+layout(push_constant) uniform PushConstants
+{
+    vec4 weights[MAX_LIGHT_GROUPS];
+} u_PushConstants;
+
+void main()
+{
+    vec3 color = vec3(0.0);
+
+    // The groups are fetched per pixel so that the result lines up exactly with the accumulation buffer
+    for (int i = 0; i < MAX_LIGHT_GROUPS; i++)
+        color += u_PushConstants.weights[i].rgb * texelFetch(samplerLightGroups, ivec3(gl_FragCoord.xy, i), 0).rgb;
+
+    outFragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,247 @@
+#include "common.glsl"
+#include "brdf.glsl"
+
+// ------------------------------------------------------------------------
+// Set 0 ------------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+layout (set = 0, binding = 0, std430) readonly buffer MaterialBuffer
+{
+    Material data[];
+} Materials;
+
+layout (set = 0, binding = 1, std430) readonly buffer InstanceBuffer
+{
+    Instance data[];
+} Instances;
+
+layout (set = 0, binding = 2, std430) readonly buffer LightBuffer
+{
+    Light data[];
+} Lights;
+
+layout (set = 0, binding = 3) uniform accelerationStructureEXT u_TopLevelAS;
+
+layout (set = 0, binding = 4) uniform samplerCube s_EnvironmentMap;
+
+// ------------------------------------------------------------------------
+// Set 1 ------------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+layout (set = 1, binding = 0, std430) readonly buffer VertexBuffer
+{
+    Vertex data[];
+} Vertices[];
+
+// ------------------------------------------------------------------------
+// Set 2 ------------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+layout (set = 2, binding = 0) readonly buffer IndexBuffer
+{
+    uint data[];
+} Indices[];
+
+// ------------------------------------------------------------------------
+// Set 11 -----------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+// Keep in sync with LightmapBufferHeader in lightmap_bake.cpp
+layout (set = 11, binding = 0, std430) readonly buffer LightmapBuffer
+{
+    uvec4 counts; // x: width, y: height, z: samples per launch, w: minimum samples per texel
+    vec4 params; // x: convergence threshold
+    vec4 texels[]; // World space position (w is zero for texels that are not covered) and normal of every texel
+} Lightmap;
+
+// Keep in sync with LightmapTexelData in lightmap_bake.cpp
+struct LightmapTexel
+{
+    vec4 mean; // xyz: mean irradiance, w: sample count
+    vec4 moments; // x: mean luminance, y: sum of squared differences from the mean luminance, z: converged flag
+};
+
+layout (set = 11, binding = 1, std430) buffer TexelBuffer
+{
+    LightmapTexel data[];
+} Texels;
+
+layout (set = 11, binding = 2, std430) buffer LightmapStateBuffer
+{
+    uint num_converged;
+} LightmapState;
+
+// ------------------------------------------------------------------------
+// Push Constants ---------------------------------------------------------
+// ------------------------------------------------------------------------
+
+layout(push_constant) uniform PathTraceConsts
+{
+    mat4 view_proj_inverse;
+    vec4 camera_pos;
+    vec4 up_direction;
+    vec4 right_direction;
+    vec4 focal_plane;
+    ivec4 ray_debug_pixel_coord;
+    uvec4 launch_id_size;
+    float accumulation;
+    uint num_lights;
+    uint num_frames;
+    uint debug_vis;
+    float shadow_ray_bias;
+    float focal_length;
+    float aperture_radius;
+    uint sample_offset;
+    uint environment_light_group;
+    uint light_group_samples;
+} u_PathTraceConsts;
+
+// ------------------------------------------------------------------------
+// Output Payload ---------------------------------------------------------
+// ------------------------------------------------------------------------
+
+layout(location = 0) rayPayloadEXT PathTracePayload p_PathTracePayload;
+
+layout(location = 2) rayPayloadEXT bool p_Visibility;
+
+// ------------------------------------------------------------------------
+// Functions --------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+#include "path_trace_lighting.glsl"
+
+// ------------------------------------------------------------------------
+
+float luminance(in vec3 c)
+{
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// ------------------------------------------------------------------------
+
+// Irradiance arriving at the texel along a single path: next event estimation at the texel itself, plus one cosine distributed
+// indirect ray whose hit shaders carry on with the regular path tracer.
+vec3 sample_irradiance(in SurfaceProperties p)
+{
+    vec3 E = vec3(0.0);
+
+    if (u_PathTraceConsts.num_lights > 0)
+    {
+        uint light_idx = sample_uint(sample_1d(p_PathTracePayload.sampler_state, bounce_dimension(0, SAMPLE_DIM_LIGHT_SELECTION)), u_PathTraceConsts.num_lights);
+
+        vec3 Wi = vec3(0.0f);
+        float pdf = 0.0f;
+
+        vec3 Li = sample_light(p, Lights.data[light_idx], Wi, pdf);
+
+        float cos_theta = clamp(dot(p.normal, Wi), 0.0, 1.0);
+
+        if (!is_black(Li))
+        {
+            if (pdf == 0.0f)
+                E += Li * cos_theta * float(u_PathTraceConsts.num_lights);
+            else
+                E += (Li * cos_theta / pdf) * float(u_PathTraceConsts.num_lights);
+        }
+    }
+
+    const vec3 Wi = sample_cosine_lobe(p.normal, sample_2d(p_PathTracePayload.sampler_state, bounce_dimension(0, SAMPLE_DIM_BSDF_DIRECTION)));
+
+    for (uint i = 0; i < NUM_RADIANCE_GROUPS; i++)
+        p_PathTracePayload.L[i] = vec3(0.0f);
+
+    // The texel is the first vertex of the path, so the hit shaders skip the emission of the surface they hit like they do after
+    // any other bounce. Direct light reaching the texel was already sampled above.
+    p_PathTracePayload.T = vec3(1.0);
+    p_PathTracePayload.depth = 1;
+
+    INCREMENT_RAY_COUNTER(RAY_COUNTER_INDIRECT);
+
+    traceRayEXT(u_TopLevelAS,
+                gl_RayFlagsOpaqueEXT,
+                0xFF,
+                PATH_TRACE_CLOSEST_HIT_SHADER_IDX,
+                0,
+                PATH_TRACE_MISS_SHADER_IDX,
+                p.vertex.position.xyz,
+                0.0001,
+                Wi,
+                10000.0,
+                0);
+
+    // Cosine weighted directions cancel the cosine term and leave PI from the pdf
+    for (uint i = 0; i < NUM_RADIANCE_GROUPS; i++)
+        E += M_PI * p_PathTracePayload.L[i];
+
+    return E;
+}
+
+// ------------------------------------------------------------------------
+// Main -------------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+void main()
+{
+    const uvec2 texel_coord = gl_LaunchIDEXT.xy;
+
+    if (texel_coord.x >= Lightmap.counts.x || texel_coord.y >= Lightmap.counts.y)
+        return;
+
+    const uint texel_idx = texel_coord.y * Lightmap.counts.x + texel_coord.x;
+    const vec4 position = Lightmap.texels[2 * texel_idx];
+
+    if (position.w == 0.0)
+        return;
+
+    LightmapTexel texel = Texels.data[texel_idx];
+
+    if (texel.moments.z != 0.0)
+        return;
+
+    SurfaceProperties p;
+
+    p.vertex.position = vec4(position.xyz, 1.0);
+    p.normal = Lightmap.texels[2 * texel_idx + 1].xyz;
+
+    const uint samples_per_launch = Lightmap.counts.z;
+
+    for (uint i = 0; i < samples_per_launch; i++)
+    {
+        p_PathTracePayload.depth = 0;
+        // Every texel is its own pixel of the sequence and continues it where the previous launch stopped
+        p_PathTracePayload.sampler_state = sampler_init(texel_coord, u_PathTraceConsts.num_frames * samples_per_launch + i);
+
+        const vec3 E = sample_irradiance(p);
+
+        // Unlike the image, the irradiance is not clamped since the bake is meant as a reference. Invalid samples are dropped.
+        if (is_nan(E) || any(isinf(E)))
+            continue;
+
+        // Welford's running mean and variance of the luminance
+        const float n = texel.mean.w + 1.0;
+        const float lum = luminance(E);
+        const float delta = lum - texel.moments.x;
+
+        texel.mean.rgb += (E - texel.mean.rgb) / n;
+        texel.mean.w = n;
+        texel.moments.x += delta / n;
+        texel.moments.y += delta * (lum - texel.moments.x);
+    }
+
+    const float n = texel.mean.w;
+
+    if (n >= float(Lightmap.counts.w) && n > 1.0)
+    {
+        const float standard_error = sqrt(texel.moments.y / ((n - 1.0) * n));
+
+        if (standard_error <= Lightmap.params.x * texel.moments.x)
+        {
+            texel.moments.z = 1.0;
+            atomicAdd(LightmapState.num_converged, 1);
+        }
+    }
+
+    Texels.data[texel_idx] = texel;
+}
+
+// ------------------------------------------------------------------------
@@ -0,0 +1,210 @@
+#ifndef PATH_TRACE_LIGHTING_GLSL
+#define PATH_TRACE_LIGHTING_GLSL
+
+// Next event estimation shared by every shader that shades a surface. The including shader declares sets 0 to 2, the
+// PathTraceConsts push constants, p_PathTracePayload and the visibility payload at location 2.
+
+#include "brdf.glsl"
+
+Vertex get_vertex(uint mesh_idx, uint vertex_idx)
+{
+    return Vertices[nonuniformEXT(mesh_idx)].data[vertex_idx];
+}
+
+// ------------------------------------------------------------------------
+
+Triangle fetch_triangle(in Instance instance, in HitInfo hit_info)
+{
+    Triangle tri;
+
+    uint primitive_id =  hit_info.primitive_id + hit_info.primitive_offset;
+
+    uvec3 idx = uvec3(Indices[nonuniformEXT(instance.mesh_idx)].data[3 * primitive_id], 
+                      Indices[nonuniformEXT(instance.mesh_idx)].data[3 * primitive_id + 1],
+                      Indices[nonuniformEXT(instance.mesh_idx)].data[3 * primitive_id + 2]);
+
+    tri.v0 = get_vertex(instance.mesh_idx, idx.x);
+    tri.v1 = get_vertex(instance.mesh_idx, idx.y);
+    tri.v2 = get_vertex(instance.mesh_idx, idx.z);
+
+    return tri;
+}
+
+// ------------------------------------------------------------------------
+
+vec3 sample_light(in SurfaceProperties p, in Light light, out vec3 Wi, out float pdf)
+{
+    uint  ray_flags = gl_RayFlagsOpaqueEXT | gl_RayFlagsTerminateOnFirstHitEXT;
+
+    // Only use any-hit shaders at the first hit.
+    if (p_PathTracePayload.depth == 0)
+        ray_flags = 0;
+    
+    uint  cull_mask = 0xFF;
+    float tmin      = 0.0001;
+    float tmax      = 10000.0;
+    vec3 origin = p.vertex.position.xyz + p.normal * u_PathTraceConsts.shadow_ray_bias;
+
+    vec3 Li = vec3(0.0f);
+
+    uint type = light_type(light);
+
+    if (type == LIGHT_DIRECTIONAL)
+    {
+        vec2 rng = sample_2d(p_PathTracePayload.sampler_state, bounce_dimension(p_PathTracePayload.depth, SAMPLE_DIM_LIGHT_POSITION));
+
+        vec3 light_dir = -punctual_light_direction(light);
+        vec3 light_tangent = normalize(cross(light_dir, vec3(0.0f, 1.0f, 0.0f)));
+        vec3 light_bitangent = normalize(cross(light_tangent, light_dir));
+        float light_radius = punctual_light_radius(light);
+
+        // calculate disk point
+        float point_radius = light_radius * sqrt(rng.x);
+        float point_angle = rng.y * 2.0f * M_PI;
+        vec2 disk_point = vec2(point_radius * cos(point_angle), point_radius * sin(point_angle));
+
+        Wi = normalize(light_dir + disk_point.x * light_tangent + disk_point.y * light_bitangent);
+        Li = punctual_light_color(light) * punctual_light_intensity(light);
+        pdf = 0.0f;
+    }
+    else if (type == LIGHT_SPOT)
+    {
+        vec2 rng = sample_2d(p_PathTracePayload.sampler_state, bounce_dimension(p_PathTracePayload.depth, SAMPLE_DIM_LIGHT_POSITION));
+
+        vec3 to_light = punctual_light_position(light) - p.vertex.position.xyz;
+        vec3 light_dir = normalize(to_light);
+        float light_distance = length(to_light);
+        float light_radius = punctual_light_radius(light) / light_distance;
+
+        float angle_attenuation = dot(light_dir, -punctual_light_direction(light));
+        angle_attenuation = smoothstep(punctual_light_cos_theta_outer(light), punctual_light_cos_theta_inner(light), angle_attenuation);
+
+        vec3 light_tangent = normalize(cross(light_dir, vec3(0.0f, 1.0f, 0.0f)));
+        vec3 light_bitangent = normalize(cross(light_tangent, light_dir));
+
+        // calculate disk point
+        float point_radius = light_radius * sqrt(rng.x);
+        float point_angle = rng.y * 2.0f * M_PI;
+        vec2 disk_point = vec2(point_radius * cos(point_angle), point_radius * sin(point_angle));
+
+        Wi = normalize(light_dir + disk_point.x * light_tangent + disk_point.y * light_bitangent);
+        Li = punctual_light_color(light) * punctual_light_intensity(light) * angle_attenuation /  (light_distance * light_distance);
+        pdf = 0.0f;
+        tmax = light_distance;
+    }
+    else if (type == LIGHT_POINT)
+    {
+        vec2 rng = sample_2d(p_PathTracePayload.sampler_state, bounce_dimension(p_PathTracePayload.depth, SAMPLE_DIM_LIGHT_POSITION));
+
+        vec3 to_light = punctual_light_position(light) - p.vertex.position.xyz;
+        vec3 light_dir = normalize(to_light);
+        float light_distance = length(to_light);
+        float light_radius = punctual_light_radius(light) / light_distance;
+
+        vec3 light_tangent = normalize(cross(light_dir, vec3(0.0f, 1.0f, 0.0f)));
+        vec3 light_bitangent = normalize(cross(light_tangent, light_dir));
+
+        // calculate disk point
+        float point_radius = light_radius * sqrt(rng.x);
+        float point_angle = rng.y * 2.0f * M_PI;
+        vec2 disk_point = vec2(point_radius * cos(point_angle), point_radius * sin(point_angle));
+
+        Wi = normalize(light_dir + disk_point.x * light_tangent + disk_point.y * light_bitangent);
+        Li = punctual_light_color(light) * punctual_light_intensity(light)  / (light_distance * light_distance);    
+        pdf = 0.0f;
+        tmax = light_distance;
+    }
+    else if (type == LIGHT_ENVIRONMENT_MAP)
+    {
+        vec2 rand_value = sample_2d(p_PathTracePayload.sampler_state, bounce_dimension(p_PathTracePayload.depth, SAMPLE_DIM_LIGHT_POSITION));
+        Wi = sample_cosine_lobe(p.normal, rand_value);
+        Li = texture(s_EnvironmentMap, Wi).rgb;
+        pdf = pdf_cosine_lobe(dot(p.normal, Wi)); 
+    }
+    else if (type == LIGHT_AREA)
+    {
+        uint mesh_id = uint(light.light_data0.y);
+        uint num_triangles = uint(light.light_data1.z);
+        uint primitive_id = sample_uint(sample_1d(p_PathTracePayload.sampler_state, bounce_dimension(p_PathTracePayload.depth, SAMPLE_DIM_LIGHT_PRIMITIVE)), num_triangles);
+
+        HitInfo hit_info;
+
+        hit_info.mat_idx = uint(light.light_data0.z);
+        hit_info.primitive_offset = uint(light.light_data0.w);
+        hit_info.primitive_id = primitive_id;
+
+        const Instance instance = Instances.data[mesh_id];
+        const Material material = Materials.data[hit_info.mat_idx];
+        Triangle triangle = fetch_triangle(instance, hit_info);
+
+        vec2 b = uniform_sample_triangle(sample_2d(p_PathTracePayload.sampler_state, bounce_dimension(p_PathTracePayload.depth, SAMPLE_DIM_LIGHT_POSITION)));
+
+        const mat4 model_mat = instance_model_matrix(instance);
+
+        triangle.v0.position = model_mat * triangle.v0.position;
+        triangle.v1.position = model_mat * triangle.v1.position;
+        triangle.v2.position = model_mat * triangle.v2.position;
+
+        vec3 light_position = barycentric_interpolate(b, triangle.v0.position.xyz, triangle.v1.position.xyz, triangle.v2.position.xyz);
+        vec3 light_normal = normalize(instance_normal_matrix(instance) * barycentric_interpolate(b, triangle.v0.normal.xyz, triangle.v1.normal.xyz, triangle.v2.normal.xyz));
+        vec3 light_dir = p.vertex.position.xyz - light_position;
+        
+        float dist_sqr = dot(light_dir, light_dir);
+        float area = triangle_area(triangle);
+
+        // early out if triangle area or square of distance to triangle are zero
+        if (area == 0.0f || dist_sqr == 0.0f)
+        {
+            Li = vec3(0.0f);
+            pdf = 0.0f;                
+            return vec3(0.0f);
+        }
+
+        // normalize light_dir
+        float dist = sqrt(dist_sqr);
+        light_dir /= dist;
+
+        // shorten the ray distance to prevent the visibility ray from always being false
+        tmax = max(0.0f, dist - EPSILON);
+        
+        // light_normal
+        //     ^  ^
+        //     | / light_dir
+        //     |/
+        //  =======  <- triangle
+        float cos_theta = dot(light_normal, light_dir);
+
+        // early out if light_dir is perpendicular to the light_normal 
+        if (cos_theta == 0.0f)
+        {
+            Li = vec3(0.0f);
+            pdf = 0.0f;                
+            return vec3(0.0f);
+        }
+
+        Li = material.emissive.rgb;
+        Wi = -light_dir;
+        pdf = pdf_triangle(dist_sqr, cos_theta, area);
+    }
+
+    INCREMENT_RAY_COUNTER(RAY_COUNTER_SHADOW);
+
+    // Trace Ray
+    traceRayEXT(u_TopLevelAS, 
+                ray_flags, 
+                cull_mask, 
+                VISIBILITY_CLOSEST_HIT_SHADER_IDX, 
+                0, 
+                VISIBILITY_MISS_SHADER_IDX, 
+                origin, 
+                tmin, 
+                Wi, 
+                tmax, 
+                2);
+
+    return Li * float(p_Visibility);
+}
+
+// ------------------------------------------------------------------------
+
+#endif
\ No newline at end of file
@@ -102,10 +102,12 @@ layout(push_constant) uniform PathTraceConsts
     uint num_lights;
     uint num_frames;
     uint debug_vis;
-    uint max_ray_bounces;
     float shadow_ray_bias;
     float focal_length;
     float aperture_radius;
+    uint sample_offset;
+    uint environment_light_group;
+    uint light_group_samples;
 } u_PathTraceConsts;
 
 // ------------------------------------------------------------------------
@@ -125,13 +127,13 @@ Vertex get_vertex(uint mesh_idx, uint vertex_idx)
 
 // ------------------------------------------------------------------------
 
-HitInfo fetch_hit_info()
+HitInfo fetch_hit_info(in Instance instance)
 {
-    uvec2 primitive_offset_mat_idx = SubmeshInfo[nonuniformEXT(gl_InstanceCustomIndexEXT)].data[gl_GeometryIndexEXT];
+    uvec2 primitive_offset_mat_idx = SubmeshInfo[nonuniformEXT(instance.mesh_idx)].data[gl_GeometryIndexEXT];
 
     HitInfo hit_info;
 
-    hit_info.mat_idx = primitive_offset_mat_idx.y;
+    hit_info.mat_idx = instance_material_index(instance, primitive_offset_mat_idx.y);
     hit_info.primitive_offset = primitive_offset_mat_idx.x;
     hit_info.primitive_id = gl_PrimitiveID;
 
@@ -173,8 +175,10 @@ vec4 fetch_albedo(in Material material, in vec2 tex_coord)
 
 void main()
 {
+    INCREMENT_RAY_COUNTER(RAY_COUNTER_ANY_HIT);
+
     const Instance instance = Instances.data[gl_InstanceCustomIndexEXT];
-    const HitInfo hit_info = fetch_hit_info();
+    const HitInfo hit_info = fetch_hit_info(instance);
     const Triangle triangle = fetch_triangle(instance, hit_info);
     const Material material = Materials.data[hit_info.mat_idx];
 
@@ -183,6 +187,7 @@ void main()
 
     vec4 albedo = fetch_albedo(material, v.tex_coord.xy);
 
+    // Keep in sync with AlphaCoverage::kAlphaTestCutoff, triangles it classified when the mesh was imported never get here
     if (albedo.a < 0.1f)
         ignoreIntersectionEXT;
 }
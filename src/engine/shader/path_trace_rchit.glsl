@@ -103,10 +103,12 @@ layout(push_constant) uniform PathTraceConsts
     uint num_lights;
     uint num_frames;
     uint debug_vis;
-    uint max_ray_bounces;
     float shadow_ray_bias;
     float focal_length;
     float aperture_radius;
+    uint sample_offset;
+    uint environment_light_group;
+    uint light_group_samples;
 } u_PathTraceConsts;
 
 // ------------------------------------------------------------------------
@@ -133,20 +135,17 @@ hitAttributeEXT vec2 b_HitAttribs;
 // Functions --------------------------------------------------------------
 // ------------------------------------------------------------------------
 
-Vertex get_vertex(uint mesh_idx, uint vertex_idx)
-{
-    return Vertices[nonuniformEXT(mesh_idx)].data[vertex_idx];
-}
+#include "path_trace_lighting.glsl"
 
 // ------------------------------------------------------------------------
 
-HitInfo fetch_hit_info()
+HitInfo fetch_hit_info(in Instance instance)
 {
-    uvec2 primitive_offset_mat_idx = SubmeshInfo[nonuniformEXT(gl_InstanceCustomIndexEXT)].data[gl_GeometryIndexEXT];
+    uvec2 primitive_offset_mat_idx = SubmeshInfo[nonuniformEXT(instance.mesh_idx)].data[gl_GeometryIndexEXT];
 
     HitInfo hit_info;
 
-    hit_info.mat_idx = primitive_offset_mat_idx.y;
+    hit_info.mat_idx = instance_material_index(instance, primitive_offset_mat_idx.y);
     hit_info.primitive_offset = primitive_offset_mat_idx.x;
     hit_info.primitive_id = gl_PrimitiveID;
 
@@ -155,34 +154,15 @@ HitInfo fetch_hit_info()
 
 // ------------------------------------------------------------------------
 
-Triangle fetch_triangle(in Instance instance, in HitInfo hit_info)
-{
-    Triangle tri;
-
-    uint primitive_id =  hit_info.primitive_id + hit_info.primitive_offset;
-
-    uvec3 idx = uvec3(Indices[nonuniformEXT(instance.mesh_idx)].data[3 * primitive_id], 
-                      Indices[nonuniformEXT(instance.mesh_idx)].data[3 * primitive_id + 1],
-                      Indices[nonuniformEXT(instance.mesh_idx)].data[3 * primitive_id + 2]);
-
-    tri.v0 = get_vertex(instance.mesh_idx, idx.x);
-    tri.v1 = get_vertex(instance.mesh_idx, idx.y);
-    tri.v2 = get_vertex(instance.mesh_idx, idx.z);
-
-    return tri;
-}
-
-// ------------------------------------------------------------------------
-
 void transform_vertex(in Instance instance, inout Vertex v)
 {
-    mat4 model_mat = instance.model_matrix;
-    mat3 normal_mat = mat3(instance.normal_matrix);
+    mat4 model_mat = instance_model_matrix(instance);
+    mat3 normal_mat = instance_normal_matrix(instance);
 
     v.position = model_mat * v.position; 
-    v.normal.xyz = normal_mat * v.normal.xyz;
-    v.tangent.xyz = normal_mat * v.tangent.xyz;
-    v.bitangent.xyz = normal_mat * v.bitangent.xyz;
+    v.normal.xyz = normalize(normal_mat * v.normal.xyz);
+    v.tangent.xyz = normalize(mat3(model_mat) * v.tangent.xyz);
+    v.bitangent.xyz = normalize(mat3(model_mat) * v.bitangent.xyz);
 }
 
 // ------------------------------------------------------------------------
@@ -256,7 +236,7 @@ void fetch_emissive(in Material material, inout SurfaceProperties p)
 void populate_surface_properties(out SurfaceProperties p)
 {
     const Instance instance = Instances.data[gl_InstanceCustomIndexEXT];
-    const HitInfo hit_info = fetch_hit_info();
+    const HitInfo hit_info = fetch_hit_info(instance);
     const Triangle triangle = fetch_triangle(instance, hit_info);
     const Material material = Materials.data[hit_info.mat_idx];
 
@@ -272,6 +252,7 @@ void populate_surface_properties(out SurfaceProperties p)
     fetch_metallic(material, p);
     fetch_emissive(material, p);
 
+    p.light_group = material_light_group(material);
     p.roughness = max(p.roughness, MIN_ROUGHNESS);
 
     p.F0 = mix(vec3(0.03), p.albedo.xyz, p.metallic);
@@ -281,183 +262,13 @@ void populate_surface_properties(out SurfaceProperties p)
 
 // ------------------------------------------------------------------------
 
-vec3 sample_light(in SurfaceProperties p, in Light light, out vec3 Wi, out float pdf)
-{
-    uint  ray_flags = gl_RayFlagsOpaqueEXT | gl_RayFlagsTerminateOnFirstHitEXT;
-
-    // Only use any-hit shaders at the first hit.
-    if (p_PathTracePayload.depth == 0)
-        ray_flags = 0;
-    
-    uint  cull_mask = 0xFF;
-    float tmin      = 0.0001;
-    float tmax      = 10000.0;
-    vec3 origin = p.vertex.position.xyz + p.normal * u_PathTraceConsts.shadow_ray_bias;
-
-    vec3 Li = vec3(0.0f);
-
-    uint type = light_type(light);
-
-    if (type == LIGHT_DIRECTIONAL)
-    {
-        vec2 rng = next_vec2(p_PathTracePayload.rng);
-
-        vec3 light_dir = -punctual_light_direction(light);
-        vec3 light_tangent = normalize(cross(light_dir, vec3(0.0f, 1.0f, 0.0f)));
-        vec3 light_bitangent = normalize(cross(light_tangent, light_dir));
-        float light_radius = punctual_light_radius(light);
-
-        // calculate disk point
-        float point_radius = light_radius * sqrt(rng.x);
-        float point_angle = rng.y * 2.0f * M_PI;
-        vec2 disk_point = vec2(point_radius * cos(point_angle), point_radius * sin(point_angle));
-
-        Wi = normalize(light_dir + disk_point.x * light_tangent + disk_point.y * light_bitangent);
-        Li = punctual_light_color(light) * punctual_light_intensity(light);
-        pdf = 0.0f;
-    }
-    else if (type == LIGHT_SPOT)
-    {
-        vec2 rng = next_vec2(p_PathTracePayload.rng);
-
-        vec3 to_light = punctual_light_position(light) - p.vertex.position.xyz;
-        vec3 light_dir = normalize(to_light);
-        float light_distance = length(to_light);
-        float light_radius = punctual_light_radius(light) / light_distance;
-
-        float angle_attenuation = dot(light_dir, -punctual_light_direction(light));
-        angle_attenuation = smoothstep(punctual_light_cos_theta_outer(light), punctual_light_cos_theta_inner(light), angle_attenuation);
-
-        vec3 light_tangent = normalize(cross(light_dir, vec3(0.0f, 1.0f, 0.0f)));
-        vec3 light_bitangent = normalize(cross(light_tangent, light_dir));
-
-        // calculate disk point
-        float point_radius = light_radius * sqrt(rng.x);
-        float point_angle = rng.y * 2.0f * M_PI;
-        vec2 disk_point = vec2(point_radius * cos(point_angle), point_radius * sin(point_angle));
-
-        Wi = normalize(light_dir + disk_point.x * light_tangent + disk_point.y * light_bitangent);
-        Li = punctual_light_color(light) * punctual_light_intensity(light) * angle_attenuation /  (light_distance * light_distance);
-        pdf = 0.0f;
-        tmax = light_distance;
-    }
-    else if (type == LIGHT_POINT)
-    {
-        vec2 rng = next_vec2(p_PathTracePayload.rng);
-
-        vec3 to_light = punctual_light_position(light) - p.vertex.position.xyz;
-        vec3 light_dir = normalize(to_light);
-        float light_distance = length(to_light);
-        float light_radius = punctual_light_radius(light) / light_distance;
-
-        vec3 light_tangent = normalize(cross(light_dir, vec3(0.0f, 1.0f, 0.0f)));
-        vec3 light_bitangent = normalize(cross(light_tangent, light_dir));
-
-        // calculate disk point
-        float point_radius = light_radius * sqrt(rng.x);
-        float point_angle = rng.y * 2.0f * M_PI;
-        vec2 disk_point = vec2(point_radius * cos(point_angle), point_radius * sin(point_angle));
-
-        Wi = normalize(light_dir + disk_point.x * light_tangent + disk_point.y * light_bitangent);
-        Li = punctual_light_color(light) * punctual_light_intensity(light)  / (light_distance * light_distance);    
-        pdf = 0.0f;
-        tmax = light_distance;
-    }
-    else if (type == LIGHT_ENVIRONMENT_MAP)
-    {
-        vec2 rand_value = next_vec2(p_PathTracePayload.rng);
-        Wi = sample_cosine_lobe(p.normal, rand_value);
-        Li = texture(s_EnvironmentMap, Wi).rgb;
-        pdf = pdf_cosine_lobe(dot(p.normal, Wi)); 
-    }
-    else if (type == LIGHT_AREA)
-    {
-        uint mesh_id = uint(light.light_data0.y);
-        uint num_triangles = uint(light.light_data1.z);
-        uint primitive_id = next_uint(p_PathTracePayload.rng, num_triangles);
-
-        HitInfo hit_info;
-
-        hit_info.mat_idx = uint(light.light_data0.z);
-        hit_info.primitive_offset = uint(light.light_data0.w);
-        hit_info.primitive_id = primitive_id;
-
-        const Instance instance = Instances.data[mesh_id];
-        const Material material = Materials.data[hit_info.mat_idx];
-        Triangle triangle = fetch_triangle(instance, hit_info);
-
-        vec2 b = uniform_sample_triangle(next_vec2(p_PathTracePayload.rng));
-
-        triangle.v0.position = instance.model_matrix * triangle.v0.position;
-        triangle.v1.position = instance.model_matrix * triangle.v1.position;
-        triangle.v2.position = instance.model_matrix * triangle.v2.position;
-
-        vec3 light_position = barycentric_interpolate(b, triangle.v0.position.xyz, triangle.v1.position.xyz, triangle.v2.position.xyz);
-        vec3 light_normal = normalize(mat3(instance.normal_matrix) * barycentric_interpolate(b, triangle.v0.normal.xyz, triangle.v1.normal.xyz, triangle.v2.normal.xyz));
-        vec3 light_dir = p.vertex.position.xyz - light_position;
-        
-        float dist_sqr = dot(light_dir, light_dir);
-        float area = triangle_area(triangle);
-
-        // early out if triangle area or square of distance to triangle are zero
-        if (area == 0.0f || dist_sqr == 0.0f)
-        {
-            Li = vec3(0.0f);
-            pdf = 0.0f;                
-            return vec3(0.0f);
-        }
-
-        // normalize light_dir
-        float dist = sqrt(dist_sqr);
-        light_dir /= dist;
-
-        // shorten the ray distance to prevent the visibility ray from always being false
-        tmax = max(0.0f, dist - EPSILON);
-        
-        // light_normal
-        //     ^  ^
-        //     | / light_dir
-        //     |/
-        //  =======  <- triangle
-        float cos_theta = dot(light_normal, light_dir);
-
-        // early out if light_dir is perpendicular to the light_normal 
-        if (cos_theta == 0.0f)
-        {
-            Li = vec3(0.0f);
-            pdf = 0.0f;                
-            return vec3(0.0f);
-        }
-
-        Li = material.emissive.rgb;
-        Wi = -light_dir;
-        pdf = pdf_triangle(dist_sqr, cos_theta, area);
-    }
-
-    // Trace Ray
-    traceRayEXT(u_TopLevelAS, 
-                ray_flags, 
-                cull_mask, 
-                VISIBILITY_CLOSEST_HIT_SHADER_IDX, 
-                0, 
-                VISIBILITY_MISS_SHADER_IDX, 
-                origin, 
-                tmin, 
-                Wi, 
-                tmax, 
-                2);
-
-    return Li * float(p_Visibility);
-}
-
-// ------------------------------------------------------------------------
-
-vec3 direct_lighting(in SurfaceProperties p)
+void direct_lighting(in SurfaceProperties p)
 {
     vec3 L = vec3(0.0f);
 
-    uint light_idx = next_uint(p_PathTracePayload.rng, u_PathTraceConsts.num_lights);
+    uint light_idx = sample_uint(sample_1d(p_PathTracePayload.sampler_state, bounce_dimension(p_PathTracePayload.depth, SAMPLE_DIM_LIGHT_SELECTION)), u_PathTraceConsts.num_lights);
     const Light light = Lights.data[light_idx];
+    const uint group = light_type(light) == LIGHT_AREA ? material_light_group(Materials.data[area_light_material_id(light)]) : light_group(light);
 
     vec3 Wo = -gl_WorldRayDirectionEXT;
     vec3 Wi = vec3(0.0f);
@@ -479,36 +290,44 @@ vec3 direct_lighting(in SurfaceProperties p)
             L = (p_PathTracePayload.T * brdf * cos_theta * Li) / pdf;
     }
  
-    return L * float(u_PathTraceConsts.num_lights);
+    p_PathTracePayload.L[radiance_group(group)] += L * float(u_PathTraceConsts.num_lights);
 }
 
 // ------------------------------------------------------------------------
 
-vec3 indirect_lighting(in SurfaceProperties p)
+void indirect_lighting(in SurfaceProperties p)
 {
     vec3 Wo = -gl_WorldRayDirectionEXT;
     vec3 Wi;
     float pdf;
 
-    vec3 brdf = sample_uber(p, Wo, p_PathTracePayload.rng, Wi, pdf);
+    vec3 rand_value = vec3(sample_1d(p_PathTracePayload.sampler_state, bounce_dimension(p_PathTracePayload.depth, SAMPLE_DIM_BSDF_LOBE)),
+                           sample_2d(p_PathTracePayload.sampler_state, bounce_dimension(p_PathTracePayload.depth, SAMPLE_DIM_BSDF_DIRECTION)));
+
+    vec3 brdf = sample_uber(p, Wo, rand_value, Wi, pdf);
 
     float cos_theta = clamp(dot(p.normal, Wi), 0.0, 1.0);
 
-    p_IndirectPayload.L = vec3(0.0f);
+    for (uint i = 0; i < NUM_RADIANCE_GROUPS; i++)
+        p_IndirectPayload.L[i] = vec3(0.0f);
+
     p_IndirectPayload.T = p_PathTracePayload.T *  (brdf * cos_theta) / pdf;
 
 #if !defined(RAY_DEBUG_VIEW)
     // Russian roulette
     float probability = max(p_IndirectPayload.T.r, max(p_IndirectPayload.T.g, p_IndirectPayload.T.b));
-    if (next_float(p_PathTracePayload.rng) > probability)
-        return vec3(0.0f);
+    if (sample_1d(p_PathTracePayload.sampler_state, bounce_dimension(p_PathTracePayload.depth, SAMPLE_DIM_RUSSIAN_ROULETTE)) > probability)
+    {
+        INCREMENT_RAY_COUNTER(RAY_COUNTER_RUSSIAN_ROULETTE);
+        return;
+    }
  
     // Add the energy we 'lose' by randomly terminating paths
     p_IndirectPayload.T *= 1.0f / probability;
 #endif
 
     p_IndirectPayload.depth = p_PathTracePayload.depth + 1;
-    p_IndirectPayload.rng = p_PathTracePayload.rng;
+    p_IndirectPayload.sampler_state = p_PathTracePayload.sampler_state;
 #if defined(RAY_DEBUG_VIEW)
     p_IndirectPayload.debug_color = p_PathTracePayload.debug_color;
 #endif
@@ -519,6 +338,8 @@ vec3 indirect_lighting(in SurfaceProperties p)
     float tmax      = 10000.0;  
     vec3 origin = p.vertex.position.xyz;// + p.vertex.normal.xyz * EPSILON;
 
+    INCREMENT_RAY_COUNTER(RAY_COUNTER_INDIRECT);
+
     // Trace Ray
     traceRayEXT(u_TopLevelAS, 
             ray_flags, 
@@ -532,7 +353,8 @@ vec3 indirect_lighting(in SurfaceProperties p)
             tmax, 
             1);
 
-    return p_IndirectPayload.L;
+    for (uint i = 0; i < NUM_RADIANCE_GROUPS; i++)
+        p_PathTracePayload.L[i] += p_IndirectPayload.L[i];
 }
 
 // ------------------------------------------------------------------------
@@ -545,6 +367,9 @@ void main()
 
     populate_surface_properties(p);
 
+    // Number of paths that reached each depth, the last bin also counts every deeper hit.
+    INCREMENT_RAY_COUNTER(RAY_COUNTER_BOUNCE_HISTOGRAM + min(p_PathTracePayload.depth, RAY_STATISTICS_BOUNCE_BINS - 1));
+
 #if defined(RAY_DEBUG_VIEW)
     // Skip the primary ray
     if (p_PathTracePayload.depth > 0)
@@ -566,16 +391,17 @@ void main()
     }
 #endif
 
-    p_PathTracePayload.L = vec3(0.0f);
+    for (uint i = 0; i < NUM_RADIANCE_GROUPS; i++)
+        p_PathTracePayload.L[i] = vec3(0.0f);
 
     if (p_PathTracePayload.depth == 0 && !is_black(p.emissive.rgb))
-        p_PathTracePayload.L += p.emissive.rgb;
+        p_PathTracePayload.L[radiance_group(p.light_group)] += p.emissive.rgb;
     
-    p_PathTracePayload.L += direct_lighting(p);
+    direct_lighting(p);
 
 #if !defined(DIRECT_LIGHTING_INTEGRATOR)
-    if ((p_PathTracePayload.depth + 1) < u_PathTraceConsts.max_ray_bounces)
-       p_PathTracePayload.L += indirect_lighting(p);
+    if ((p_PathTracePayload.depth + 1) < MAX_RAY_BOUNCES)
+       indirect_lighting(p);
 #endif
 }
 
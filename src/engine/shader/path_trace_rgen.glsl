@@ -74,6 +74,8 @@ layout (set = 5, binding = 1) buffer DebugRayDrawArgs_t
     uint first;
     uint base_instance;
 } DebugRayDrawArgs;
+#elif defined(MULTI_VIEW)
+layout(set = 5, binding = 0, rgba32f) readonly uniform image2DArray i_PreviousColor;
 #else
 layout(set = 5, binding = 0, rgba32f) readonly uniform image2D i_PreviousColor;
 #endif
@@ -82,10 +84,33 @@ layout(set = 5, binding = 0, rgba32f) readonly uniform image2D i_PreviousColor;
 // Set 6 ------------------------------------------------------------------
 // ------------------------------------------------------------------------
 
-#if !defined(RAY_DEBUG_VIEW)
+#if defined(MULTI_VIEW)
+layout(set = 6, binding = 0, rgba32f) writeonly uniform image2DArray i_CurrentColor;
+#elif !defined(RAY_DEBUG_VIEW)
 layout(set = 6, binding = 0, rgba32f) writeonly uniform image2D i_CurrentColor;
 #endif
 
+// ------------------------------------------------------------------------
+// Set 8 ------------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+#if defined(LIGHT_GROUPS) && !defined(RAY_DEBUG_VIEW) && !defined(MULTI_VIEW)
+// One layer per light group. Each pixel is only touched by its own invocation, so it is accumulated in place.
+layout(set = 8, binding = 0, rgba32f) uniform image2DArray i_LightGroups;
+#endif
+
+// ------------------------------------------------------------------------
+// Set 9 ------------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+#if defined(MULTI_VIEW)
+// One view per layer of the launch, indexed by gl_LaunchIDEXT.z.
+layout (set = 9, binding = 0, std430) readonly buffer ViewBuffer 
+{
+    View data[];
+} Views;
+#endif
+
 // ------------------------------------------------------------------------
 // Push Constants ---------------------------------------------------------
 // ------------------------------------------------------------------------
@@ -103,10 +128,12 @@ layout(push_constant) uniform PathTraceConsts
     uint num_lights;
     uint num_frames;
     uint debug_vis;
-    uint max_ray_bounces;
     float shadow_ray_bias;
     float focal_length;
     float aperture_radius;
+    uint sample_offset;
+    uint environment_light_group;
+    uint light_group_samples;
 } u_PathTraceConsts;
 
 // ------------------------------------------------------------------------
@@ -119,6 +146,12 @@ layout(location = 0) rayPayloadEXT PathTracePayload p_PathTracePayload;
 // Structures -------------------------------------------------------------
 // ------------------------------------------------------------------------
 
+#if defined(MULTI_VIEW)
+#define OUTPUT_COORD ivec3(launch_id, gl_LaunchIDEXT.z)
+#else
+#define OUTPUT_COORD ivec2(launch_id)
+#endif
+
 struct Ray
 {
     vec3 origin;
@@ -129,7 +162,60 @@ struct Ray
 // Functions --------------------------------------------------------------
 // ------------------------------------------------------------------------
 
-Ray generate_ray(in uvec2 launch_id, in uvec2 launch_size)
+View current_view()
+{
+#if defined(MULTI_VIEW)
+    return Views.data[gl_LaunchIDEXT.z];
+#else
+    View view;
+
+    view.view_proj_inverse = u_PathTraceConsts.view_proj_inverse;
+    view.camera_pos = u_PathTraceConsts.camera_pos;
+    view.up_direction = u_PathTraceConsts.up_direction;
+    view.right_direction = u_PathTraceConsts.right_direction;
+    view.focal_plane = u_PathTraceConsts.focal_plane;
+    view.projection = uvec4(VIEW_PROJECTION_PERSPECTIVE, 0, 0, 0);
+    view.lens = vec4(u_PathTraceConsts.aperture_radius, 0.0, 0.0, 0.0);
+
+    return view;
+#endif
+}
+
+// ------------------------------------------------------------------------
+
+// Direction through a texel of a cubemap face, using the face orientation of Vulkan so that the output can be copied into a cubemap.
+vec3 cubemap_face_direction(in uint face, in vec2 tex_coord)
+{
+    const vec2 uv = tex_coord * 2.0 - 1.0;
+
+    if (face == 0)
+        return normalize(vec3(1.0, -uv.y, -uv.x));
+    else if (face == 1)
+        return normalize(vec3(-1.0, -uv.y, uv.x));
+    else if (face == 2)
+        return normalize(vec3(uv.x, 1.0, uv.y));
+    else if (face == 3)
+        return normalize(vec3(uv.x, -1.0, -uv.y));
+    else if (face == 4)
+        return normalize(vec3(uv.x, -uv.y, 1.0));
+    else
+        return normalize(vec3(-uv.x, -uv.y, -1.0));
+}
+
+// ------------------------------------------------------------------------
+
+// Latitude-longitude mapping with +Y at the top row of the image.
+vec3 equirectangular_direction(in vec2 tex_coord)
+{
+    const float phi = tex_coord.x * 2.0 * M_PI;
+    const float theta = tex_coord.y * M_PI;
+
+    return vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+}
+
+// ------------------------------------------------------------------------
+
+Ray generate_ray(in uvec2 launch_id, in uvec2 launch_size, in View view)
 {
     Ray ray;
 
@@ -139,32 +225,49 @@ Ray generate_ray(in uvec2 launch_id, in uvec2 launch_size)
 #else
     const vec2 pixel_coord = vec2(launch_id) + vec2(0.5);
 #endif
-    const vec2 jittered_coord = pixel_coord + vec2(next_float(p_PathTracePayload.rng), next_float(p_PathTracePayload.rng)); 
+    const vec2 jittered_coord = pixel_coord + sample_2d(p_PathTracePayload.sampler_state, SAMPLE_DIM_CAMERA_JITTER);
 #if defined(RAY_DEBUG_VIEW)
     const vec2 tex_coord = jittered_coord / vec2(u_PathTraceConsts.ray_debug_pixel_coord.zw);
 #else
     const vec2 tex_coord = jittered_coord / vec2(launch_size);
 #endif
+
+    // Panoramic views have no lens
+    if (view.projection.x == VIEW_PROJECTION_CUBEMAP_FACE)
+    {
+        ray.origin = view.camera_pos.xyz;
+        ray.direction = cubemap_face_direction(view.projection.y, tex_coord);
+
+        return ray;
+    }
+    else if (view.projection.x == VIEW_PROJECTION_EQUIRECTANGULAR)
+    {
+        ray.origin = view.camera_pos.xyz;
+        ray.direction = equirectangular_direction(tex_coord);
+
+        return ray;
+    }
     
     vec2 tex_coord_neg_to_pos = tex_coord * 2.0 - 1.0;
     // Compute Ray Origin and Direction
-    ray.origin = u_PathTraceConsts.camera_pos.xyz;
-    vec4 target =  u_PathTraceConsts.view_proj_inverse * vec4(tex_coord_neg_to_pos, 0.0f, 1.0f);
+    ray.origin = view.camera_pos.xyz;
+    vec4 target =  view.view_proj_inverse * vec4(tex_coord_neg_to_pos, 0.0f, 1.0f);
     target /= target.w;
     ray.direction = normalize(target.xyz - ray.origin);
 
     // Aperture Offset
-    float angle = next_float(p_PathTracePayload.rng) * 2.0f * M_PI;
-    float radius = sqrt(next_float(p_PathTracePayload.rng));
-    vec2 offset = vec2(cos(angle), sin(angle)) * radius * u_PathTraceConsts.aperture_radius;
-    float aperture_area = M_PI * u_PathTraceConsts.aperture_radius * u_PathTraceConsts.aperture_radius;
+    vec2 aperture_sample = sample_2d(p_PathTracePayload.sampler_state, SAMPLE_DIM_APERTURE);
+    float angle = aperture_sample.x * 2.0f * M_PI;
+    float radius = sqrt(aperture_sample.y);
+    vec2 offset = vec2(cos(angle), sin(angle)) * radius * view.lens.x;
+    float aperture_area = M_PI * view.lens.x * view.lens.x;
 
     // Aperture Pos
-    vec3 aperture_pos = u_PathTraceConsts.camera_pos.xyz + u_PathTraceConsts.right_direction.xyz * offset.x + u_PathTraceConsts.up_direction.xyz * offset.y;
+    vec3 aperture_pos = view.camera_pos.xyz + view.right_direction.xyz * offset.x + view.up_direction.xyz * offset.y;
 
-    vec3 rstart = u_PathTraceConsts.camera_pos.xyz;
-    vec3 rdir = -normalize(target.xyz - u_PathTraceConsts.camera_pos.xyz);
-    float t = -(dot(rstart, u_PathTraceConsts.focal_plane.xyz) + u_PathTraceConsts.focal_plane.w) / dot(rdir, u_PathTraceConsts.focal_plane.xyz);
+    vec3 rstart = view.camera_pos.xyz;
+    vec3 rdir = -normalize(target.xyz - view.camera_pos.xyz);
+    float t = -(dot(rstart, view.focal_plane.xyz) + view.focal_plane.w) / dot(rdir, view.focal_plane.xyz);
     vec3 focus_pos = rstart + rdir * t;
     
     ray.origin = aperture_pos;
@@ -185,22 +288,29 @@ void main()
     if (launch_id.x < launch_size.x && launch_id.y < launch_size.y)
     {
         // Init Payload
-        p_PathTracePayload.L = vec3(0.0f);
+        for (uint i = 0; i < NUM_RADIANCE_GROUPS; i++)
+            p_PathTracePayload.L[i] = vec3(0.0f);
+
         p_PathTracePayload.T = vec3(1.0);
         p_PathTracePayload.depth = 0;
-        p_PathTracePayload.rng = rng_init(launch_id, u_PathTraceConsts.num_frames);
+        // Samples are indexed globally so that the result does not depend on how the work was split between jobs. Each view gets
+        // its own rows of the sequence so that the views are not correlated.
+        p_PathTracePayload.sampler_state = sampler_init(uvec2(launch_id.x, launch_id.y + gl_LaunchIDEXT.z * launch_size.y), u_PathTraceConsts.sample_offset + u_PathTraceConsts.num_frames);
 
     #if defined(RAY_DEBUG_VIEW)
-        p_PathTracePayload.debug_color = vec3(next_float(p_PathTracePayload.rng) * 0.5f + 0.5f, next_float(p_PathTracePayload.rng) * 0.5f + 0.5f, next_float(p_PathTracePayload.rng) * 0.5f + 0.5f);
+        uint color_hash = rng_hash(p_PathTracePayload.sampler_state.pixel_seed ^ u_PathTraceConsts.num_frames);
+        p_PathTracePayload.debug_color = vec3(uvec3(color_hash, color_hash >> 8, color_hash >> 16) & 0xffu) / 255.0f * 0.5f + 0.5f;
     #endif
 
-        Ray ray = generate_ray(launch_id, launch_size);
+        Ray ray = generate_ray(launch_id, launch_size, current_view());
 
         uint  ray_flags = 0;
         uint  cull_mask = 0xFF;
         float tmin      = 0.001;
         float tmax      = 10000.0;
 
+        INCREMENT_RAY_COUNTER(RAY_COUNTER_PRIMARY);
+
         // Trace Ray
         traceRayEXT(u_TopLevelAS, 
                     ray_flags, 
@@ -215,35 +325,50 @@ void main()
                     0);
 
     #if !defined(RAY_DEBUG_VIEW)
-        // Blend current frames' result with the previous frame
-        vec3 clamped_color = min(p_PathTracePayload.L, RADIANCE_CLAMP_COLOR);
+        // Each group is clamped on its own so that the groups still add up to the total after clamping
+        vec3 clamped_color = vec3(0.0f);
+        vec3 radiance = vec3(0.0f);
 
+        for (uint i = 0; i < NUM_RADIANCE_GROUPS; i++)
+        {
+            vec3 clamped_group = min(p_PathTracePayload.L[i], RADIANCE_CLAMP_COLOR);
+
+        #if defined(LIGHT_GROUPS) && !defined(MULTI_VIEW)
+            vec3 prev_group = u_PathTraceConsts.light_group_samples == 0 ? vec3(0.0f) : imageLoad(i_LightGroups, ivec3(launch_id, i)).rgb;
+            imageStore(i_LightGroups, ivec3(launch_id, i), vec4(prev_group + (clamped_group - prev_group) / float(u_PathTraceConsts.light_group_samples + 1), 1.0));
+        #endif
+
+            clamped_color += clamped_group;
+            radiance += p_PathTracePayload.L[i];
+        }
+
+        // Blend current frames' result with the previous frame
         if (u_PathTraceConsts.num_frames == 0)
         {
             vec3 final_color = clamped_color;
 
     #if defined(VISUALIZE_NANS)
-            if (is_nan(p_PathTracePayload.L))
+            if (is_nan(radiance))
                 final_color = vec3(1.0, 0.0, 0.0);
     #endif
 
-            imageStore(i_CurrentColor, ivec2(launch_id), vec4(final_color, 1.0));
+            imageStore(i_CurrentColor, OUTPUT_COORD, vec4(final_color, 1.0));
         }
         else
         {
-            vec3 prev_color = imageLoad(i_PreviousColor, ivec2(launch_id)).rgb;
+            vec3 prev_color = imageLoad(i_PreviousColor, OUTPUT_COORD).rgb;
 
             //vec3 accumulated_color = mix(p_PathTracePayload.color, prev_color, u_PathTraceConsts.accumulation); 
-            vec3 accumulated_color = prev_color + (clamped_color - prev_color) / float(u_PathTraceConsts.num_frames);
+            vec3 accumulated_color = prev_color + (clamped_color - prev_color) / float(u_PathTraceConsts.num_frames + 1);
 
             vec3 final_color = accumulated_color;
 
     #if defined(VISUALIZE_NANS)
-            if (is_nan(p_PathTracePayload.L))
+            if (is_nan(radiance))
                 final_color = vec3(1.0, 0.0, 0.0);
     #endif
 
-            imageStore(i_CurrentColor, ivec2(launch_id), vec4(final_color, 1.0));
+            imageStore(i_CurrentColor, OUTPUT_COORD, vec4(final_color, 1.0));
         }
     #endif
     }
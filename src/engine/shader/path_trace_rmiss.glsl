@@ -25,6 +25,31 @@ layout (set = 5, binding = 1) buffer DebugRayDrawArgs_t
 } DebugRayDrawArgs;
 #endif
 
+// ------------------------------------------------------------------------
+// Push Constants ---------------------------------------------------------
+// ------------------------------------------------------------------------
+
+layout(push_constant) uniform PathTraceConsts
+{
+    mat4 view_proj_inverse;
+    vec4 camera_pos;
+    vec4 up_direction;
+    vec4 right_direction;
+    vec4 focal_plane;
+    ivec4 ray_debug_pixel_coord;
+    uvec4 launch_id_size;
+    float accumulation;
+    uint num_lights;
+    uint num_frames;
+    uint debug_vis;
+    float shadow_ray_bias;
+    float focal_length;
+    float aperture_radius;
+    uint sample_offset;
+    uint environment_light_group;
+    uint light_group_samples;
+} u_PathTraceConsts;
+
 // ------------------------------------------------------------------------
 // Input Payload ----------------------------------------------------------
 // ------------------------------------------------------------------------
@@ -59,10 +84,15 @@ void main()
 #else
     vec3 environment_map_sample = texture(s_EnvironmentMap, gl_WorldRayDirectionEXT).rgb; 
 
+    for (uint i = 0; i < NUM_RADIANCE_GROUPS; i++)
+        p_PathTracePayload.L[i] = vec3(0.0f);
+
+    uint group = radiance_group(u_PathTraceConsts.environment_light_group);
+
     if (p_PathTracePayload.depth == 0)
-        p_PathTracePayload.L = environment_map_sample;
+        p_PathTracePayload.L[group] = environment_map_sample;
     else
-        p_PathTracePayload.L = p_PathTracePayload.T * environment_map_sample;
+        p_PathTracePayload.L[group] = p_PathTracePayload.T * environment_map_sample;
 #endif
 }
 
@@ -0,0 +1,247 @@
+#include "common.glsl"
+
+// ------------------------------------------------------------------------
+// Set 0 ------------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+layout (set = 0, binding = 3) uniform accelerationStructureEXT u_TopLevelAS;
+
+// ------------------------------------------------------------------------
+// Set 10 -----------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+// Keep in sync with ProbeBufferHeader in probe_bake.cpp
+layout (set = 10, binding = 0, std430) readonly buffer ProbeBuffer
+{
+    uvec4 counts; // x: number of probes, y: rays per lane, z: SH coefficients, w: minimum rays per probe
+    vec4 params; // x: convergence threshold
+    vec4 positions[];
+} Probes;
+
+// Keep in sync with ProbeLaneData in probe_bake.cpp
+struct ProbeLane
+{
+    vec4 coefficients[PROBE_BAKE_MAX_SH_COEFFICIENTS]; // Mean of radiance * Y_lm over the rays of the lane, w of the first one is the ray count
+};
+
+// Lanes written by the previous launch. They are never written during a launch, so every lane of a probe can read all of them.
+layout (set = 10, binding = 1, std430) readonly buffer PreviousLaneBuffer
+{
+    ProbeLane data[];
+} PreviousLanes;
+
+layout (set = 10, binding = 2, std430) writeonly buffer CurrentLaneBuffer
+{
+    ProbeLane data[];
+} CurrentLanes;
+
+layout (set = 10, binding = 3, std430) buffer ProbeStateBuffer
+{
+    uint num_converged;
+    uint converged[]; // Only touched by the first lane of each probe
+} ProbeState;
+
+// ------------------------------------------------------------------------
+// Push Constants ---------------------------------------------------------
+// ------------------------------------------------------------------------
+
+layout(push_constant) uniform PathTraceConsts
+{
+    mat4 view_proj_inverse;
+    vec4 camera_pos;
+    vec4 up_direction;
+    vec4 right_direction;
+    vec4 focal_plane;
+    ivec4 ray_debug_pixel_coord;
+    uvec4 launch_id_size;
+    float accumulation;
+    uint num_lights;
+    uint num_frames;
+    uint debug_vis;
+    float shadow_ray_bias;
+    float focal_length;
+    float aperture_radius;
+    uint sample_offset;
+    uint environment_light_group;
+    uint light_group_samples;
+} u_PathTraceConsts;
+
+// ------------------------------------------------------------------------
+// Output Payload ---------------------------------------------------------
+// ------------------------------------------------------------------------
+
+layout(location = 0) rayPayloadEXT PathTracePayload p_PathTracePayload;
+
+// ------------------------------------------------------------------------
+// Functions --------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+vec3 uniform_sphere_direction(in vec2 u)
+{
+    const float z = 1.0 - 2.0 * u.x;
+    const float r = sqrt(max(0.0, 1.0 - z * z));
+    const float phi = 2.0 * M_PI * u.y;
+
+    return vec3(r * cos(phi), r * sin(phi), z);
+}
+
+// ------------------------------------------------------------------------
+
+// Real SH basis ordered Y00, Y1-1, Y10, Y11, Y2-2, Y2-1, Y20, Y21, Y22.
+void sh_basis(in vec3 d, out float Y[PROBE_BAKE_MAX_SH_COEFFICIENTS])
+{
+    Y[0] = 0.282095;
+    Y[1] = 0.488603 * d.y;
+    Y[2] = 0.488603 * d.z;
+    Y[3] = 0.488603 * d.x;
+    Y[4] = 1.092548 * d.x * d.y;
+    Y[5] = 1.092548 * d.y * d.z;
+    Y[6] = 0.315392 * (3.0 * d.z * d.z - 1.0);
+    Y[7] = 1.092548 * d.x * d.z;
+    Y[8] = 0.546274 * (d.x * d.x - d.y * d.y);
+}
+
+// ------------------------------------------------------------------------
+
+float luminance(in vec3 c)
+{
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// ------------------------------------------------------------------------
+
+// Treats the lanes of a probe as independent estimates of its DC term and compares the standard error of their mean against the
+// mean itself. Only the data of the previous launch is used, so every lane of the probe comes to the same conclusion.
+bool is_converged(in uint probe_idx)
+{
+    const uint first_lane = probe_idx * PROBE_BAKE_LANES;
+
+    float num_rays = 0.0;
+    float mean = 0.0;
+
+    for (uint i = 0; i < PROBE_BAKE_LANES; i++)
+    {
+        const vec4 dc = PreviousLanes.data[first_lane + i].coefficients[0];
+
+        num_rays += dc.w;
+        mean += dc.w * luminance(dc.rgb);
+    }
+
+    if (num_rays < float(Probes.counts.w))
+        return false;
+
+    mean /= num_rays;
+
+    float variance = 0.0;
+
+    for (uint i = 0; i < PROBE_BAKE_LANES; i++)
+    {
+        const float d = luminance(PreviousLanes.data[first_lane + i].coefficients[0].rgb) - mean;
+
+        variance += d * d;
+    }
+
+    variance /= float(PROBE_BAKE_LANES - 1);
+
+    return sqrt(variance / float(PROBE_BAKE_LANES)) <= Probes.params.x * mean;
+}
+
+// ------------------------------------------------------------------------
+// Main -------------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+void main()
+{
+    const uint lane_idx = gl_LaunchIDEXT.x;
+    const uint probe_idx = gl_LaunchIDEXT.y;
+
+    if (probe_idx >= Probes.counts.x)
+        return;
+
+    const uint lane_offset = probe_idx * PROBE_BAKE_LANES + lane_idx;
+
+    ProbeLane lane = PreviousLanes.data[lane_offset];
+
+    if (is_converged(probe_idx))
+    {
+        if (lane_idx == 0 && ProbeState.converged[probe_idx] == 0)
+        {
+            ProbeState.converged[probe_idx] = 1;
+            atomicAdd(ProbeState.num_converged, 1);
+        }
+
+        // The buffers swap after every launch, so converged lanes are carried over as they are
+        CurrentLanes.data[lane_offset] = lane;
+        return;
+    }
+
+    const uint num_coefficients = Probes.counts.z;
+    const uint rays_per_lane = Probes.counts.y;
+    const vec3 origin = Probes.positions[probe_idx].xyz;
+
+    vec3 batch[PROBE_BAKE_MAX_SH_COEFFICIENTS];
+
+    for (uint c = 0; c < PROBE_BAKE_MAX_SH_COEFFICIENTS; c++)
+        batch[c] = vec3(0.0);
+
+    uint num_valid_rays = 0;
+
+    for (uint i = 0; i < rays_per_lane; i++)
+    {
+        for (uint j = 0; j < NUM_RADIANCE_GROUPS; j++)
+            p_PathTracePayload.L[j] = vec3(0.0f);
+
+        p_PathTracePayload.T = vec3(1.0);
+        p_PathTracePayload.depth = 0;
+        // Every lane is its own pixel of the sequence and continues it where the previous launch stopped
+        p_PathTracePayload.sampler_state = sampler_init(uvec2(probe_idx, lane_idx), u_PathTraceConsts.num_frames * rays_per_lane + i);
+
+        const vec3 direction = uniform_sphere_direction(sample_2d(p_PathTracePayload.sampler_state, SAMPLE_DIM_CAMERA_JITTER));
+
+        INCREMENT_RAY_COUNTER(RAY_COUNTER_PRIMARY);
+
+        traceRayEXT(u_TopLevelAS,
+                    0,
+                    0xFF,
+                    PATH_TRACE_CLOSEST_HIT_SHADER_IDX,
+                    0,
+                    PATH_TRACE_MISS_SHADER_IDX,
+                    origin,
+                    0.001,
+                    direction,
+                    10000.0,
+                    0);
+
+        // Unlike the image, the radiance is not clamped since the bake is meant as a reference. Invalid samples are dropped.
+        vec3 radiance = vec3(0.0f);
+
+        for (uint j = 0; j < NUM_RADIANCE_GROUPS; j++)
+            radiance += p_PathTracePayload.L[j];
+
+        if (is_nan(radiance) || any(isinf(radiance)))
+            continue;
+
+        float Y[PROBE_BAKE_MAX_SH_COEFFICIENTS];
+        sh_basis(direction, Y);
+
+        for (uint c = 0; c < num_coefficients; c++)
+            batch[c] += radiance * Y[c];
+
+        num_valid_rays++;
+    }
+
+    if (num_valid_rays > 0)
+    {
+        const float num_rays = lane.coefficients[0].w + float(num_valid_rays);
+        const float weight = float(num_valid_rays) / num_rays;
+
+        for (uint c = 0; c < num_coefficients; c++)
+            lane.coefficients[c].rgb += (batch[c] / float(num_valid_rays) - lane.coefficients[c].rgb) * weight;
+
+        lane.coefficients[0].w = num_rays;
+    }
+
+    CurrentLanes.data[lane_offset] = lane;
+}
+
+// ------------------------------------------------------------------------
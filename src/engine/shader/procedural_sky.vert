@@ -1,55 +0,0 @@
-#version 460
-
-// ------------------------------------------------------------------
-// INPUTS -----------------------------------------------------------
-// ------------------------------------------------------------------
-
-layout (location = 0) in vec3 VS_IN_Position;
-layout (location = 1) in vec3 VS_IN_Normal;
-layout (location = 2) in vec3 VS_IN_TexCoord;
-
-// ------------------------------------------------------------------
-// OUTPUTS ----------------------------------------------------------
-// ------------------------------------------------------------------
-
-layout (location = 0) out vec3 FS_IN_Position;
-
-// ------------------------------------------------------------------
-// DESCRIPTOR SETS --------------------------------------------------
-// ------------------------------------------------------------------
-
-layout (set = 0, binding = 0) uniform PerFrameUBO 
-{
-    vec4 A;
-    vec4 B;
-    vec4 C;
-    vec4 D;
-    vec4 E;
-    vec4 F;
-    vec4 G;
-    vec4 H;
-    vec4 I;
-    vec4 Z;
-} u_PerFrameUBO;
-
-// ------------------------------------------------------------------
-// PUSH CONSTANTS ---------------------------------------------------
-// ------------------------------------------------------------------
-
-layout(push_constant) uniform PushConstants
-{
-    mat4 view_proj;
-    vec3 direction;
-} u_PushConstants;
-
-// ------------------------------------------------------------------
-// MAIN -------------------------------------------------------------
-// ------------------------------------------------------------------
-
-void main()
-{
-    FS_IN_Position = VS_IN_Position;
-    gl_Position = u_PushConstants.view_proj * vec4(VS_IN_Position, 1.0f);
-}
-
-// ------------------------------------------------------------------
\ No newline at end of file
@@ -1,29 +1,34 @@
 #ifndef RANDOM_GLSL
 #define RANDOM_GLSL
 
-struct RNG
-{
-    uvec2 s;
-};
+// Keep in sync with include/utility/sampler.h
 
-// xoroshiro64* random number generator.
-// http://prng.di.unimi.it/xoroshiro64star.c
-uint rng_rotl(uint x, uint k)
-{
-    return (x << k) | (x >> (32 - k));
-}
+#define SAMPLER_SOBOL 0
+#define SAMPLER_BLUE_NOISE 1
 
-// Xoroshiro64* RNG
-uint rng_next(inout RNG rng)
-{
-    uint result = rng.s.x * 0x9e3779bb;
+// Specialization constant so that the sampler branch is resolved when the pipeline is created.
+layout (constant_id = 1) const uint SAMPLER_TYPE = SAMPLER_SOBOL;
 
-    rng.s.y ^= rng.s.x;
-    rng.s.x = rng_rotl(rng.s.x, 26) ^ rng.s.y ^ (rng.s.y << 9);
-    rng.s.y = rng_rotl(rng.s.y, 13);
+// Sample dimensions used by the camera ray.
+#define SAMPLE_DIM_CAMERA_JITTER 0
+#define SAMPLE_DIM_APERTURE 2
+#define SAMPLE_DIM_BOUNCE_START 4
 
-    return result;
-}
+// Sample dimensions used at each bounce, relative to the start of that bounce.
+#define SAMPLE_DIM_LIGHT_SELECTION 0
+#define SAMPLE_DIM_LIGHT_PRIMITIVE 1
+#define SAMPLE_DIM_LIGHT_POSITION 2
+#define SAMPLE_DIM_BSDF_LOBE 4
+#define SAMPLE_DIM_BSDF_DIRECTION 5
+#define SAMPLE_DIM_RUSSIAN_ROULETTE 7
+#define SAMPLE_DIMS_PER_BOUNCE 8
+
+struct Sampler
+{
+    uint pixel;
+    uint pixel_seed;
+    uint sample_idx;
+};
 
 // Thomas Wang 32-bit hash.
 // http://www.reedbeta.com/blog/quick-and-easy-gpu-random-numbers-in-d3d11/
@@ -37,16 +42,105 @@ uint rng_hash(uint seed)
     return seed;
 }
 
-RNG rng_init(uvec2 id, uint frameIndex)
+uint hash_combine(uint seed, uint v)
+{
+    return seed ^ (v + (seed << 6) + (seed >> 2));
+}
+
+// Practical Hash-based Owen Scrambling, Burley 2020.
+// https://jcgt.org/published/0009/04/01/
+uint laine_karras_permutation(uint x, uint seed)
 {
-    uint s0 = (id.x << 16) | id.y;
-    uint s1 = frameIndex;
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint nested_uniform_scramble(uint x, uint seed)
+{
+    x = bitfieldReverse(x);
+    x = laine_karras_permutation(x, seed);
+    x = bitfieldReverse(x);
+    return x;
+}
+
+// Second dimension of the Sobol sequence. The first one is the bit reversed index.
+uint sobol_dim1(uint index)
+{
+    uint result = 0;
+
+    for (uint v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1)
+    {
+        if ((index & 1u) != 0)
+            result ^= v;
+    }
+
+    return result;
+}
+
+float uint_to_unit_float(uint x)
+{
+    return float(x >> 8) * (1.0 / 16777216.0);
+}
 
-    RNG rng;
-    rng.s.x = rng_hash(s0);
-    rng.s.y = rng_hash(s1);
-    rng_next(rng);
-    return rng;
+// Padded 2D Owen-scrambled Sobol. Every dimension pair gets an independently shuffled and scrambled copy of the 2D sequence.
+vec2 sobol_owen_2d(uint index, uint seed)
+{
+    index = nested_uniform_scramble(index, seed);
+
+    uint x = nested_uniform_scramble(bitfieldReverse(index), hash_combine(seed, 0xa511e9b3u));
+    uint y = nested_uniform_scramble(sobol_dim1(index), hash_combine(seed, 0x63d83595u));
+
+    return vec2(uint_to_unit_float(x), uint_to_unit_float(y));
+}
+
+// R2 dither: a cheap spatially blue distribution used to rotate a sequence shared by all pixels.
+vec2 blue_noise_offset(uint pixel, uint dimension)
+{
+    vec2 p = vec2(float(pixel >> 16), float(pixel & 0xffffu));
+
+    float x = fract(0.5 + dot(p, vec2(0.7548776662, 0.5698402910)) + float(dimension) * 0.6180339887);
+    float y = fract(0.5 + dot(p.yx, vec2(0.7548776662, 0.5698402910)) + float(dimension) * 0.4142135623);
+
+    return vec2(x, y);
+}
+
+Sampler sampler_init(uvec2 id, uint sample_idx)
+{
+    Sampler s;
+
+    s.pixel      = (id.x << 16) | (id.y & 0xffffu);
+    s.pixel_seed = rng_hash(s.pixel);
+    s.sample_idx = sample_idx;
+
+    return s;
+}
+
+uint bounce_dimension(uint depth, uint offset)
+{
+    return SAMPLE_DIM_BOUNCE_START + depth * SAMPLE_DIMS_PER_BOUNCE + offset;
+}
+
+// The sampler type is a parameter here so that sampler_check.comp can test both in one pipeline.
+vec2 sample_2d(in Sampler s, uint dimension, uint sampler_type)
+{
+    if (sampler_type == SAMPLER_BLUE_NOISE)
+        return fract(sobol_owen_2d(s.sample_idx, rng_hash(dimension)) + blue_noise_offset(s.pixel, dimension));
+    else
+        return sobol_owen_2d(s.sample_idx, hash_combine(s.pixel_seed, rng_hash(dimension)));
+}
+
+vec2 sample_2d(in Sampler s, uint dimension)
+{
+    return sample_2d(s, dimension, SAMPLER_TYPE);
+}
+
+float sample_1d(in Sampler s, uint dimension)
+{
+    return sample_2d(s, dimension).x;
 }
 
 #endif
\ No newline at end of file
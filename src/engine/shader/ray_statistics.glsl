@@ -0,0 +1,57 @@
+#ifndef RAY_STATISTICS_GLSL
+#define RAY_STATISTICS_GLSL
+
+// Keep in sync with RayCounter in include/gfx/path_integrator.h
+
+#define RAY_COUNTER_PRIMARY 0
+#define RAY_COUNTER_SHADOW 1
+#define RAY_COUNTER_INDIRECT 2
+#define RAY_COUNTER_ANY_HIT 3
+#define RAY_COUNTER_RUSSIAN_ROULETTE 4
+#define RAY_COUNTER_BOUNCE_HISTOGRAM 5
+#define RAY_STATISTICS_BOUNCE_BINS 16
+
+#if defined(RAY_STATISTICS)
+
+// ------------------------------------------------------------------------
+// Set 7 ------------------------------------------------------------------
+// ------------------------------------------------------------------------
+
+layout (set = 7, binding = 0, std430) buffer RayStatisticsBuffer
+{
+    uint counters[];
+} RayStatistics;
+
+// ------------------------------------------------------------------------
+
+void increment_ray_counter(uint counter)
+{
+#if defined(RAY_STATISTICS_SUBGROUP)
+    // Invocations are grouped by counter index so that each group issues a single atomic for all of its active lanes.
+    for (;;)
+    {
+        if (subgroupBroadcastFirst(counter) == counter)
+        {
+            uint count = subgroupBallotBitCount(subgroupBallot(true));
+
+            if (subgroupElect())
+                atomicAdd(RayStatistics.counters[counter], count);
+
+            break;
+        }
+    }
+#else
+    atomicAdd(RayStatistics.counters[counter], 1);
+#endif
+}
+
+// ------------------------------------------------------------------------
+
+#define INCREMENT_RAY_COUNTER(counter) increment_ray_counter(counter)
+#else
+#define INCREMENT_RAY_COUNTER(counter)
+#endif
+
+// ------------------------------------------------------------------------
+
+#endif
@@ -3,26 +3,10 @@
 
 #include "common.glsl"
 
-float next_float(inout RNG rng)
+// Maps a uniform sample to an integer in [0, nmax).
+uint sample_uint(float u, uint nmax)
 {
-    uint u = 0x3f800000 | (rng_next(rng) >> 9);
-    return uintBitsToFloat(u) - 1.0;
-}
-
-uint next_uint(inout RNG rng, uint nmax)
-{
-    float f = next_float(rng);
-    return uint(floor(f * nmax));
-}
-
-vec2 next_vec2(inout RNG rng)
-{
-    return vec2(next_float(rng), next_float(rng));
-}
-
-vec3 next_vec3(inout RNG rng)
-{
-    return vec3(next_float(rng), next_float(rng), next_float(rng));
+    return min(uint(floor(u * float(nmax))), nmax - 1);
 }
 
 mat3 make_rotation_matrix(vec3 z)
@@ -0,0 +1,170 @@
+#include <utility/file_watcher.h>
+#include <utility/logger.h>
+#include <algorithm>
+
+#if defined(__linux__)
+#    include <sys/inotify.h>
+#    include <unistd.h>
+#endif
+
+namespace helios
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+#if !defined(__linux__)
+static const std::chrono::milliseconds kPollInterval = std::chrono::milliseconds(500);
+#endif
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FileWatcher::FileWatcher()
+{
+#if defined(__linux__)
+    m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (m_inotify_fd == -1)
+        HELIOS_LOG_ERROR("Failed to initialize inotify, changed files will not be detected.");
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FileWatcher::~FileWatcher()
+{
+#if defined(__linux__)
+    if (m_inotify_fd != -1)
+        close(m_inotify_fd);
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FileWatcher::watch(const std::string& path)
+{
+    std::filesystem::path normalized = std::filesystem::path(path).lexically_normal();
+
+    if (!m_files.insert({ normalized.string(), path }).second)
+        return;
+
+#if defined(__linux__)
+    if (m_inotify_fd == -1)
+        return;
+
+    std::string directory = normalized.parent_path().string();
+
+    if (m_watches.find(directory) != m_watches.end())
+    {
+        m_watch_counts[directory]++;
+        return;
+    }
+
+    // Only completed writes and files moved into place are of interest, partially written files would fail to load
+    int wd = inotify_add_watch(m_inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+    if (wd == -1)
+    {
+        HELIOS_LOG_ERROR("Failed to watch directory: " + directory);
+        return;
+    }
+
+    m_watches[directory]      = wd;
+    m_directories[wd]         = directory;
+    m_watch_counts[directory] = 1;
+#else
+    std::error_code error;
+    m_write_times[normalized.string()] = std::filesystem::last_write_time(normalized, error);
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FileWatcher::unwatch(const std::string& path)
+{
+    std::filesystem::path normalized = std::filesystem::path(path).lexically_normal();
+
+    if (m_files.erase(normalized.string()) == 0)
+        return;
+
+#if defined(__linux__)
+    std::string directory = normalized.parent_path().string();
+    auto        watch     = m_watches.find(directory);
+
+    // The directory may have failed to be watched
+    if (watch == m_watches.end() || --m_watch_counts[directory] > 0)
+        return;
+
+    inotify_rm_watch(m_inotify_fd, watch->second);
+
+    m_directories.erase(watch->second);
+    m_watch_counts.erase(directory);
+    m_watches.erase(watch);
+#else
+    m_write_times.erase(normalized.string());
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FileWatcher::poll(std::vector<std::string>& changed_files)
+{
+    const size_t first_change = changed_files.size();
+
+#if defined(__linux__)
+    if (m_inotify_fd == -1)
+        return;
+
+    alignas(inotify_event) char buffer[4096];
+
+    while (true)
+    {
+        ssize_t length = read(m_inotify_fd, buffer, sizeof(buffer));
+
+        // Non-blocking, so the queue is drained once read() fails with EAGAIN
+        if (length <= 0)
+            break;
+
+        for (char* ptr = buffer; ptr < buffer + length;)
+        {
+            const inotify_event* event = (const inotify_event*)ptr;
+
+            ptr += sizeof(inotify_event) + event->len;
+
+            auto directory = m_directories.find(event->wd);
+
+            if (event->len == 0 || directory == m_directories.end())
+                continue;
+
+            auto file = m_files.find((std::filesystem::path(directory->second) / event->name).string());
+
+            if (file != m_files.end())
+                changed_files.push_back(file->second);
+        }
+    }
+#else
+    const auto now = std::chrono::steady_clock::now();
+
+    if (now - m_last_poll < kPollInterval)
+        return;
+
+    m_last_poll = now;
+
+    for (auto& it : m_write_times)
+    {
+        std::error_code error;
+        auto            write_time = std::filesystem::last_write_time(it.first, error);
+
+        if (!error && write_time != it.second)
+        {
+            it.second = write_time;
+            changed_files.push_back(m_files[it.first]);
+        }
+    }
+#endif
+
+    // Tools often write a file more than once when saving it
+    std::sort(changed_files.begin() + first_change, changed_files.end());
+    changed_files.erase(std::unique(changed_files.begin() + first_change, changed_files.end()), changed_files.end());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace helios
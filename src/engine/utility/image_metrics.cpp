@@ -0,0 +1,300 @@
+#include <utility/image_metrics.h>
+#include <glm.hpp>
+#include <algorithm>
+#include <vector>
+#include <math.h>
+
+namespace helios
+{
+namespace image_metrics
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static const glm::vec3 kWhitePoint = glm::vec3(0.950428545f, 1.0f, 1.088900371f); // D65
+
+static const float kPi = 3.14159265359f;
+
+// Error mapping from the FLIP paper
+static const float kHyAbExponent  = 0.7f;
+static const float kErrorPoint    = 0.4f;
+static const float kErrorFraction = 0.95f;
+
+// Contrast sensitivity of the achromatic, red-green and blue-yellow channels, each a weighted sum of up to two Gaussians.
+struct ContrastSensitivity
+{
+    float a1;
+    float b1;
+    float a2;
+    float b2;
+};
+
+static const ContrastSensitivity kContrastSensitivity[3] = {
+    { 1.0f, 0.0047f, 0.0f, 1e-5f },
+    { 1.0f, 0.0053f, 0.0f, 1e-5f },
+    { 34.1f, 0.04f, 13.5f, 0.025f }
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static glm::vec3 linear_rgb_to_xyz(const glm::vec3& c)
+{
+    return glm::vec3(0.4124564f * c.r + 0.3575761f * c.g + 0.1804375f * c.b,
+                     0.2126729f * c.r + 0.7151522f * c.g + 0.0721750f * c.b,
+                     0.0193339f * c.r + 0.1191920f * c.g + 0.9503041f * c.b);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static glm::vec3 xyz_to_linear_rgb(const glm::vec3& c)
+{
+    return glm::vec3(3.2404542f * c.x - 1.5371385f * c.y - 0.4985314f * c.z,
+                     -0.9692660f * c.x + 1.8760108f * c.y + 0.0415560f * c.z,
+                     0.0556434f * c.x - 0.2040259f * c.y + 1.0572252f * c.z);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static glm::vec3 xyz_to_ycxcz(const glm::vec3& c)
+{
+    const glm::vec3 n = c / kWhitePoint;
+
+    return glm::vec3(116.0f * n.y - 16.0f, 500.0f * (n.x - n.y), 200.0f * (n.y - n.z));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static glm::vec3 ycxcz_to_xyz(const glm::vec3& c)
+{
+    const float y = (c.x + 16.0f) / 116.0f;
+
+    return glm::vec3(y + c.y / 500.0f, y, y - c.z / 200.0f) * kWhitePoint;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float lab_f(float t)
+{
+    const float delta = 6.0f / 29.0f;
+
+    if (t > delta * delta * delta)
+        return cbrtf(t);
+    else
+        return t / (3.0f * delta * delta) + 4.0f / 29.0f;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// CIELAB with the Hunt effect applied to the chromatic channels, as in FLIP.
+static glm::vec3 xyz_to_hunt_lab(const glm::vec3& c)
+{
+    const glm::vec3 n = c / kWhitePoint;
+
+    const float fx = lab_f(n.x);
+    const float fy = lab_f(n.y);
+    const float fz = lab_f(n.z);
+
+    const float l = 116.0f * fy - 16.0f;
+
+    return glm::vec3(l, 0.01f * l * 500.0f * (fx - fy), 0.01f * l * 200.0f * (fy - fz));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float hyab(const glm::vec3& a, const glm::vec3& b)
+{
+    const glm::vec3 d = a - b;
+
+    return fabsf(d.x) + sqrtf(d.y * d.y + d.z * d.z);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float aces(float x)
+{
+    return glm::clamp((x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f), 0.0f, 1.0f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Separable Gaussian blur of a single channel with clamp-to-edge addressing.
+static void gaussian_blur(const std::vector<float>& src, std::vector<float>& dst, uint32_t width, uint32_t height, float sigma)
+{
+    const int32_t radius = std::max(int32_t(ceilf(3.0f * sigma)), 1);
+
+    std::vector<float> kernel(radius * 2 + 1);
+    float              sum = 0.0f;
+
+    for (int32_t i = -radius; i <= radius; i++)
+    {
+        kernel[i + radius] = expf(-float(i * i) / (2.0f * sigma * sigma));
+        sum += kernel[i + radius];
+    }
+
+    for (auto& weight : kernel)
+        weight /= sum;
+
+    std::vector<float> temp(src.size());
+
+    dst.resize(src.size());
+
+    for (int32_t y = 0; y < int32_t(height); y++)
+    {
+        for (int32_t x = 0; x < int32_t(width); x++)
+        {
+            float value = 0.0f;
+
+            for (int32_t i = -radius; i <= radius; i++)
+                value += kernel[i + radius] * src[size_t(y) * width + glm::clamp(x + i, 0, int32_t(width) - 1)];
+
+            temp[size_t(y) * width + x] = value;
+        }
+    }
+
+    for (int32_t y = 0; y < int32_t(height); y++)
+    {
+        for (int32_t x = 0; x < int32_t(width); x++)
+        {
+            float value = 0.0f;
+
+            for (int32_t i = -radius; i <= radius; i++)
+                value += kernel[i + radius] * temp[size_t(glm::clamp(y + i, 0, int32_t(height) - 1)) * width + x];
+
+            dst[size_t(y) * width + x] = value;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Tone maps an image, filters it with the contrast sensitivity functions and returns it in Hunt-adjusted CIELAB.
+static std::vector<glm::vec3> filtered_lab(const float* rgba, uint32_t width, uint32_t height, float exposure, float pixels_per_degree)
+{
+    const size_t num_pixels = size_t(width) * size_t(height);
+
+    std::vector<float> channels[3];
+
+    for (int c = 0; c < 3; c++)
+        channels[c].resize(num_pixels);
+
+    for (size_t i = 0; i < num_pixels; i++)
+    {
+        const glm::vec3 color = glm::vec3(aces(rgba[i * 4 + 0] * exposure), aces(rgba[i * 4 + 1] * exposure), aces(rgba[i * 4 + 2] * exposure));
+        const glm::vec3 ycxcz = xyz_to_ycxcz(linear_rgb_to_xyz(color));
+
+        channels[0][i] = ycxcz.x;
+        channels[1][i] = ycxcz.y;
+        channels[2][i] = ycxcz.z;
+    }
+
+    for (int c = 0; c < 3; c++)
+    {
+        const ContrastSensitivity& csf = kContrastSensitivity[c];
+
+        // The spatial form of a*exp(-pi^2 * f^2 / b) integrates to a, so the two Gaussians are mixed by their amplitudes.
+        std::vector<float> first;
+        gaussian_blur(channels[c], first, width, height, sqrtf(csf.b1 / (2.0f * kPi * kPi)) * pixels_per_degree);
+
+        if (csf.a2 > 0.0f)
+        {
+            std::vector<float> second;
+            gaussian_blur(channels[c], second, width, height, sqrtf(csf.b2 / (2.0f * kPi * kPi)) * pixels_per_degree);
+
+            const float w1 = csf.a1 / (csf.a1 + csf.a2);
+            const float w2 = csf.a2 / (csf.a1 + csf.a2);
+
+            for (size_t i = 0; i < num_pixels; i++)
+                first[i] = w1 * first[i] + w2 * second[i];
+        }
+
+        channels[c] = std::move(first);
+    }
+
+    std::vector<glm::vec3> lab(num_pixels);
+
+    for (size_t i = 0; i < num_pixels; i++)
+    {
+        const glm::vec3 rgb = glm::clamp(xyz_to_linear_rgb(ycxcz_to_xyz(glm::vec3(channels[0][i], channels[1][i], channels[2][i]))), glm::vec3(0.0f), glm::vec3(1.0f));
+
+        lab[i] = xyz_to_hunt_lab(linear_rgb_to_xyz(rgb));
+    }
+
+    return lab;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+double rmse(const float* test, const float* reference, uint32_t width, uint32_t height)
+{
+    const size_t num_pixels = size_t(width) * size_t(height);
+
+    double sum = 0.0;
+
+    for (size_t i = 0; i < num_pixels; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            const double d = double(test[i * 4 + c]) - double(reference[i * 4 + c]);
+            sum += d * d;
+        }
+    }
+
+    return sqrt(sum / double(num_pixels * 3));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+double rel_mse(const float* test, const float* reference, uint32_t width, uint32_t height, float epsilon)
+{
+    const size_t num_pixels = size_t(width) * size_t(height);
+
+    double sum = 0.0;
+
+    for (size_t i = 0; i < num_pixels; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            const double r = double(reference[i * 4 + c]);
+            const double d = double(test[i * 4 + c]) - r;
+
+            sum += (d * d) / (r * r + double(epsilon));
+        }
+    }
+
+    return sum / double(num_pixels * 3);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+double flip(const float* test, const float* reference, uint32_t width, uint32_t height, float exposure, float pixels_per_degree)
+{
+    const size_t num_pixels = size_t(width) * size_t(height);
+
+    if (num_pixels == 0)
+        return 0.0;
+
+    std::vector<glm::vec3> test_lab      = filtered_lab(test, width, height, exposure, pixels_per_degree);
+    std::vector<glm::vec3> reference_lab = filtered_lab(reference, width, height, exposure, pixels_per_degree);
+
+    // The largest color difference is between pure green and pure blue.
+    const float max_error = powf(hyab(xyz_to_hunt_lab(linear_rgb_to_xyz(glm::vec3(0.0f, 1.0f, 0.0f))), xyz_to_hunt_lab(linear_rgb_to_xyz(glm::vec3(0.0f, 0.0f, 1.0f)))), kHyAbExponent);
+    const float knee      = kErrorPoint * max_error;
+
+    double sum = 0.0;
+
+    for (size_t i = 0; i < num_pixels; i++)
+    {
+        const float error = powf(hyab(test_lab[i], reference_lab[i]), kHyAbExponent);
+
+        // Compress large differences so that the error of a single pixel is bounded by 1.
+        if (error < knee)
+            sum += (kErrorFraction / knee) * error;
+        else
+            sum += kErrorFraction + ((error - knee) / (max_error - knee)) * (1.0f - kErrorFraction);
+    }
+
+    return sum / double(num_pixels);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace image_metrics
+} // namespace helios
@@ -0,0 +1,77 @@
+#include <utility/linear_allocator.h>
+#include <algorithm>
+#include <stdlib.h>
+
+namespace helios
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+LinearAllocator::LinearAllocator(size_t block_size) :
+    m_block_size(block_size)
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+LinearAllocator::~LinearAllocator()
+{
+    for (auto& block : m_blocks)
+        free(block.data);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void* LinearAllocator::allocate(size_t size, size_t alignment)
+{
+    while (m_current_block < m_blocks.size())
+    {
+        Block&          block   = m_blocks[m_current_block];
+        const uintptr_t address = (uintptr_t(block.data) + m_offset + alignment - 1) & ~uintptr_t(alignment - 1);
+        const size_t    offset  = address - uintptr_t(block.data);
+
+        if (offset + size <= block.size)
+        {
+            m_offset = offset + size;
+            return (void*)address;
+        }
+
+        // The rest of the block is left unused until the next reset
+        m_current_block++;
+        m_offset = 0;
+    }
+
+    // malloc() alignment covers every type, larger alignments get room to shift the allocation
+    Block block;
+
+    block.size = std::max(m_block_size, size + alignment);
+    block.data = (uint8_t*)malloc(block.size);
+
+    m_blocks.push_back(block);
+    m_current_block = m_blocks.size() - 1;
+    m_offset        = 0;
+
+    return allocate(size, alignment);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void LinearAllocator::rewind(const Marker& marker)
+{
+    m_current_block = marker.block;
+    m_offset        = marker.offset;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+size_t LinearAllocator::capacity()
+{
+    size_t size = 0;
+
+    for (auto& block : m_blocks)
+        size += block.size;
+
+    return size;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace helios
@@ -1,11 +1,15 @@
 #include <utility/logger.h>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <fstream>
 #include <iostream>
 #include <mutex>
+#include <thread>
 
 #define FILE_STREAM_INDEX 0
 #define CONSOLE_STREAM_INDEX 1
@@ -15,25 +19,96 @@
     "**************************************************************************" \
     "******************************\n"
 
+// Records are fixed-size so that queueing a message is a single copy into a preallocated slot. Longer messages spill to the heap.
+#define RECORD_SIZE 256
+#define RECORD_TEXT_SIZE 208
+#define QUEUE_CAPACITY 4096
+#define FLUSH_INTERVAL_MS 10
+
 namespace helios
 {
 namespace logger
 {
+static const char* kLevelStrings[] = {
+    "INFO   ",
+    "WARNING",
+    "ERROR  ",
+    "FATAL  "
+};
+
+struct Record
+{
+    std::atomic<uint64_t> sequence;
+    int64_t               timestamp;
+    const char*           file;
+    char*                 overflow;
+    uint32_t              line;
+    uint32_t              level;
+    uint32_t              length;
+    char                  text[RECORD_TEXT_SIZE];
+};
+
+static_assert(sizeof(Record) == RECORD_SIZE, "Record size mismatch");
+
 struct LoggerState
 {
-    bool                 _open_streams[3];
-    std::mutex           _log_mutex;
-    std::ofstream        _stream;
-    std::time_t          _rawtime;
-    std::tm*             _timeinfo;
-    int                  _verbosity;
-    char                 _temp_buffer[80];
-    CustomStreamCallback _callback;
-    bool                 _debug;
+    // Bounded MPSC queue: producers claim a slot with a CAS on _enqueue_pos and publish it by bumping its sequence number, the
+    // logger thread is the only consumer.
+    Record                  _records[QUEUE_CAPACITY];
+    std::atomic<uint64_t>   _enqueue_pos;
+    uint64_t                _dequeue_pos;
+    std::atomic<uint64_t>   _written_pos;
+    std::thread             _thread;
+    std::atomic<bool>       _running;
+    bool                    _stop;
+    bool                    _wake_requested;
+    std::mutex              _wake_mutex;
+    std::condition_variable _wake_cv;
+    std::condition_variable _written_cv;
+    std::mutex              _stream_mutex;
+    bool                    _open_streams[3];
+    std::ofstream           _stream;
+    std::time_t             _rawtime;
+    std::time_t             _formatted_time;
+    int                     _verbosity;
+    char                    _temp_buffer[80];
+    std::string             _output;
+    CustomStreamCallback    _callback;
+    bool                    _debug;
+
+    LoggerState()
+    {
+        for (uint64_t i = 0; i < QUEUE_CAPACITY; i++)
+            _records[i].sequence.store(i, std::memory_order_relaxed);
+
+        _enqueue_pos.store(0, std::memory_order_relaxed);
+        _written_pos.store(0, std::memory_order_relaxed);
+        _running.store(false, std::memory_order_relaxed);
+
+        _dequeue_pos    = 0;
+        _stop           = false;
+        _wake_requested = false;
+        _formatted_time = 0;
+        _temp_buffer[0] = '\0';
+        _verbosity      = VERBOSITY_ALL;
+        _callback       = nullptr;
+        _debug          = false;
+
+        for (int i = 0; i < 3; i++)
+            _open_streams[i] = false;
+    }
+
+    ~LoggerState()
+    {
+        shutdown();
+    }
 };
 
 LoggerState g_logger;
 
+static void write_record(const Record& record, const char* text, uint32_t length);
+static void worker();
+
 void initialize()
 {
     for (int i = 0; i < 3; i++)
@@ -42,12 +117,36 @@ void initialize()
     g_logger._callback  = nullptr;
     g_logger._verbosity = VERBOSITY_ALL;
     g_logger._debug     = false;
+
+    if (!g_logger._running.load())
+    {
+        g_logger._stop = false;
+        g_logger._running.store(true);
+        g_logger._thread = std::thread(worker);
+    }
+}
+
+void shutdown()
+{
+    if (!g_logger._running.load())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(g_logger._wake_mutex);
+        g_logger._stop = true;
+    }
+
+    g_logger._wake_cv.notify_one();
+    g_logger._thread.join();
+    g_logger._running.store(false);
 }
 
 void set_verbosity(int flags) { g_logger._verbosity = flags; }
 
 void open_console_stream()
 {
+    std::lock_guard<std::mutex> lock(g_logger._stream_mutex);
+
     g_logger._open_streams[CONSOLE_STREAM_INDEX] = true;
 
     std::time(&g_logger._rawtime);
@@ -58,6 +157,8 @@ void open_console_stream()
 
 void open_file_stream()
 {
+    std::lock_guard<std::mutex> lock(g_logger._stream_mutex);
+
     g_logger._open_streams[FILE_STREAM_INDEX] = true;
     g_logger._stream.open("log.txt", std::ios::app | std::ofstream::out);
 
@@ -69,6 +170,8 @@ void open_file_stream()
 
 void open_custom_stream(CustomStreamCallback callback)
 {
+    std::lock_guard<std::mutex> lock(g_logger._stream_mutex);
+
     g_logger._open_streams[CUSTOM_STREAM_INDEX] = true;
     g_logger._callback                          = callback;
 
@@ -88,6 +191,11 @@ void open_custom_stream(CustomStreamCallback callback)
 
 void close_console_stream()
 {
+    // Write out anything still queued before the stream goes away.
+    flush();
+
+    std::lock_guard<std::mutex> lock(g_logger._stream_mutex);
+
     g_logger._open_streams[CONSOLE_STREAM_INDEX] = false;
 
     std::time(&g_logger._rawtime);
@@ -98,6 +206,10 @@ void close_console_stream()
 
 void close_file_stream()
 {
+    flush();
+
+    std::lock_guard<std::mutex> lock(g_logger._stream_mutex);
+
     g_logger._open_streams[FILE_STREAM_INDEX] = false;
 
     std::time(&g_logger._rawtime);
@@ -110,6 +222,10 @@ void close_file_stream()
 
 void close_custom_stream()
 {
+    flush();
+
+    std::lock_guard<std::mutex> lock(g_logger._stream_mutex);
+
     g_logger._open_streams[CUSTOM_STREAM_INDEX] = false;
 
     std::time(&g_logger._rawtime);
@@ -130,71 +246,157 @@ void enable_debug_mode() { g_logger._debug = true; }
 
 void disable_debug_mode() { g_logger._debug = false; }
 
-void log(std::string text, std::string file, int line, LogLevel level)
+static void wake_worker()
 {
-    std::lock_guard<std::mutex> lock(g_logger._log_mutex);
+    {
+        std::lock_guard<std::mutex> lock(g_logger._wake_mutex);
+        g_logger._wake_requested = true;
+    }
 
-    std::string file_with_extension = file.substr(file.find_last_of("/\\") + 1);
-    std::time(&g_logger._rawtime);
-    g_logger._timeinfo = std::localtime(&g_logger._rawtime);
-    std::strftime(g_logger._temp_buffer, 80, "%H:%M:%S", g_logger._timeinfo);
+    g_logger._wake_cv.notify_one();
+}
 
-    std::string log_level_string;
+static void push(const char* text, size_t length, const char* file, int line, LogLevel level)
+{
+    const int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 
-    switch (level)
+    // Without the logger thread (before initialize() or after shutdown()) messages are written straight away.
+    if (!g_logger._running.load(std::memory_order_acquire))
     {
-        case LEVEL_INFO:
-        {
-            log_level_string = "INFO   ";
-            break;
-        }
-        case LEVEL_WARNING:
-        {
-            log_level_string = "WARNING";
-            break;
-        }
-        case LEVEL_ERR:
+        Record record;
+
+        record.timestamp = timestamp;
+        record.file      = file;
+        record.line      = line;
+        record.level     = level;
+
+        std::lock_guard<std::mutex> lock(g_logger._stream_mutex);
+        write_record(record, text, (uint32_t)length);
+
+        if ((level == LEVEL_ERR || level == LEVEL_FATAL || g_logger._debug) && g_logger._open_streams[FILE_STREAM_INDEX])
+            g_logger._stream.flush();
+
+        return;
+    }
+
+    uint64_t pos = g_logger._enqueue_pos.load(std::memory_order_relaxed);
+    Record*  record;
+
+    for (;;)
+    {
+        record = &g_logger._records[pos % QUEUE_CAPACITY];
+
+        const uint64_t sequence = record->sequence.load(std::memory_order_acquire);
+        const int64_t  diff     = int64_t(sequence) - int64_t(pos);
+
+        if (diff == 0)
         {
-            log_level_string = "ERROR  ";
-            break;
+            if (g_logger._enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
         }
-        case LEVEL_FATAL:
+        else if (diff < 0)
         {
-            log_level_string = "FATAL  ";
-            break;
+            // The queue is full, so wait for the logger thread to catch up rather than drop the message.
+            wake_worker();
+            std::this_thread::yield();
+            pos = g_logger._enqueue_pos.load(std::memory_order_relaxed);
         }
+        else
+            pos = g_logger._enqueue_pos.load(std::memory_order_relaxed);
+    }
+
+    record->timestamp = timestamp;
+    record->file      = file;
+    record->line      = line;
+    record->level     = level;
+    record->length    = (uint32_t)length;
+
+    if (length <= RECORD_TEXT_SIZE)
+    {
+        memcpy(record->text, text, length);
+        record->overflow = nullptr;
+    }
+    else
+    {
+        record->overflow = new char[length];
+        memcpy(record->overflow, text, length);
     }
 
-    std::string output;
+    record->sequence.store(pos + 1, std::memory_order_release);
+
+    if (level == LEVEL_FATAL || g_logger._debug)
+        flush();
+    else if (level == LEVEL_ERR)
+        wake_worker();
+}
+
+void log(const std::string& text, const char* file, int line, LogLevel level)
+{
+    push(text.c_str(), text.length(), file, line, level);
+}
+
+void log(const char* text, const char* file, int line, LogLevel level)
+{
+    push(text, strlen(text), file, line, level);
+}
+
+// Expects the stream mutex to be held.
+static void write_record(const Record& record, const char* text, uint32_t length)
+{
+    std::string& output = g_logger._output;
+
+    output.clear();
 
     if ((g_logger._verbosity & VERBOSITY_TIMESTAMP) || (g_logger._verbosity & VERBOSITY_LEVEL))
     {
         output = "[ ";
 
         if (g_logger._verbosity & VERBOSITY_TIMESTAMP)
+        {
+            std::time_t time = std::time_t(record.timestamp / 1000000000);
+
+            // Only reformat when the second changes.
+            if (time != g_logger._formatted_time)
+            {
+                std::strftime(g_logger._temp_buffer, 80, "%H:%M:%S", std::localtime(&time));
+                g_logger._formatted_time = time;
+            }
+
             output += g_logger._temp_buffer;
+        }
 
         if ((g_logger._verbosity & VERBOSITY_TIMESTAMP) && (g_logger._verbosity & VERBOSITY_LEVEL))
             output += " | ";
 
         if (g_logger._verbosity & VERBOSITY_LEVEL)
-            output += log_level_string;
+            output += kLevelStrings[record.level];
 
         output += " ] : ";
     }
 
-    output += text;
+    output.append(text, length);
 
-    if (g_logger._verbosity & VERBOSITY_FILE)
+    if (record.file)
     {
-        output += " , FILE : ";
-        output += file_with_extension;
-    }
+        if (g_logger._verbosity & VERBOSITY_FILE)
+        {
+            const char* file_with_extension = record.file;
 
-    if (g_logger._verbosity & VERBOSITY_LINE)
-    {
-        output += " , LINE : ";
-        output += std::to_string(line);
+            for (const char* c = record.file; *c; c++)
+            {
+                if (*c == '/' || *c == '\\')
+                    file_with_extension = c + 1;
+            }
+
+            output += " , FILE : ";
+            output += file_with_extension;
+        }
+
+        if (g_logger._verbosity & VERBOSITY_LINE)
+        {
+            output += " , LINE : ";
+            output += std::to_string(record.line);
+        }
     }
 
     if (g_logger._open_streams[FILE_STREAM_INDEX])
@@ -209,82 +411,86 @@ void log(std::string text, std::string file, int line, LogLevel level)
 
     if (g_logger._open_streams[CUSTOM_STREAM_INDEX] && g_logger._callback)
     {
-        g_logger._callback(output, level);
+        g_logger._callback(output, (LogLevel)record.level);
     }
-
-    // Flush stream if error
-    if (level == LEVEL_ERR || level == LEVEL_FATAL || g_logger._debug)
-        flush();
 }
 
-void log_simple(std::string text, LogLevel level)
+// Writes out every published record and returns the number of records written.
+static size_t drain()
 {
-    std::lock_guard<std::mutex> lock(g_logger._log_mutex);
+    size_t count = 0;
 
-    std::time(&g_logger._rawtime);
-    g_logger._timeinfo = std::localtime(&g_logger._rawtime);
-    std::strftime(g_logger._temp_buffer, 80, "%H:%M:%S", g_logger._timeinfo);
-
-    std::string log_level_string;
+    std::lock_guard<std::mutex> lock(g_logger._stream_mutex);
 
-    switch (level)
+    for (;;)
     {
-        case LEVEL_INFO:
-        {
-            log_level_string = "INFO   ";
-            break;
-        }
-        case LEVEL_WARNING:
-        {
-            log_level_string = "WARNING";
-            break;
-        }
-        case LEVEL_ERR:
-        {
-            log_level_string = "ERROR  ";
+        Record& record = g_logger._records[g_logger._dequeue_pos % QUEUE_CAPACITY];
+
+        if (record.sequence.load(std::memory_order_acquire) != g_logger._dequeue_pos + 1)
             break;
-        }
-        case LEVEL_FATAL:
+
+        if (record.overflow)
         {
-            log_level_string = "FATAL  ";
-            break;
+            write_record(record, record.overflow, record.length);
+            delete[] record.overflow;
         }
+        else
+            write_record(record, record.text, record.length);
+
+        record.sequence.store(g_logger._dequeue_pos + QUEUE_CAPACITY, std::memory_order_release);
+
+        g_logger._dequeue_pos++;
+        count++;
     }
 
-    std::string output;
+    if (count > 0)
+    {
+        if (g_logger._open_streams[FILE_STREAM_INDEX])
+            g_logger._stream.flush();
 
-    if ((g_logger._verbosity & VERBOSITY_TIMESTAMP) || (g_logger._verbosity & VERBOSITY_LEVEL))
+        if (g_logger._open_streams[CONSOLE_STREAM_INDEX])
+            std::cout.flush();
+    }
+
+    return count;
+}
+
+static void worker()
+{
+    for (;;)
     {
-        output = "[ ";
+        drain();
 
-        if (g_logger._verbosity & VERBOSITY_TIMESTAMP)
-            output += g_logger._temp_buffer;
+        {
+            std::lock_guard<std::mutex> lock(g_logger._wake_mutex);
+            g_logger._written_pos.store(g_logger._dequeue_pos, std::memory_order_release);
+        }
 
-        if ((g_logger._verbosity & VERBOSITY_TIMESTAMP) && (g_logger._verbosity & VERBOSITY_LEVEL))
-            output += " | ";
+        g_logger._written_cv.notify_all();
 
-        if (g_logger._verbosity & VERBOSITY_LEVEL)
-            output += log_level_string;
+        std::unique_lock<std::mutex> lock(g_logger._wake_mutex);
 
-        output += " ] : ";
+        if (g_logger._stop)
+            break;
+
+        g_logger._wake_cv.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS), []() { return g_logger._wake_requested || g_logger._stop; });
+        g_logger._wake_requested = false;
     }
 
-    output += text;
+    // Producers may still have published records after the last drain.
+    drain();
 
-    if (g_logger._open_streams[FILE_STREAM_INDEX])
     {
-        g_logger._stream << output << "\n";
+        std::lock_guard<std::mutex> lock(g_logger._wake_mutex);
+        g_logger._written_pos.store(g_logger._dequeue_pos, std::memory_order_release);
     }
 
-    if (g_logger._open_streams[CONSOLE_STREAM_INDEX])
-    {
-        std::cout << output << "\n";
-    }
+    g_logger._written_cv.notify_all();
+}
 
-    if (g_logger._open_streams[CUSTOM_STREAM_INDEX] && g_logger._callback)
-    {
-        g_logger._callback(output, level);
-    }
+static void log_simple(std::string text, LogLevel level)
+{
+    push(text.c_str(), text.length(), nullptr, 0, level);
 }
 
 void log_info(std::string text) { log_simple(text, LEVEL_INFO); }
@@ -297,10 +503,24 @@ void log_fatal(std::string text) { log_simple(text, LEVEL_FATAL); }
 
 void flush()
 {
-    if (g_logger._open_streams[FILE_STREAM_INDEX])
+    if (!g_logger._running.load(std::memory_order_acquire) || std::this_thread::get_id() == g_logger._thread.get_id())
     {
-        g_logger._stream.flush();
+        std::lock_guard<std::mutex> lock(g_logger._stream_mutex);
+
+        if (g_logger._open_streams[FILE_STREAM_INDEX])
+            g_logger._stream.flush();
+
+        return;
     }
+
+    const uint64_t target = g_logger._enqueue_pos.load(std::memory_order_acquire);
+
+    std::unique_lock<std::mutex> lock(g_logger._wake_mutex);
+
+    g_logger._wake_requested = true;
+    g_logger._wake_cv.notify_one();
+
+    g_logger._written_cv.wait(lock, [target]() { return g_logger._written_pos.load(std::memory_order_acquire) >= target || g_logger._stop; });
 }
 } // namespace logger
 } // namespace helios
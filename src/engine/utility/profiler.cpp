@@ -1,12 +1,22 @@
 #include <imgui.h>
-#include <Windows.h>
 #include <utility/macros.h>
 #include <utility/profiler.h>
-#include <stack>
+#include <utility/logger.h>
+#include <utility/utility.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
 #include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <stdio.h>
+#include <string.h>
 
-#define BUFFER_COUNT 3
-#define MAX_SAMPLES 100
+#define BUFFER_COUNT vk::Backend::kMaxFramesInFlight
+#define MAX_GPU_SAMPLES 128
+#define MAX_SAMPLE_DEPTH 64
+#define RING_CAPACITY 65536
+#define GPU_TRACK_ID 0
 
 namespace helios
 {
@@ -14,54 +24,151 @@ namespace profiler
 {
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+static const char* kCaptureModeNames[] = {
+    "Off",
+    "Live",
+    "Ring Buffer",
+    "Full"
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::atomic<bool> g_sampling_enabled(true);
+
+static uint32_t                        g_generation = 0;
+static std::mutex                      g_intern_mutex;
+static std::unordered_set<std::string> g_interned_names;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 struct Profiler
 {
-    struct Sample
+    struct Event
     {
-        std::string name;
-        uint32_t    query_index;
-        bool        start = true;
-        double      cpu_time;
-        Sample*     end_sample;
+        const char* name;
+        int64_t     start;
+        int64_t     end;
     };
 
-    struct Buffer
+    // Events recorded by a single thread (or the GPU). Only the owning thread writes to it, the lock is there for export.
+    struct Track
     {
-        std::vector<std::unique_ptr<Sample>> samples;
-        int32_t                              index = 0;
-        vk::QueryPool::Ptr                   query_pool;
-        uint32_t                             query_index = 0;
+        std::string        name;
+        uint32_t           id;
+        std::mutex         mutex;
+        std::vector<Event> events;
+        size_t             next = 0;
+
+        void push(const Event& event, CaptureMode mode)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (mode == CAPTURE_RING && events.size() == RING_CAPACITY)
+            {
+                events[next] = event;
+                next         = (next + 1) % RING_CAPACITY;
+            }
+            else
+                events.push_back(event);
+        }
 
-        Buffer()
+        void clear()
         {
-            samples.resize(MAX_SAMPLES);
+            std::lock_guard<std::mutex> lock(mutex);
 
-            for (uint32_t i = 0; i < MAX_SAMPLES; i++)
-                samples[i] = nullptr;
+            events.clear();
+            next = 0;
         }
     };
 
+    struct OpenSample
+    {
+        const char* name;
+        int64_t     start;
+        int32_t     frame_sample;
+        uint64_t    frame;
+    };
+
+    struct ThreadState
+    {
+        Track*     track      = nullptr;
+        uint32_t   generation = 0;
+        uint32_t   depth      = 0;
+        OpenSample stack[MAX_SAMPLE_DEPTH];
+    };
+
+    // Samples taken on the main thread while a frame is being recorded, these also get GPU timestamps.
+    struct FrameSample
+    {
+        const char* name;
+        uint32_t    depth;
+        int64_t     cpu_start;
+        int64_t     cpu_end;
+        uint32_t    query_index;
+        bool        closed;
+    };
+
+    struct FrameBuffer
+    {
+        std::vector<FrameSample> samples;
+        vk::QueryPool::Ptr       query_pool;
+        uint32_t                 query_count = 0;
+        bool                     reset       = false;
+        bool                     pending     = false;
+    };
+
+    struct CounterEvent
+    {
+        const char* name;
+        int64_t     time;
+        double      value;
+    };
+
+    struct ResolvedSample
+    {
+        const char* name;
+        uint32_t    depth;
+        float       cpu_time;
+        float       gpu_time;
+        bool        has_gpu_time;
+    };
+
+    static thread_local ThreadState t_thread_state;
+
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    Profiler(vk::Backend::Ptr backend)
+    Profiler(vk::Backend::Ptr backend) :
+        m_backend(backend)
     {
-#ifdef WIN32
-        QueryPerformanceFrequency(&m_frequency);
-#endif
+        g_generation++;
+
+        m_epoch       = now_ns();
+        m_main_thread = std::this_thread::get_id();
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(backend->physical_device(), &properties);
+
+        m_timestamp_period = properties.limits.timestampPeriod;
 
         for (int i = 0; i < BUFFER_COUNT; i++)
-            m_sample_buffers[i].query_pool = vk::QueryPool::create(backend, VK_QUERY_TYPE_TIMESTAMP, MAX_SAMPLES);
+        {
+            m_frame_buffers[i].query_pool = vk::QueryPool::create(backend, VK_QUERY_TYPE_TIMESTAMP, MAX_GPU_SAMPLES * 2);
+            m_frame_buffers[i].samples.reserve(MAX_GPU_SAMPLES);
+        }
 
-        m_should_reset = true;
-        m_read_buffer_idx++;
-        m_write_buffer_idx++;
-        m_cmd_buf = nullptr;
+        m_gpu_track.name = "GPU (Graphics Queue)";
+        m_gpu_track.id   = GPU_TRACK_ID;
 
-        if (m_read_buffer_idx == BUFFER_COUNT)
-            m_read_buffer_idx = 0;
+        m_timestamps.resize(MAX_GPU_SAMPLES * 2);
 
-        if (m_write_buffer_idx == BUFFER_COUNT)
-            m_write_buffer_idx = 0;
+        calibrate();
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
@@ -69,86 +176,309 @@ struct Profiler
     ~Profiler()
     {
         for (int i = 0; i < BUFFER_COUNT; i++)
-            m_sample_buffers[i].query_pool.reset();
+            m_frame_buffers[i].query_pool.reset();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Measures the offset between the GPU timestamp counter and steady_clock. The queue is drained first so that the timestamp is
+    // written as soon as the command buffer is submitted, which bounds the error by half of the submit round trip.
+    void calibrate()
+    {
+        auto backend = m_backend.lock();
+
+        backend->wait_idle();
+
+        vk::CommandPool::Ptr   cmd_pool   = vk::CommandPool::create(backend, backend->queue_infos().graphics_queue_index);
+        vk::CommandBuffer::Ptr cmd_buf    = vk::CommandBuffer::create(backend, cmd_pool);
+        vk::QueryPool::Ptr     query_pool = vk::QueryPool::create(backend, VK_QUERY_TYPE_TIMESTAMP, 1);
+        vk::Fence::Ptr         fence      = vk::Fence::create(backend);
+
+        VkCommandBufferBeginInfo begin_info;
+        HELIOS_ZERO_MEMORY(begin_info);
+
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(cmd_buf->handle(), &begin_info);
+
+        vkCmdResetQueryPool(cmd_buf->handle(), query_pool->handle(), 0, 1);
+        vkCmdWriteTimestamp(cmd_buf->handle(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool->handle(), 0);
+
+        vkEndCommandBuffer(cmd_buf->handle());
+
+        VkSubmitInfo submit_info;
+        HELIOS_ZERO_MEMORY(submit_info);
+
+        submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers    = &cmd_buf->handle();
+
+        vkResetFences(backend->device(), 1, &fence->handle());
+
+        int64_t cpu_before = now_ns();
+
+        vkQueueSubmit(backend->graphics_queue(), 1, &submit_info, fence->handle());
+        vkWaitForFences(backend->device(), 1, &fence->handle(), VK_TRUE, UINT64_MAX);
+
+        int64_t cpu_after = now_ns();
+
+        uint64_t gpu_time = 0;
+
+        if (!query_pool->results(0, 1, sizeof(uint64_t), &gpu_time, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT))
+        {
+            HELIOS_LOG_WARNING("Failed to calibrate GPU timestamps, GPU samples will not line up with the CPU timeline.");
+            return;
+        }
+
+        m_calibration_cpu = (cpu_before + cpu_after) / 2;
+        m_calibration_gpu = gpu_time;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    inline int64_t gpu_to_cpu(uint64_t gpu_time)
+    {
+        return m_calibration_cpu + int64_t(double(int64_t(gpu_time - m_calibration_gpu)) * m_timestamp_period);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    inline bool is_capturing()
+    {
+        const CaptureMode mode = (CaptureMode)m_mode.load(std::memory_order_relaxed);
+        return mode == CAPTURE_RING || mode == CAPTURE_FULL;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void begin_sample(std::string name)
+    ThreadState& thread_state()
     {
-        if (m_should_reset)
+        ThreadState& state = t_thread_state;
+
+        // Threads keep their state across a shutdown/initialize cycle, so anything from a previous profiler is discarded here.
+        if (state.generation != g_generation)
         {
-            m_sample_buffers[m_write_buffer_idx].query_index = 0;
-            vkCmdResetQueryPool(m_cmd_buf->handle(), m_sample_buffers[m_write_buffer_idx].query_pool->handle(), 0, MAX_SAMPLES);
-            m_should_reset = false;
+            std::lock_guard<std::mutex> lock(m_tracks_mutex);
+
+            std::unique_ptr<Track> track = std::make_unique<Track>();
+
+            track->id   = uint32_t(m_tracks.size()) + 1;
+            track->name = "Thread " + std::to_string(track->id);
+
+            state.track      = track.get();
+            state.generation = g_generation;
+            state.depth      = 0;
+
+            m_tracks.push_back(std::move(track));
         }
 
-        int32_t idx = m_sample_buffers[m_write_buffer_idx].index++;
+        return state;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void begin_sample(const char* name)
+    {
+        ThreadState& state = thread_state();
 
-        if (!m_sample_buffers[m_write_buffer_idx].samples[idx])
-            m_sample_buffers[m_write_buffer_idx].samples[idx] = std::make_unique<Sample>();
+        if (state.depth < MAX_SAMPLE_DEPTH)
+        {
+            OpenSample& sample = state.stack[state.depth];
 
-        auto& sample = m_sample_buffers[m_write_buffer_idx].samples[idx];
+            sample.name         = name;
+            sample.frame_sample = -1;
+            sample.frame        = 0;
 
-        sample->name        = name;
-        sample->query_index = m_sample_buffers[m_write_buffer_idx].query_index++;
-        vkCmdWriteTimestamp(m_cmd_buf->handle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_sample_buffers[m_write_buffer_idx].query_pool->handle(), sample->query_index);
+            // The frame state is owned by the main thread, other threads must not read it.
+            if (std::this_thread::get_id() == m_main_thread)
+            {
+                sample.frame = m_frame_number;
 
-        sample->end_sample = nullptr;
-        sample->start      = true;
+                if (m_cmd_buf)
+                    sample.frame_sample = begin_frame_sample(name, state.depth);
+            }
 
-#ifdef WIN32
-        LARGE_INTEGER cpu_time;
-        QueryPerformanceCounter(&cpu_time);
-        sample->cpu_time = cpu_time.QuadPart * (1000000.0 / m_frequency.QuadPart);
-#else
-        timeval cpu_time;
-        gettimeofday(&cpu_time, nullptr);
-        sample->cpu_time = (cpu_time.tv_sec * 1000000.0) + cpu_time.tv_usec;
-#endif
+            sample.start = now_ns();
+        }
 
-        m_sample_stack.push(sample.get());
+        state.depth++;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void end_sample(std::string name)
+    void end_sample(const char* name)
     {
-        int32_t idx = m_sample_buffers[m_write_buffer_idx].index++;
+        ThreadState& state = thread_state();
+
+        if (state.depth == 0)
+            return;
+
+        state.depth--;
 
-        if (!m_sample_buffers[m_write_buffer_idx].samples[idx])
-            m_sample_buffers[m_write_buffer_idx].samples[idx] = std::make_unique<Sample>();
+        if (state.depth >= MAX_SAMPLE_DEPTH)
+            return;
 
-        auto& sample = m_sample_buffers[m_write_buffer_idx].samples[idx];
+        const int64_t     end    = now_ns();
+        const OpenSample& sample = state.stack[state.depth];
 
-        sample->name        = name;
-        sample->start       = false;
-        sample->query_index = m_sample_buffers[m_write_buffer_idx].query_index++;
-        vkCmdWriteTimestamp(m_cmd_buf->handle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_sample_buffers[m_write_buffer_idx].query_pool->handle(), sample->query_index);
+        // Samples that were left open at the end of their frame have already been closed by end_frame(). Only samples of the main thread
+        // have a frame sample, so other threads never get to read the frame state.
+        if (sample.frame_sample >= 0 && sample.frame == m_frame_number && m_cmd_buf)
+            end_frame_sample(sample.frame_sample, sample.start, end);
+
+        if (is_capturing())
+            state.track->push({ sample.name, sample.start, end }, (CaptureMode)m_mode.load(std::memory_order_relaxed));
+    }
 
-        sample->end_sample = nullptr;
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    int32_t begin_frame_sample(const char* name, uint32_t depth)
+    {
+        FrameBuffer& buffer = m_frame_buffers[m_frame_idx];
+
+        if (!buffer.reset)
+        {
+            vkCmdResetQueryPool(m_cmd_buf->handle(), buffer.query_pool->handle(), 0, MAX_GPU_SAMPLES * 2);
+            buffer.reset = true;
+        }
+
+        FrameSample sample;
+
+        sample.name        = name;
+        sample.depth       = depth;
+        sample.cpu_start   = 0;
+        sample.cpu_end     = 0;
+        sample.query_index = UINT32_MAX;
+        sample.closed      = false;
+
+        if (buffer.query_count < MAX_GPU_SAMPLES * 2)
+        {
+            sample.query_index = buffer.query_count;
+            buffer.query_count += 2;
+
+            vkCmdWriteTimestamp(m_cmd_buf->handle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, buffer.query_pool->handle(), sample.query_index);
+        }
+
+        buffer.samples.push_back(sample);
+
+        return int32_t(buffer.samples.size()) - 1;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void end_frame_sample(int32_t idx, int64_t start, int64_t end)
+    {
+        FrameBuffer& buffer = m_frame_buffers[m_frame_idx];
 
-#ifdef WIN32
-        LARGE_INTEGER cpu_time;
-        QueryPerformanceCounter(&cpu_time);
-        sample->cpu_time = cpu_time.QuadPart * (1000000.0 / m_frequency.QuadPart);
-#else
-        timeval cpu_time;
-        gettimeofday(&cpu_time, nullptr);
-        sample->cpu_time = (cpu_time.tv_sec * 1000000.0) + cpu_time.tv_usec;
-#endif
+        FrameSample& sample = buffer.samples[idx];
 
-        Sample* start = m_sample_stack.top();
+        sample.cpu_start = start;
+        sample.cpu_end   = end;
+        sample.closed    = true;
 
-        start->end_sample = sample.get();
+        if (sample.query_index != UINT32_MAX)
+            vkCmdWriteTimestamp(m_cmd_buf->handle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, buffer.query_pool->handle(), sample.query_index + 1);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void resolve(FrameBuffer& buffer)
+    {
+        if (buffer.query_count > 0)
+            buffer.query_pool->results(0, buffer.query_count, sizeof(uint64_t) * buffer.query_count, m_timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+        const bool capturing = is_capturing();
+
+        m_resolved.clear();
+
+        for (auto& sample : buffer.samples)
+        {
+            ResolvedSample resolved;
+
+            resolved.name         = sample.name;
+            resolved.depth        = sample.depth;
+            resolved.cpu_time     = float(double(sample.cpu_end - sample.cpu_start) * 1e-6);
+            resolved.gpu_time     = 0.0f;
+            resolved.has_gpu_time = sample.query_index != UINT32_MAX;
+
+            if (resolved.has_gpu_time)
+            {
+                const int64_t gpu_start = gpu_to_cpu(m_timestamps[sample.query_index]);
+                const int64_t gpu_end   = gpu_to_cpu(m_timestamps[sample.query_index + 1]);
+
+                resolved.gpu_time = float(double(gpu_end - gpu_start) * 1e-6);
+
+                if (capturing)
+                    m_gpu_track.push({ sample.name, gpu_start, gpu_end }, (CaptureMode)m_mode.load(std::memory_order_relaxed));
+            }
+
+            m_resolved.push_back(resolved);
+            m_latest[sample.name] = resolved;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void apply_capture_mode()
+    {
+        const CaptureMode previous = (CaptureMode)m_mode.load(std::memory_order_relaxed);
+
+        if (previous == m_requested_mode)
+            return;
+
+        if (m_requested_mode == CAPTURE_RING || m_requested_mode == CAPTURE_FULL)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_tracks_mutex);
+
+                for (auto& track : m_tracks)
+                    track->clear();
+            }
+
+            m_gpu_track.clear();
+
+            {
+                std::lock_guard<std::mutex> lock(m_counter_mutex);
+
+                m_counter_events.clear();
+                m_counter_next = 0;
+            }
+
+            // Re-anchor the GPU clock at the start of every capture since the two clocks drift apart over long sessions.
+            calibrate();
+        }
+
+        if (m_requested_mode == CAPTURE_OFF)
+        {
+            m_resolved.clear();
+            m_counters.clear();
+        }
 
-        m_sample_stack.pop();
+        m_mode.store(m_requested_mode, std::memory_order_relaxed);
+        g_sampling_enabled.store(m_requested_mode != CAPTURE_OFF, std::memory_order_relaxed);
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
     void begin_frame(vk::CommandBuffer::Ptr cmd_buf)
     {
+        apply_capture_mode();
+
+        // The backend has already waited on the fence of this frame, so the queries written the last time it was used are available.
+        m_frame_idx = m_backend.lock()->current_frame_idx();
+        m_frame_number++;
+
+        FrameBuffer& buffer = m_frame_buffers[m_frame_idx];
+
+        if (buffer.pending)
+            resolve(buffer);
+
+        buffer.samples.clear();
+        buffer.query_count = 0;
+        buffer.reset       = false;
+        buffer.pending     = false;
+
         m_cmd_buf = cmd_buf;
     }
 
@@ -156,146 +486,370 @@ struct Profiler
 
     void end_frame()
     {
-        if (m_read_buffer_idx >= 0)
-            m_sample_buffers[m_read_buffer_idx].index = 0;
+        FrameBuffer& buffer = m_frame_buffers[m_frame_idx];
 
-        m_should_reset = true;
-        m_read_buffer_idx++;
-        m_write_buffer_idx++;
-        m_cmd_buf = nullptr;
+        // Close anything left open so that every query that was started also gets its end timestamp.
+        const int64_t now = now_ns();
 
-        if (m_read_buffer_idx == BUFFER_COUNT)
-            m_read_buffer_idx = 0;
+        for (int32_t i = 0; i < buffer.samples.size(); i++)
+        {
+            if (!buffer.samples[i].closed)
+                end_frame_sample(i, buffer.samples[i].cpu_start, now);
+        }
 
-        if (m_write_buffer_idx == BUFFER_COUNT)
-            m_write_buffer_idx = 0;
+        buffer.pending = buffer.samples.size() > 0;
+
+        m_cmd_buf = nullptr;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
     void ui()
     {
-        if (m_read_buffer_idx >= 0)
+        int32_t mode = m_requested_mode;
+
+        if (ImGui::BeginCombo("Capture", kCaptureModeNames[mode]))
         {
-            for (int32_t i = 0; i < m_sample_buffers[m_read_buffer_idx].index; i++)
+            for (int32_t i = 0; i < IM_ARRAYSIZE(kCaptureModeNames); i++)
             {
-                auto& sample = m_sample_buffers[m_read_buffer_idx].samples[i];
-
-                if (sample->start)
-                {
-                    if (!m_should_pop_stack.empty())
-                    {
-                        if (!m_should_pop_stack.top())
-                        {
-                            m_should_pop_stack.push(false);
-                            continue;
-                        }
-                    }
-
-                    std::string id = std::to_string(i);
-
-                    uint64_t start_time = 0;
-                    uint64_t end_time   = 0;
-
-                    m_sample_buffers[m_read_buffer_idx].query_pool->results(sample->query_index, 1, sizeof(uint64_t), &start_time, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
-                    m_sample_buffers[m_read_buffer_idx].query_pool->results(sample->end_sample->query_index, 1, sizeof(uint64_t), &end_time, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
-
-                    uint64_t gpu_time_diff = end_time - start_time;
-
-                    float gpu_time = float(gpu_time_diff / 1000000.0);
-                    float cpu_time = (sample->end_sample->cpu_time - sample->cpu_time) * 0.001f;
-
-                    if (ImGui::TreeNode(id.c_str(), "%s | %f ms (CPU) | %f ms (GPU)", sample->name.c_str(), cpu_time, gpu_time))
-                        m_should_pop_stack.push(true);
-                    else
-                        m_should_pop_stack.push(false);
-                }
-                else
-                {
-                    if (!m_should_pop_stack.empty())
-                    {
-                        bool should_pop = m_should_pop_stack.top();
-                        m_should_pop_stack.pop();
-
-                        if (should_pop)
-                            ImGui::TreePop();
-                    }
-                }
+                const bool is_selected = (i == mode);
+
+                if (ImGui::Selectable(kCaptureModeNames[i], is_selected))
+                    m_requested_mode = (CaptureMode)i;
+
+                if (is_selected)
+                    ImGui::SetItemDefaultFocus();
             }
+            ImGui::EndCombo();
+        }
+
+        if (is_capturing())
+            ImGui::Text("Captured Events: %u", (uint32_t)event_count());
+
+        ImGui::Spacing();
+
+        // Samples are stored in the order they were started, so a sample is a child of the closest preceding one with a smaller depth.
+        uint32_t open_depth = 0;
+
+        for (int32_t i = 0; i < m_resolved.size(); i++)
+        {
+            const ResolvedSample& sample = m_resolved[i];
+
+            if (sample.depth > open_depth)
+                continue;
+
+            for (; open_depth > sample.depth; open_depth--)
+                ImGui::TreePop();
+
+            std::string id = std::to_string(i);
+
+            bool is_open = false;
+
+            if (sample.has_gpu_time)
+                is_open = ImGui::TreeNode(id.c_str(), "%s | %f ms (CPU) | %f ms (GPU)", sample.name, sample.cpu_time, sample.gpu_time);
+            else
+                is_open = ImGui::TreeNode(id.c_str(), "%s | %f ms (CPU)", sample.name, sample.cpu_time);
+
+            if (is_open)
+                open_depth = sample.depth + 1;
+        }
+
+        for (; open_depth > 0; open_depth--)
+            ImGui::TreePop();
+
+        if (m_counters.size() > 0)
+        {
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            for (auto& counter : m_counters)
+                ImGui::Text("%s: %.3f", counter.name, counter.value);
         }
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    int32_t                m_read_buffer_idx  = -BUFFER_COUNT;
-    int32_t                m_write_buffer_idx = -1;
-    Buffer                 m_sample_buffers[BUFFER_COUNT];
-    std::stack<Sample*>    m_sample_stack;
-    std::stack<bool>       m_should_pop_stack;
-    vk::CommandBuffer::Ptr m_cmd_buf      = nullptr;
-    bool                   m_should_reset = true;
-#ifdef WIN32
-    LARGE_INTEGER m_frequency;
-#endif
+    void set_counter(const char* name, double value)
+    {
+        const int64_t time = now_ns();
+
+        bool found = false;
+
+        for (auto& counter : m_counters)
+        {
+            if (strcmp(counter.name, name) == 0)
+            {
+                counter.time  = time;
+                counter.value = value;
+                found         = true;
+                break;
+            }
+        }
+
+        if (!found)
+            m_counters.push_back({ name, time, value });
+
+        if (is_capturing())
+        {
+            std::lock_guard<std::mutex> lock(m_counter_mutex);
+
+            if (m_mode.load(std::memory_order_relaxed) == CAPTURE_RING && m_counter_events.size() == RING_CAPACITY)
+            {
+                m_counter_events[m_counter_next] = { name, time, value };
+                m_counter_next                   = (m_counter_next + 1) % RING_CAPACITY;
+            }
+            else
+                m_counter_events.push_back({ name, time, value });
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    size_t event_count()
+    {
+        size_t count = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(m_tracks_mutex);
+
+            for (auto& track : m_tracks)
+            {
+                std::lock_guard<std::mutex> track_lock(track->mutex);
+                count += track->events.size();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_counter_mutex);
+            count += m_counter_events.size();
+        }
+
+        std::lock_guard<std::mutex> lock(m_gpu_track.mutex);
+
+        return count + m_gpu_track.events.size();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void write_track(FILE* f, Track& track, bool& first)
+    {
+        std::lock_guard<std::mutex> lock(track.mutex);
+
+        fprintf(f, "%s\n{\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", first ? "" : ",", track.id);
+        utility::write_json_string(f, track.name.c_str());
+        fprintf(f, "}}");
+
+        first = false;
+
+        for (auto& event : track.events)
+        {
+            fprintf(f, ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":", track.id, double(event.start - m_epoch) * 1e-3, double(event.end - event.start) * 1e-3);
+            utility::write_json_string(f, event.name);
+            fprintf(f, "}");
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool export_trace(const std::string& path)
+    {
+        FILE* f = fopen(path.c_str(), "w");
+
+        if (!f)
+        {
+            HELIOS_LOG_ERROR("Failed to open trace for writing: " + path);
+            return false;
+        }
+
+        bool first = true;
+
+        fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+        write_track(f, m_gpu_track, first);
+
+        {
+            std::lock_guard<std::mutex> lock(m_tracks_mutex);
+
+            for (auto& track : m_tracks)
+                write_track(f, *track, first);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_counter_mutex);
+
+            for (auto& event : m_counter_events)
+            {
+                fprintf(f, ",\n{\"ph\":\"C\",\"pid\":0,\"ts\":%.3f,\"name\":", double(event.time - m_epoch) * 1e-3);
+                utility::write_json_string(f, event.name);
+                fprintf(f, ",\"args\":{\"value\":%.6f}}", event.value);
+            }
+        }
+
+        fprintf(f, "\n]}\n");
+
+        if (fclose(f) != 0)
+        {
+            HELIOS_LOG_ERROR("Failed to write trace: " + path);
+            return false;
+        }
+
+        HELIOS_LOG_INFO("Wrote trace: " + path);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void set_thread_name(const char* name)
+    {
+        ThreadState& state = thread_state();
+
+        std::lock_guard<std::mutex> lock(m_tracks_mutex);
+        state.track->name = name;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    std::weak_ptr<vk::Backend>                      m_backend;
+    std::thread::id                                 m_main_thread;
+    int64_t                                         m_epoch;
+    int64_t                                         m_calibration_cpu  = 0;
+    uint64_t                                        m_calibration_gpu  = 0;
+    float                                           m_timestamp_period = 1.0f;
+    std::atomic<uint32_t>                           m_mode             = CAPTURE_LIVE;
+    CaptureMode                                     m_requested_mode   = CAPTURE_LIVE;
+    uint32_t                                        m_frame_idx        = 0;
+    uint64_t                                        m_frame_number     = 0;
+    FrameBuffer                                     m_frame_buffers[BUFFER_COUNT];
+    std::vector<uint64_t>                           m_timestamps;
+    std::vector<ResolvedSample>                     m_resolved;
+    std::unordered_map<std::string, ResolvedSample> m_latest;
+    vk::CommandBuffer::Ptr                          m_cmd_buf = nullptr;
+    std::mutex                                      m_tracks_mutex;
+    std::vector<std::unique_ptr<Track>>             m_tracks;
+    Track                                           m_gpu_track;
+    std::vector<CounterEvent>                       m_counters;
+    std::mutex                                      m_counter_mutex;
+    std::vector<CounterEvent>                       m_counter_events;
+    size_t                                          m_counter_next = 0;
 };
 
+thread_local Profiler::ThreadState Profiler::t_thread_state;
+
 Profiler* g_profiler = nullptr;
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-ScopedProfile::ScopedProfile(std::string name) :
-    m_name(name)
+void initialize(vk::Backend::Ptr backend)
 {
-    begin_sample(m_name);
+    g_profiler = new Profiler(backend);
+    g_sampling_enabled.store(true, std::memory_order_relaxed);
+
+    set_thread_name("Main");
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-ScopedProfile::~ScopedProfile()
+void shutdown()
 {
-    end_sample(m_name);
+    g_sampling_enabled.store(false, std::memory_order_relaxed);
+
+    HELIOS_SAFE_DELETE(g_profiler);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void initialize(vk::Backend::Ptr backend)
+void begin_sample(const char* name)
 {
-    g_profiler = new Profiler(backend);
+    if (g_profiler && is_sampling_enabled())
+        g_profiler->begin_sample(name);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void end_sample(const char* name)
+{
+    if (g_profiler)
+        g_profiler->end_sample(name);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void shutdown() { HELIOS_SAFE_DELETE(g_profiler); }
+void begin_frame(vk::CommandBuffer::Ptr cmd_buf) { g_profiler->begin_frame(cmd_buf); }
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void end_frame() { g_profiler->end_frame(); }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void begin_sample(std::string name)
+void ui()
 {
-    g_profiler->begin_sample(name);
+    g_profiler->ui();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void end_sample(std::string name)
+void set_capture_mode(CaptureMode mode)
 {
-    g_profiler->end_sample(name);
+    g_profiler->m_requested_mode = mode;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void begin_frame(vk::CommandBuffer::Ptr cmd_buf) { g_profiler->begin_frame(cmd_buf); }
+CaptureMode capture_mode()
+{
+    return g_profiler->m_requested_mode;
+}
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void end_frame() { g_profiler->end_frame(); }
+bool export_trace(const std::string& path)
+{
+    return g_profiler->export_trace(path);
+}
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void ui()
+bool sample_time(const std::string& name, float& cpu_time, float& gpu_time)
 {
-    g_profiler->ui();
+    auto it = g_profiler->m_latest.find(name);
+
+    if (it == g_profiler->m_latest.end())
+        return false;
+
+    cpu_time = it->second.cpu_time;
+    gpu_time = it->second.gpu_time;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void set_counter(const char* name, double value)
+{
+    if (g_profiler && is_sampling_enabled())
+        g_profiler->set_counter(name, value);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+const char* intern(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(g_intern_mutex);
+
+    return g_interned_names.insert(name).first->c_str();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void set_thread_name(const char* name)
+{
+    if (g_profiler)
+        g_profiler->set_thread_name(name);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 } // namespace profiler
-} // namespace helios
\ No newline at end of file
+} // namespace helios
@@ -0,0 +1,156 @@
+#include <utility/sampler.h>
+#include <cmath>
+
+namespace helios
+{
+namespace sampler
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint32_t reverse_bits(uint32_t x)
+{
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint32_t laine_karras_permutation(uint32_t x, uint32_t seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint32_t sobol_dim1(uint32_t index)
+{
+    uint32_t result = 0;
+
+    for (uint32_t v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1)
+    {
+        if (index & 1u)
+            result ^= v;
+    }
+
+    return result;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float uint_to_unit_float(uint32_t x)
+{
+    return float(x >> 8) * (1.0f / 16777216.0f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float fract(float x)
+{
+    return x - std::floor(x);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static glm::vec2 blue_noise_offset(uint32_t pixel, uint32_t dimension)
+{
+    glm::vec2 p = glm::vec2(float(pixel >> 16), float(pixel & 0xffffu));
+
+    float x = fract(0.5f + glm::dot(p, glm::vec2(0.7548776662f, 0.5698402910f)) + float(dimension) * 0.6180339887f);
+    float y = fract(0.5f + glm::dot(glm::vec2(p.y, p.x), glm::vec2(0.7548776662f, 0.5698402910f)) + float(dimension) * 0.4142135623f);
+
+    return glm::vec2(x, y);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t hash(uint32_t seed)
+{
+    seed = (seed ^ 61) ^ (seed >> 16);
+    seed *= 9;
+    seed = seed ^ (seed >> 4);
+    seed *= 0x27d4eb2d;
+    seed = seed ^ (seed >> 15);
+    return seed;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t hash_combine(uint32_t seed, uint32_t v)
+{
+    return seed ^ (v + (seed << 6) + (seed >> 2));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed)
+{
+    x = reverse_bits(x);
+    x = laine_karras_permutation(x, seed);
+    x = reverse_bits(x);
+    return x;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec2 sobol_owen_2d(uint32_t index, uint32_t seed)
+{
+    index = nested_uniform_scramble(index, seed);
+
+    uint32_t x = nested_uniform_scramble(reverse_bits(index), hash_combine(seed, 0xa511e9b3u));
+    uint32_t y = nested_uniform_scramble(sobol_dim1(index), hash_combine(seed, 0x63d83595u));
+
+    return glm::vec2(uint_to_unit_float(x), uint_to_unit_float(y));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+State init(const glm::uvec2& pixel, uint32_t sample_idx, SamplerType type)
+{
+    State state;
+
+    state.pixel      = (pixel.x << 16) | (pixel.y & 0xffffu);
+    state.pixel_seed = hash(state.pixel);
+    state.sample_idx = sample_idx;
+    state.type       = type;
+
+    return state;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t bounce_dimension(uint32_t depth, uint32_t offset)
+{
+    return kDimBounceStart + depth * kDimsPerBounce + offset;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec2 sample_2d(const State& state, uint32_t dimension)
+{
+    if (state.type == SAMPLER_BLUE_NOISE)
+    {
+        glm::vec2 u = sobol_owen_2d(state.sample_idx, hash(dimension)) + blue_noise_offset(state.pixel, dimension);
+        return glm::vec2(fract(u.x), fract(u.y));
+    }
+    else
+        return sobol_owen_2d(state.sample_idx, hash_combine(state.pixel_seed, hash(dimension)));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+float sample_1d(const State& state, uint32_t dimension)
+{
+    return sample_2d(state, dimension).x;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace sampler
+} // namespace helios
@@ -144,6 +144,50 @@ std::string file_name_from_path(std::string filepath)
     return filename;
 }
 
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void write_json_string(FILE* f, const char* str)
+{
+    fputc('"', f);
+
+    for (const char* c = str; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            fprintf(f, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20)
+            fprintf(f, "\\u%04x", (unsigned char)*c);
+        else
+            fputc(*c, f);
+    }
+
+    fputc('"', f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool write_file_atomic(const std::string& path, const std::function<bool(const std::string& temp_path)>& write)
+{
+    std::string temp_path = path + ".tmp";
+
+    if (!write(temp_path))
+    {
+        HELIOS_LOG_ERROR("Failed to write file: " + temp_path);
+        remove(temp_path.c_str());
+        return false;
+    }
+
+    // rename() does not replace an existing file on Windows.
+    remove(path.c_str());
+
+    if (rename(temp_path.c_str(), path.c_str()) != 0)
+    {
+        HELIOS_LOG_ERROR("Failed to rename file: " + temp_path);
+        return false;
+    }
+
+    return true;
+}
+
 // -----------------------------------------------------------------------------------------------------------------------------------
 } // namespace utility
 } // namespace helios
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include <gfx/checkpoint.h>
+#include <stb_image_write.h>
+#include <filesystem>
+#include <stdio.h>
+
+// Merges the partial outputs of a split render (see the --job option of the viewer) into a single image.
+//
+// usage: helios_merge <output.hdr> <directory | part.hckp...>
+//
+// Every part accumulates an independent, globally indexed range of samples or tiles, so the merge is a per-pixel average weighted
+// by the number of samples each part contributed. If every pixel ends up with the same sample count and the render was not tiled,
+// a merged checkpoint is written next to the image so that the accumulation can be continued with --resume.
+
+using namespace helios;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void collect_parts(const char* arg, std::vector<std::string>& parts)
+{
+    if (std::filesystem::is_directory(arg))
+    {
+        for (auto& entry : std::filesystem::directory_iterator(arg))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".hckp")
+                parts.push_back(entry.path().string());
+        }
+    }
+    else
+        parts.push_back(arg);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, const char* argv[])
+{
+    if (argc < 3)
+    {
+        printf("usage: helios_merge <output.hdr> <directory | part.hckp...>\n");
+        return 1;
+    }
+
+    std::string              output_path = argv[1];
+    std::vector<std::string> parts;
+
+    for (int i = 2; i < argc; i++)
+        collect_parts(argv[i], parts);
+
+    if (parts.size() == 0)
+    {
+        printf("No parts to merge.\n");
+        return 1;
+    }
+
+    CheckpointHeader      first_header;
+    std::vector<double>   sum;
+    std::vector<uint32_t> total_counts;
+
+    for (uint32_t i = 0; i < parts.size(); i++)
+    {
+        CheckpointHeader   header;
+        std::vector<float> rgba;
+
+        if (!checkpoint::read(parts[i], header, rgba))
+            return 1;
+
+        if (i == 0)
+        {
+            first_header = header;
+            sum.resize(rgba.size(), 0.0);
+            total_counts.resize(size_t(header.width) * size_t(header.height), 0);
+        }
+        else if (header.fingerprint != first_header.fingerprint || header.width != first_header.width || header.height != first_header.height)
+        {
+            printf("%s was rendered from a different scene or resolution than %s.\n", parts[i].c_str(), parts[0].c_str());
+            return 1;
+        }
+
+        std::vector<uint32_t> counts = checkpoint::sample_counts(header);
+
+        for (size_t p = 0; p < counts.size(); p++)
+        {
+            for (size_t c = 0; c < 3; c++)
+                sum[p * 4 + c] += double(rgba[p * 4 + c]) * double(counts[p]);
+
+            total_counts[p] += counts[p];
+        }
+
+        printf("Merged %s (job %u of %u)\n", parts[i].c_str(), header.job_index + 1, header.job_count);
+    }
+
+    std::vector<float> merged(sum.size());
+    bool               uniform = true;
+
+    for (size_t p = 0; p < total_counts.size(); p++)
+    {
+        const double weight = total_counts[p] > 0 ? 1.0 / double(total_counts[p]) : 0.0;
+
+        for (size_t c = 0; c < 3; c++)
+            merged[p * 4 + c] = float(sum[p * 4 + c] * weight);
+
+        merged[p * 4 + 3] = 1.0f;
+
+        if (total_counts[p] != total_counts[0])
+            uniform = false;
+    }
+
+    if (!uniform)
+        printf("Warning: pixels received different sample counts, some parts may be missing or incomplete.\n");
+
+    if (stbi_write_hdr(output_path.c_str(), first_header.width, first_header.height, 4, merged.data()) == 0)
+    {
+        printf("Failed to write %s\n", output_path.c_str());
+        return 1;
+    }
+
+    printf("Wrote %s\n", output_path.c_str());
+
+    if (uniform && !first_header.tiled && total_counts[0] > 0)
+    {
+        CheckpointHeader header = first_header;
+
+        header.num_accumulated_samples = total_counts[0];
+        header.tile_idx                = 0;
+        header.sample_idx              = total_counts[0];
+        header.split_mode              = JOB_SPLIT_NONE;
+        header.job_index               = 0;
+        header.job_count               = 1;
+        header.job_samples             = total_counts[0];
+        header.sample_offset           = 0;
+
+        std::string checkpoint_path = std::filesystem::path(output_path).replace_extension(".hckp").string();
+
+        if (checkpoint::write(checkpoint_path, header, merged.data()))
+            printf("Wrote %s\n", checkpoint_path.c_str());
+    }
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
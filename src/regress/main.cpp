@@ -0,0 +1,829 @@
+#include <core/application.h>
+#include <gfx/checkpoint.h>
+#include <gfx/shader_cache.h>
+#include <utility/image_metrics.h>
+#include <utility/logger.h>
+#include <utility/macros.h>
+#include <utility/sampler.h>
+#include <utility/utility.h>
+#include <vk_mem_alloc.h>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <ctype.h>
+#include <stdio.h>
+
+// Renders a fixed corpus of scenes and compares the result against stored reference images, so that changes to the integrator that
+// alter the image are caught even when they are meant to be pure optimizations.
+//
+// usage: helios_regress [options] <corpus.txt>
+//
+// --references <dir>            : directory holding the reference images (default regress/references)
+// --output <dir>                : directory for the convergence curves and results.json (default regress/output)
+// --resolution <width> <height> : render resolution (default 512 512)
+// --update                      : render the references at their sample count instead of comparing against them
+// --max-rmse <value>            : RMSE tolerance, disabled by default
+// --max-relmse <value>          : relMSE tolerance (default 0.05)
+// --max-flip <value>            : mean FLIP tolerance (default 0.05)
+//
+// Every line of the corpus file holds a scene, the sample count to test at and the sample count of the reference, e.g.
+//
+//     scene/cornell_box.json 256 16384
+//
+// Lines starting with '#' are ignored. The samplers are seeded by pixel and sample index so repeated runs produce the same image on
+// the same driver. The accumulation is captured at every power of two up to the test sample count, which gives an error-versus-time
+// curve per scene: a change that makes the integrator faster but noisier shows up as a worse efficiency (relMSE * time) even though
+// time-to-spp improved.
+//
+// Before any scene is rendered the shader sampler in random.glsl is checked against its CPU mirror in utility/sampler.h, so that the
+// two can not drift apart.
+//
+// There is no GPU-less path in the renderer, so on CI without a GPU run it on a software Vulkan driver that supports ray tracing by
+// pointing VK_ICD_FILENAMES at its ICD manifest. The tool exits with 1 if any scene is out of tolerance.
+
+namespace helios
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+enum RegressPhase
+{
+    PHASE_LOAD,
+    PHASE_RENDER,
+    PHASE_DONE
+};
+
+struct RegressCase
+{
+    std::string scene;
+    uint32_t    spp;
+    uint32_t    reference_spp;
+};
+
+struct RegressConfig
+{
+    std::string corpus_path;
+    std::string references_path = "regress/references";
+    std::string output_path     = "regress/output";
+    uint32_t    width           = 512;
+    uint32_t    height          = 512;
+    bool        update          = false;
+    double      max_rmse        = -1.0;
+    double      max_rel_mse     = 0.05;
+    double      max_flip        = 0.05;
+};
+
+struct ConvergencePoint
+{
+    uint32_t samples;
+    double   time_ms;
+    double   rmse;
+    double   rel_mse;
+};
+
+struct CaseResults
+{
+    std::string                   scene;
+    uint32_t                      spp;
+    std::vector<ConvergencePoint> convergence;
+    double                        rmse    = 0.0;
+    double                        rel_mse = 0.0;
+    double                        flip    = 0.0;
+    double                        time_ms = 0.0;
+    bool                          passed  = false;
+    std::string                   error;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool load_corpus(const std::string& path, std::vector<RegressCase>& cases)
+{
+    std::ifstream f(path);
+
+    if (!f.is_open())
+    {
+        HELIOS_LOG_ERROR("Failed to open corpus: " + path);
+        return false;
+    }
+
+    std::string line;
+
+    while (std::getline(f, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream stream(line);
+        RegressCase        regress_case;
+
+        if (!(stream >> regress_case.scene))
+            continue;
+
+        if (!(stream >> regress_case.spp >> regress_case.reference_spp) || regress_case.spp == 0 || regress_case.reference_spp == 0)
+        {
+            HELIOS_LOG_ERROR("Invalid corpus entry: " + line);
+            return false;
+        }
+
+        cases.push_back(regress_case);
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Scenes in different directories often share a file name, so outputs are named after the whole scene path without the extension.
+static std::string case_name(const std::string& scene)
+{
+    std::string name = std::filesystem::path(scene).replace_extension().generic_string();
+
+    for (auto& c : name)
+    {
+        if (!isalnum((unsigned char)c) && c != '-' && c != '_')
+            c = '_';
+    }
+
+    return name;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+#define SAMPLER_CHECK_GROUP_SIZE 64 // Keep in sync with sampler_check.comp
+#define SAMPLER_CHECK_TYPES 2       // Keep in sync with sampler_check.comp
+#define SAMPLER_CHECK_WIDTH 16
+#define SAMPLER_CHECK_HEIGHT 16
+#define SAMPLER_CHECK_SAMPLES 64
+
+struct SamplerCheckConsts
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t num_samples;
+    uint32_t num_dimensions;
+};
+
+// Evaluates the camera dimensions and two bounces of every sample of a block of pixels with both sampler types on the GPU, and compares
+// them with the CPU mirror. Sobol samples must match exactly, blue noise samples within the rounding of their float offset.
+static bool check_sampler(vk::Backend::Ptr backend, ShaderCache::Ptr shader_cache)
+{
+    const uint32_t num_pixels     = SAMPLER_CHECK_WIDTH * SAMPLER_CHECK_HEIGHT;
+    const uint32_t num_dimensions = sampler::kDimBounceStart + 2 * sampler::kDimsPerBounce;
+    const size_t   num_values     = size_t(SAMPLER_CHECK_TYPES) * SAMPLER_CHECK_SAMPLES * num_pixels * num_dimensions;
+
+    vk::Buffer::Ptr samples = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(glm::vec2) * num_values, VMA_MEMORY_USAGE_GPU_TO_CPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+    vk::DescriptorSetLayout::Desc ds_layout_desc;
+
+    ds_layout_desc.add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+
+    vk::DescriptorSetLayout::Ptr ds_layout = vk::DescriptorSetLayout::create(backend, ds_layout_desc);
+    vk::DescriptorSet::Ptr       ds        = backend->allocate_descriptor_set(ds_layout);
+
+    VkDescriptorBufferInfo buffer_info;
+    HELIOS_ZERO_MEMORY(buffer_info);
+
+    buffer_info.buffer = samples->handle();
+    buffer_info.offset = 0;
+    buffer_info.range  = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet write_data;
+    HELIOS_ZERO_MEMORY(write_data);
+
+    write_data.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write_data.descriptorCount = 1;
+    write_data.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write_data.pBufferInfo     = &buffer_info;
+    write_data.dstBinding      = 0;
+    write_data.dstSet          = ds->handle();
+
+    vkUpdateDescriptorSets(backend->device(), 1, &write_data, 0, nullptr);
+
+    vk::PipelineLayout::Desc pl_desc;
+
+    pl_desc.add_descriptor_set_layout(ds_layout);
+    pl_desc.add_push_constant_range(VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SamplerCheckConsts));
+
+    vk::PipelineLayout::Ptr pipeline_layout = vk::PipelineLayout::create(backend, pl_desc);
+
+    vk::ComputePipeline::Desc pso_desc;
+
+    pso_desc.set_shader_stage(shader_cache->load("sampler_check.comp"), "main")
+        .set_pipeline_layout(pipeline_layout);
+
+    vk::ComputePipeline::Ptr pipeline = vk::ComputePipeline::create(backend, pso_desc);
+
+    SamplerCheckConsts consts;
+
+    consts.width          = SAMPLER_CHECK_WIDTH;
+    consts.height         = SAMPLER_CHECK_HEIGHT;
+    consts.num_samples    = SAMPLER_CHECK_SAMPLES;
+    consts.num_dimensions = num_dimensions;
+
+    vk::CommandBuffer::Ptr cmd_buf = backend->allocate_graphics_command_buffer(true);
+
+    vkCmdBindPipeline(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->handle());
+    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout->handle(), 0, 1, &ds->handle(), 0, nullptr);
+    vkCmdPushConstants(cmd_buf->handle(), pipeline_layout->handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SamplerCheckConsts), &consts);
+    vkCmdDispatch(cmd_buf->handle(), (num_pixels * SAMPLER_CHECK_SAMPLES + SAMPLER_CHECK_GROUP_SIZE - 1) / SAMPLER_CHECK_GROUP_SIZE, 1, 1);
+
+    vkEndCommandBuffer(cmd_buf->handle());
+
+    backend->flush_graphics({ cmd_buf });
+
+    samples->invalidate_mapped_data();
+
+    const glm::vec2* gpu_samples = (const glm::vec2*)samples->mapped_ptr();
+    const SamplerType types[]    = { SAMPLER_SOBOL, SAMPLER_BLUE_NOISE };
+    const char*       names[]    = { "Sobol", "blue noise" };
+
+    bool passed = true;
+
+    for (uint32_t type = 0; type < SAMPLER_CHECK_TYPES; type++)
+    {
+        uint32_t    mismatches = 0;
+        std::string first_mismatch;
+
+        for (uint32_t sample_idx = 0; sample_idx < SAMPLER_CHECK_SAMPLES; sample_idx++)
+        {
+            for (uint32_t pixel_idx = 0; pixel_idx < num_pixels; pixel_idx++)
+            {
+                const glm::uvec2     pixel = glm::uvec2(pixel_idx % SAMPLER_CHECK_WIDTH, pixel_idx / SAMPLER_CHECK_WIDTH);
+                const sampler::State state = sampler::init(pixel, sample_idx, types[type]);
+                const glm::vec2*     gpu   = gpu_samples + ((size_t(type) * SAMPLER_CHECK_SAMPLES + sample_idx) * num_pixels + pixel_idx) * num_dimensions;
+
+                for (uint32_t dimension = 0; dimension < num_dimensions; dimension++)
+                {
+                    const glm::vec2 cpu = sampler::sample_2d(state, dimension);
+
+                    bool match = true;
+
+                    for (int i = 0; i < 2; i++)
+                    {
+                        if (types[type] == SAMPLER_SOBOL)
+                            match = match && cpu[i] == gpu[dimension][i];
+                        else
+                        {
+                            // fract() of a value that rounded across an integer lands on the other end of [0, 1)
+                            const float error = std::abs(cpu[i] - gpu[dimension][i]);
+                            match             = match && std::min(error, 1.0f - error) <= 1e-5f;
+                        }
+                    }
+
+                    if (!match && mismatches++ == 0)
+                    {
+                        char message[256];
+                        snprintf(message, sizeof(message), "pixel (%u, %u), sample %u, dimension %u: CPU (%.9f, %.9f), GPU (%.9f, %.9f)", pixel.x, pixel.y, sample_idx, dimension, cpu.x, cpu.y, gpu[dimension].x, gpu[dimension].y);
+                        first_mismatch = message;
+                    }
+                }
+            }
+        }
+
+        if (mismatches > 0)
+        {
+            HELIOS_LOG_ERROR("The " + std::string(names[type]) + " sampler differs from its CPU mirror in " + std::to_string(mismatches) + " samples, first at " + first_mismatch);
+            passed = false;
+        }
+    }
+
+    if (passed)
+        HELIOS_LOG_INFO("The shader sampler matches its CPU mirror.");
+
+    return passed;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+class Regress : public Application
+{
+public:
+    Regress(const RegressConfig& config) :
+        m_config(config)
+    {
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    inline bool failed() { return m_failed; }
+
+protected:
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool init(int argc, const char* argv[]) override
+    {
+        if (!load_corpus(m_config.corpus_path, m_cases))
+            return false;
+
+        if (m_cases.size() == 0)
+        {
+            HELIOS_LOG_ERROR("The corpus is empty: " + m_config.corpus_path);
+            return false;
+        }
+
+        if (!check_sampler(m_vk_backend, m_renderer->shader_cache()))
+            m_failed = true;
+
+        std::error_code ec;
+
+        std::filesystem::create_directories(m_config.references_path, ec);
+        std::filesystem::create_directories(m_config.output_path, ec);
+
+        m_results.resize(m_cases.size());
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Loading and anything that waits on the GPU happens here rather than in update(), since this is called before the command buffer
+    // of the frame starts recording.
+    void gui() override
+    {
+        switch (m_phase)
+        {
+            case PHASE_LOAD:
+            {
+                if (load_case())
+                    m_phase = PHASE_RENDER;
+                else
+                {
+                    m_failed = true;
+                    next_case();
+                }
+
+                break;
+            }
+            case PHASE_RENDER:
+            {
+                // The final capture may be recorded a few frames after the last sample if the readback slots were busy.
+                if (m_renderer->path_integrator()->is_complete() && !m_renderer->is_accumulation_capture_pending())
+                {
+                    // Delivers the final capture.
+                    m_renderer->image_readback()->flush();
+
+                    if (m_config.update)
+                        write_reference();
+                    else
+                        compare();
+
+                    next_case();
+                }
+
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void update(vk::CommandBuffer::Ptr cmd_buffer) override
+    {
+        m_render_state.setup(m_width, m_height, cmd_buffer);
+
+        if (m_scene)
+            m_scene->update(m_render_state);
+
+        m_renderer->render(m_render_state);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void shutdown() override
+    {
+        m_renderer->set_accumulation_captures({}, nullptr);
+        m_scene.reset();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    Settings intial_settings() override
+    {
+        Settings settings;
+
+        settings.resizable = false;
+        settings.width     = m_config.width;
+        settings.height    = m_config.height;
+        settings.title     = "Helios Regress";
+
+        return settings;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+private:
+    inline RegressCase& current_case() { return m_cases[m_case_idx]; }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    inline CaseResults& current_results() { return m_results[m_case_idx]; }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    std::string reference_path(const RegressCase& regress_case)
+    {
+        return m_config.references_path + "/" + case_name(regress_case.scene) + ".hckp";
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // The reference of a scene is rendered with its own sample count as the limit, which the fingerprint includes.
+    uint64_t reference_fingerprint(const RegressCase& regress_case)
+    {
+        PathIntegrator::Ptr path_integrator = m_renderer->path_integrator();
+        const uint32_t      max_samples     = path_integrator->max_samples();
+
+        path_integrator->set_max_samples(regress_case.reference_spp);
+
+        const uint64_t fingerprint = checkpoint::fingerprint(m_render_state, path_integrator, m_width, m_height);
+
+        path_integrator->set_max_samples(max_samples);
+
+        return fingerprint;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool load_case()
+    {
+        RegressCase& regress_case = current_case();
+        CaseResults& results      = current_results();
+
+        results.scene = regress_case.scene;
+        results.spp   = m_config.update ? regress_case.reference_spp : regress_case.spp;
+
+        m_reference.clear();
+        m_final.clear();
+
+        if (!m_config.update)
+        {
+            CheckpointHeader header;
+
+            if (!checkpoint::read(reference_path(regress_case), header, m_reference))
+            {
+                results.error = "Missing reference, run with --update to create it.";
+                HELIOS_LOG_ERROR(regress_case.scene + ": " + results.error);
+                return false;
+            }
+
+            if (header.width != m_width || header.height != m_height)
+            {
+                results.error = "The reference was rendered at " + std::to_string(header.width) + "x" + std::to_string(header.height) + ".";
+                HELIOS_LOG_ERROR(regress_case.scene + ": " + results.error);
+                return false;
+            }
+
+            if (header.num_accumulated_samples != regress_case.reference_spp)
+            {
+                results.error = "The reference was rendered at " + std::to_string(header.num_accumulated_samples) + " spp, run with --update to recreate it.";
+                HELIOS_LOG_ERROR(regress_case.scene + ": " + results.error);
+                return false;
+            }
+
+            m_reference_fingerprint = header.fingerprint;
+        }
+
+        m_vk_backend->wait_idle();
+        m_scene.reset();
+        m_scene = m_resource_manager->load_scene(regress_case.scene);
+
+        if (!m_scene)
+        {
+            results.error = "Failed to load scene.";
+            HELIOS_LOG_ERROR(regress_case.scene + ": " + results.error);
+            return false;
+        }
+
+        HELIOS_LOG_INFO((m_config.update ? "Rendering reference for " : "Testing ") + regress_case.scene + " at " + std::to_string(results.spp) + " spp");
+
+        // References only need the final image, the test run is captured at every power of two to build the convergence curve.
+        std::vector<uint32_t> sample_counts;
+
+        if (!m_config.update)
+        {
+            for (uint32_t samples = 1; samples < results.spp; samples *= 2)
+                sample_counts.push_back(samples);
+        }
+
+        sample_counts.push_back(results.spp);
+
+        m_renderer->path_integrator()->set_max_samples(results.spp);
+        m_renderer->path_integrator()->restart_bake();
+        m_renderer->set_accumulation_captures(sample_counts, [this](const float* rgba, uint32_t width, uint32_t height, uint32_t num_samples) {
+            on_capture(rgba, width, height, num_samples);
+        });
+
+        m_render_start = std::chrono::steady_clock::now();
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Called on the readback worker thread. The time is taken first so that computing the metrics does not skew later points.
+    void on_capture(const float* rgba, uint32_t width, uint32_t height, uint32_t num_samples)
+    {
+        const double   time_ms = elapsed_ms(m_render_start);
+        const uint32_t spp     = current_results().spp;
+
+        if (!m_config.update)
+        {
+            ConvergencePoint point;
+
+            point.samples = num_samples;
+            point.time_ms = time_ms;
+            point.rmse    = image_metrics::rmse(rgba, m_reference.data(), width, height);
+            point.rel_mse = image_metrics::rel_mse(rgba, m_reference.data(), width, height);
+
+            std::lock_guard<std::mutex> lock(m_capture_mutex);
+            current_results().convergence.push_back(point);
+        }
+
+        if (num_samples == spp)
+        {
+            std::lock_guard<std::mutex> lock(m_capture_mutex);
+
+            m_final.assign(rgba, rgba + size_t(width) * size_t(height) * 4);
+            current_results().time_ms = time_ms;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void write_reference()
+    {
+        RegressCase& regress_case = current_case();
+        CaseResults& results      = current_results();
+
+        std::lock_guard<std::mutex> lock(m_capture_mutex);
+
+        if (m_final.size() == 0)
+        {
+            results.error = "The final image was not captured.";
+            HELIOS_LOG_ERROR(regress_case.scene + ": " + results.error);
+            m_failed = true;
+            return;
+        }
+
+        CheckpointHeader header;
+
+        header.width                   = m_width;
+        header.height                  = m_height;
+        header.num_accumulated_samples = regress_case.reference_spp;
+        header.tile_idx                = 0;
+        header.sample_idx              = regress_case.reference_spp;
+        header.fingerprint             = reference_fingerprint(regress_case);
+        header.tiled                   = false;
+        header.job_samples             = regress_case.reference_spp;
+        header.sample_offset           = 0;
+
+        if (checkpoint::write(reference_path(regress_case), header, m_final.data()))
+        {
+            results.passed = true;
+            HELIOS_LOG_INFO("Wrote reference: " + reference_path(regress_case));
+        }
+        else
+        {
+            results.error = "Failed to write the reference.";
+            m_failed      = true;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void compare()
+    {
+        RegressCase& regress_case = current_case();
+        CaseResults& results      = current_results();
+
+        std::lock_guard<std::mutex> lock(m_capture_mutex);
+
+        if (m_final.size() == 0)
+        {
+            results.error = "The final image was not captured.";
+            HELIOS_LOG_ERROR(regress_case.scene + ": " + results.error);
+            m_failed = true;
+            return;
+        }
+
+        // The scene is only known to the render state once it has been updated, so the fingerprint is checked here rather than on load.
+        if (reference_fingerprint(regress_case) != m_reference_fingerprint)
+        {
+            results.error = "The reference was rendered with a different scene or settings, run with --update to recreate it.";
+            HELIOS_LOG_ERROR(regress_case.scene + ": " + results.error);
+            m_failed = true;
+            return;
+        }
+
+        results.rmse    = image_metrics::rmse(m_final.data(), m_reference.data(), m_width, m_height);
+        results.rel_mse = image_metrics::rel_mse(m_final.data(), m_reference.data(), m_width, m_height);
+        results.flip    = image_metrics::flip(m_final.data(), m_reference.data(), m_width, m_height);
+
+        results.passed = true;
+
+        if (m_config.max_rmse >= 0.0 && results.rmse > m_config.max_rmse)
+            results.passed = false;
+
+        if (m_config.max_rel_mse >= 0.0 && results.rel_mse > m_config.max_rel_mse)
+            results.passed = false;
+
+        if (m_config.max_flip >= 0.0 && results.flip > m_config.max_flip)
+            results.passed = false;
+
+        char summary[256];
+        snprintf(summary, sizeof(summary), "%s: rmse %.6f, relMSE %.6f, FLIP %.6f", regress_case.scene.c_str(), results.rmse, results.rel_mse, results.flip);
+
+        if (results.passed)
+            HELIOS_LOG_INFO(std::string(summary) + " [passed]");
+        else
+        {
+            HELIOS_LOG_ERROR(std::string(summary) + " [failed]");
+            m_failed = true;
+        }
+
+        write_convergence(results);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void write_convergence(CaseResults& results)
+    {
+        std::sort(results.convergence.begin(), results.convergence.end(), [](const ConvergencePoint& a, const ConvergencePoint& b) {
+            return a.samples < b.samples;
+        });
+
+        std::string path = m_config.output_path + "/" + case_name(results.scene) + "_convergence.csv";
+        FILE*       f    = fopen(path.c_str(), "w");
+
+        if (!f)
+        {
+            HELIOS_LOG_ERROR("Failed to open convergence curve for writing: " + path);
+            return;
+        }
+
+        fprintf(f, "samples,time_ms,rmse,rel_mse,efficiency\n");
+
+        for (auto& point : results.convergence)
+            fprintf(f, "%u,%.4f,%.8f,%.8f,%.8f\n", point.samples, point.time_ms, point.rmse, point.rel_mse, point.rel_mse * point.time_ms);
+
+        fclose(f);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void next_case()
+    {
+        m_renderer->set_accumulation_captures({}, nullptr);
+
+        m_case_idx++;
+
+        if (m_case_idx == m_cases.size())
+        {
+            if (!m_config.update)
+                write_results();
+
+            m_phase = PHASE_DONE;
+            request_exit();
+        }
+        else
+            m_phase = PHASE_LOAD;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void write_results()
+    {
+        std::string path = m_config.output_path + "/results.json";
+        FILE*       f    = fopen(path.c_str(), "w");
+
+        if (!f)
+        {
+            HELIOS_LOG_ERROR("Failed to open regression results for writing: " + path);
+            return;
+        }
+
+        fprintf(f, "{\n");
+        fprintf(f, "    \"config\": { \"width\": %u, \"height\": %u, \"max_rmse\": %.6f, \"max_rel_mse\": %.6f, \"max_flip\": %.6f },\n", m_width, m_height, m_config.max_rmse, m_config.max_rel_mse, m_config.max_flip);
+        fprintf(f, "    \"scenes\": [\n");
+
+        for (uint32_t i = 0; i < m_results.size(); i++)
+        {
+            CaseResults& results = m_results[i];
+
+            fprintf(f, "        {\n");
+            fprintf(f, "            \"path\": ");
+            utility::write_json_string(f, results.scene.c_str());
+            fprintf(f, ",\n");
+            fprintf(f, "            \"spp\": %u,\n", results.spp);
+            fprintf(f, "            \"passed\": %s,\n", results.passed ? "true" : "false");
+
+            if (results.error.length() > 0)
+            {
+                fprintf(f, "            \"error\": ");
+                utility::write_json_string(f, results.error.c_str());
+                fprintf(f, ",\n");
+            }
+
+            fprintf(f, "            \"rmse\": %.8f,\n", results.rmse);
+            fprintf(f, "            \"rel_mse\": %.8f,\n", results.rel_mse);
+            fprintf(f, "            \"flip\": %.8f,\n", results.flip);
+            fprintf(f, "            \"time_ms\": %.4f,\n", results.time_ms);
+            fprintf(f, "            \"efficiency\": %.8f\n", results.rel_mse * results.time_ms);
+            fprintf(f, "        }%s\n", i == m_results.size() - 1 ? "" : ",");
+        }
+
+        fprintf(f, "    ]\n");
+        fprintf(f, "}\n");
+
+        fclose(f);
+
+        HELIOS_LOG_INFO("Wrote regression results: " + path);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+private:
+    RegressConfig                         m_config;
+    RegressPhase                          m_phase    = PHASE_LOAD;
+    uint32_t                              m_case_idx = 0;
+    bool                                  m_failed   = false;
+    std::vector<RegressCase>              m_cases;
+    std::vector<CaseResults>              m_results;
+    std::vector<float>                    m_reference;
+    std::vector<float>                    m_final;
+    uint64_t                              m_reference_fingerprint = 0;
+    std::mutex                            m_capture_mutex;
+    std::chrono::steady_clock::time_point m_render_start;
+    RenderState                           m_render_state;
+    Scene::Ptr                            m_scene;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace helios
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, const char* argv[])
+{
+    helios::RegressConfig config;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--references" && i + 1 < argc)
+            config.references_path = argv[++i];
+        else if (arg == "--output" && i + 1 < argc)
+            config.output_path = argv[++i];
+        else if (arg == "--resolution" && i + 2 < argc)
+        {
+            config.width  = std::stoi(argv[i + 1]);
+            config.height = std::stoi(argv[i + 2]);
+            i += 2;
+        }
+        else if (arg == "--update")
+            config.update = true;
+        else if (arg == "--max-rmse" && i + 1 < argc)
+            config.max_rmse = std::stod(argv[++i]);
+        else if (arg == "--max-relmse" && i + 1 < argc)
+            config.max_rel_mse = std::stod(argv[++i]);
+        else if (arg == "--max-flip" && i + 1 < argc)
+            config.max_flip = std::stod(argv[++i]);
+        else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0)
+        {
+            printf("usage: helios_regress [--references <dir>] [--output <dir>] [--resolution <width> <height>] [--update] [--max-rmse <value>] [--max-relmse <value>] [--max-flip <value>] <corpus.txt>\n");
+            return 1;
+        }
+        else
+            config.corpus_path = arg;
+    }
+
+    if (config.corpus_path.empty())
+    {
+        printf("usage: helios_regress [--references <dir>] [--output <dir>] [--resolution <width> <height>] [--update] [--max-rmse <value>] [--max-relmse <value>] [--max-flip <value>] <corpus.txt>\n");
+        return 1;
+    }
+
+    helios::Regress app(config);
+
+    int result = app.run(argc, argv);
+
+    if (result == 0 && app.failed())
+        return 1;
+
+    return result;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -3,6 +3,7 @@
 #include <imgui_internal.h>
 #include <utility/imgui_plot.h>
 #include <utility/profiler.h>
+#include <utility/logger.h>
 #include <filesystem>
 #include <nfd.h>
 
@@ -13,6 +14,16 @@ static const std::vector<std::string> tone_map_operators = {
     "Reinhard"
 };
 
+static const std::vector<std::string> sampler_types = {
+    "Sobol",
+    "Blue Noise"
+};
+
+static const std::vector<std::string> integrator_modes = {
+    "Path Trace",
+    "Direct Lighting"
+};
+
 static const std::vector<std::string> output_buffers = {
     "Albedo",
     "Normals",
@@ -31,6 +42,63 @@ protected:
     {
         m_string_buffer.reserve(256);
 
+        // --checkpoint <path> <sample interval>                : periodically write checkpoints of the accumulation
+        // --resume <path>                                     : continue an accumulation from a checkpoint
+        // --job <directory> <tiles|samples> <index> <count>   : render one share of a split render into <directory>/part_<index>.hckp and exit
+        // --trace <path>                                      : keep a ring buffer of profiler events and write it as a Chrome trace on exit
+        // --ray-stats                                         : count rays in the shaders, a job also writes <directory>/part_<index>.json
+        // --memory-budget <megabytes>                         : evict cold resources to stay within the given amount of device memory
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+
+            if (arg == "--checkpoint" && i + 2 < argc)
+            {
+                m_renderer->set_checkpoint_interval(std::stoi(argv[i + 2]), argv[i + 1]);
+                i += 2;
+            }
+            else if (arg == "--resume" && i + 1 < argc)
+            {
+                m_renderer->resume_from_checkpoint(argv[i + 1]);
+                i += 1;
+            }
+            else if (arg == "--job" && i + 4 < argc)
+            {
+                std::string  mode_str = argv[i + 2];
+                JobSplitMode mode;
+
+                if (mode_str == "samples")
+                    mode = JOB_SPLIT_SAMPLES;
+                else if (mode_str == "tiles")
+                    mode = JOB_SPLIT_TILES;
+                else
+                {
+                    HELIOS_LOG_ERROR("Unknown job split mode: " + mode_str + ", usage: --job <directory> <tiles|samples> <index> <count>");
+                    return false;
+                }
+
+                uint32_t index = std::stoi(argv[i + 3]);
+
+                m_renderer->path_integrator()->set_job(mode, index, std::stoi(argv[i + 4]));
+                m_renderer->set_job_output(std::string(argv[i + 1]) + "/part_" + std::to_string(index) + ".hckp");
+                m_job_report_path = std::string(argv[i + 1]) + "/part_" + std::to_string(index) + ".json";
+                i += 4;
+            }
+            else if (arg == "--trace" && i + 1 < argc)
+            {
+                m_trace_path = argv[i + 1];
+                profiler::set_capture_mode(profiler::CAPTURE_RING);
+                i += 1;
+            }
+            else if (arg == "--ray-stats")
+                m_renderer->path_integrator()->set_ray_statistics_enabled(true);
+            else if (arg == "--memory-budget" && i + 1 < argc)
+            {
+                m_resource_manager->set_memory_budget(VkDeviceSize(std::stoull(argv[i + 1])) * 1024 * 1024);
+                i += 1;
+            }
+        }
+
         if (std::filesystem::exists("assets/scene/default.json"))
             m_scene = m_resource_manager->load_scene("scene/default.json");
         else
@@ -47,11 +115,13 @@ protected:
 
                 m_vk_backend->queue_object_deletion(m_scene);
 
-                m_scene = m_resource_manager->load_scene(path);
+                m_scene_load = m_resource_manager->load_scene_async(path);
 
-                if (!m_scene)
+                if (!m_scene_load)
                     return false;
 
+                m_scene = m_scene_load->scene();
+
                 set_default_camera_orientation();
             }
             else
@@ -69,10 +139,23 @@ protected:
 
         m_render_state.setup(m_width, m_height, cmd_buffer);
 
+        m_resource_manager->reload_changed_resources();
+        m_resource_manager->update_scene_loads();
+
+        if (m_scene_load && m_scene_load->is_complete())
+            m_scene_load = nullptr;
+
         if (m_scene)
+        {
             m_scene->update(m_render_state);
+            m_resource_manager->update_residency(m_render_state);
+        }
 
         m_renderer->render(m_render_state);
+
+        // The readback is flushed when the renderer shuts down, so the job output is complete once the process exits.
+        if (m_renderer->is_job_output_requested())
+            request_exit();
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
@@ -120,12 +203,20 @@ protected:
 
                     m_vk_backend->queue_object_deletion(m_scene);
 
-                    m_scene = m_resource_manager->load_scene(path);
+                    m_scene_load = m_resource_manager->load_scene_async(path);
+                    m_scene      = m_scene_load ? m_scene_load->scene() : nullptr;
 
                     if (m_scene)
                         set_default_camera_orientation();
                 }
             }
+
+            if (m_scene_load)
+            {
+                std::string overlay_text = std::to_string(m_scene_load->num_loaded_meshes()) + " / " + std::to_string(m_scene_load->num_meshes()) + " Meshes";
+
+                ImGui::ProgressBar(m_scene_load->progress(), ImVec2(ImGui::GetContentRegionAvail().x, 0.0f), overlay_text.c_str());
+            }
         }
         if (ImGui::CollapsingHeader("Bake"))
         {
@@ -155,10 +246,45 @@ protected:
                     m_renderer->save_image_to_disk(path + ".png");
                 }
             }
+
+            if (ImGui::Button("Save Checkpoint", ImVec2(region.x, 30.0f)))
+            {
+                nfdchar_t*  out_path = NULL;
+                nfdresult_t result   = NFD_SaveDialog("hckp", NULL, &out_path);
+
+                if (result == NFD_OKAY)
+                {
+                    std::string path;
+                    path.resize(strlen(out_path));
+                    strcpy(path.data(), out_path);
+                    free(out_path);
+
+                    m_renderer->save_checkpoint(path + ".hckp");
+                }
+            }
+
+            if (ImGui::Button("Resume From Checkpoint", ImVec2(region.x, 30.0f)))
+            {
+                nfdchar_t*  out_path = NULL;
+                nfdresult_t result   = NFD_OpenDialog("hckp", NULL, &out_path);
+
+                if (result == NFD_OKAY)
+                {
+                    std::string path;
+                    path.resize(strlen(out_path));
+                    strcpy(path.data(), out_path);
+                    free(out_path);
+
+                    m_renderer->resume_from_checkpoint(path);
+                }
+            }
         }
         if (ImGui::CollapsingHeader("Profiler"))
             profiler_gui();
 
+        if (ImGui::CollapsingHeader("Ray Statistics"))
+            ray_statistics_gui();
+
         if (ImGui::CollapsingHeader("Settings"))
         {
             bool tiled = m_renderer->path_integrator()->is_tiled();
@@ -214,6 +340,50 @@ protected:
                 m_renderer->path_integrator()->restart_bake();
             }
 
+            if (ImGui::BeginCombo("Sampler", sampler_types[m_renderer->path_integrator()->sampler_type()].c_str()))
+            {
+                for (uint32_t i = 0; i < sampler_types.size(); i++)
+                {
+                    const bool is_selected = (i == m_renderer->path_integrator()->sampler_type());
+
+                    if (ImGui::Selectable(sampler_types[i].c_str(), is_selected))
+                    {
+                        m_renderer->path_integrator()->set_sampler_type((SamplerType)i);
+                        m_renderer->path_integrator()->restart_bake();
+                    }
+
+                    if (is_selected)
+                        ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
+            }
+
+            if (ImGui::BeginCombo("Integrator", integrator_modes[m_renderer->path_integrator()->integrator_mode()].c_str()))
+            {
+                for (uint32_t i = 0; i < integrator_modes.size(); i++)
+                {
+                    const bool is_selected = (i == m_renderer->path_integrator()->integrator_mode());
+
+                    if (ImGui::Selectable(integrator_modes[i].c_str(), is_selected))
+                    {
+                        m_renderer->path_integrator()->set_integrator_mode((IntegratorMode)i);
+                        m_renderer->path_integrator()->restart_bake();
+                    }
+
+                    if (is_selected)
+                        ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
+            }
+
+            bool visualize_nans = m_renderer->path_integrator()->visualize_nans();
+
+            if (ImGui::Checkbox("Visualize NaNs", &visualize_nans))
+            {
+                m_renderer->path_integrator()->set_visualize_nans(visualize_nans);
+                m_renderer->path_integrator()->restart_bake();
+            }
+
             if (ImGui::BeginCombo("Tone Map Operator", tone_map_operators[m_renderer->tone_map_operator()].c_str()))
             {
                 for (uint32_t i = 0; i < tone_map_operators.size(); i++)
@@ -249,6 +419,12 @@ protected:
 
     void shutdown() override
     {
+        if (!m_job_report_path.empty() && m_renderer->path_integrator()->ray_statistics_enabled())
+            write_job_report();
+
+        if (!m_trace_path.empty())
+            profiler::export_trace(m_trace_path);
+
         m_scene.reset();
     }
 
@@ -404,14 +580,119 @@ private:
 
         profiler::ui();
 
+        if (profiler::capture_mode() == profiler::CAPTURE_RING || profiler::capture_mode() == profiler::CAPTURE_FULL)
+        {
+            ImGui::Spacing();
+
+            if (ImGui::Button("Export Trace"))
+            {
+                nfdchar_t*  out_path = NULL;
+                nfdresult_t result   = NFD_SaveDialog("json", NULL, &out_path);
+
+                if (result == NFD_OKAY)
+                {
+                    std::string path;
+                    path.resize(strlen(out_path));
+                    strcpy(path.data(), out_path);
+                    free(out_path);
+
+                    profiler::export_trace(path + ".json");
+                }
+            }
+        }
+
+        ImGui::Spacing();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void ray_statistics_gui()
+    {
+        ImGui::Spacing();
+
+        bool enabled = m_renderer->path_integrator()->ray_statistics_enabled();
+
+        if (ImGui::Checkbox("Collect Ray Statistics", &enabled))
+            m_renderer->path_integrator()->set_ray_statistics_enabled(enabled);
+
+        if (!enabled)
+            return;
+
+        const RayStatistics& launch = m_renderer->path_integrator()->ray_statistics();
+        const RayStatistics& bake   = m_renderer->path_integrator()->bake_ray_statistics();
+
+        ImGui::Text("Launch: %.3f ms", launch.gpu_time);
+        ImGui::Text("Primary Rays: %llu (%.2f Mrays/s)", (unsigned long long)launch.counters[RAY_COUNTER_PRIMARY], launch.mrays_per_second(RAY_COUNTER_PRIMARY));
+        ImGui::Text("Shadow Rays: %llu (%.2f Mrays/s)", (unsigned long long)launch.counters[RAY_COUNTER_SHADOW], launch.mrays_per_second(RAY_COUNTER_SHADOW));
+        ImGui::Text("Indirect Rays: %llu (%.2f Mrays/s)", (unsigned long long)launch.counters[RAY_COUNTER_INDIRECT], launch.mrays_per_second(RAY_COUNTER_INDIRECT));
+        ImGui::Text("Total Rays: %llu (%.2f Mrays/s)", (unsigned long long)launch.total_rays(), launch.mrays_per_second(launch.total_rays()));
+        ImGui::Text("Any-Hit Invocations: %llu", (unsigned long long)launch.counters[RAY_COUNTER_ANY_HIT]);
+        ImGui::Text("Russian Roulette Terminations: %llu", (unsigned long long)launch.counters[RAY_COUNTER_RUSSIAN_ROULETTE]);
+
+        float histogram[RAY_STATISTICS_BOUNCE_BINS];
+
+        for (uint32_t i = 0; i < RAY_STATISTICS_BOUNCE_BINS; i++)
+            histogram[i] = float(launch.counters[RAY_COUNTER_BOUNCE_HISTOGRAM + i]);
+
+        const int32_t num_bins = std::min(m_renderer->path_integrator()->max_ray_bounces(), uint32_t(RAY_STATISTICS_BOUNCE_BINS));
+
+        ImGui::PlotHistogram("Hits per Bounce", histogram, num_bins, 0, nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 80.0f));
+
+        ImGui::Separator();
+
+        ImGui::Text("Bake: %u launches, %.3f ms", bake.num_launches, bake.gpu_time);
+        ImGui::Text("Bake Total Rays: %llu (%.2f Mrays/s)", (unsigned long long)bake.total_rays(), bake.mrays_per_second(bake.total_rays()));
+
         ImGui::Spacing();
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
+    void write_job_report()
+    {
+        m_renderer->path_integrator()->flush_ray_statistics();
+
+        const RayStatistics& bake = m_renderer->path_integrator()->bake_ray_statistics();
+
+        FILE* f = fopen(m_job_report_path.c_str(), "w");
+
+        if (!f)
+        {
+            HELIOS_LOG_ERROR("Failed to open job report for writing: " + m_job_report_path);
+            return;
+        }
+
+        fprintf(f, "{\n");
+        fprintf(f, "    \"launches\": %u,\n", bake.num_launches);
+        fprintf(f, "    \"gpu_time_ms\": %.4f,\n", bake.gpu_time);
+        fprintf(f, "    \"primary_rays\": %llu,\n", (unsigned long long)bake.counters[RAY_COUNTER_PRIMARY]);
+        fprintf(f, "    \"shadow_rays\": %llu,\n", (unsigned long long)bake.counters[RAY_COUNTER_SHADOW]);
+        fprintf(f, "    \"indirect_rays\": %llu,\n", (unsigned long long)bake.counters[RAY_COUNTER_INDIRECT]);
+        fprintf(f, "    \"any_hit_invocations\": %llu,\n", (unsigned long long)bake.counters[RAY_COUNTER_ANY_HIT]);
+        fprintf(f, "    \"russian_roulette_terminations\": %llu,\n", (unsigned long long)bake.counters[RAY_COUNTER_RUSSIAN_ROULETTE]);
+        fprintf(f, "    \"primary_mrays_per_sec\": %.4f,\n", bake.mrays_per_second(RAY_COUNTER_PRIMARY));
+        fprintf(f, "    \"shadow_mrays_per_sec\": %.4f,\n", bake.mrays_per_second(RAY_COUNTER_SHADOW));
+        fprintf(f, "    \"indirect_mrays_per_sec\": %.4f,\n", bake.mrays_per_second(RAY_COUNTER_INDIRECT));
+        fprintf(f, "    \"total_mrays_per_sec\": %.4f,\n", bake.mrays_per_second(bake.total_rays()));
+        fprintf(f, "    \"bounce_histogram\": [");
+
+        for (uint32_t i = 0; i < RAY_STATISTICS_BOUNCE_BINS; i++)
+            fprintf(f, "%s%llu", i == 0 ? "" : ", ", (unsigned long long)bake.counters[RAY_COUNTER_BOUNCE_HISTOGRAM + i]);
+
+        fprintf(f, "]\n");
+        fprintf(f, "}\n");
+
+        fclose(f);
+
+        HELIOS_LOG_INFO("Wrote job report: " + m_job_report_path + " (" + std::to_string(bake.mrays_per_second(bake.total_rays())) + " Mrays/s)");
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
 private:
     RenderState     m_render_state;
     Scene::Ptr      m_scene;
+    SceneLoad::Ptr  m_scene_load;
     bool            m_show_gui           = true;
     bool            m_mouse_look         = false;
     float           m_camera_yaw         = 0.0f;
@@ -423,6 +704,8 @@ private:
     float           m_smooth_frametime   = 0.0f;
     int32_t         m_num_debug_rays     = 32;
     std::string     m_string_buffer;
+    std::string     m_trace_path;
+    std::string     m_job_report_path;
     CameraNode::Ptr m_current_camera;
 };
 } // namespace helios